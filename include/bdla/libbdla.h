@@ -33,6 +33,8 @@ SOFTWARE.
 # endif
 #endif 
 #include <assert.h>
+#include <stddef.h>
+#include <stdint.h>
 
 typedef struct {
 	int dims[2];
@@ -44,6 +46,99 @@ typedef struct {
 	float *arr;
 } bdla_Vxf;
 
+/* Compressed sparse row matrix. Row i holds the entries
+arr[row_ptr[i]] to arr[row_ptr[i+1] - 1], with column indices in col_idx
+sorted in ascending order. */
+typedef struct {
+	int dims[2];
+	int nnz;
+	int *row_ptr;
+	int *col_idx;
+	float *arr;
+} bdla_SMxf;
+
+/* 16 bit floating point formats. */
+typedef enum {
+	BDLA_HALF_FP16,		/* IEEE binary16: 11 bit significand, magnitudes to 65504. */
+	BDLA_HALF_BF16		/* bfloat16: float's range with an 8 bit significand. */
+} bdla_HalfFormat;
+
+/* Row-major matrix stored as 16 bit floats. Arithmetic widens each entry
+to float and accumulates in float, so only storage loses precision. Halves
+the memory traffic of matvecs on matrices that can stand that. */
+typedef struct {
+	int dims[2];
+	bdla_HalfFormat format;
+	uint16_t *arr;
+} bdla_HMxf;
+
+/* Row-major matrix quantised to 8 bits with a float scale per row, for
+approximate products at a quarter of the memory traffic:
+A[i][j] ~= scales[i] * arr[i * dims[1] + j], with arr in [-127, 127]. */
+typedef struct {
+	int dims[2];
+	int8_t *arr;
+	float *scales;
+} bdla_QMxf;
+
+/* How far a quantised matrix Q is from the A it was made from. For any x,
+|(A x - Q x)_i| <= max_abs * ||x||_1. */
+typedef struct {
+	float max_abs;			/* Largest |A - Q| over all entries. */
+	float rel_frobenius;	/* ||A - Q||_F / ||A||_F. */
+} bdla_QuantError;
+
+/* A batch of count equally sized row-major matrices held in one buffer.
+Matrix i starts at arr + i * stride. A batch of vectors is a batch of
+single column matrices. */
+typedef struct {
+	int dims[2];
+	int count;
+	int stride;
+	float *arr;
+} bdla_BMxf;
+
+/* Streaming covariance of samples of length dim. Samples are buffered into
+a block and each full block is folded in with one syrk, after centring it
+on its own mean. Blocks are combined with the running mean and centred sum
+of squares in double, so the count can run to billions without the sums
+cancelling. */
+typedef struct {
+	int dim;
+	int block;			/* Samples per block. */
+	int buffered;		/* Samples in buf, not yet folded in. */
+	int64_t count;		/* Samples folded in. */
+	float *buf;			/* block x dim. */
+	float *gram;		/* dim x dim. */
+	double *mean;		/* dim, then dim more for a block's mean. */
+	double *m2;			/* Lower triangle of sum (x - mean)(x - mean)^T, dim x dim. */
+} bdla_Covf;
+
+/* Fixed size row-major matrices and vectors for stack allocation. */
+typedef struct {
+	float arr[4];
+} bdla_M2f;
+
+typedef struct {
+	float arr[2];
+} bdla_V2f;
+
+typedef struct {
+	float arr[9];
+} bdla_M3f;
+
+typedef struct {
+	float arr[3];
+} bdla_V3f;
+
+typedef struct {
+	float arr[16];
+} bdla_M4f;
+
+typedef struct {
+	float arr[4];
+} bdla_V4f;
+
 typedef enum {
 	BDLA_GOOD = 0,
 	BDLA_DIMENSION_MISMATCH = -1,
@@ -66,16 +161,157 @@ typedef enum {
 	BDLA_MATRIX_SQUARE
 } bdla_MatrixProperty;
 
+typedef enum {
+	BDLA_NO_TRANS,
+	BDLA_TRANS
+} bdla_Transpose;
+
+/* Where the pages of a large array are placed on NUMA machines. */
+typedef enum {
+	BDLA_NUMA_DEFAULT,		/* With the thread that creates the array. */
+	BDLA_NUMA_FIRST_TOUCH,	/* With the threads that work on their rows. */
+	BDLA_NUMA_INTERLEAVE	/* Round robin over every node. */
+} bdla_NumaPolicy;
+
+/* Whether a large array asks for transparent huge pages, so that walking
+down its columns doesn't miss the TLB on every row. */
+typedef enum {
+	BDLA_PAGES_DEFAULT,		/* Huge at or above the bdla_hugepage_threshold size. */
+	BDLA_PAGES_SMALL,
+	BDLA_PAGES_HUGE
+} bdla_PagePolicy;
+
+typedef struct {
+	size_t requested;	/* Bytes ever allocated asking for huge pages. */
+	size_t backed;		/* Bytes of the whole process on huge pages now. */
+} bdla_HugePageStats;
+
+/* What an iterative linear solver measures to decide it has converged. */
+typedef enum {
+	BDLA_CONVERGE_RESIDUAL,	/* |b - A x| <= max(atol, rtol |b|). */
+	BDLA_CONVERGE_UPDATE	/* |x_k - x_k-1| <= max(atol, rtol |x_k|). No product by A. */
+} bdla_ConvergeTest;
+
+/* One iteration of an *_ext linear solver. The norms are negative on
+iterations that didn't measure them; see check_every. */
+typedef struct {
+	int iteration;			/* Counting from 1. */
+	float residual;			/* |b - A x|. */
+	float update;			/* |x_k - x_k-1|. */
+	double elapsed;			/* Wall clock seconds since the solve began. */
+} bdla_SolveRecord;
+
+/* Called after every iteration. Returning nonzero stops the solver. */
+typedef int(*bdla_SolveCallback)(const bdla_SolveRecord *record, void *data);
+
+/* The latest iterations, in a ring buffer of capacity records the caller
+owns. count is how many were ever written, so the newest is at
+(count - 1) % capacity; set it to 0 before each solve. */
+typedef struct {
+	bdla_SolveRecord *records;
+	int capacity;
+	int count;
+} bdla_SolveHistory;
+
+/* Options for the *_ext linear solvers. Start from bdla_SolveOptions_default. */
+typedef struct {
+	float rtol;
+	float atol;
+	int max_iter;			/* 0 for no limit. */
+	int check_every;		/* Iterations between convergence tests. */
+	bdla_ConvergeTest test;
+	double time_limit;		/* Wall clock seconds, 0 for no limit. */
+	/* Telemetry. Each may be NULL, and with neither nothing is recorded. */
+	bdla_SolveCallback callback;
+	void *callback_data;
+	bdla_SolveHistory *history;
+} bdla_SolveOptions;
+
+typedef enum {
+	BDLA_STOP_CONVERGED,
+	BDLA_STOP_MAX_ITER,
+	BDLA_STOP_TIME_LIMIT,
+	BDLA_STOP_CALLBACK
+} bdla_StopReason;
+
+typedef struct {
+	bdla_StopReason reason;
+	int iterations;
+	float residual;			/* |b - A x| for the x returned. */
+} bdla_SolveResult;
+
+/* Lazy elementwise expressions. Operations on Vxf / Mxf operands are
+recorded as nodes and only run when evaluated, as a single fused pass
+over the data. Nodes only refer to earlier nodes, so the node list is
+already in evaluation order. */
+#define BDLA_EXPR_MAX_NODES 32
+
+typedef enum {
+	BDLA_EXPR_LEAF,
+	BDLA_EXPR_CONST,
+	BDLA_EXPR_PLUS,
+	BDLA_EXPR_MINUS,
+	BDLA_EXPR_EWMULT,
+	BDLA_EXPR_EWDIV,
+	BDLA_EXPR_MIN,
+	BDLA_EXPR_MAX,
+	BDLA_EXPR_FPLUS,
+	BDLA_EXPR_FMULT,
+	BDLA_EXPR_AXPY,
+	BDLA_EXPR_ABS,
+	BDLA_EXPR_SQRT
+} bdla_ExprOp;
+
+typedef enum {
+	BDLA_REDUCE_SUM,
+	BDLA_REDUCE_SUMSQ,
+	BDLA_REDUCE_MAXABS
+} bdla_Reduction;
+
+typedef struct {
+	bdla_ExprOp op;
+	int a, b;
+	float f;
+	const float *arr;
+} bdla_ExprNode;
+
+/* Errors while building are sticky: the failing call returns -1, any
+node built on it returns -1 too, and evaluation returns status. */
+typedef struct {
+	int count;
+	int len;
+	int dims[2];
+	bdla_Status status;
+	bdla_ExprNode nodes[BDLA_EXPR_MAX_NODES];
+} bdla_Expr;
+
+/* Handle to work submitted with one of the *_async functions. */
+typedef struct bdla_Task bdla_Task;
+typedef bdla_Status(*bdla_TaskFn)(void *arg);
+
 /* Mxf - Variable sized single precision matrix ----------------------------*/
 /* Creation & destruction */
 BDLA_EXPORT bdla_Mxf bdla_Mxf_create(int r, int c);
+/* A zeroed matrix whose pages are placed by policy. By default the
+calling thread zeroes it all, so it lands on that thread's node. With
+first touch, each thread's block of rows is zeroed by that thread, using
+the same split of rows as gemv and the other row-parallel kernels, so they
+read local memory; set BDLA_PIN_THREADS so that the threads stay put.
+Interleaving suits arrays every thread reads all of. */
+BDLA_EXPORT bdla_Mxf bdla_Mxf_create_numa(int r, int c, bdla_NumaPolicy policy);
+/* As bdla_Mxf_create_numa, choosing the page size too. */
+BDLA_EXPORT bdla_Mxf bdla_Mxf_create_ext(int r, int c,
+	bdla_NumaPolicy numa, bdla_PagePolicy pages);
 BDLA_EXPORT void bdla_Mxf_release(bdla_Mxf *mat);
 BDLA_EXPORT bdla_Mxf bdla_Mxf_copy(bdla_Mxf mat);
 /* Shape changing */
 BDLA_EXPORT void bdla_Mxf_transpose(bdla_Mxf A, bdla_Mxf *Y);
+BDLA_EXPORT bdla_Status bdla_Mxf_transpose_inplace(bdla_Mxf *A);
 BDLA_EXPORT bdla_Status bdla_Mxf_reshape(bdla_Mxf A, int rows, int cols, bdla_Mxf *Y);
 BDLA_EXPORT bdla_Status bdla_Mxf_resize(bdla_Mxf *A, int rows, int cols);
 BDLA_EXPORT bdla_Status bdla_Mxf_copyin(bdla_Mxf *dest, bdla_Mxf source);
+/* Views sharing A's memory, made without copying. Don't release them. */
+BDLA_EXPORT bdla_Status bdla_Mxf_asVxf(bdla_Mxf A, bdla_Vxf *y);
 /* Info */
 BDLA_EXPORT int bdla_Mxf_rows(bdla_Mxf A);
 BDLA_EXPORT int bdla_Mxf_cols(bdla_Mxf A);
@@ -88,6 +324,9 @@ BDLA_EXPORT int bdla_Mxf_istriupper(bdla_Mxf A);
 /* Manipulation */
 BDLA_EXPORT bdla_Status bdla_Mxf_fplus(bdla_Mxf A, float b, bdla_Mxf *Y);
 BDLA_EXPORT bdla_Status bdla_Mxf_diagplus(bdla_Mxf A, bdla_Vxf b, int k, bdla_Mxf *Y);
+BDLA_EXPORT bdla_Status bdla_Mxf_fdiagplus(bdla_Mxf A, float s, int k, bdla_Mxf *Y);
+BDLA_EXPORT bdla_Status bdla_Mxf_diagshift(bdla_Mxf *A, bdla_Vxf b, int k);
+BDLA_EXPORT bdla_Status bdla_Mxf_fdiagshift(bdla_Mxf *A, float s, int k);
 BDLA_EXPORT bdla_Status bdla_Mxf_plus(bdla_Mxf A, bdla_Mxf B, bdla_Mxf *Y);
 BDLA_EXPORT bdla_Status bdla_Mxf_fminus(bdla_Mxf A, float B, bdla_Mxf *Y);
 BDLA_EXPORT bdla_Status bdla_Mxf_diagminus(bdla_Mxf A, bdla_Vxf b, int k, bdla_Mxf *Y);
@@ -97,7 +336,24 @@ BDLA_EXPORT bdla_Status bdla_Mxf_ewmult(bdla_Mxf A, bdla_Mxf B, bdla_Mxf *Y);
 BDLA_EXPORT bdla_Status bdla_Mxf_mult(bdla_Mxf A, bdla_Mxf B, bdla_Mxf *Y);
 BDLA_EXPORT bdla_Status bdla_Mxf_mult_ext(bdla_Mxf A, bdla_MatrixProperty A_prop, 
 	bdla_Mxf B, bdla_MatrixProperty B_prop, bdla_Mxf *Y);
+BDLA_EXPORT bdla_Status bdla_Mxf_gemm(float alpha, bdla_Mxf A, bdla_Transpose A_trans,
+	bdla_Mxf B, bdla_Transpose B_trans, float beta, bdla_Mxf *Y);
+/* Rank updates. ger is Y += alpha a b^T. syr and syr2 are Y += alpha a a^T
+and Y += alpha (a b^T + b a^T), and syrk is Y = alpha op(A) op(A)^T + beta Y:
+A A^T, or A^T A when transposed. The symmetric ones only read and write the
+triangle of Y that Y_prop, BDLA_MATRIX_TRI_LOWER or _UPPER, names. */
+BDLA_EXPORT bdla_Status bdla_Mxf_ger(float alpha, bdla_Vxf a, bdla_Vxf b, bdla_Mxf *Y);
+BDLA_EXPORT bdla_Status bdla_Mxf_syr(float alpha, bdla_Vxf a,
+	bdla_MatrixProperty Y_prop, bdla_Mxf *Y);
+BDLA_EXPORT bdla_Status bdla_Mxf_syr2(float alpha, bdla_Vxf a, bdla_Vxf b,
+	bdla_MatrixProperty Y_prop, bdla_Mxf *Y);
+BDLA_EXPORT bdla_Status bdla_Mxf_syrk(float alpha, bdla_Mxf A, bdla_Transpose A_trans,
+	float beta, bdla_MatrixProperty Y_prop, bdla_Mxf *Y);
 BDLA_EXPORT bdla_Status bdla_Mxf_vmult(bdla_Mxf A, bdla_Vxf b, bdla_Vxf *y);
+BDLA_EXPORT bdla_Status bdla_Mxf_gemv(float alpha, bdla_Mxf A, bdla_Transpose A_trans,
+	bdla_Vxf x, float beta, bdla_Vxf *y);
+BDLA_EXPORT bdla_Status bdla_Mxf_residual(bdla_Mxf A, bdla_Vxf x, bdla_Vxf b,
+	bdla_Vxf *r, float *rnorm);
 BDLA_EXPORT bdla_Status bdla_Mxf_fdiv(bdla_Mxf A, float b, bdla_Mxf *Y);
 BDLA_EXPORT bdla_Status bdla_Mxf_ewdiv(bdla_Mxf A, bdla_Mxf B, bdla_Mxf *Y);
 BDLA_EXPORT bdla_Status bdla_Mxf_trisolve(bdla_Mxf A, bdla_MatrixProperty A_prop,
@@ -119,6 +375,7 @@ BDLA_EXPORT bdla_Status bdla_Mxf_diag(bdla_Mxf A, int k, bdla_Vxf *b);
 BDLA_EXPORT bdla_Status bdla_Mxf_writediag(bdla_Mxf A, int k, bdla_Vxf b);
 BDLA_EXPORT bdla_Status bdla_Mxf_tri(bdla_Mxf A, int k, bdla_MatrixProperty prop, bdla_Mxf *Y);
 BDLA_EXPORT bdla_Status bdla_Mxf_writetri(bdla_Mxf A, int k, bdla_MatrixProperty prop, bdla_Mxf Y);
+BDLA_EXPORT bdla_Status bdla_Mxf_tri_inplace(bdla_Mxf *A, int k, bdla_MatrixProperty prop);
 /* Setting to specific values */
 BDLA_EXPORT bdla_Status bdla_Mxf_zero(bdla_Mxf *A);
 BDLA_EXPORT bdla_Status bdla_Mxf_uniform(bdla_Mxf *A, float b);
@@ -128,11 +385,16 @@ BDLA_EXPORT bdla_Status bdla_Mxf_diagonal(bdla_Mxf *A, bdla_Vxf b, int k);
 /* Vxf - Variable sized single precision vector ----------------------------*/
 /* Creation */
 BDLA_EXPORT bdla_Vxf bdla_Vxf_create(int len);
+/* As bdla_Mxf_create_numa. */
+BDLA_EXPORT bdla_Vxf bdla_Vxf_create_numa(int len, bdla_NumaPolicy policy);
+BDLA_EXPORT bdla_Vxf bdla_Vxf_create_ext(int len, bdla_NumaPolicy numa, bdla_PagePolicy pages);
 BDLA_EXPORT void bdla_Vxf_release(bdla_Vxf *vec);
 BDLA_EXPORT bdla_Vxf bdla_Vxf_copy(bdla_Vxf vec);
 /* Shape changing */
 BDLA_EXPORT bdla_Status bdla_Vxf_resize(bdla_Vxf *a, int len);
 BDLA_EXPORT bdla_Status bdla_Vxf_copyin(bdla_Vxf *dest, bdla_Vxf source);
+/* A view sharing a's memory, made without copying. Don't release it. */
+BDLA_EXPORT bdla_Status bdla_Vxf_asMxf(bdla_Vxf a, int rows, int cols, bdla_Mxf *Y);
 /* Info */
 BDLA_EXPORT int bdla_Vxf_length(bdla_Vxf a);
 BDLA_EXPORT int bdla_Vxf_isequal(bdla_Vxf a, bdla_Vxf b);
@@ -162,11 +424,321 @@ BDLA_EXPORT bdla_Status bdla_Vxf_zero(bdla_Vxf *a);
 BDLA_EXPORT bdla_Status bdla_Vxf_uniform(bdla_Vxf *a, float b);
 BDLA_EXPORT bdla_Status bdla_Vxf_linspace(bdla_Vxf *a, float startval, float endval);
 
+/* HMxf - 16 bit storage matrix -------------------------------------------*/
+/* Creation & destruction */
+BDLA_EXPORT bdla_HMxf bdla_HMxf_create(int r, int c, bdla_HalfFormat format);
+BDLA_EXPORT void bdla_HMxf_release(bdla_HMxf *mat);
+/* Conversion. Rounds to nearest, ties to even; FP16 overflows to inf. */
+BDLA_EXPORT bdla_Status bdla_HMxf_fromMxf(bdla_Mxf A, bdla_HalfFormat format, bdla_HMxf *Y);
+BDLA_EXPORT bdla_Status bdla_HMxf_toMxf(bdla_HMxf A, bdla_Mxf *Y);
+/* Properties */
+BDLA_EXPORT int bdla_HMxf_rows(bdla_HMxf A);
+BDLA_EXPORT int bdla_HMxf_cols(bdla_HMxf A);
+BDLA_EXPORT float bdla_HMxf_value(bdla_HMxf A, int row, int col);
+/* Operations */
+BDLA_EXPORT bdla_Status bdla_HMxf_vmult(bdla_HMxf A, bdla_Vxf b, bdla_Vxf *y);
+BDLA_EXPORT bdla_Status bdla_HMxf_residual(bdla_HMxf A, bdla_Vxf x, bdla_Vxf b,
+	bdla_Vxf *r, float *rnorm);
+BDLA_EXPORT bdla_Status bdla_HMxf_diag(bdla_HMxf A, bdla_Vxf *b);
+
+/* QMxf - 8 bit quantised matrix -------------------------------------------*/
+/* Creation & destruction. err may be NULL. */
+BDLA_EXPORT bdla_Status bdla_QMxf_fromMxf(bdla_Mxf A, bdla_QMxf *Y, bdla_QuantError *err);
+BDLA_EXPORT void bdla_QMxf_release(bdla_QMxf *mat);
+BDLA_EXPORT bdla_Status bdla_QMxf_toMxf(bdla_QMxf A, bdla_Mxf *Y);
+/* Properties */
+BDLA_EXPORT int bdla_QMxf_rows(bdla_QMxf A);
+BDLA_EXPORT int bdla_QMxf_cols(bdla_QMxf A);
+BDLA_EXPORT float bdla_QMxf_value(bdla_QMxf A, int row, int col);
+/* Operations. The float operand is quantised to 8 bits as well (per
+column for mult), which adds at most ||Q_i||_1 * max|x| / 254 to the
+error of row i. */
+BDLA_EXPORT bdla_Status bdla_QMxf_vmult(bdla_QMxf A, bdla_Vxf b, bdla_Vxf *y);
+BDLA_EXPORT bdla_Status bdla_QMxf_mult(bdla_QMxf A, bdla_Mxf B, bdla_Mxf *Y);
+
+/* SMxf - Compressed sparse row single precision matrix --------------------*/
+/* Creation & destruction */
+BDLA_EXPORT bdla_SMxf bdla_SMxf_create(int r, int c, int nnz);
+BDLA_EXPORT void bdla_SMxf_release(bdla_SMxf *mat);
+BDLA_EXPORT bdla_SMxf bdla_SMxf_copy(bdla_SMxf mat);
+/* Conversion. Output matrices are overwritten, not released. */
+BDLA_EXPORT bdla_Status bdla_SMxf_fromMxf(bdla_Mxf A, bdla_SMxf *Y);
+BDLA_EXPORT bdla_Status bdla_SMxf_fromtriplets(int r, int c, int n,
+	const int *rows, const int *cols, const float *vals, bdla_SMxf *Y);
+BDLA_EXPORT bdla_Status bdla_SMxf_toMxf(bdla_SMxf A, bdla_Mxf *Y);
+/* Info */
+BDLA_EXPORT int bdla_SMxf_rows(bdla_SMxf A);
+BDLA_EXPORT int bdla_SMxf_cols(bdla_SMxf A);
+BDLA_EXPORT int bdla_SMxf_nnz(bdla_SMxf A);
+BDLA_EXPORT float bdla_SMxf_value(bdla_SMxf A, int row, int col);
+/* Manipulation */
+BDLA_EXPORT bdla_Status bdla_SMxf_vmult(bdla_SMxf A, bdla_Vxf b, bdla_Vxf *y);
+BDLA_EXPORT bdla_Status bdla_SMxf_residual(bdla_SMxf A, bdla_Vxf x, bdla_Vxf b,
+	bdla_Vxf *r, float *rnorm);
+BDLA_EXPORT bdla_Status bdla_SMxf_diag(bdla_SMxf A, bdla_Vxf *b);
+
+/* BMxf - Batch of small single precision matrices -------------------------*/
+/* Creation & destruction */
+BDLA_EXPORT bdla_BMxf bdla_BMxf_create(int count, int r, int c);
+BDLA_EXPORT void bdla_BMxf_release(bdla_BMxf *mat);
+BDLA_EXPORT bdla_BMxf bdla_BMxf_copy(bdla_BMxf mat);
+/* Info */
+BDLA_EXPORT int bdla_BMxf_count(bdla_BMxf A);
+BDLA_EXPORT int bdla_BMxf_rows(bdla_BMxf A);
+BDLA_EXPORT int bdla_BMxf_cols(bdla_BMxf A);
+/* Access. The returned matrix shares the batch's memory: don't release it. */
+BDLA_EXPORT bdla_Mxf bdla_BMxf_matrix(bdla_BMxf A, int i);
+/* Manipulation - each is applied independently to every matrix in the batch
+and parallelised across the batch. */
+BDLA_EXPORT bdla_Status bdla_BMxf_mult(bdla_BMxf A, bdla_BMxf B, bdla_BMxf *Y);
+BDLA_EXPORT bdla_Status bdla_BMxf_vmult(bdla_BMxf A, bdla_BMxf b, bdla_BMxf *y);
+BDLA_EXPORT bdla_Status bdla_BMxf_lu(bdla_BMxf *A, int *piv);
+BDLA_EXPORT bdla_Status bdla_BMxf_lusolve(bdla_BMxf LU, const int *piv,
+	bdla_BMxf b, bdla_BMxf *y);
+BDLA_EXPORT bdla_Status bdla_BMxf_cholesky(bdla_BMxf *A);
+BDLA_EXPORT bdla_Status bdla_BMxf_cholsolve(bdla_BMxf L, bdla_BMxf b, bdla_BMxf *y);
+BDLA_EXPORT bdla_Status bdla_BMxf_solve(bdla_BMxf A, bdla_MatrixProperty A_prop,
+	bdla_BMxf b, bdla_BMxf *y);
+
+/* M2f, M3f, M4f - Fixed size single precision matrices --------------------*/
+/* Fully unrolled and inlined; there are no allocations, asserts or calls
+into cblas. The asMxf and asVxf views share the fixed size object's
+memory so that it may be passed to the variable sized API. */
+/* 2x2 */
+static inline void bdla_M2f_eye(bdla_M2f *A);
+static inline void bdla_M2f_mult(const bdla_M2f *A, const bdla_M2f *B, bdla_M2f *Y);
+static inline void bdla_M2f_vmult(const bdla_M2f *A, const bdla_V2f *b, bdla_V2f *y);
+static inline void bdla_M2f_transpose(const bdla_M2f *A, bdla_M2f *Y);
+static inline float bdla_M2f_det(const bdla_M2f *A);
+static inline bdla_Status bdla_M2f_inverse(const bdla_M2f *A, bdla_M2f *Y);
+static inline bdla_Status bdla_M2f_solve(const bdla_M2f *A, const bdla_V2f *b, bdla_V2f *y);
+static inline bdla_Mxf bdla_M2f_asMxf(bdla_M2f *A);
+static inline bdla_Vxf bdla_V2f_asVxf(bdla_V2f *a);
+static inline bdla_Status bdla_M2f_fromMxf(bdla_Mxf A, bdla_M2f *Y);
+/* 3x3 */
+static inline void bdla_M3f_eye(bdla_M3f *A);
+static inline void bdla_M3f_mult(const bdla_M3f *A, const bdla_M3f *B, bdla_M3f *Y);
+static inline void bdla_M3f_vmult(const bdla_M3f *A, const bdla_V3f *b, bdla_V3f *y);
+static inline void bdla_M3f_transpose(const bdla_M3f *A, bdla_M3f *Y);
+static inline float bdla_M3f_det(const bdla_M3f *A);
+static inline bdla_Status bdla_M3f_inverse(const bdla_M3f *A, bdla_M3f *Y);
+static inline bdla_Status bdla_M3f_solve(const bdla_M3f *A, const bdla_V3f *b, bdla_V3f *y);
+static inline bdla_Mxf bdla_M3f_asMxf(bdla_M3f *A);
+static inline bdla_Vxf bdla_V3f_asVxf(bdla_V3f *a);
+static inline bdla_Status bdla_M3f_fromMxf(bdla_Mxf A, bdla_M3f *Y);
+/* 4x4 */
+static inline void bdla_M4f_eye(bdla_M4f *A);
+static inline void bdla_M4f_mult(const bdla_M4f *A, const bdla_M4f *B, bdla_M4f *Y);
+static inline void bdla_M4f_vmult(const bdla_M4f *A, const bdla_V4f *b, bdla_V4f *y);
+static inline void bdla_M4f_transpose(const bdla_M4f *A, bdla_M4f *Y);
+static inline float bdla_M4f_det(const bdla_M4f *A);
+static inline bdla_Status bdla_M4f_inverse(const bdla_M4f *A, bdla_M4f *Y);
+static inline bdla_Status bdla_M4f_solve(const bdla_M4f *A, const bdla_V4f *b, bdla_V4f *y);
+static inline bdla_Mxf bdla_M4f_asMxf(bdla_M4f *A);
+static inline bdla_Vxf bdla_V4f_asVxf(bdla_V4f *a);
+static inline bdla_Status bdla_M4f_fromMxf(bdla_Mxf A, bdla_M4f *Y);
+
+/* Expr - Lazy fused elementwise expressions ------------------------------*/
+/* Operands are read when the expression is evaluated, not when they are
+added. The output may alias an operand. */
+BDLA_EXPORT bdla_Expr bdla_Expr_create(void);
+BDLA_EXPORT int bdla_Expr_vxf(bdla_Expr *e, bdla_Vxf a);
+BDLA_EXPORT int bdla_Expr_mxf(bdla_Expr *e, bdla_Mxf A);
+BDLA_EXPORT int bdla_Expr_const(bdla_Expr *e, float f);
+BDLA_EXPORT int bdla_Expr_plus(bdla_Expr *e, int a, int b);
+BDLA_EXPORT int bdla_Expr_minus(bdla_Expr *e, int a, int b);
+BDLA_EXPORT int bdla_Expr_ewmult(bdla_Expr *e, int a, int b);
+BDLA_EXPORT int bdla_Expr_ewdiv(bdla_Expr *e, int a, int b);
+BDLA_EXPORT int bdla_Expr_min(bdla_Expr *e, int a, int b);
+BDLA_EXPORT int bdla_Expr_max(bdla_Expr *e, int a, int b);
+BDLA_EXPORT int bdla_Expr_fplus(bdla_Expr *e, int a, float f);
+BDLA_EXPORT int bdla_Expr_fmult(bdla_Expr *e, int a, float f);
+BDLA_EXPORT int bdla_Expr_axpy(bdla_Expr *e, float alpha, int x, int y);
+BDLA_EXPORT int bdla_Expr_abs(bdla_Expr *e, int a);
+BDLA_EXPORT int bdla_Expr_sqrt(bdla_Expr *e, int a);
+/* Evaluation */
+BDLA_EXPORT bdla_Status bdla_Expr_evalVxf(const bdla_Expr *e, int node, bdla_Vxf *y);
+BDLA_EXPORT bdla_Status bdla_Expr_evalMxf(const bdla_Expr *e, int node, bdla_Mxf *Y);
+BDLA_EXPORT bdla_Status bdla_Expr_reduce(const bdla_Expr *e, int node, 
+	bdla_Reduction op, float *result);
+
 /* Linear solvers */
 BDLA_EXPORT bdla_Status bdla_Mxf_solve_jacobi(
 	bdla_Mxf A, bdla_Vxf b, bdla_Vxf *y, float tol, bdla_Vxf *guess, int *max_iter);
 BDLA_EXPORT bdla_Status bdla_Mxf_solve_gauss_seidel(
 	bdla_Mxf A, bdla_Vxf b, bdla_Vxf *y, float tol, bdla_Vxf *guess, int *max_iter);
+BDLA_EXPORT bdla_Status bdla_SMxf_solve_jacobi(
+	bdla_SMxf A, bdla_Vxf b, bdla_Vxf *y, float tol, bdla_Vxf *guess, int *max_iter);
+BDLA_EXPORT bdla_Status bdla_SMxf_solve_gauss_seidel(
+	bdla_SMxf A, bdla_Vxf b, bdla_Vxf *y, float tol, bdla_Vxf *guess, int *max_iter);
+BDLA_EXPORT bdla_Status bdla_HMxf_solve_jacobi(
+	bdla_HMxf A, bdla_Vxf b, bdla_Vxf *y, float tol, bdla_Vxf *guess, int *max_iter);
+/* The *_ext forms stop as opts say rather than testing |b - A x| after
+every iteration, and report how they stopped in result. Either may be
+NULL, for the defaults and for no report. Running out of iterations or
+time, or being stopped by the callback, isn't an error: y holds the
+iterate reached and result->reason says why. */
+BDLA_EXPORT bdla_SolveOptions bdla_SolveOptions_default(void);
+BDLA_EXPORT bdla_Status bdla_Mxf_solve_jacobi_ext(bdla_Mxf A, bdla_Vxf b, bdla_Vxf *y,
+	bdla_Vxf *guess, const bdla_SolveOptions *opts, bdla_SolveResult *result);
+BDLA_EXPORT bdla_Status bdla_Mxf_solve_gauss_seidel_ext(bdla_Mxf A, bdla_Vxf b, bdla_Vxf *y,
+	bdla_Vxf *guess, const bdla_SolveOptions *opts, bdla_SolveResult *result);
+BDLA_EXPORT bdla_Status bdla_SMxf_solve_jacobi_ext(bdla_SMxf A, bdla_Vxf b, bdla_Vxf *y,
+	bdla_Vxf *guess, const bdla_SolveOptions *opts, bdla_SolveResult *result);
+BDLA_EXPORT bdla_Status bdla_SMxf_solve_gauss_seidel_ext(bdla_SMxf A, bdla_Vxf b, bdla_Vxf *y,
+	bdla_Vxf *guess, const bdla_SolveOptions *opts, bdla_SolveResult *result);
+BDLA_EXPORT bdla_Status bdla_HMxf_solve_jacobi_ext(bdla_HMxf A, bdla_Vxf b, bdla_Vxf *y,
+	bdla_Vxf *guess, const bdla_SolveOptions *opts, bdla_SolveResult *result);
+/* Conjugate gradients, for symmetric positive definite A. Returns
+BDLA_BAD_PROPERTY if A turns out not to be. */
+BDLA_EXPORT bdla_Status bdla_Mxf_solve_cg(
+	bdla_Mxf A, bdla_Vxf b, bdla_Vxf *y, float tol, bdla_Vxf *guess, int *max_iter);
+BDLA_EXPORT bdla_Status bdla_SMxf_solve_cg(
+	bdla_SMxf A, bdla_Vxf b, bdla_Vxf *y, float tol, bdla_Vxf *guess, int *max_iter);
+BDLA_EXPORT bdla_Status bdla_HMxf_solve_cg(
+	bdla_HMxf A, bdla_Vxf b, bdla_Vxf *y, float tol, bdla_Vxf *guess, int *max_iter);
+BDLA_EXPORT bdla_Status bdla_Mxf_solve_cg_ext(bdla_Mxf A, bdla_Vxf b, bdla_Vxf *y,
+	bdla_Vxf *guess, const bdla_SolveOptions *opts, bdla_SolveResult *result);
+BDLA_EXPORT bdla_Status bdla_SMxf_solve_cg_ext(bdla_SMxf A, bdla_Vxf b, bdla_Vxf *y,
+	bdla_Vxf *guess, const bdla_SolveOptions *opts, bdla_SolveResult *result);
+BDLA_EXPORT bdla_Status bdla_HMxf_solve_cg_ext(bdla_HMxf A, bdla_Vxf b, bdla_Vxf *y,
+	bdla_Vxf *guess, const bdla_SolveOptions *opts, bdla_SolveResult *result);
+/* Chebyshev iteration, for symmetric positive definite A with eigenvalues
+in [lmin, lmax]. It takes no inner products: the steps needed to reach tol
+are predicted from the bounds, and only then is b - A x measured.
+BDLA_BAD_PROPERTY if the residual grew, or if those steps didn't reach tol
+or even halve it, which means the bounds were wrong: most likely lmin is
+above the smallest eigenvalue. */
+BDLA_EXPORT bdla_Status bdla_Mxf_solve_chebyshev(bdla_Mxf A, bdla_Vxf b, bdla_Vxf *y,
+	float lmin, float lmax, float tol, bdla_Vxf *guess, int *max_iter);
+BDLA_EXPORT bdla_Status bdla_SMxf_solve_chebyshev(bdla_SMxf A, bdla_Vxf b, bdla_Vxf *y,
+	float lmin, float lmax, float tol, bdla_Vxf *guess, int *max_iter);
+BDLA_EXPORT bdla_Status bdla_HMxf_solve_chebyshev(bdla_HMxf A, bdla_Vxf b, bdla_Vxf *y,
+	float lmin, float lmax, float tol, bdla_Vxf *guess, int *max_iter);
+/* s-step conjugate gradients, 1 <= s <= 8. Each block of s steps comes
+from s products with A, and takes all its inner products in one pass
+rather than two reductions per step. The residual is checked once per
+block, so max_iter may be overrun by up to s - 1 steps. */
+BDLA_EXPORT bdla_Status bdla_Mxf_solve_cg_sstep(bdla_Mxf A, bdla_Vxf b, bdla_Vxf *y,
+	int s, float tol, bdla_Vxf *guess, int *max_iter);
+BDLA_EXPORT bdla_Status bdla_SMxf_solve_cg_sstep(bdla_SMxf A, bdla_Vxf b, bdla_Vxf *y,
+	int s, float tol, bdla_Vxf *guess, int *max_iter);
+BDLA_EXPORT bdla_Status bdla_HMxf_solve_cg_sstep(bdla_HMxf A, bdla_Vxf b, bdla_Vxf *y,
+	int s, float tol, bdla_Vxf *guess, int *max_iter);
+
+/* Householder QR, A = Q R, in blocks of reflectors held in compact WY form.
+A is overwritten by R on and above its diagonal and the reflectors below
+it. T is resized to nb x min(m, n) and gets the triangular factor of each
+block of nb reflectors, which Q is applied with. Q itself is never formed. */
+BDLA_EXPORT bdla_Status bdla_Mxf_qr(bdla_Mxf *A, bdla_Mxf *T);
+/* B = Q^T B and b = Q^T b in place, for QR and T from bdla_Mxf_qr. */
+BDLA_EXPORT bdla_Status bdla_Mxf_qtmult(bdla_Mxf QR, bdla_Mxf T, bdla_Mxf *B);
+BDLA_EXPORT bdla_Status bdla_Mxf_vqtmult(bdla_Mxf QR, bdla_Mxf T, bdla_Vxf *b);
+/* Least squares: the X minimising |A X - B|, for m x n A with m >= n, from
+bdla_Mxf_qr's factors. B is overwritten: its first n rows become X and the
+norm of the rest is the residual. BDLA_BAD_PROPERTY if R is singular. */
+BDLA_EXPORT bdla_Status bdla_Mxf_qrsolve(bdla_Mxf QR, bdla_Mxf T, bdla_Mxf *B);
+BDLA_EXPORT bdla_Status bdla_Mxf_vqrsolve(bdla_Mxf QR, bdla_Mxf T, bdla_Vxf *b);
+
+/* Eigensolvers, for BDLA_MATRIX_SYMMETRIC or BDLA_MATRIX_POSITIVE_DEFINITE
+A. Eigenvalues come largest magnitude first, eigenvectors are unit length,
+and an eigenpair has converged when |A v - lambda v| <= tol * |lambda_1|. */
+/* Power iteration on A - shift I, which finds the eigenvalue furthest from
+shift. x is the starting vector and gets the eigenvector; a zero x starts
+from a random one. */
+BDLA_EXPORT bdla_Status bdla_Mxf_eig_power(bdla_Mxf A, bdla_MatrixProperty A_prop,
+	float shift, float *lambda, bdla_Vxf *x, float tol, int *max_iter);
+/* The k dominant eigenpairs by thick restart Lanczos. lambda is resized to
+k, and V, unless NULL, to n x k with an eigenvector per column. max_iter
+limits the number of products with A. */
+BDLA_EXPORT bdla_Status bdla_Mxf_eig_lanczos(bdla_Mxf A, bdla_MatrixProperty A_prop,
+	int k, bdla_Vxf *lambda, bdla_Mxf *V, float tol, int *max_iter);
+/* As bdla_Mxf_eig_lanczos, but the Krylov space grows block vectors at a
+time, so A is applied by gemm. Copes better with repeated eigenvalues. */
+BDLA_EXPORT bdla_Status bdla_Mxf_eig_lanczos_block(bdla_Mxf A, bdla_MatrixProperty A_prop,
+	int k, int block, bdla_Vxf *lambda, bdla_Mxf *V, float tol, int *max_iter);
+/* Every eigenpair of A, by blocked Householder tridiagonalisation and
+divide and conquer. Unlike the iterative solvers, lambda comes out in
+ascending order. Only A's lower triangle is read. V may be NULL when only
+eigenvalues are wanted, which is much cheaper. */
+BDLA_EXPORT bdla_Status bdla_Mxf_eig_sym(bdla_Mxf A, bdla_MatrixProperty A_prop,
+	bdla_Vxf *lambda, bdla_Mxf *V);
+
+/* Singular value decomposition A = U diag(s) V^T by one-sided Jacobi, for
+any m x n A. With k = min(m, n), s is resized to k and sorted descending,
+and U and V to m x k and n x k with the singular vectors in their columns.
+Either may be NULL if it isn't wanted. Without the vectors along A's longer
+side, A is streamed through in row blocks and the work arrays are only
+k x k, however long A is. */
+BDLA_EXPORT bdla_Status bdla_Mxf_svd(bdla_Mxf A, bdla_Vxf *s, bdla_Mxf *U, bdla_Mxf *V);
+
+/* Covf - Streaming covariance accumulator --------------------------------*/
+/* block is the number of samples folded in at once; 0 for the default. */
+BDLA_EXPORT bdla_Covf bdla_Covf_create(int dim, int block);
+BDLA_EXPORT void bdla_Covf_release(bdla_Covf *acc);
+BDLA_EXPORT int64_t bdla_Covf_count(bdla_Covf acc);
+/* One sample, or one per row of X. */
+BDLA_EXPORT bdla_Status bdla_Covf_add(bdla_Covf *acc, bdla_Vxf x);
+BDLA_EXPORT bdla_Status bdla_Covf_addrows(bdla_Covf *acc, bdla_Mxf X);
+/* acc takes in every sample other has seen, as if they had been added to
+acc. Partial accumulators from different threads combine this way. */
+BDLA_EXPORT bdla_Status bdla_Covf_merge(bdla_Covf *acc, bdla_Covf *other);
+/* The mean and the covariance sum (x - mean)(x - mean)^T / (count - ddof),
+both triangles filled in. Either may be NULL. BDLA_UNDERSIZED if there are
+no more than ddof samples. The accumulator can go on taking samples. */
+BDLA_EXPORT bdla_Status bdla_Covf_finalise(bdla_Covf *acc, int ddof,
+	bdla_Vxf *mean, bdla_Mxf *cov);
+/* The Gram matrix sum x x^T. */
+BDLA_EXPORT bdla_Status bdla_Covf_gram(bdla_Covf *acc, bdla_Mxf *G);
+
+/* Memory - Page sizes of large arrays ------------------------------------*/
+/* Arrays of at least bytes from the create and copy functions ask for huge
+pages, unless made with BDLA_PAGES_SMALL. Zero, the default, turns it off. */
+BDLA_EXPORT void bdla_hugepage_threshold(size_t bytes);
+/* requested is a running total: releasing an array doesn't take it off. */
+BDLA_EXPORT bdla_HugePageStats bdla_hugepage_stats(void);
+
+/* Async - Work run in the background -------------------------------------*/
+/* Tasks that touch overlapping memory run in the order they were
+submitted, so views into the same buffer are ordered too; independent tasks
+run concurrently. Operands are read when the task runs, so keep them alive
+and don't resize them until it has finished. Outputs must already be the
+right size; the matrix-vector products may write over their inputs. Pass
+task as NULL if you don't need the handle; otherwise wait on it and then
+release it.
+bdla_call_async orders its tasks by the memory of the vectors listed in
+reads and writes; name a matrix's memory with bdla_Mxf_asVxf.
+Tasks share the thread pool that the parallel kernels run on. It starts
+on first use with BDLA_NUM_THREADS threads, or one per core; call
+bdla_async_init first to choose the count. Setting BDLA_PIN_THREADS
+nonzero keeps each worker on one processor. */
+BDLA_EXPORT bdla_Status bdla_async_init(int nthreads);
+BDLA_EXPORT void bdla_async_waitall(void);
+BDLA_EXPORT void bdla_async_shutdown(void);
+BDLA_EXPORT bdla_Status bdla_Task_wait(bdla_Task *task);
+BDLA_EXPORT int bdla_Task_done(bdla_Task *task);
+BDLA_EXPORT void bdla_Task_release(bdla_Task **task);
+BDLA_EXPORT bdla_Status bdla_call_async(bdla_TaskFn fn, void *arg,
+	const bdla_Vxf *reads, int nreads, const bdla_Vxf *writes, int nwrites,
+	bdla_Task **task);
+BDLA_EXPORT bdla_Status bdla_Mxf_mult_async(bdla_Mxf A, bdla_Mxf B, bdla_Mxf Y,
+	bdla_Task **task);
+BDLA_EXPORT bdla_Status bdla_Mxf_gemm_async(float alpha, bdla_Mxf A, bdla_Transpose A_trans,
+	bdla_Mxf B, bdla_Transpose B_trans, float beta, bdla_Mxf Y, bdla_Task **task);
+BDLA_EXPORT bdla_Status bdla_Mxf_vmult_async(bdla_Mxf A, bdla_Vxf b, bdla_Vxf y,
+	bdla_Task **task);
+BDLA_EXPORT bdla_Status bdla_Mxf_gemv_async(float alpha, bdla_Mxf A, bdla_Transpose A_trans,
+	bdla_Vxf x, float beta, bdla_Vxf y, bdla_Task **task);
+BDLA_EXPORT bdla_Status bdla_SMxf_vmult_async(bdla_SMxf A, bdla_Vxf b, bdla_Vxf y,
+	bdla_Task **task);
+BDLA_EXPORT bdla_Status bdla_Mxf_solve_jacobi_async(bdla_Mxf A, bdla_Vxf b, bdla_Vxf y,
+	float tol, bdla_Vxf *guess, int *max_iter, bdla_Task **task);
+BDLA_EXPORT bdla_Status bdla_Mxf_solve_gauss_seidel_async(bdla_Mxf A, bdla_Vxf b, bdla_Vxf y,
+	float tol, bdla_Vxf *guess, int *max_iter, bdla_Task **task);
+BDLA_EXPORT bdla_Status bdla_SMxf_solve_jacobi_async(bdla_SMxf A, bdla_Vxf b, bdla_Vxf y,
+	float tol, bdla_Vxf *guess, int *max_iter, bdla_Task **task);
+BDLA_EXPORT bdla_Status bdla_SMxf_solve_gauss_seidel_async(bdla_SMxf A, bdla_Vxf b, bdla_Vxf y,
+	float tol, bdla_Vxf *guess, int *max_iter, bdla_Task **task);
 
 /* IMPLEMENTATION ----------------------------------------------------------*/
 
@@ -197,5 +769,394 @@ static inline void bdla_Vxf_writevalue(bdla_Vxf a, int pos, float y) {
 	a.arr[pos] = y;
 }
 
+/* Implementation of fixed size matrix functions - inlined. */
+static inline void bdla_M2f_eye(bdla_M2f *A) {
+	A->arr[0] = 1.f;
+	A->arr[1] = 0.f;
+	A->arr[2] = 0.f;
+	A->arr[3] = 1.f;
+}
+
+static inline void bdla_M2f_mult(const bdla_M2f *A, const bdla_M2f *B, bdla_M2f *Y) {
+	bdla_M2f t;
+	t.arr[0] = A->arr[0] * B->arr[0] + A->arr[1] * B->arr[2];
+	t.arr[1] = A->arr[0] * B->arr[1] + A->arr[1] * B->arr[3];
+	t.arr[2] = A->arr[2] * B->arr[0] + A->arr[3] * B->arr[2];
+	t.arr[3] = A->arr[2] * B->arr[1] + A->arr[3] * B->arr[3];
+	*Y = t;
+}
+
+static inline void bdla_M2f_vmult(const bdla_M2f *A, const bdla_V2f *b, bdla_V2f *y) {
+	bdla_V2f t;
+	t.arr[0] = A->arr[0] * b->arr[0] + A->arr[1] * b->arr[1];
+	t.arr[1] = A->arr[2] * b->arr[0] + A->arr[3] * b->arr[1];
+	*y = t;
+}
+
+static inline void bdla_M2f_transpose(const bdla_M2f *A, bdla_M2f *Y) {
+	bdla_M2f t;
+	t.arr[0] = A->arr[0];
+	t.arr[1] = A->arr[2];
+	t.arr[2] = A->arr[1];
+	t.arr[3] = A->arr[3];
+	*Y = t;
+}
+
+static inline float bdla_M2f_det(const bdla_M2f *A) {
+	return A->arr[0] * A->arr[3] - A->arr[1] * A->arr[2];
+}
+
+static inline bdla_Status bdla_M2f_inverse(const bdla_M2f *A, bdla_M2f *Y) {
+	bdla_M2f t;
+	float det = A->arr[0] * A->arr[3] - A->arr[1] * A->arr[2];
+	if (det == 0.f) { return BDLA_BAD_PROPERTY; }
+	float r = 1.f / det;
+	t.arr[0] = A->arr[3] * r;
+	t.arr[1] = -A->arr[1] * r;
+	t.arr[2] = -A->arr[2] * r;
+	t.arr[3] = A->arr[0] * r;
+	*Y = t;
+	return BDLA_GOOD;
+}
+
+static inline bdla_Status bdla_M2f_solve(const bdla_M2f *A, const bdla_V2f *b, bdla_V2f *y) {
+	/* Cramer's rule. */
+	bdla_V2f t;
+	float det = A->arr[0] * A->arr[3] - A->arr[1] * A->arr[2];
+	if (det == 0.f) { return BDLA_BAD_PROPERTY; }
+	t.arr[0] = (b->arr[0] * A->arr[3] - A->arr[1] * b->arr[1]) / det;
+	t.arr[1] = (A->arr[0] * b->arr[1] - b->arr[0] * A->arr[2]) / det;
+	*y = t;
+	return BDLA_GOOD;
+}
+
+static inline bdla_Mxf bdla_M2f_asMxf(bdla_M2f *A) {
+	bdla_Mxf ret = { { 2, 2 }, A->arr };
+	return ret;
+}
+
+static inline bdla_Vxf bdla_V2f_asVxf(bdla_V2f *a) {
+	bdla_Vxf ret = { 2, a->arr };
+	return ret;
+}
+
+static inline bdla_Status bdla_M2f_fromMxf(bdla_Mxf A, bdla_M2f *Y) {
+	if (A.dims[0] != 2 || A.dims[1] != 2) { return BDLA_DIMENSION_MISMATCH; }
+	Y->arr[0] = A.arr[0];
+	Y->arr[1] = A.arr[1];
+	Y->arr[2] = A.arr[2];
+	Y->arr[3] = A.arr[3];
+	return BDLA_GOOD;
+}
+
+static inline void bdla_M3f_eye(bdla_M3f *A) {
+	A->arr[0] = 1.f;
+	A->arr[1] = 0.f;
+	A->arr[2] = 0.f;
+	A->arr[3] = 0.f;
+	A->arr[4] = 1.f;
+	A->arr[5] = 0.f;
+	A->arr[6] = 0.f;
+	A->arr[7] = 0.f;
+	A->arr[8] = 1.f;
+}
+
+static inline void bdla_M3f_mult(const bdla_M3f *A, const bdla_M3f *B, bdla_M3f *Y) {
+	bdla_M3f t;
+	t.arr[0] = A->arr[0] * B->arr[0] + A->arr[1] * B->arr[3] + A->arr[2] * B->arr[6];
+	t.arr[1] = A->arr[0] * B->arr[1] + A->arr[1] * B->arr[4] + A->arr[2] * B->arr[7];
+	t.arr[2] = A->arr[0] * B->arr[2] + A->arr[1] * B->arr[5] + A->arr[2] * B->arr[8];
+	t.arr[3] = A->arr[3] * B->arr[0] + A->arr[4] * B->arr[3] + A->arr[5] * B->arr[6];
+	t.arr[4] = A->arr[3] * B->arr[1] + A->arr[4] * B->arr[4] + A->arr[5] * B->arr[7];
+	t.arr[5] = A->arr[3] * B->arr[2] + A->arr[4] * B->arr[5] + A->arr[5] * B->arr[8];
+	t.arr[6] = A->arr[6] * B->arr[0] + A->arr[7] * B->arr[3] + A->arr[8] * B->arr[6];
+	t.arr[7] = A->arr[6] * B->arr[1] + A->arr[7] * B->arr[4] + A->arr[8] * B->arr[7];
+	t.arr[8] = A->arr[6] * B->arr[2] + A->arr[7] * B->arr[5] + A->arr[8] * B->arr[8];
+	*Y = t;
+}
+
+static inline void bdla_M3f_vmult(const bdla_M3f *A, const bdla_V3f *b, bdla_V3f *y) {
+	bdla_V3f t;
+	t.arr[0] = A->arr[0] * b->arr[0] + A->arr[1] * b->arr[1] + A->arr[2] * b->arr[2];
+	t.arr[1] = A->arr[3] * b->arr[0] + A->arr[4] * b->arr[1] + A->arr[5] * b->arr[2];
+	t.arr[2] = A->arr[6] * b->arr[0] + A->arr[7] * b->arr[1] + A->arr[8] * b->arr[2];
+	*y = t;
+}
+
+static inline void bdla_M3f_transpose(const bdla_M3f *A, bdla_M3f *Y) {
+	bdla_M3f t;
+	t.arr[0] = A->arr[0];
+	t.arr[1] = A->arr[3];
+	t.arr[2] = A->arr[6];
+	t.arr[3] = A->arr[1];
+	t.arr[4] = A->arr[4];
+	t.arr[5] = A->arr[7];
+	t.arr[6] = A->arr[2];
+	t.arr[7] = A->arr[5];
+	t.arr[8] = A->arr[8];
+	*Y = t;
+}
+
+static inline float bdla_M3f_det(const bdla_M3f *A) {
+	return A->arr[0] * (A->arr[4] * A->arr[8] - A->arr[5] * A->arr[7])
+		+ A->arr[1] * (A->arr[5] * A->arr[6] - A->arr[3] * A->arr[8])
+		+ A->arr[2] * (A->arr[3] * A->arr[7] - A->arr[4] * A->arr[6]);
+}
+
+static inline bdla_Status bdla_M3f_inverse(const bdla_M3f *A, bdla_M3f *Y) {
+	bdla_M3f t;
+	float c00 = (A->arr[4] * A->arr[8] - A->arr[5] * A->arr[7]);
+	float c01 = (A->arr[5] * A->arr[6] - A->arr[3] * A->arr[8]);
+	float c02 = (A->arr[3] * A->arr[7] - A->arr[4] * A->arr[6]);
+	float c10 = (A->arr[7] * A->arr[2] - A->arr[8] * A->arr[1]);
+	float c11 = (A->arr[8] * A->arr[0] - A->arr[6] * A->arr[2]);
+	float c12 = (A->arr[6] * A->arr[1] - A->arr[7] * A->arr[0]);
+	float c20 = (A->arr[1] * A->arr[5] - A->arr[2] * A->arr[4]);
+	float c21 = (A->arr[2] * A->arr[3] - A->arr[0] * A->arr[5]);
+	float c22 = (A->arr[0] * A->arr[4] - A->arr[1] * A->arr[3]);
+	float det = A->arr[0] * c00 + A->arr[1] * c01 + A->arr[2] * c02;
+	if (det == 0.f) { return BDLA_BAD_PROPERTY; }
+	float r = 1.f / det;
+	t.arr[0] = c00 * r;
+	t.arr[1] = c10 * r;
+	t.arr[2] = c20 * r;
+	t.arr[3] = c01 * r;
+	t.arr[4] = c11 * r;
+	t.arr[5] = c21 * r;
+	t.arr[6] = c02 * r;
+	t.arr[7] = c12 * r;
+	t.arr[8] = c22 * r;
+	*Y = t;
+	return BDLA_GOOD;
+}
+
+static inline bdla_Status bdla_M3f_solve(const bdla_M3f *A, const bdla_V3f *b, bdla_V3f *y) {
+	/* Cramer's rule, expanding each det(A_i) down the column b replaces. */
+	bdla_V3f t;
+	float c00 = (A->arr[4] * A->arr[8] - A->arr[5] * A->arr[7]);
+	float c01 = (A->arr[5] * A->arr[6] - A->arr[3] * A->arr[8]);
+	float c02 = (A->arr[3] * A->arr[7] - A->arr[4] * A->arr[6]);
+	float c10 = (A->arr[7] * A->arr[2] - A->arr[8] * A->arr[1]);
+	float c11 = (A->arr[8] * A->arr[0] - A->arr[6] * A->arr[2]);
+	float c12 = (A->arr[6] * A->arr[1] - A->arr[7] * A->arr[0]);
+	float c20 = (A->arr[1] * A->arr[5] - A->arr[2] * A->arr[4]);
+	float c21 = (A->arr[2] * A->arr[3] - A->arr[0] * A->arr[5]);
+	float c22 = (A->arr[0] * A->arr[4] - A->arr[1] * A->arr[3]);
+	float det = A->arr[0] * c00 + A->arr[1] * c01 + A->arr[2] * c02;
+	if (det == 0.f) { return BDLA_BAD_PROPERTY; }
+	t.arr[0] = (c00 * b->arr[0] + c10 * b->arr[1] + c20 * b->arr[2]) / det;
+	t.arr[1] = (c01 * b->arr[0] + c11 * b->arr[1] + c21 * b->arr[2]) / det;
+	t.arr[2] = (c02 * b->arr[0] + c12 * b->arr[1] + c22 * b->arr[2]) / det;
+	*y = t;
+	return BDLA_GOOD;
+}
+
+static inline bdla_Mxf bdla_M3f_asMxf(bdla_M3f *A) {
+	bdla_Mxf ret = { { 3, 3 }, A->arr };
+	return ret;
+}
+
+static inline bdla_Vxf bdla_V3f_asVxf(bdla_V3f *a) {
+	bdla_Vxf ret = { 3, a->arr };
+	return ret;
+}
+
+static inline bdla_Status bdla_M3f_fromMxf(bdla_Mxf A, bdla_M3f *Y) {
+	if (A.dims[0] != 3 || A.dims[1] != 3) { return BDLA_DIMENSION_MISMATCH; }
+	Y->arr[0] = A.arr[0];
+	Y->arr[1] = A.arr[1];
+	Y->arr[2] = A.arr[2];
+	Y->arr[3] = A.arr[3];
+	Y->arr[4] = A.arr[4];
+	Y->arr[5] = A.arr[5];
+	Y->arr[6] = A.arr[6];
+	Y->arr[7] = A.arr[7];
+	Y->arr[8] = A.arr[8];
+	return BDLA_GOOD;
+}
+
+static inline void bdla_M4f_eye(bdla_M4f *A) {
+	A->arr[0] = 1.f;
+	A->arr[1] = 0.f;
+	A->arr[2] = 0.f;
+	A->arr[3] = 0.f;
+	A->arr[4] = 0.f;
+	A->arr[5] = 1.f;
+	A->arr[6] = 0.f;
+	A->arr[7] = 0.f;
+	A->arr[8] = 0.f;
+	A->arr[9] = 0.f;
+	A->arr[10] = 1.f;
+	A->arr[11] = 0.f;
+	A->arr[12] = 0.f;
+	A->arr[13] = 0.f;
+	A->arr[14] = 0.f;
+	A->arr[15] = 1.f;
+}
+
+static inline void bdla_M4f_mult(const bdla_M4f *A, const bdla_M4f *B, bdla_M4f *Y) {
+	bdla_M4f t;
+	t.arr[0] = A->arr[0] * B->arr[0] + A->arr[1] * B->arr[4] + A->arr[2] * B->arr[8] + A->arr[3] * B->arr[12];
+	t.arr[1] = A->arr[0] * B->arr[1] + A->arr[1] * B->arr[5] + A->arr[2] * B->arr[9] + A->arr[3] * B->arr[13];
+	t.arr[2] = A->arr[0] * B->arr[2] + A->arr[1] * B->arr[6] + A->arr[2] * B->arr[10] + A->arr[3] * B->arr[14];
+	t.arr[3] = A->arr[0] * B->arr[3] + A->arr[1] * B->arr[7] + A->arr[2] * B->arr[11] + A->arr[3] * B->arr[15];
+	t.arr[4] = A->arr[4] * B->arr[0] + A->arr[5] * B->arr[4] + A->arr[6] * B->arr[8] + A->arr[7] * B->arr[12];
+	t.arr[5] = A->arr[4] * B->arr[1] + A->arr[5] * B->arr[5] + A->arr[6] * B->arr[9] + A->arr[7] * B->arr[13];
+	t.arr[6] = A->arr[4] * B->arr[2] + A->arr[5] * B->arr[6] + A->arr[6] * B->arr[10] + A->arr[7] * B->arr[14];
+	t.arr[7] = A->arr[4] * B->arr[3] + A->arr[5] * B->arr[7] + A->arr[6] * B->arr[11] + A->arr[7] * B->arr[15];
+	t.arr[8] = A->arr[8] * B->arr[0] + A->arr[9] * B->arr[4] + A->arr[10] * B->arr[8] + A->arr[11] * B->arr[12];
+	t.arr[9] = A->arr[8] * B->arr[1] + A->arr[9] * B->arr[5] + A->arr[10] * B->arr[9] + A->arr[11] * B->arr[13];
+	t.arr[10] = A->arr[8] * B->arr[2] + A->arr[9] * B->arr[6] + A->arr[10] * B->arr[10] + A->arr[11] * B->arr[14];
+	t.arr[11] = A->arr[8] * B->arr[3] + A->arr[9] * B->arr[7] + A->arr[10] * B->arr[11] + A->arr[11] * B->arr[15];
+	t.arr[12] = A->arr[12] * B->arr[0] + A->arr[13] * B->arr[4] + A->arr[14] * B->arr[8] + A->arr[15] * B->arr[12];
+	t.arr[13] = A->arr[12] * B->arr[1] + A->arr[13] * B->arr[5] + A->arr[14] * B->arr[9] + A->arr[15] * B->arr[13];
+	t.arr[14] = A->arr[12] * B->arr[2] + A->arr[13] * B->arr[6] + A->arr[14] * B->arr[10] + A->arr[15] * B->arr[14];
+	t.arr[15] = A->arr[12] * B->arr[3] + A->arr[13] * B->arr[7] + A->arr[14] * B->arr[11] + A->arr[15] * B->arr[15];
+	*Y = t;
+}
+
+static inline void bdla_M4f_vmult(const bdla_M4f *A, const bdla_V4f *b, bdla_V4f *y) {
+	bdla_V4f t;
+	t.arr[0] = A->arr[0] * b->arr[0] + A->arr[1] * b->arr[1] + A->arr[2] * b->arr[2] + A->arr[3] * b->arr[3];
+	t.arr[1] = A->arr[4] * b->arr[0] + A->arr[5] * b->arr[1] + A->arr[6] * b->arr[2] + A->arr[7] * b->arr[3];
+	t.arr[2] = A->arr[8] * b->arr[0] + A->arr[9] * b->arr[1] + A->arr[10] * b->arr[2] + A->arr[11] * b->arr[3];
+	t.arr[3] = A->arr[12] * b->arr[0] + A->arr[13] * b->arr[1] + A->arr[14] * b->arr[2] + A->arr[15] * b->arr[3];
+	*y = t;
+}
+
+static inline void bdla_M4f_transpose(const bdla_M4f *A, bdla_M4f *Y) {
+	bdla_M4f t;
+	t.arr[0] = A->arr[0];
+	t.arr[1] = A->arr[4];
+	t.arr[2] = A->arr[8];
+	t.arr[3] = A->arr[12];
+	t.arr[4] = A->arr[1];
+	t.arr[5] = A->arr[5];
+	t.arr[6] = A->arr[9];
+	t.arr[7] = A->arr[13];
+	t.arr[8] = A->arr[2];
+	t.arr[9] = A->arr[6];
+	t.arr[10] = A->arr[10];
+	t.arr[11] = A->arr[14];
+	t.arr[12] = A->arr[3];
+	t.arr[13] = A->arr[7];
+	t.arr[14] = A->arr[11];
+	t.arr[15] = A->arr[15];
+	*Y = t;
+}
+
+static inline float bdla_M4f_det(const bdla_M4f *A) {
+	float s0 = A->arr[0] * A->arr[5] - A->arr[4] * A->arr[1];
+	float s1 = A->arr[0] * A->arr[6] - A->arr[4] * A->arr[2];
+	float s2 = A->arr[0] * A->arr[7] - A->arr[4] * A->arr[3];
+	float s3 = A->arr[1] * A->arr[6] - A->arr[5] * A->arr[2];
+	float s4 = A->arr[1] * A->arr[7] - A->arr[5] * A->arr[3];
+	float s5 = A->arr[2] * A->arr[7] - A->arr[6] * A->arr[3];
+	float c0 = A->arr[8] * A->arr[13] - A->arr[12] * A->arr[9];
+	float c1 = A->arr[8] * A->arr[14] - A->arr[12] * A->arr[10];
+	float c2 = A->arr[8] * A->arr[15] - A->arr[12] * A->arr[11];
+	float c3 = A->arr[9] * A->arr[14] - A->arr[13] * A->arr[10];
+	float c4 = A->arr[9] * A->arr[15] - A->arr[13] * A->arr[11];
+	float c5 = A->arr[10] * A->arr[15] - A->arr[14] * A->arr[11];
+	return s0 * c5 - s1 * c4 + s2 * c3 + s3 * c2 - s4 * c1 + s5 * c0;
+}
+
+static inline bdla_Status bdla_M4f_inverse(const bdla_M4f *A, bdla_M4f *Y) {
+	bdla_M4f t;
+	float s0 = A->arr[0] * A->arr[5] - A->arr[4] * A->arr[1];
+	float s1 = A->arr[0] * A->arr[6] - A->arr[4] * A->arr[2];
+	float s2 = A->arr[0] * A->arr[7] - A->arr[4] * A->arr[3];
+	float s3 = A->arr[1] * A->arr[6] - A->arr[5] * A->arr[2];
+	float s4 = A->arr[1] * A->arr[7] - A->arr[5] * A->arr[3];
+	float s5 = A->arr[2] * A->arr[7] - A->arr[6] * A->arr[3];
+	float c0 = A->arr[8] * A->arr[13] - A->arr[12] * A->arr[9];
+	float c1 = A->arr[8] * A->arr[14] - A->arr[12] * A->arr[10];
+	float c2 = A->arr[8] * A->arr[15] - A->arr[12] * A->arr[11];
+	float c3 = A->arr[9] * A->arr[14] - A->arr[13] * A->arr[10];
+	float c4 = A->arr[9] * A->arr[15] - A->arr[13] * A->arr[11];
+	float c5 = A->arr[10] * A->arr[15] - A->arr[14] * A->arr[11];
+	float det = s0 * c5 - s1 * c4 + s2 * c3 + s3 * c2 - s4 * c1 + s5 * c0;
+	if (det == 0.f) { return BDLA_BAD_PROPERTY; }
+	float r = 1.f / det;
+	t.arr[0] = ( A->arr[5] * c5 - A->arr[6] * c4 + A->arr[7] * c3) * r;
+	t.arr[1] = (-A->arr[1] * c5 + A->arr[2] * c4 - A->arr[3] * c3) * r;
+	t.arr[2] = ( A->arr[13] * s5 - A->arr[14] * s4 + A->arr[15] * s3) * r;
+	t.arr[3] = (-A->arr[9] * s5 + A->arr[10] * s4 - A->arr[11] * s3) * r;
+	t.arr[4] = (-A->arr[4] * c5 + A->arr[6] * c2 - A->arr[7] * c1) * r;
+	t.arr[5] = ( A->arr[0] * c5 - A->arr[2] * c2 + A->arr[3] * c1) * r;
+	t.arr[6] = (-A->arr[12] * s5 + A->arr[14] * s2 - A->arr[15] * s1) * r;
+	t.arr[7] = ( A->arr[8] * s5 - A->arr[10] * s2 + A->arr[11] * s1) * r;
+	t.arr[8] = ( A->arr[4] * c4 - A->arr[5] * c2 + A->arr[7] * c0) * r;
+	t.arr[9] = (-A->arr[0] * c4 + A->arr[1] * c2 - A->arr[3] * c0) * r;
+	t.arr[10] = ( A->arr[12] * s4 - A->arr[13] * s2 + A->arr[15] * s0) * r;
+	t.arr[11] = (-A->arr[8] * s4 + A->arr[9] * s2 - A->arr[11] * s0) * r;
+	t.arr[12] = (-A->arr[4] * c3 + A->arr[5] * c1 - A->arr[6] * c0) * r;
+	t.arr[13] = ( A->arr[0] * c3 - A->arr[1] * c1 + A->arr[2] * c0) * r;
+	t.arr[14] = (-A->arr[12] * s3 + A->arr[13] * s1 - A->arr[14] * s0) * r;
+	t.arr[15] = ( A->arr[8] * s3 - A->arr[9] * s1 + A->arr[10] * s0) * r;
+	*Y = t;
+	return BDLA_GOOD;
+}
+
+static inline bdla_Status bdla_M4f_solve(const bdla_M4f *A, const bdla_V4f *b, bdla_V4f *y) {
+	/* Gaussian elimination on [A | b] with partial pivoting. Rows are
+	swapped by pointer; the fixed trip counts unroll. */
+	float m[4][5], *r[4], *tmp, f;
+	int i, j, k, p;
+	for (i = 0; i < 4; ++i) {
+		for (j = 0; j < 4; ++j) { m[i][j] = A->arr[4 * i + j]; }
+		m[i][4] = b->arr[i];
+		r[i] = m[i];
+	}
+	for (k = 0; k < 4; ++k) {
+		for (p = k, i = k + 1; i < 4; ++i) {
+			f = r[i][k] < 0.f ? -r[i][k] : r[i][k];
+			if (f > (r[p][k] < 0.f ? -r[p][k] : r[p][k])) { p = i; }
+		}
+		if (r[p][k] == 0.f) { return BDLA_BAD_PROPERTY; }
+		tmp = r[k]; r[k] = r[p]; r[p] = tmp;
+		for (i = k + 1; i < 4; ++i) {
+			f = r[i][k] / r[k][k];
+			for (j = k + 1; j < 5; ++j) { r[i][j] -= f * r[k][j]; }
+		}
+	}
+	y->arr[3] = r[3][4] / r[3][3];
+	y->arr[2] = (r[2][4] - r[2][3] * y->arr[3]) / r[2][2];
+	y->arr[1] = (r[1][4] - r[1][2] * y->arr[2] - r[1][3] * y->arr[3]) / r[1][1];
+	y->arr[0] = (r[0][4] - r[0][1] * y->arr[1] - r[0][2] * y->arr[2]
+		- r[0][3] * y->arr[3]) / r[0][0];
+	return BDLA_GOOD;
+}
+
+static inline bdla_Mxf bdla_M4f_asMxf(bdla_M4f *A) {
+	bdla_Mxf ret = { { 4, 4 }, A->arr };
+	return ret;
+}
+
+static inline bdla_Vxf bdla_V4f_asVxf(bdla_V4f *a) {
+	bdla_Vxf ret = { 4, a->arr };
+	return ret;
+}
+
+static inline bdla_Status bdla_M4f_fromMxf(bdla_Mxf A, bdla_M4f *Y) {
+	if (A.dims[0] != 4 || A.dims[1] != 4) { return BDLA_DIMENSION_MISMATCH; }
+	Y->arr[0] = A.arr[0];
+	Y->arr[1] = A.arr[1];
+	Y->arr[2] = A.arr[2];
+	Y->arr[3] = A.arr[3];
+	Y->arr[4] = A.arr[4];
+	Y->arr[5] = A.arr[5];
+	Y->arr[6] = A.arr[6];
+	Y->arr[7] = A.arr[7];
+	Y->arr[8] = A.arr[8];
+	Y->arr[9] = A.arr[9];
+	Y->arr[10] = A.arr[10];
+	Y->arr[11] = A.arr[11];
+	Y->arr[12] = A.arr[12];
+	Y->arr[13] = A.arr[13];
+	Y->arr[14] = A.arr[14];
+	Y->arr[15] = A.arr[15];
+	return BDLA_GOOD;
+}
 
 #endif /* BDLA_LIBBDLA_H */
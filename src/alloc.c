@@ -0,0 +1,193 @@
+#include "libbdla.h"
+/*============================================================================
+alloc.c
+
+Allocation of large arrays: placement on NUMA nodes and huge pages.
+
+Copyright(c) 2019 HJA Bird
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files(the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions :
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+============================================================================*/
+#include <assert.h>
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(__linux__)
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#define BDLA_ALLOC_LINUX
+#ifndef MPOL_INTERLEAVE
+#define MPOL_INTERLEAVE 3
+#endif
+#endif
+
+#include "alloc.h"
+#include "threadpool.h"
+#include "threads.h"
+
+/* Arrays of at least this many bytes ask for huge pages. Zero for never.
+Set and read atomically, as arrays may be made on any thread. */
+static volatile long bdla_hugepage_min = 0;
+/* Kilobytes allocated asking for huge pages. */
+static volatile long bdla_hugepage_kb = 0;
+
+#ifdef BDLA_ALLOC_LINUX
+/* Mask of the online nodes, or zero if there are fewer than two. */
+static unsigned long bdla_numa_nodes(void) {
+	FILE *f = fopen("/sys/devices/system/node/online", "r");
+	unsigned long mask = 0;
+	int lo, hi, c = ',';
+	if (f == NULL) { return 0; }
+	/* A list of ranges, such as "0-1,4". */
+	while (c == ',' && fscanf(f, "%d", &lo) == 1) {
+		hi = lo;
+		c = fgetc(f);
+		if (c == '-') {
+			if (fscanf(f, "%d", &hi) != 1) { break; }
+			c = fgetc(f);
+		}
+		for (; lo <= hi && lo < (int)(8 * sizeof(mask)); ++lo) {
+			mask |= 1ul << lo;
+		}
+	}
+	fclose(f);
+	return (mask & (mask - 1)) != 0 ? mask : 0;
+}
+
+static size_t bdla_hugepage_size(void) {
+	static size_t size = 0;
+	unsigned long v;
+	FILE *f;
+	if (size == 0) {
+		f = fopen("/sys/kernel/mm/transparent_hugepage/hpage_pmd_size", "r");
+		v = 0;
+		if (f != NULL) {
+			if (fscanf(f, "%lu", &v) != 1) { v = 0; }
+			fclose(f);
+		}
+		size = v > 0 ? v : 2 * 1024 * 1024;
+	}
+	return size;
+}
+#endif
+
+/* Memory for len floats. Unless both policies are the defaults, it is
+whole pages with nothing resident yet, so the first writes decide where
+the pages go. Huge pages are only ever asked for with madvise: memory
+from MAP_HUGETLB couldn't be released with free(). */
+static float *bdla_alloc_placed(size_t len, bdla_NumaPolicy numa, bdla_PagePolicy pages) {
+	size_t bytes = sizeof(float) * len;
+#ifdef BDLA_ALLOC_LINUX
+	size_t align;
+	unsigned long nodes;
+	void *p;
+	long min = bdla_atomic_load(&bdla_hugepage_min);
+	int huge = pages == BDLA_PAGES_HUGE || (pages == BDLA_PAGES_DEFAULT
+		&& min > 0 && bytes >= (size_t)min);
+	if (!huge && numa == BDLA_NUMA_DEFAULT) { return malloc(bytes); }
+	align = huge ? bdla_hugepage_size() : (size_t)sysconf(_SC_PAGESIZE);
+	bytes = (bytes + align - 1) / align * align;
+	if (posix_memalign(&p, align, bytes) != 0) { return NULL; }
+	/* Recycled heap memory may already be resident somewhere. */
+	madvise(p, bytes, MADV_DONTNEED);
+#ifdef MADV_HUGEPAGE
+	if (huge && madvise(p, bytes, MADV_HUGEPAGE) == 0) {
+		bdla_atomic_add(&bdla_hugepage_kb, (long)(bytes / 1024));
+	}
+#endif
+	if (numa == BDLA_NUMA_INTERLEAVE && (nodes = bdla_numa_nodes()) != 0) {
+		/* On failure the pages are just first touched. */
+		syscall(SYS_mbind, p, bytes, MPOL_INTERLEAVE, &nodes, 8 * sizeof(nodes) + 1, 0);
+	}
+	return p;
+#else
+	/* Elsewhere there's only first touch and small pages. */
+	(void)numa;
+	(void)pages;
+	return malloc(bytes);
+#endif
+}
+
+/* Zero a new array, which is what first touches its pages: on this thread
+by default, else split over the pool as the row-parallel kernels split
+it. */
+static void bdla_alloc_zero(float *arr, int rows, size_t rowlen, bdla_NumaPolicy numa) {
+	if (arr == NULL) { return; }
+	if (numa == BDLA_NUMA_DEFAULT) { memset(arr, 0, sizeof(float) * rows * rowlen); }
+	else { bdla_parallel_fill(arr, rows, rowlen, 0.f); }
+}
+
+float *bdla_alloc_floats(size_t len) {
+	return bdla_alloc_placed(len, BDLA_NUMA_DEFAULT, BDLA_PAGES_DEFAULT);
+}
+
+BDLA_EXPORT void bdla_hugepage_threshold(size_t bytes) {
+	bdla_atomic_store(&bdla_hugepage_min, bytes < (size_t)LONG_MAX ? (long)bytes : LONG_MAX);
+}
+
+BDLA_EXPORT bdla_HugePageStats bdla_hugepage_stats(void) {
+	bdla_HugePageStats ret;
+	ret.requested = (size_t)bdla_atomic_load(&bdla_hugepage_kb) * 1024;
+	ret.backed = 0;
+#ifdef BDLA_ALLOC_LINUX
+	{
+		char line[256];
+		unsigned long kb;
+		/* The rollup needs Linux 4.14; before that, add up every mapping. */
+		FILE *f = fopen("/proc/self/smaps_rollup", "r");
+		if (f == NULL) { f = fopen("/proc/self/smaps", "r"); }
+		if (f != NULL) {
+			while (fgets(line, sizeof(line), f) != NULL) {
+				if (sscanf(line, "AnonHugePages: %lu kB", &kb) == 1) {
+					ret.backed += (size_t)kb * 1024;
+				}
+			}
+			fclose(f);
+		}
+	}
+#endif
+	return ret;
+}
+
+BDLA_EXPORT bdla_Mxf bdla_Mxf_create_ext(int r, int c,
+	bdla_NumaPolicy numa, bdla_PagePolicy pages) {
+	assert(r > 0);
+	assert(c > 0);
+	bdla_Mxf ret = { { r, c }, bdla_alloc_placed((size_t)r * c, numa, pages) };
+	bdla_alloc_zero(ret.arr, r, c, numa);
+	return ret;
+}
+
+BDLA_EXPORT bdla_Mxf bdla_Mxf_create_numa(int r, int c, bdla_NumaPolicy policy) {
+	return bdla_Mxf_create_ext(r, c, policy, BDLA_PAGES_DEFAULT);
+}
+
+BDLA_EXPORT bdla_Vxf bdla_Vxf_create_ext(int len, bdla_NumaPolicy numa, bdla_PagePolicy pages) {
+	assert(len > 0);
+	bdla_Vxf ret = { len, bdla_alloc_placed(len, numa, pages) };
+	bdla_alloc_zero(ret.arr, len, 1, numa);
+	return ret;
+}
+
+BDLA_EXPORT bdla_Vxf bdla_Vxf_create_numa(int len, bdla_NumaPolicy policy) {
+	return bdla_Vxf_create_ext(len, policy, BDLA_PAGES_DEFAULT);
+}
@@ -0,0 +1,44 @@
+#ifndef BDLA_ALLOC_H
+#define BDLA_ALLOC_H
+/*============================================================================
+alloc.h
+
+Allocation of large arrays, with huge pages where asked for.
+
+Copyright(c) 2019 HJA Bird
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files(the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions :
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+============================================================================*/
+#include "libbdla.h"
+
+#include <stddef.h>
+#include <stdint.h>
+
+/* Memory for len floats. Arrays over the bdla_hugepage_threshold size ask
+for huge pages. Release with free(). */
+float *bdla_alloc_floats(size_t len);
+
+/* Whether the alen floats at a share any memory with the blen at b. An
+output that overlaps an input is computed in scratch and copied back. */
+static inline int bdla_floats_overlap(const float *a, size_t alen,
+	const float *b, size_t blen) {
+	return (uintptr_t)a < (uintptr_t)(b + blen) && (uintptr_t)b < (uintptr_t)(a + alen);
+}
+
+#endif /* BDLA_ALLOC_H */
@@ -0,0 +1,599 @@
+#include "libbdla.h"
+/*============================================================================
+async.c
+
+Background tasks. Dependencies between tasks come from the arrays they
+read and write, tracked per array, and ready tasks are handed to the
+shared thread pool.
+
+Copyright(c) 2019 HJA Bird
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files(the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions :
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+============================================================================*/
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "threads.h"
+#include "threadpool.h"
+
+struct bdla_Task {
+	bdla_TaskFn fn;
+	void *arg;
+	union {
+		struct {
+			float alpha, beta;
+			bdla_Mxf A, B, Y;
+			bdla_Transpose A_trans, B_trans;
+		} gemm;
+		struct {
+			float alpha, beta;
+			bdla_Mxf A;
+			bdla_Transpose A_trans;
+			bdla_Vxf x, y;
+		} gemv;
+		struct {
+			bdla_SMxf A;
+			bdla_Vxf b, y;
+		} spmv;
+		struct {
+			bdla_Mxf A;
+			bdla_Vxf b, y, *guess;
+			float tol;
+			int *max_iter;
+		} solve;
+		struct {
+			bdla_SMxf A;
+			bdla_Vxf b, y, *guess;
+			float tol;
+			int *max_iter;
+		} ssolve;
+	} u;
+	bdla_Status status;
+	int done;
+	int refs;		/* The caller's handle, plus one until the task has run. */
+	int npred;		/* Unfinished tasks this one has to wait for. */
+	int nsucc, capsucc;
+	bdla_Task **succ;
+};
+
+/* The floats an operand covers, [lo, hi). */
+typedef struct {
+	const float *lo, *hi;
+} bdla_AsyncRange;
+
+/* The unfinished tasks touching a range: the last to write it, and those
+reading it since. Tasks on other ranges that overlap this one are ordered
+against it too. */
+typedef struct {
+	bdla_AsyncRange range;
+	bdla_Task *writer;
+	bdla_Task **readers;
+	int nreaders, capreaders;
+} bdla_BufferRecord;
+
+static struct {
+	bdla_Mutex lock;
+	bdla_Cond finished;	/* A task finished. */
+	int pending;		/* Submitted but unfinished tasks. */
+	bdla_BufferRecord *recs;
+	int nrecs, caprecs;
+} bdla_async = { BDLA_MUTEX_INIT, BDLA_COND_INIT, 0, NULL, 0, 0 };
+
+/* Everything below named *_locked expects bdla_async.lock to be held. */
+static void bdla_async_runtask(void *arg);
+
+static void bdla_async_push_locked(bdla_Task *t) {
+	/* Can only fail for want of memory: then run it here and now. */
+	if (bdla_pool_submit(bdla_async_runtask, t) != BDLA_GOOD) {
+		bdla_mutex_unlock(&bdla_async.lock);
+		bdla_async_runtask(t);
+		bdla_mutex_lock(&bdla_async.lock);
+	}
+}
+
+static void bdla_async_unref_locked(bdla_Task *t) {
+	if (--t->refs == 0) {
+		free(t->succ);
+		free(t);
+	}
+}
+
+static bdla_AsyncRange bdla_async_range(const float *arr, size_t len) {
+	bdla_AsyncRange r;
+	r.lo = arr;
+	r.hi = arr + len;
+	return r;
+}
+
+static int bdla_async_sameas(bdla_AsyncRange a, bdla_AsyncRange b) {
+	return a.lo == b.lo && a.hi == b.hi;
+}
+
+/* Compared as addresses, since the ranges may lie in different arrays. */
+static int bdla_async_overlaps(bdla_AsyncRange a, bdla_AsyncRange b) {
+	return (uintptr_t)a.lo < (uintptr_t)b.hi && (uintptr_t)b.lo < (uintptr_t)a.hi;
+}
+
+static bdla_BufferRecord *bdla_async_find_locked(bdla_AsyncRange range) {
+	int i;
+	for (i = 0; i < bdla_async.nrecs; ++i) {
+		if (bdla_async_sameas(bdla_async.recs[i].range, range)) { return bdla_async.recs + i; }
+	}
+	return NULL;
+}
+
+/* Drop records with nothing unfinished. */
+static void bdla_async_prune_locked(void) {
+	int i;
+	bdla_BufferRecord *r;
+	for (i = 0; i < bdla_async.nrecs; ) {
+		r = bdla_async.recs + i;
+		if (r->writer == NULL && r->nreaders == 0) {
+			free(r->readers);
+			bdla_async.recs[i] = bdla_async.recs[--bdla_async.nrecs];
+		}
+		else { ++i; }
+	}
+}
+
+/* Drop a finished task from the buffer records. */
+static void bdla_async_forget_locked(bdla_Task *t) {
+	int i, j;
+	bdla_BufferRecord *r;
+	for (i = 0; i < bdla_async.nrecs; ++i) {
+		r = bdla_async.recs + i;
+		if (r->writer == t) { r->writer = NULL; }
+		for (j = 0; j < r->nreaders; ) {
+			if (r->readers[j] == t) { r->readers[j] = r->readers[--r->nreaders]; }
+			else { ++j; }
+		}
+	}
+	bdla_async_prune_locked();
+}
+
+/* Run a ready task: a job on the pool. */
+static void bdla_async_runtask(void *arg) {
+	bdla_Task *t = arg;
+	bdla_Status s;
+	int i;
+	s = t->fn(t->arg);
+	bdla_mutex_lock(&bdla_async.lock);
+	t->status = s;
+	t->done = 1;
+	/* Forget t first so that no new task can come to depend on it. */
+	bdla_async_forget_locked(t);
+	for (i = 0; i < t->nsucc; ++i) {
+		if (--t->succ[i]->npred == 0) { bdla_async_push_locked(t->succ[i]); }
+	}
+	--bdla_async.pending;
+	bdla_cond_broadcast(&bdla_async.finished);
+	bdla_async_unref_locked(t);
+	bdla_mutex_unlock(&bdla_async.lock);
+}
+
+/* Help the pool until *flag is set, or until pending work runs out when
+flag is NULL. Called and returns with the lock held. */
+static void bdla_async_help_locked(const int *flag) {
+	int ran;
+	while (flag != NULL ? !*flag : bdla_async.pending > 0) {
+		bdla_mutex_unlock(&bdla_async.lock);
+		ran = bdla_pool_run_one();
+		bdla_mutex_lock(&bdla_async.lock);
+		if (!ran && (flag != NULL ? !*flag : bdla_async.pending > 0)) {
+			bdla_cond_wait(&bdla_async.finished, &bdla_async.lock);
+		}
+	}
+}
+
+static int bdla_async_contains(const bdla_AsyncRange *ranges, int n, bdla_AsyncRange range) {
+	int i;
+	for (i = 0; i < n; ++i) {
+		if (bdla_async_sameas(ranges[i], range)) { return 1; }
+	}
+	return 0;
+}
+
+/* Work out t's dependencies from the ranges it touches and queue it. A
+read waits for the writers of every overlapping range, and a write for
+their readers too. All allocation happens before anything is linked, so
+failing leaves the scheduler as it was. */
+static bdla_Status bdla_async_submit(bdla_Task *t,
+	const bdla_AsyncRange *reads, int nreads, const bdla_AsyncRange *writes, int nwrites,
+	bdla_Task **task) {
+	bdla_BufferRecord *r;
+	bdla_Task **preds, **grown;
+	bdla_Status s;
+	int i, j, k, npreds = 0, maxpreds = 0, cap;
+
+	s = bdla_pool_start(0);
+	if (s != BDLA_GOOD) {
+		free(t);
+		if (task != NULL) { *task = NULL; }
+		return s;
+	}
+	bdla_mutex_lock(&bdla_async.lock);
+	/* Read after write, and write after read or write. */
+	for (i = 0; i < nreads + nwrites; ++i) {
+		bdla_AsyncRange range = i < nreads ? reads[i] : writes[i - nreads];
+		for (k = 0; k < bdla_async.nrecs; ++k) {
+			r = bdla_async.recs + k;
+			if (!bdla_async_overlaps(r->range, range)) { continue; }
+			maxpreds += 1 + (i >= nreads ? r->nreaders : 0);
+		}
+	}
+	preds = malloc(sizeof(bdla_Task *) * (maxpreds > 0 ? maxpreds : 1));
+	if (preds == NULL) { s = BDLA_MEM_ERROR; goto fail; }
+	for (i = 0; i < nreads + nwrites; ++i) {
+		bdla_AsyncRange range = i < nreads ? reads[i] : writes[i - nreads];
+		for (k = 0; k < bdla_async.nrecs; ++k) {
+			r = bdla_async.recs + k;
+			if (!bdla_async_overlaps(r->range, range)) { continue; }
+			if (r->writer != NULL) { preds[npreds++] = r->writer; }
+			if (i >= nreads) {
+				for (j = 0; j < r->nreaders; ++j) { preds[npreds++] = r->readers[j]; }
+			}
+		}
+	}
+	/* Remove duplicates and make room in each predecessor's successors. */
+	for (i = 0; i < npreds; ++i) {
+		for (j = 0; j < i; ++j) {
+			if (preds[j] == preds[i]) { preds[i--] = preds[--npreds]; break; }
+		}
+	}
+	for (i = 0; i < npreds; ++i) {
+		if (preds[i]->nsucc == preds[i]->capsucc) {
+			cap = 2 * preds[i]->capsucc + 4;
+			grown = realloc(preds[i]->succ, sizeof(bdla_Task *) * cap);
+			if (grown == NULL) { free(preds); s = BDLA_MEM_ERROR; goto fail; }
+			preds[i]->succ = grown;
+			preds[i]->capsucc = cap;
+		}
+	}
+	/* Make room for new records, and for t as a reader of existing ones. */
+	if (bdla_async.nrecs + nreads + nwrites > bdla_async.caprecs) {
+		cap = 2 * bdla_async.caprecs + nreads + nwrites;
+		r = realloc(bdla_async.recs, sizeof(bdla_BufferRecord) * cap);
+		if (r == NULL) { free(preds); s = BDLA_MEM_ERROR; goto fail; }
+		bdla_async.recs = r;
+		bdla_async.caprecs = cap;
+	}
+	for (i = 0; i < nreads; ++i) {
+		if ((r = bdla_async_find_locked(reads[i])) == NULL) {
+			r = bdla_async.recs + bdla_async.nrecs++;
+			memset(r, 0, sizeof(*r));
+			r->range = reads[i];
+		}
+		if (r->nreaders == r->capreaders) {
+			cap = 2 * r->capreaders + 4;
+			grown = realloc(r->readers, sizeof(bdla_Task *) * cap);
+			if (grown == NULL) { free(preds); s = BDLA_MEM_ERROR; goto fail; }
+			r->readers = grown;
+			r->capreaders = cap;
+		}
+	}
+	for (i = 0; i < nwrites; ++i) {
+		if (bdla_async_find_locked(writes[i]) == NULL) {
+			r = bdla_async.recs + bdla_async.nrecs++;
+			memset(r, 0, sizeof(*r));
+			r->range = writes[i];
+		}
+	}
+
+	/* Nothing can fail from here. */
+	t->refs = task != NULL ? 2 : 1;
+	t->npred = npreds;
+	for (i = 0; i < npreds; ++i) {
+		preds[i]->succ[preds[i]->nsucc++] = t;
+	}
+	free(preds);
+	for (i = 0; i < nwrites; ++i) {
+		r = bdla_async_find_locked(writes[i]);
+		r->writer = t;
+		r->nreaders = 0;
+	}
+	for (i = 0; i < nreads; ++i) {
+		if (bdla_async_contains(writes, nwrites, reads[i])
+			|| bdla_async_contains(reads, i, reads[i])) { continue; }
+		r = bdla_async_find_locked(reads[i]);
+		r->readers[r->nreaders++] = t;
+	}
+	++bdla_async.pending;
+	if (t->npred == 0) { bdla_async_push_locked(t); }
+	bdla_mutex_unlock(&bdla_async.lock);
+	if (task != NULL) { *task = t; }
+	return BDLA_GOOD;
+fail:
+	/* Records made for t before running out of memory have nothing in them. */
+	bdla_async_prune_locked();
+	bdla_mutex_unlock(&bdla_async.lock);
+	free(t);
+	if (task != NULL) { *task = NULL; }
+	return s;
+}
+
+static bdla_Task *bdla_async_newtask(void) {
+	bdla_Task *t = calloc(1, sizeof(bdla_Task));
+	if (t != NULL) { t->arg = t; }
+	return t;
+}
+
+BDLA_EXPORT bdla_Status bdla_async_init(int nthreads) {
+	return bdla_pool_start(nthreads);
+}
+
+BDLA_EXPORT void bdla_async_waitall(void) {
+	bdla_mutex_lock(&bdla_async.lock);
+	bdla_async_help_locked(NULL);
+	bdla_mutex_unlock(&bdla_async.lock);
+}
+
+BDLA_EXPORT void bdla_async_shutdown(void) {
+	bdla_async_waitall();
+	bdla_pool_stop();
+	bdla_mutex_lock(&bdla_async.lock);
+	free(bdla_async.recs);
+	bdla_async.recs = NULL;
+	bdla_async.nrecs = bdla_async.caprecs = 0;
+	bdla_mutex_unlock(&bdla_async.lock);
+}
+
+BDLA_EXPORT bdla_Status bdla_Task_wait(bdla_Task *task) {
+	assert(task != NULL);
+	bdla_Status s;
+	bdla_mutex_lock(&bdla_async.lock);
+	/* Rather than block, run whatever is ready. */
+	bdla_async_help_locked(&task->done);
+	s = task->status;
+	bdla_mutex_unlock(&bdla_async.lock);
+	return s;
+}
+
+BDLA_EXPORT int bdla_Task_done(bdla_Task *task) {
+	assert(task != NULL);
+	int done;
+	bdla_mutex_lock(&bdla_async.lock);
+	done = task->done;
+	bdla_mutex_unlock(&bdla_async.lock);
+	return done;
+}
+
+BDLA_EXPORT void bdla_Task_release(bdla_Task **task) {
+	assert(task != NULL);
+	if (*task == NULL) { return; }
+	bdla_mutex_lock(&bdla_async.lock);
+	bdla_async_unref_locked(*task);
+	bdla_mutex_unlock(&bdla_async.lock);
+	*task = NULL;
+}
+
+BDLA_EXPORT bdla_Status bdla_call_async(bdla_TaskFn fn, void *arg,
+	const bdla_Vxf *reads, int nreads, const bdla_Vxf *writes, int nwrites,
+	bdla_Task **task) {
+	assert(fn != NULL);
+	assert(nreads == 0 || reads != NULL);
+	assert(nwrites == 0 || writes != NULL);
+	bdla_AsyncRange *ranges;
+	bdla_Status s;
+	int i;
+	bdla_Task *t = bdla_async_newtask();
+	if (t == NULL) { return BDLA_MEM_ERROR; }
+	ranges = malloc(sizeof(bdla_AsyncRange) * (nreads + nwrites > 0 ? nreads + nwrites : 1));
+	if (ranges == NULL) { free(t); return BDLA_MEM_ERROR; }
+	for (i = 0; i < nreads; ++i) {
+		ranges[i] = bdla_async_range(reads[i].arr, reads[i].len);
+	}
+	for (i = 0; i < nwrites; ++i) {
+		ranges[nreads + i] = bdla_async_range(writes[i].arr, writes[i].len);
+	}
+	t->fn = fn;
+	t->arg = arg;
+	s = bdla_async_submit(t, ranges, nreads, ranges + nreads, nwrites, task);
+	free(ranges);
+	return s;
+}
+
+static bdla_Status bdla_async_gemm(void *arg) {
+	bdla_Task *t = arg;
+	return bdla_Mxf_gemm(t->u.gemm.alpha, t->u.gemm.A, t->u.gemm.A_trans,
+		t->u.gemm.B, t->u.gemm.B_trans, t->u.gemm.beta, &t->u.gemm.Y);
+}
+
+BDLA_EXPORT bdla_Status bdla_Mxf_gemm_async(float alpha, bdla_Mxf A, bdla_Transpose A_trans,
+	bdla_Mxf B, bdla_Transpose B_trans, float beta, bdla_Mxf Y, bdla_Task **task) {
+	assert(A.arr != NULL);
+	assert(B.arr != NULL);
+	assert(Y.arr != NULL);
+	int m = A_trans == BDLA_NO_TRANS ? A.dims[0] : A.dims[1];
+	int k = A_trans == BDLA_NO_TRANS ? A.dims[1] : A.dims[0];
+	int kb = B_trans == BDLA_NO_TRANS ? B.dims[0] : B.dims[1];
+	int n = B_trans == BDLA_NO_TRANS ? B.dims[1] : B.dims[0];
+	bdla_AsyncRange reads[3], writes[1];
+	if (k != kb || Y.dims[0] != m || Y.dims[1] != n) { return BDLA_DIMENSION_MISMATCH; }
+	bdla_Task *t = bdla_async_newtask();
+	if (t == NULL) { return BDLA_MEM_ERROR; }
+	t->fn = bdla_async_gemm;
+	t->u.gemm.alpha = alpha;
+	t->u.gemm.beta = beta;
+	t->u.gemm.A = A;
+	t->u.gemm.B = B;
+	t->u.gemm.Y = Y;
+	t->u.gemm.A_trans = A_trans;
+	t->u.gemm.B_trans = B_trans;
+	reads[0] = bdla_async_range(A.arr, (size_t)A.dims[0] * A.dims[1]);
+	reads[1] = bdla_async_range(B.arr, (size_t)B.dims[0] * B.dims[1]);
+	reads[2] = bdla_async_range(Y.arr, (size_t)m * n);
+	writes[0] = reads[2];
+	return bdla_async_submit(t, reads, beta != 0.f ? 3 : 2, writes, 1, task);
+}
+
+BDLA_EXPORT bdla_Status bdla_Mxf_mult_async(bdla_Mxf A, bdla_Mxf B, bdla_Mxf Y,
+	bdla_Task **task) {
+	return bdla_Mxf_gemm_async(1.f, A, BDLA_NO_TRANS, B, BDLA_NO_TRANS, 0.f, Y, task);
+}
+
+static bdla_Status bdla_async_gemv(void *arg) {
+	bdla_Task *t = arg;
+	return bdla_Mxf_gemv(t->u.gemv.alpha, t->u.gemv.A, t->u.gemv.A_trans,
+		t->u.gemv.x, t->u.gemv.beta, &t->u.gemv.y);
+}
+
+BDLA_EXPORT bdla_Status bdla_Mxf_gemv_async(float alpha, bdla_Mxf A, bdla_Transpose A_trans,
+	bdla_Vxf x, float beta, bdla_Vxf y, bdla_Task **task) {
+	assert(A.arr != NULL);
+	assert(x.arr != NULL);
+	assert(y.arr != NULL);
+	int m = A_trans == BDLA_NO_TRANS ? A.dims[0] : A.dims[1];
+	int n = A_trans == BDLA_NO_TRANS ? A.dims[1] : A.dims[0];
+	bdla_AsyncRange reads[3], writes[1];
+	if (x.len != n || y.len != m) { return BDLA_DIMENSION_MISMATCH; }
+	bdla_Task *t = bdla_async_newtask();
+	if (t == NULL) { return BDLA_MEM_ERROR; }
+	t->fn = bdla_async_gemv;
+	t->u.gemv.alpha = alpha;
+	t->u.gemv.beta = beta;
+	t->u.gemv.A = A;
+	t->u.gemv.A_trans = A_trans;
+	t->u.gemv.x = x;
+	t->u.gemv.y = y;
+	reads[0] = bdla_async_range(A.arr, (size_t)A.dims[0] * A.dims[1]);
+	reads[1] = bdla_async_range(x.arr, x.len);
+	reads[2] = bdla_async_range(y.arr, y.len);
+	writes[0] = reads[2];
+	return bdla_async_submit(t, reads, beta != 0.f ? 3 : 2, writes, 1, task);
+}
+
+BDLA_EXPORT bdla_Status bdla_Mxf_vmult_async(bdla_Mxf A, bdla_Vxf b, bdla_Vxf y,
+	bdla_Task **task) {
+	return bdla_Mxf_gemv_async(1.f, A, BDLA_NO_TRANS, b, 0.f, y, task);
+}
+
+static bdla_Status bdla_async_spmv(void *arg) {
+	bdla_Task *t = arg;
+	return bdla_SMxf_vmult(t->u.spmv.A, t->u.spmv.b, &t->u.spmv.y);
+}
+
+BDLA_EXPORT bdla_Status bdla_SMxf_vmult_async(bdla_SMxf A, bdla_Vxf b, bdla_Vxf y,
+	bdla_Task **task) {
+	assert(A.arr != NULL);
+	assert(b.arr != NULL);
+	assert(y.arr != NULL);
+	bdla_AsyncRange reads[2], writes[1];
+	if (b.len != A.dims[1] || y.len != A.dims[0]) { return BDLA_DIMENSION_MISMATCH; }
+	bdla_Task *t = bdla_async_newtask();
+	if (t == NULL) { return BDLA_MEM_ERROR; }
+	t->fn = bdla_async_spmv;
+	t->u.spmv.A = A;
+	t->u.spmv.b = b;
+	t->u.spmv.y = y;
+	reads[0] = bdla_async_range(A.arr, A.nnz);
+	reads[1] = bdla_async_range(b.arr, b.len);
+	writes[0] = bdla_async_range(y.arr, y.len);
+	return bdla_async_submit(t, reads, 2, writes, 1, task);
+}
+
+static bdla_Status bdla_async_jacobi(void *arg) {
+	bdla_Task *t = arg;
+	return bdla_Mxf_solve_jacobi(t->u.solve.A, t->u.solve.b, &t->u.solve.y,
+		t->u.solve.tol, t->u.solve.guess, t->u.solve.max_iter);
+}
+
+static bdla_Status bdla_async_gauss_seidel(void *arg) {
+	bdla_Task *t = arg;
+	return bdla_Mxf_solve_gauss_seidel(t->u.solve.A, t->u.solve.b, &t->u.solve.y,
+		t->u.solve.tol, t->u.solve.guess, t->u.solve.max_iter);
+}
+
+static bdla_Status bdla_async_solve(bdla_TaskFn fn, bdla_Mxf A, bdla_Vxf b, bdla_Vxf y,
+	float tol, bdla_Vxf *guess, int *max_iter, bdla_Task **task) {
+	assert(A.arr != NULL);
+	assert(b.arr != NULL);
+	assert(y.arr != NULL);
+	bdla_AsyncRange reads[3], writes[1];
+	if (y.len != A.dims[0]) { return BDLA_DIMENSION_MISMATCH; }
+	bdla_Task *t = bdla_async_newtask();
+	if (t == NULL) { return BDLA_MEM_ERROR; }
+	t->fn = fn;
+	t->u.solve.A = A;
+	t->u.solve.b = b;
+	t->u.solve.y = y;
+	t->u.solve.guess = guess;
+	t->u.solve.tol = tol;
+	t->u.solve.max_iter = max_iter;
+	reads[0] = bdla_async_range(A.arr, (size_t)A.dims[0] * A.dims[1]);
+	reads[1] = bdla_async_range(b.arr, b.len);
+	if (guess != NULL) { reads[2] = bdla_async_range(guess->arr, guess->len); }
+	writes[0] = bdla_async_range(y.arr, y.len);
+	return bdla_async_submit(t, reads, guess != NULL ? 3 : 2, writes, 1, task);
+}
+
+BDLA_EXPORT bdla_Status bdla_Mxf_solve_jacobi_async(bdla_Mxf A, bdla_Vxf b, bdla_Vxf y,
+	float tol, bdla_Vxf *guess, int *max_iter, bdla_Task **task) {
+	return bdla_async_solve(bdla_async_jacobi, A, b, y, tol, guess, max_iter, task);
+}
+
+BDLA_EXPORT bdla_Status bdla_Mxf_solve_gauss_seidel_async(bdla_Mxf A, bdla_Vxf b, bdla_Vxf y,
+	float tol, bdla_Vxf *guess, int *max_iter, bdla_Task **task) {
+	return bdla_async_solve(bdla_async_gauss_seidel, A, b, y, tol, guess, max_iter, task);
+}
+
+static bdla_Status bdla_async_sjacobi(void *arg) {
+	bdla_Task *t = arg;
+	return bdla_SMxf_solve_jacobi(t->u.ssolve.A, t->u.ssolve.b, &t->u.ssolve.y,
+		t->u.ssolve.tol, t->u.ssolve.guess, t->u.ssolve.max_iter);
+}
+
+static bdla_Status bdla_async_sgauss_seidel(void *arg) {
+	bdla_Task *t = arg;
+	return bdla_SMxf_solve_gauss_seidel(t->u.ssolve.A, t->u.ssolve.b, &t->u.ssolve.y,
+		t->u.ssolve.tol, t->u.ssolve.guess, t->u.ssolve.max_iter);
+}
+
+static bdla_Status bdla_async_ssolve(bdla_TaskFn fn, bdla_SMxf A, bdla_Vxf b, bdla_Vxf y,
+	float tol, bdla_Vxf *guess, int *max_iter, bdla_Task **task) {
+	assert(A.arr != NULL);
+	assert(b.arr != NULL);
+	assert(y.arr != NULL);
+	bdla_AsyncRange reads[3], writes[1];
+	if (y.len != A.dims[0]) { return BDLA_DIMENSION_MISMATCH; }
+	bdla_Task *t = bdla_async_newtask();
+	if (t == NULL) { return BDLA_MEM_ERROR; }
+	t->fn = fn;
+	t->u.ssolve.A = A;
+	t->u.ssolve.b = b;
+	t->u.ssolve.y = y;
+	t->u.ssolve.guess = guess;
+	t->u.ssolve.tol = tol;
+	t->u.ssolve.max_iter = max_iter;
+	reads[0] = bdla_async_range(A.arr, A.nnz);
+	reads[1] = bdla_async_range(b.arr, b.len);
+	if (guess != NULL) { reads[2] = bdla_async_range(guess->arr, guess->len); }
+	writes[0] = bdla_async_range(y.arr, y.len);
+	return bdla_async_submit(t, reads, guess != NULL ? 3 : 2, writes, 1, task);
+}
+
+BDLA_EXPORT bdla_Status bdla_SMxf_solve_jacobi_async(bdla_SMxf A, bdla_Vxf b, bdla_Vxf y,
+	float tol, bdla_Vxf *guess, int *max_iter, bdla_Task **task) {
+	return bdla_async_ssolve(bdla_async_sjacobi, A, b, y, tol, guess, max_iter, task);
+}
+
+BDLA_EXPORT bdla_Status bdla_SMxf_solve_gauss_seidel_async(bdla_SMxf A, bdla_Vxf b, bdla_Vxf y,
+	float tol, bdla_Vxf *guess, int *max_iter, bdla_Task **task) {
+	return bdla_async_ssolve(bdla_async_sgauss_seidel, A, b, y, tol, guess, max_iter, task);
+}
@@ -0,0 +1,421 @@
+#include "libbdla.h"
+/*============================================================================
+blasBMxf.c
+
+Batched small float matrix linear algebra.
+
+Each routine applies a hand written kernel to every matrix in the batch. For
+matrices this small the cblas dispatch costs more than the arithmetic, so the
+parallelism is across the batch rather than inside each matrix.
+
+Copyright(c) 2019 HJA Bird
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files(the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions :
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+============================================================================*/
+#include <assert.h>
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "alloc.h"
+#include "threadpool.h"
+
+/* Kernels for a single matrix of the batch --------------------------------*/
+static void bdla_BMxf_kernel_mult(int m, int n, int p,
+	const float *A, const float *B, float *Y) {
+	int i, j, k;
+	for (i = 0; i < m; ++i) {
+		float *yrow = Y + i * p;
+		for (j = 0; j < p; ++j) { yrow[j] = 0.f; }
+		for (k = 0; k < n; ++k) {
+			float aik = A[i * n + k];
+			const float *brow = B + k * p;
+			for (j = 0; j < p; ++j) {
+				yrow[j] += aik * brow[j];
+			}
+		}
+	}
+}
+
+/* Partial pivoting LU in place. piv[k] is the row swapped with row k. */
+static int bdla_BMxf_kernel_lu(int n, float *A, int *piv) {
+	int i, j, k, p, singular = 0;
+	float maxval, tmp, inv;
+	for (k = 0; k < n; ++k) {
+		p = k;
+		maxval = fabsf(A[k * n + k]);
+		for (i = k + 1; i < n; ++i) {
+			if (fabsf(A[i * n + k]) > maxval) {
+				maxval = fabsf(A[i * n + k]);
+				p = i;
+			}
+		}
+		piv[k] = p;
+		if (p != k) {
+			for (j = 0; j < n; ++j) {
+				tmp = A[k * n + j];
+				A[k * n + j] = A[p * n + j];
+				A[p * n + j] = tmp;
+			}
+		}
+		if (A[k * n + k] == 0.f) { singular = 1; continue; }
+		inv = 1.f / A[k * n + k];
+		for (i = k + 1; i < n; ++i) {
+			float l = A[i * n + k] * inv;
+			A[i * n + k] = l;
+			for (j = k + 1; j < n; ++j) {
+				A[i * n + j] -= l * A[k * n + j];
+			}
+		}
+	}
+	return singular;
+}
+
+static void bdla_BMxf_kernel_lusolve(int n, const float *LU, const int *piv,
+	const float *b, float *y) {
+	int i, j;
+	float tmp;
+	if (y != b) { memcpy(y, b, sizeof(float) * n); }
+	for (i = 0; i < n; ++i) {
+		if (piv[i] != i) {
+			tmp = y[i]; y[i] = y[piv[i]]; y[piv[i]] = tmp;
+		}
+	}
+	for (i = 1; i < n; ++i) {			/* Unit lower */
+		for (j = 0; j < i; ++j) {
+			y[i] -= LU[i * n + j] * y[j];
+		}
+	}
+	for (i = n - 1; i >= 0; --i) {		/* Upper */
+		for (j = i + 1; j < n; ++j) {
+			y[i] -= LU[i * n + j] * y[j];
+		}
+		y[i] /= LU[i * n + i];
+	}
+}
+
+/* Cholesky in place. Leaves L in the lower triangle and zeros the upper. */
+static int bdla_BMxf_kernel_cholesky(int n, float *A) {
+	int i, j, k;
+	float acc;
+	for (j = 0; j < n; ++j) {
+		acc = A[j * n + j];
+		for (k = 0; k < j; ++k) {
+			acc -= A[j * n + k] * A[j * n + k];
+		}
+		if (!(acc > 0.f)) { return 1; }
+		acc = sqrtf(acc);
+		A[j * n + j] = acc;
+		for (i = j + 1; i < n; ++i) {
+			float v = A[i * n + j];
+			for (k = 0; k < j; ++k) {
+				v -= A[i * n + k] * A[j * n + k];
+			}
+			A[i * n + j] = v / acc;
+			A[j * n + i] = 0.f;
+		}
+	}
+	return 0;
+}
+
+static void bdla_BMxf_kernel_cholsolve(int n, const float *L,
+	const float *b, float *y) {
+	int i, j;
+	if (y != b) { memcpy(y, b, sizeof(float) * n); }
+	for (i = 0; i < n; ++i) {			/* L z = b */
+		for (j = 0; j < i; ++j) {
+			y[i] -= L[i * n + j] * y[j];
+		}
+		y[i] /= L[i * n + i];
+	}
+	for (i = n - 1; i >= 0; --i) {		/* L^T y = z */
+		for (j = i + 1; j < n; ++j) {
+			y[i] -= L[j * n + i] * y[j];
+		}
+		y[i] /= L[i * n + i];
+	}
+}
+
+/* Batch routines ----------------------------------------------------------*/
+/* Shared by the batched operations: each handles a range of the batch. */
+typedef struct {
+	bdla_BMxf A, B;
+	bdla_BMxf *Y;
+	int *piv;
+	int alias, chol;
+	/* Set by any chunk that runs out of memory or hits a bad matrix. */
+	volatile int failed, bad;
+} bdla_BatchCtx;
+
+static void bdla_BMxf_mult_range(void *ctx, int begin, int end) {
+	bdla_BatchCtx *c = ctx;
+	int i, m = c->A.dims[0], n = c->A.dims[1], p = c->B.dims[1];
+	float *out, *tmp = NULL;
+	/* An aliased output needs somewhere to put each product. */
+	if (c->alias) {
+		tmp = malloc(sizeof(float) * m * p);
+		if (tmp == NULL) { c->failed = 1; return; }
+	}
+	for (i = begin; i < end; ++i) {
+		out = c->Y->arr + (size_t)i * c->Y->stride;
+		bdla_BMxf_kernel_mult(m, n, p, c->A.arr + (size_t)i * c->A.stride,
+			c->B.arr + (size_t)i * c->B.stride, c->alias ? tmp : out);
+		if (c->alias) { memcpy(out, tmp, sizeof(float) * m * p); }
+	}
+	free(tmp);
+}
+
+static void bdla_BMxf_lu_range(void *ctx, int begin, int end) {
+	bdla_BatchCtx *c = ctx;
+	int i, n = c->A.dims[0];
+	for (i = begin; i < end; ++i) {
+		if (bdla_BMxf_kernel_lu(n, c->A.arr + (size_t)i * c->A.stride, c->piv + (size_t)i * n)) {
+			c->bad = 1;
+		}
+	}
+}
+
+static void bdla_BMxf_lusolve_range(void *ctx, int begin, int end) {
+	bdla_BatchCtx *c = ctx;
+	int i, n = c->A.dims[0];
+	for (i = begin; i < end; ++i) {
+		bdla_BMxf_kernel_lusolve(n, c->A.arr + (size_t)i * c->A.stride, c->piv + (size_t)i * n,
+			c->B.arr + (size_t)i * c->B.stride, c->Y->arr + (size_t)i * c->Y->stride);
+	}
+}
+
+static void bdla_BMxf_cholesky_range(void *ctx, int begin, int end) {
+	bdla_BatchCtx *c = ctx;
+	int i, n = c->A.dims[0];
+	for (i = begin; i < end; ++i) {
+		if (bdla_BMxf_kernel_cholesky(n, c->A.arr + (size_t)i * c->A.stride)) {
+			c->bad = 1;
+		}
+	}
+}
+
+static void bdla_BMxf_cholsolve_range(void *ctx, int begin, int end) {
+	bdla_BatchCtx *c = ctx;
+	int i, n = c->A.dims[0];
+	for (i = begin; i < end; ++i) {
+		bdla_BMxf_kernel_cholsolve(n, c->A.arr + (size_t)i * c->A.stride,
+			c->B.arr + (size_t)i * c->B.stride, c->Y->arr + (size_t)i * c->Y->stride);
+	}
+}
+
+static void bdla_BMxf_solve_range(void *ctx, int begin, int end) {
+	bdla_BatchCtx *c = ctx;
+	int i, n = c->A.dims[0];
+	float *bi, *yi;
+	/* Factor a per-chunk copy of each matrix so A is left untouched. */
+	float *work = malloc(sizeof(float) * n * n);
+	int *piv = malloc(sizeof(int) * n);
+	if (work == NULL || piv == NULL) {
+		c->failed = 1;
+		free(work);
+		free(piv);
+		return;
+	}
+	for (i = begin; i < end; ++i) {
+		bi = c->B.arr + (size_t)i * c->B.stride;
+		yi = c->Y->arr + (size_t)i * c->Y->stride;
+		memcpy(work, c->A.arr + (size_t)i * c->A.stride, sizeof(float) * n * n);
+		if (c->chol) {
+			if (bdla_BMxf_kernel_cholesky(n, work)) { c->bad = 1; continue; }
+			bdla_BMxf_kernel_cholsolve(n, work, bi, yi);
+		}
+		else {
+			if (bdla_BMxf_kernel_lu(n, work, piv)) { c->bad = 1; continue; }
+			bdla_BMxf_kernel_lusolve(n, work, piv, bi, yi);
+		}
+	}
+	free(work);
+	free(piv);
+}
+
+BDLA_EXPORT bdla_BMxf bdla_BMxf_create(int count, int r, int c) {
+	assert(count > 0);
+	assert(r > 0);
+	assert(c > 0);
+	bdla_BMxf ret;
+	ret.dims[0] = r;
+	ret.dims[1] = c;
+	ret.count = count;
+	ret.stride = r * c;
+	ret.arr = bdla_alloc_floats((size_t)count * r * c);
+	return ret;
+}
+
+BDLA_EXPORT void bdla_BMxf_release(bdla_BMxf *mat) {
+	if (mat != NULL) {
+		assert(mat->arr != NULL);
+		free(mat->arr); mat->arr = NULL;
+		mat->dims[0] = 0;
+		mat->dims[1] = 0;
+		mat->count = 0;
+		mat->stride = 0;
+	}
+	return;
+}
+
+BDLA_EXPORT bdla_BMxf bdla_BMxf_copy(bdla_BMxf mat) {
+	assert(mat.arr != NULL);
+	bdla_BMxf ret = mat;
+	ret.arr = bdla_alloc_floats((size_t)mat.count * mat.stride);
+	memcpy(ret.arr, mat.arr, sizeof(float) * (size_t)mat.count * mat.stride);
+	return ret;
+}
+
+BDLA_EXPORT int bdla_BMxf_count(bdla_BMxf A) {
+	assert(A.arr != NULL);
+	return A.count;
+}
+
+BDLA_EXPORT int bdla_BMxf_rows(bdla_BMxf A) {
+	assert(A.arr != NULL);
+	return A.dims[0];
+}
+
+BDLA_EXPORT int bdla_BMxf_cols(bdla_BMxf A) {
+	assert(A.arr != NULL);
+	return A.dims[1];
+}
+
+BDLA_EXPORT bdla_Mxf bdla_BMxf_matrix(bdla_BMxf A, int i) {
+	assert(A.arr != NULL);
+	assert(i >= 0 && i < A.count && "Bad batch index");
+	bdla_Mxf ret = { { A.dims[0], A.dims[1] }, A.arr + (size_t)i * A.stride };
+	return ret;
+}
+
+BDLA_EXPORT bdla_Status bdla_BMxf_mult(bdla_BMxf A, bdla_BMxf B, bdla_BMxf *Y) {
+	assert(A.arr != NULL);
+	assert(B.arr != NULL);
+	assert(Y != NULL);
+	assert(Y->arr != NULL);
+	if (A.count != B.count || A.count != Y->count) { return BDLA_DIMENSION_MISMATCH; }
+	if (A.dims[1] != B.dims[0]) { return BDLA_DIMENSION_MISMATCH; }
+	if (Y->dims[0] != A.dims[0] || Y->dims[1] != B.dims[1]) {
+		return BDLA_DIMENSION_MISMATCH;
+	}
+	bdla_BatchCtx c = { 0 };
+	c.A = A;
+	c.B = B;
+	c.Y = Y;
+	c.alias = Y->arr == A.arr || Y->arr == B.arr;
+	bdla_parallel_for(A.count, bdla_parallel_grain((size_t)A.dims[0] * A.dims[1] * B.dims[1]),
+		bdla_BMxf_mult_range, &c);
+	return c.failed ? BDLA_MEM_ERROR : BDLA_GOOD;
+}
+
+BDLA_EXPORT bdla_Status bdla_BMxf_vmult(bdla_BMxf A, bdla_BMxf b, bdla_BMxf *y) {
+	assert(y != NULL);
+	if (b.dims[1] != 1 || y->dims[1] != 1) { return BDLA_DIMENSION_MISMATCH; }
+	return bdla_BMxf_mult(A, b, y);
+}
+
+BDLA_EXPORT bdla_Status bdla_BMxf_lu(bdla_BMxf *A, int *piv) {
+	assert(A != NULL);
+	assert(A->arr != NULL);
+	assert(piv != NULL);
+	if (A->dims[0] != A->dims[1]) { return BDLA_NONSQUARE; }
+	size_t n = A->dims[0];
+	bdla_BatchCtx c = { 0 };
+	c.A = *A;
+	c.piv = piv;
+	bdla_parallel_for(A->count, bdla_parallel_grain(n * n * n), bdla_BMxf_lu_range, &c);
+	return c.bad ? BDLA_BAD_PROPERTY : BDLA_GOOD;
+}
+
+BDLA_EXPORT bdla_Status bdla_BMxf_lusolve(bdla_BMxf LU, const int *piv,
+	bdla_BMxf b, bdla_BMxf *y) {
+	assert(LU.arr != NULL);
+	assert(piv != NULL);
+	assert(b.arr != NULL);
+	assert(y != NULL);
+	assert(y->arr != NULL);
+	if (LU.dims[0] != LU.dims[1]) { return BDLA_NONSQUARE; }
+	if (LU.count != b.count || b.count != y->count) { return BDLA_DIMENSION_MISMATCH; }
+	if (b.dims[0] != LU.dims[0] || b.dims[1] != 1 ||
+		y->dims[0] != LU.dims[0] || y->dims[1] != 1) {
+		return BDLA_DIMENSION_MISMATCH;
+	}
+	size_t n = LU.dims[0];
+	bdla_BatchCtx c = { 0 };
+	c.A = LU;
+	c.B = b;
+	c.Y = y;
+	c.piv = (int *)piv;
+	bdla_parallel_for(LU.count, bdla_parallel_grain(n * n), bdla_BMxf_lusolve_range, &c);
+	return BDLA_GOOD;
+}
+
+BDLA_EXPORT bdla_Status bdla_BMxf_cholesky(bdla_BMxf *A) {
+	assert(A != NULL);
+	assert(A->arr != NULL);
+	if (A->dims[0] != A->dims[1]) { return BDLA_NONSQUARE; }
+	size_t n = A->dims[0];
+	bdla_BatchCtx c = { 0 };
+	c.A = *A;
+	bdla_parallel_for(A->count, bdla_parallel_grain(n * n * n), bdla_BMxf_cholesky_range, &c);
+	return c.bad ? BDLA_BAD_PROPERTY : BDLA_GOOD;
+}
+
+BDLA_EXPORT bdla_Status bdla_BMxf_cholsolve(bdla_BMxf L, bdla_BMxf b, bdla_BMxf *y) {
+	assert(L.arr != NULL);
+	assert(b.arr != NULL);
+	assert(y != NULL);
+	assert(y->arr != NULL);
+	if (L.dims[0] != L.dims[1]) { return BDLA_NONSQUARE; }
+	if (L.count != b.count || b.count != y->count) { return BDLA_DIMENSION_MISMATCH; }
+	if (b.dims[0] != L.dims[0] || b.dims[1] != 1 ||
+		y->dims[0] != L.dims[0] || y->dims[1] != 1) {
+		return BDLA_DIMENSION_MISMATCH;
+	}
+	size_t n = L.dims[0];
+	bdla_BatchCtx c = { 0 };
+	c.A = L;
+	c.B = b;
+	c.Y = y;
+	bdla_parallel_for(L.count, bdla_parallel_grain(n * n), bdla_BMxf_cholsolve_range, &c);
+	return BDLA_GOOD;
+}
+
+BDLA_EXPORT bdla_Status bdla_BMxf_solve(bdla_BMxf A, bdla_MatrixProperty A_prop,
+	bdla_BMxf b, bdla_BMxf *y) {
+	assert(A.arr != NULL);
+	assert(b.arr != NULL);
+	assert(y != NULL);
+	assert(y->arr != NULL);
+	if (A.dims[0] != A.dims[1]) { return BDLA_NONSQUARE; }
+	if (A.count != b.count || b.count != y->count) { return BDLA_DIMENSION_MISMATCH; }
+	if (b.dims[0] != A.dims[0] || b.dims[1] != 1 ||
+		y->dims[0] != A.dims[0] || y->dims[1] != 1) {
+		return BDLA_DIMENSION_MISMATCH;
+	}
+	size_t n = A.dims[0];
+	bdla_BatchCtx c = { 0 };
+	c.A = A;
+	c.B = b;
+	c.Y = y;
+	c.chol = A_prop == BDLA_MATRIX_POSITIVE_DEFINITE;
+	bdla_parallel_for(A.count, bdla_parallel_grain(n * n * n), bdla_BMxf_solve_range, &c);
+	if (c.failed) { return BDLA_MEM_ERROR; }
+	return c.bad ? BDLA_BAD_PROPERTY : BDLA_GOOD;
+}
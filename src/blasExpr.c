@@ -0,0 +1,393 @@
+#include "libbdla.h"
+/*============================================================================
+blasExpr.c
+
+Lazy elementwise expressions, evaluated as one fused pass over the data.
+
+Copyright(c) 2019 HJA Bird
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files(the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions :
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+============================================================================*/
+#include <assert.h>
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "threadpool.h"
+#include "threads.h"
+
+/* Elements per block. Every live node's block of values stays in cache
+while the rest of the expression reads it. */
+#define BDLA_EXPR_BLOCK 256
+
+/* Guards merging per-chunk maxima. */
+static bdla_Mutex bdla_expr_lock = BDLA_MUTEX_INIT;
+
+BDLA_EXPORT bdla_Expr bdla_Expr_create(void) {
+	bdla_Expr ret;
+	memset(&ret, 0, sizeof(ret));
+	ret.status = BDLA_GOOD;
+	return ret;
+}
+
+static int bdla_Expr_push(bdla_Expr *e, bdla_ExprOp op, int a, int b, float f) {
+	bdla_ExprNode *nd;
+	if (e->status != BDLA_GOOD) { return -1; }
+	if (a < 0 || a >= e->count || b < 0 || b >= e->count) {
+		e->status = BDLA_BAD_INDEX;
+		return -1;
+	}
+	if (e->count == BDLA_EXPR_MAX_NODES) {
+		e->status = BDLA_MEM_ERROR;	/* No room for another node. */
+		return -1;
+	}
+	nd = e->nodes + e->count;
+	nd->op = op;
+	nd->a = a;
+	nd->b = b;
+	nd->f = f;
+	nd->arr = NULL;
+	return e->count++;
+}
+
+static int bdla_Expr_leaf(bdla_Expr *e, const float *arr, int len) {
+	bdla_ExprNode *nd;
+	if (e->status != BDLA_GOOD) { return -1; }
+	if (e->len != 0 && e->len != len) {
+		e->status = BDLA_DIMENSION_MISMATCH;
+		return -1;
+	}
+	if (e->count == BDLA_EXPR_MAX_NODES) {
+		e->status = BDLA_MEM_ERROR;
+		return -1;
+	}
+	e->len = len;
+	nd = e->nodes + e->count;
+	nd->op = BDLA_EXPR_LEAF;
+	nd->a = nd->b = 0;
+	nd->f = 0.f;
+	nd->arr = arr;
+	return e->count++;
+}
+
+BDLA_EXPORT int bdla_Expr_vxf(bdla_Expr *e, bdla_Vxf a) {
+	assert(e != NULL);
+	assert(a.arr != NULL);
+	assert(a.len > 0);
+	return bdla_Expr_leaf(e, a.arr, a.len);
+}
+
+BDLA_EXPORT int bdla_Expr_mxf(bdla_Expr *e, bdla_Mxf A) {
+	assert(e != NULL);
+	assert(A.arr != NULL);
+	assert(A.dims[0] > 0);
+	assert(A.dims[1] > 0);
+	if (e->status == BDLA_GOOD && e->dims[0] != 0 &&
+		(e->dims[0] != A.dims[0] || e->dims[1] != A.dims[1])) {
+		e->status = BDLA_DIMENSION_MISMATCH;
+		return -1;
+	}
+	int ret = bdla_Expr_leaf(e, A.arr, A.dims[0] * A.dims[1]);
+	if (ret >= 0) {
+		e->dims[0] = A.dims[0];
+		e->dims[1] = A.dims[1];
+	}
+	return ret;
+}
+
+BDLA_EXPORT int bdla_Expr_const(bdla_Expr *e, float f) {
+	assert(e != NULL);
+	if (e->status != BDLA_GOOD) { return -1; }
+	if (e->count == BDLA_EXPR_MAX_NODES) {
+		e->status = BDLA_MEM_ERROR;
+		return -1;
+	}
+	bdla_ExprNode *nd = e->nodes + e->count;
+	nd->op = BDLA_EXPR_CONST;
+	nd->a = nd->b = 0;
+	nd->f = f;
+	nd->arr = NULL;
+	return e->count++;
+}
+
+BDLA_EXPORT int bdla_Expr_plus(bdla_Expr *e, int a, int b) {
+	assert(e != NULL);
+	return bdla_Expr_push(e, BDLA_EXPR_PLUS, a, b, 0.f);
+}
+
+BDLA_EXPORT int bdla_Expr_minus(bdla_Expr *e, int a, int b) {
+	assert(e != NULL);
+	return bdla_Expr_push(e, BDLA_EXPR_MINUS, a, b, 0.f);
+}
+
+BDLA_EXPORT int bdla_Expr_ewmult(bdla_Expr *e, int a, int b) {
+	assert(e != NULL);
+	return bdla_Expr_push(e, BDLA_EXPR_EWMULT, a, b, 0.f);
+}
+
+BDLA_EXPORT int bdla_Expr_ewdiv(bdla_Expr *e, int a, int b) {
+	assert(e != NULL);
+	return bdla_Expr_push(e, BDLA_EXPR_EWDIV, a, b, 0.f);
+}
+
+BDLA_EXPORT int bdla_Expr_min(bdla_Expr *e, int a, int b) {
+	assert(e != NULL);
+	return bdla_Expr_push(e, BDLA_EXPR_MIN, a, b, 0.f);
+}
+
+BDLA_EXPORT int bdla_Expr_max(bdla_Expr *e, int a, int b) {
+	assert(e != NULL);
+	return bdla_Expr_push(e, BDLA_EXPR_MAX, a, b, 0.f);
+}
+
+BDLA_EXPORT int bdla_Expr_fplus(bdla_Expr *e, int a, float f) {
+	assert(e != NULL);
+	return bdla_Expr_push(e, BDLA_EXPR_FPLUS, a, a, f);
+}
+
+BDLA_EXPORT int bdla_Expr_fmult(bdla_Expr *e, int a, float f) {
+	assert(e != NULL);
+	return bdla_Expr_push(e, BDLA_EXPR_FMULT, a, a, f);
+}
+
+BDLA_EXPORT int bdla_Expr_axpy(bdla_Expr *e, float alpha, int x, int y) {
+	assert(e != NULL);
+	return bdla_Expr_push(e, BDLA_EXPR_AXPY, x, y, alpha);
+}
+
+BDLA_EXPORT int bdla_Expr_abs(bdla_Expr *e, int a) {
+	assert(e != NULL);
+	return bdla_Expr_push(e, BDLA_EXPR_ABS, a, a, 0.f);
+}
+
+BDLA_EXPORT int bdla_Expr_sqrt(bdla_Expr *e, int a) {
+	assert(e != NULL);
+	return bdla_Expr_push(e, BDLA_EXPR_SQRT, a, a, 0.f);
+}
+
+/* Evaluate the live nodes up to root for elements [off, off + n). Each
+intermediate gets its own slot of scratch; leaves are read in place. The
+root is written straight to out when out isn't NULL. Returns the root's
+values. */
+static const float *bdla_Expr_block(const bdla_Expr *e, const char *live,
+	int root, size_t off, int n, float *scratch, float *out) {
+	const float *val[BDLA_EXPR_MAX_NODES];
+	const float *a, *b;
+	const bdla_ExprNode *nd;
+	float *dst, f;
+	int i, j;
+	for (i = 0; i <= root; ++i) {
+		if (!live[i]) { continue; }
+		nd = e->nodes + i;
+		if (nd->op == BDLA_EXPR_LEAF) {
+			val[i] = nd->arr + off;
+			if (i == root && out != NULL && out != val[i]) {
+				memcpy(out, val[i], sizeof(float) * n);
+			}
+			continue;
+		}
+		dst = (i == root && out != NULL) ? out : scratch + (size_t)i * BDLA_EXPR_BLOCK;
+		f = nd->f;
+		switch (nd->op) {
+		case BDLA_EXPR_CONST:
+			for (j = 0; j < n; ++j) { dst[j] = f; }
+			break;
+		case BDLA_EXPR_PLUS:
+			a = val[nd->a]; b = val[nd->b];
+			for (j = 0; j < n; ++j) { dst[j] = a[j] + b[j]; }
+			break;
+		case BDLA_EXPR_MINUS:
+			a = val[nd->a]; b = val[nd->b];
+			for (j = 0; j < n; ++j) { dst[j] = a[j] - b[j]; }
+			break;
+		case BDLA_EXPR_EWMULT:
+			a = val[nd->a]; b = val[nd->b];
+			for (j = 0; j < n; ++j) { dst[j] = a[j] * b[j]; }
+			break;
+		case BDLA_EXPR_EWDIV:
+			a = val[nd->a]; b = val[nd->b];
+			for (j = 0; j < n; ++j) { dst[j] = a[j] / b[j]; }
+			break;
+		case BDLA_EXPR_MIN:
+			a = val[nd->a]; b = val[nd->b];
+			for (j = 0; j < n; ++j) { dst[j] = a[j] < b[j] ? a[j] : b[j]; }
+			break;
+		case BDLA_EXPR_MAX:
+			a = val[nd->a]; b = val[nd->b];
+			for (j = 0; j < n; ++j) { dst[j] = a[j] > b[j] ? a[j] : b[j]; }
+			break;
+		case BDLA_EXPR_FPLUS:
+			a = val[nd->a];
+			for (j = 0; j < n; ++j) { dst[j] = a[j] + f; }
+			break;
+		case BDLA_EXPR_FMULT:
+			a = val[nd->a];
+			for (j = 0; j < n; ++j) { dst[j] = a[j] * f; }
+			break;
+		case BDLA_EXPR_AXPY:
+			a = val[nd->a]; b = val[nd->b];
+			for (j = 0; j < n; ++j) { dst[j] = f * a[j] + b[j]; }
+			break;
+		case BDLA_EXPR_ABS:
+			a = val[nd->a];
+			for (j = 0; j < n; ++j) { dst[j] = fabsf(a[j]); }
+			break;
+		case BDLA_EXPR_SQRT:
+			a = val[nd->a];
+			for (j = 0; j < n; ++j) { dst[j] = sqrtf(a[j]); }
+			break;
+		default:
+			assert(0 && "Unknown expression op");
+		}
+		val[i] = dst;
+	}
+	return val[root];
+}
+
+typedef struct {
+	const bdla_Expr *e;
+	const char *live;
+	int root;
+	float *out;
+	bdla_Reduction op;
+	int reduce;
+	float maxabs;
+} bdla_ExprCtx;
+
+/* Evaluate blocks [begin, end), returning their part of a sum reduction. */
+static double bdla_Expr_blocks(void *ctx, int begin, int end) {
+	bdla_ExprCtx *c = ctx;
+	float scratch[BDLA_EXPR_MAX_NODES * BDLA_EXPR_BLOCK];
+	double part = 0.;
+	float pmax = 0.f, v;
+	const float *vals;
+	size_t off;
+	int blk, j, n, len = c->e->len;
+	for (blk = begin; blk < end; ++blk) {
+		off = (size_t)blk * BDLA_EXPR_BLOCK;
+		n = len - (int)off < BDLA_EXPR_BLOCK ? len - (int)off : BDLA_EXPR_BLOCK;
+		vals = bdla_Expr_block(c->e, c->live, c->root, off, n, scratch,
+			c->out != NULL ? c->out + off : NULL);
+		if (!c->reduce) { continue; }
+		switch (c->op) {
+		case BDLA_REDUCE_SUM:
+			for (j = 0; j < n; ++j) { part += vals[j]; }
+			break;
+		case BDLA_REDUCE_SUMSQ:
+			for (j = 0; j < n; ++j) { part += (double)vals[j] * vals[j]; }
+			break;
+		case BDLA_REDUCE_MAXABS:
+			for (j = 0; j < n; ++j) {
+				v = fabsf(vals[j]);
+				pmax = v > pmax ? v : pmax;
+			}
+			break;
+		}
+	}
+	if (c->reduce && c->op == BDLA_REDUCE_MAXABS) {
+		bdla_mutex_lock(&bdla_expr_lock);
+		c->maxabs = pmax > c->maxabs ? pmax : c->maxabs;
+		bdla_mutex_unlock(&bdla_expr_lock);
+	}
+	return part;
+}
+
+/* Evaluate root over the whole length, writing to out and / or reducing
+to result when they aren't NULL. */
+static void bdla_Expr_run(const bdla_Expr *e, int root, float *out,
+	bdla_Reduction op, float *result) {
+	char live[BDLA_EXPR_MAX_NODES];
+	bdla_ExprCtx c;
+	double total;
+	int i, nlive = 0;
+	/* Only evaluate nodes root depends on. */
+	memset(live, 0, sizeof(live));
+	live[root] = 1;
+	for (i = root; i >= 0; --i) {
+		if (live[i] && e->nodes[i].op != BDLA_EXPR_LEAF
+			&& e->nodes[i].op != BDLA_EXPR_CONST) {
+			live[e->nodes[i].a] = 1;
+			live[e->nodes[i].b] = 1;
+		}
+		nlive += live[i];
+	}
+	c.e = e;
+	c.live = live;
+	c.root = root;
+	c.out = out;
+	c.op = op;
+	c.reduce = result != NULL;
+	c.maxabs = 0.f;
+	total = bdla_parallel_sum((e->len + BDLA_EXPR_BLOCK - 1) / BDLA_EXPR_BLOCK,
+		bdla_parallel_grain((size_t)BDLA_EXPR_BLOCK * nlive), bdla_Expr_blocks, &c);
+	if (result != NULL) {
+		*result = op == BDLA_REDUCE_MAXABS ? c.maxabs : (float)total;
+	}
+}
+
+static bdla_Status bdla_Expr_check(const bdla_Expr *e, int node) {
+	if (e->status != BDLA_GOOD) { return e->status; }
+	if (node < 0 || node >= e->count) { return BDLA_BAD_INDEX; }
+	if (e->len == 0) { return BDLA_DIMENSION_MISMATCH; }	/* Nothing sets the size. */
+	return BDLA_GOOD;
+}
+
+BDLA_EXPORT bdla_Status bdla_Expr_evalVxf(const bdla_Expr *e, int node, bdla_Vxf *y) {
+	assert(e != NULL);
+	assert(y != NULL);
+	assert(y->arr != NULL);
+	bdla_Status s = bdla_Expr_check(e, node);
+	if (s != BDLA_GOOD) { return s; }
+	if (y->len != e->len) {
+		if (bdla_Vxf_resize(y, e->len) == BDLA_MEM_ERROR) { return BDLA_MEM_ERROR; }
+	}
+	bdla_Expr_run(e, node, y->arr, BDLA_REDUCE_SUM, NULL);
+	return BDLA_GOOD;
+}
+
+BDLA_EXPORT bdla_Status bdla_Expr_evalMxf(const bdla_Expr *e, int node, bdla_Mxf *Y) {
+	assert(e != NULL);
+	assert(Y != NULL);
+	assert(Y->arr != NULL);
+	bdla_Status s = bdla_Expr_check(e, node);
+	if (s != BDLA_GOOD) { return s; }
+	if (e->dims[0] != 0) {
+		if (Y->dims[0] != e->dims[0] || Y->dims[1] != e->dims[1]) {
+			if (bdla_Mxf_resize(Y, e->dims[0], e->dims[1]) == BDLA_MEM_ERROR) {
+				return BDLA_MEM_ERROR;
+			}
+		}
+	}
+	else if (Y->dims[0] * Y->dims[1] != e->len) {
+		return BDLA_DIMENSION_MISMATCH;	/* Only vector leaves: no shape to use. */
+	}
+	bdla_Expr_run(e, node, Y->arr, BDLA_REDUCE_SUM, NULL);
+	return BDLA_GOOD;
+}
+
+BDLA_EXPORT bdla_Status bdla_Expr_reduce(const bdla_Expr *e, int node,
+	bdla_Reduction op, float *result) {
+	assert(e != NULL);
+	assert(result != NULL);
+	assert(op == BDLA_REDUCE_SUM || op == BDLA_REDUCE_SUMSQ || op == BDLA_REDUCE_MAXABS);
+	bdla_Status s = bdla_Expr_check(e, node);
+	if (s != BDLA_GOOD) { return s; }
+	bdla_Expr_run(e, node, NULL, op, result);
+	return BDLA_GOOD;
+}
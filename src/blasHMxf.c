@@ -0,0 +1,358 @@
+#include "libbdla.h"
+/*============================================================================
+blasHMxf.c
+
+Dense matrices stored as 16 bit floats and widened to float for arithmetic.
+
+Copyright(c) 2019 HJA Bird
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files(the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions :
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+============================================================================*/
+#include <assert.h>
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "alloc.h"
+#include "threadpool.h"
+
+/* Loads are widened eight or sixteen at a time where the instruction set
+allows. BF16 widens exactly with a shift, so it only needs integer SIMD. */
+#if defined(__AVX512F__)
+#include <immintrin.h>
+#define BDLA_HALF_AVX512
+#elif defined(__AVX2__) && defined(__F16C__)
+#include <immintrin.h>
+#define BDLA_HALF_AVX2
+#endif
+
+static inline float bdla_bits_tofloat(uint32_t bits) {
+	float f;
+	memcpy(&f, &bits, sizeof(f));
+	return f;
+}
+
+static inline uint32_t bdla_float_tobits(float f) {
+	uint32_t bits;
+	memcpy(&bits, &f, sizeof(bits));
+	return bits;
+}
+
+static float bdla_fp16_tofloat(uint16_t h) {
+	uint32_t sign = (uint32_t)(h & 0x8000u) << 16;
+	uint32_t exp = (h >> 10) & 0x1fu, man = h & 0x3ffu;
+	if (exp == 0x1f) { return bdla_bits_tofloat(sign | 0x7f800000u | (man << 13)); }
+	if (exp != 0) { return bdla_bits_tofloat(sign | ((exp + 112) << 23) | (man << 13)); }
+	if (man == 0) { return bdla_bits_tofloat(sign); }
+	/* Subnormal: normalise the significand. */
+	exp = 113;
+	while (!(man & 0x400u)) {
+		man <<= 1;
+		--exp;
+	}
+	return bdla_bits_tofloat(sign | (exp << 23) | ((man & 0x3ffu) << 13));
+}
+
+static uint16_t bdla_fp16_fromfloat(float f) {
+	uint32_t x = bdla_float_tobits(f), man = x & 0x7fffffu, rem, half;
+	uint16_t sign = (uint16_t)((x >> 16) & 0x8000u), h;
+	int exp = (int)((x >> 23) & 0xff) - 112, shift;
+	if (((x >> 23) & 0xff) == 0xff) {		/* Inf stays inf and NaN stays NaN. */
+		return sign | 0x7c00u | (man != 0 ? 0x200u : 0);
+	}
+	if (exp >= 0x1f) { return sign | 0x7c00u; }
+	if (exp <= 0) {
+		/* Subnormal, or too small even for that. */
+		if (exp < -10) { return sign; }
+		man |= 0x800000u;
+		shift = 14 - exp;
+		h = (uint16_t)(man >> shift);
+		rem = man & ((1u << shift) - 1);
+		half = 1u << (shift - 1);
+	}
+	else {
+		h = (uint16_t)((exp << 10) | (man >> 13));
+		rem = man & 0x1fffu;
+		half = 0x1000u;
+	}
+	/* Nearest, ties to even. A carry rolls into the exponent as it should. */
+	if (rem > half || (rem == half && (h & 1))) { ++h; }
+	return sign | h;
+}
+
+static inline float bdla_bf16_tofloat(uint16_t h) {
+	return bdla_bits_tofloat((uint32_t)h << 16);
+}
+
+static uint16_t bdla_bf16_fromfloat(float f) {
+	uint32_t x = bdla_float_tobits(f);
+	if ((x & 0x7fffffffu) > 0x7f800000u) {
+		return (uint16_t)((x >> 16) | 0x40u);	/* Keep NaNs quiet and non-zero. */
+	}
+	x += 0x7fffu + ((x >> 16) & 1);
+	return (uint16_t)(x >> 16);
+}
+
+static inline float bdla_half_tofloat(bdla_HalfFormat format, uint16_t h) {
+	return format == BDLA_HALF_FP16 ? bdla_fp16_tofloat(h) : bdla_bf16_tofloat(h);
+}
+
+/* Dot product of n stored values with x, accumulated in float. */
+static float bdla_HMxf_dot(bdla_HalfFormat format, const uint16_t *a, const float *x, int n) {
+	float acc = 0.f;
+	int j = 0;
+#if defined(BDLA_HALF_AVX512)
+	__m512 sum = _mm512_setzero_ps();
+	__m256i h;
+	if (format == BDLA_HALF_FP16) {
+		for (; j + 16 <= n; j += 16) {
+			h = _mm256_loadu_si256((const __m256i *)(a + j));
+			sum = _mm512_fmadd_ps(_mm512_cvtph_ps(h), _mm512_loadu_ps(x + j), sum);
+		}
+	}
+	else {
+		for (; j + 16 <= n; j += 16) {
+			h = _mm256_loadu_si256((const __m256i *)(a + j));
+			sum = _mm512_fmadd_ps(_mm512_castsi512_ps(_mm512_slli_epi32(
+				_mm512_cvtepu16_epi32(h), 16)), _mm512_loadu_ps(x + j), sum);
+		}
+	}
+	acc = _mm512_reduce_add_ps(sum);
+#elif defined(BDLA_HALF_AVX2)
+	__m256 sum = _mm256_setzero_ps(), v;
+	__m128 s4;
+	__m128i h;
+	for (; j + 8 <= n; j += 8) {
+		h = _mm_loadu_si128((const __m128i *)(a + j));
+		v = format == BDLA_HALF_FP16 ? _mm256_cvtph_ps(h)
+			: _mm256_castsi256_ps(_mm256_slli_epi32(_mm256_cvtepu16_epi32(h), 16));
+#ifdef __FMA__
+		sum = _mm256_fmadd_ps(v, _mm256_loadu_ps(x + j), sum);
+#else
+		sum = _mm256_add_ps(sum, _mm256_mul_ps(v, _mm256_loadu_ps(x + j)));
+#endif
+	}
+	s4 = _mm_add_ps(_mm256_castps256_ps128(sum), _mm256_extractf128_ps(sum, 1));
+	s4 = _mm_add_ps(s4, _mm_movehl_ps(s4, s4));
+	s4 = _mm_add_ss(s4, _mm_shuffle_ps(s4, s4, 1));
+	acc = _mm_cvtss_f32(s4);
+#endif
+	if (format == BDLA_HALF_FP16) {
+		for (; j < n; ++j) { acc += bdla_fp16_tofloat(a[j]) * x[j]; }
+	}
+	else {
+		for (; j < n; ++j) { acc += bdla_bf16_tofloat(a[j]) * x[j]; }
+	}
+	return acc;
+}
+
+typedef struct {
+	bdla_HMxf H;
+	float *M;
+} bdla_HalfConvCtx;
+
+static void bdla_HMxf_fromrows(void *ctx, int begin, int end) {
+	bdla_HalfConvCtx *c = ctx;
+	size_t k = (size_t)begin * c->H.dims[1], last = (size_t)end * c->H.dims[1];
+	if (c->H.format == BDLA_HALF_FP16) {
+		for (; k < last; ++k) { c->H.arr[k] = bdla_fp16_fromfloat(c->M[k]); }
+	}
+	else {
+		for (; k < last; ++k) { c->H.arr[k] = bdla_bf16_fromfloat(c->M[k]); }
+	}
+}
+
+static void bdla_HMxf_torows(void *ctx, int begin, int end) {
+	bdla_HalfConvCtx *c = ctx;
+	size_t k = (size_t)begin * c->H.dims[1], last = (size_t)end * c->H.dims[1];
+	for (; k < last; ++k) { c->M[k] = bdla_half_tofloat(c->H.format, c->H.arr[k]); }
+}
+
+typedef struct {
+	bdla_HMxf A;
+	const float *x, *b;
+	float *y;
+} bdla_HalfMvCtx;
+
+static void bdla_HMxf_vmult_rows(void *ctx, int begin, int end) {
+	bdla_HalfMvCtx *c = ctx;
+	int i, n = c->A.dims[1];
+	for (i = begin; i < end; ++i) {
+		c->y[i] = bdla_HMxf_dot(c->A.format, c->A.arr + (size_t)i * n, c->x, n);
+	}
+}
+
+static double bdla_HMxf_residual_rows(void *ctx, int begin, int end) {
+	bdla_HalfMvCtx *c = ctx;
+	double sumsq = 0.;
+	float ri;
+	int i, n = c->A.dims[1];
+	for (i = begin; i < end; ++i) {
+		ri = c->b[i] - bdla_HMxf_dot(c->A.format, c->A.arr + (size_t)i * n, c->x, n);
+		if (c->y != NULL) { c->y[i] = ri; }
+		sumsq += (double)ri * ri;
+	}
+	return sumsq;
+}
+
+BDLA_EXPORT bdla_HMxf bdla_HMxf_create(int r, int c, bdla_HalfFormat format) {
+	assert(r > 0);
+	assert(c > 0);
+	assert(format == BDLA_HALF_FP16 || format == BDLA_HALF_BF16);
+	bdla_HMxf ret;
+	ret.dims[0] = r;
+	ret.dims[1] = c;
+	ret.format = format;
+	/* Two halves to a float, rounded up. */
+	ret.arr = (uint16_t *)bdla_alloc_floats(((size_t)r * c + 1) / 2);
+	return ret;
+}
+
+BDLA_EXPORT void bdla_HMxf_release(bdla_HMxf *mat) {
+	if (mat != NULL) {
+		assert(mat->arr != NULL);
+		free(mat->arr); mat->arr = NULL;
+		mat->dims[0] = 0;
+		mat->dims[1] = 0;
+	}
+	return;
+}
+
+BDLA_EXPORT bdla_Status bdla_HMxf_fromMxf(bdla_Mxf A, bdla_HalfFormat format, bdla_HMxf *Y) {
+	assert(A.arr != NULL);
+	assert(A.dims[0] > 0);
+	assert(A.dims[1] > 0);
+	assert(Y != NULL);
+	bdla_HalfConvCtx c;
+	*Y = bdla_HMxf_create(A.dims[0], A.dims[1], format);
+	if (Y->arr == NULL) { return BDLA_MEM_ERROR; }
+	c.H = *Y;
+	c.M = A.arr;
+	bdla_parallel_for_static(A.dims[0], bdla_parallel_grain(A.dims[1]), bdla_HMxf_fromrows, &c);
+	return BDLA_GOOD;
+}
+
+BDLA_EXPORT bdla_Status bdla_HMxf_toMxf(bdla_HMxf A, bdla_Mxf *Y) {
+	assert(A.arr != NULL);
+	assert(Y != NULL);
+	assert(Y->arr != NULL);
+	bdla_HalfConvCtx c;
+	if (A.dims[0] != Y->dims[0] || A.dims[1] != Y->dims[1]) {
+		if (bdla_Mxf_resize(Y, A.dims[0], A.dims[1]) != BDLA_GOOD) {
+			return BDLA_MEM_ERROR;
+		}
+	}
+	c.H = A;
+	c.M = Y->arr;
+	bdla_parallel_for_static(A.dims[0], bdla_parallel_grain(A.dims[1]), bdla_HMxf_torows, &c);
+	return BDLA_GOOD;
+}
+
+BDLA_EXPORT int bdla_HMxf_rows(bdla_HMxf A) {
+	assert(A.arr != NULL);
+	return A.dims[0];
+}
+
+BDLA_EXPORT int bdla_HMxf_cols(bdla_HMxf A) {
+	assert(A.arr != NULL);
+	return A.dims[1];
+}
+
+BDLA_EXPORT float bdla_HMxf_value(bdla_HMxf A, int row, int col) {
+	assert(A.arr != NULL);
+	assert(row >= 0 && row < A.dims[0] && "Bad row index");
+	assert(col >= 0 && col < A.dims[1] && "Bad column index");
+	return bdla_half_tofloat(A.format, A.arr[(size_t)row * A.dims[1] + col]);
+}
+
+BDLA_EXPORT bdla_Status bdla_HMxf_vmult(bdla_HMxf A, bdla_Vxf b, bdla_Vxf *y) {
+	assert(A.arr != NULL);
+	assert(b.arr != NULL);
+	assert(y != NULL);
+	assert(y->arr != NULL);
+	if (A.dims[0] != y->len || A.dims[1] != b.len) {
+		return BDLA_DIMENSION_MISMATCH;
+	}
+	int alias = 0;
+	bdla_HalfMvCtx c;
+	float *outarr = y->arr;
+	if (bdla_floats_overlap(y->arr, y->len, b.arr, b.len)) {
+		alias = 1;
+		outarr = malloc(sizeof(float) * y->len);
+		if (outarr == NULL) { return BDLA_MEM_ERROR; }
+	}
+	c.A = A;
+	c.x = b.arr;
+	c.b = NULL;
+	c.y = outarr;
+	bdla_parallel_for_static(A.dims[0], bdla_parallel_grain(A.dims[1]), bdla_HMxf_vmult_rows, &c);
+	if (alias) {
+		memcpy(y->arr, outarr, sizeof(float) * y->len);
+		free(outarr);
+	}
+	return BDLA_GOOD;
+}
+
+BDLA_EXPORT bdla_Status bdla_HMxf_residual(bdla_HMxf A, bdla_Vxf x, bdla_Vxf b,
+	bdla_Vxf *r, float *rnorm) {
+	assert(A.arr != NULL);
+	assert(x.arr != NULL);
+	assert(b.arr != NULL);
+	assert(r == NULL || r->arr != NULL);
+	if (x.len != A.dims[1] || b.len != A.dims[0]) { return BDLA_DIMENSION_MISMATCH; }
+	if (r != NULL && r->len != A.dims[0]) { return BDLA_DIMENSION_MISMATCH; }
+	int alias = 0;
+	double sumsq;
+	bdla_HalfMvCtx c;
+	float *outarr = r != NULL ? r->arr : NULL;
+	/* Each row reads its own element of b before writing r, so r may be b. */
+	if (r != NULL && (bdla_floats_overlap(r->arr, r->len, x.arr, x.len)
+		|| (r->arr != b.arr && bdla_floats_overlap(r->arr, r->len, b.arr, b.len)))) {
+		alias = 1;
+		outarr = malloc(sizeof(float) * r->len);
+		if (outarr == NULL) { return BDLA_MEM_ERROR; }
+	}
+	c.A = A;
+	c.x = x.arr;
+	c.b = b.arr;
+	c.y = outarr;
+	sumsq = bdla_parallel_sum(A.dims[0], bdla_parallel_grain(A.dims[1]),
+		bdla_HMxf_residual_rows, &c);
+	if (alias) {
+		memcpy(r->arr, outarr, sizeof(float) * r->len);
+		free(outarr);
+	}
+	if (rnorm != NULL) { *rnorm = (float)sqrt(sumsq); }
+	return BDLA_GOOD;
+}
+
+BDLA_EXPORT bdla_Status bdla_HMxf_diag(bdla_HMxf A, bdla_Vxf *b) {
+	assert(A.arr != NULL);
+	assert(b != NULL);
+	assert(b->arr != NULL);
+	int i, len;
+	len = A.dims[0] < A.dims[1] ? A.dims[0] : A.dims[1];
+	if (b->len != len) {
+		if (bdla_Vxf_resize(b, len) != BDLA_GOOD) { return BDLA_MEM_ERROR; }
+	}
+	for (i = 0; i < len; ++i) {
+		b->arr[i] = bdla_half_tofloat(A.format, A.arr[(size_t)i * A.dims[1] + i]);
+	}
+	return BDLA_GOOD;
+}
@@ -25,15 +25,24 @@ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
 SOFTWARE.
 ============================================================================*/
 #include <assert.h>
+#include <math.h>
 #include <stdlib.h>
 #include <string.h>
 
 #include <openblas/cblas.h>
 
+#include "alloc.h"
+#include "threadpool.h"
+
+#if defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+#include <xmmintrin.h>
+#define BDLA_TRANSPOSE_SSE
+#endif
+
 BDLA_EXPORT bdla_Mxf bdla_Mxf_create(int r, int c) {
 	assert(r > 0);
 	assert(c > 0);
-	bdla_Mxf ret = { r, c, malloc(sizeof(float)*c*r) };
+	bdla_Mxf ret = { r, c, bdla_alloc_floats((size_t)c * r) };
 	return ret;
 }
 
@@ -50,11 +59,81 @@ BDLA_EXPORT void bdla_Mxf_release(bdla_Mxf *mat) {
 BDLA_EXPORT bdla_Mxf bdla_Mxf_copy(bdla_Mxf mat) {
 	assert(mat.arr != NULL);
 	bdla_Mxf ret = mat;
-	ret.arr = malloc(sizeof(float) * ret.dims[1] * ret.dims[0]);
+	ret.arr = bdla_alloc_floats((size_t)ret.dims[1] * ret.dims[0]);
 	memcpy(ret.arr, mat.arr, sizeof(float) * ret.dims[1] * ret.dims[0]);
 	return ret;
 }
 
+/* Transposition is done a tile at a time so that both the reads and the
+writes stay within a few cache lines. Inside a tile, 4x4 register blocks are
+transposed with SSE shuffles where available. */
+#define BDLA_TRANSPOSE_TILE 32
+
+static void bdla_Mxf_transpose_tile(const float *src, int lds,
+	float *dst, int ldd, int rows, int cols) {
+	int i = 0, j;
+#ifdef BDLA_TRANSPOSE_SSE
+	for (; i + 3 < rows; i += 4) {
+		for (j = 0; j + 3 < cols; j += 4) {
+			const float *a = src + (size_t)i * lds + j;
+			float *b = dst + (size_t)j * ldd + i;
+			__m128 r0 = _mm_loadu_ps(a);
+			__m128 r1 = _mm_loadu_ps(a + lds);
+			__m128 r2 = _mm_loadu_ps(a + 2 * lds);
+			__m128 r3 = _mm_loadu_ps(a + 3 * lds);
+			_MM_TRANSPOSE4_PS(r0, r1, r2, r3);
+			_mm_storeu_ps(b, r0);
+			_mm_storeu_ps(b + ldd, r1);
+			_mm_storeu_ps(b + 2 * ldd, r2);
+			_mm_storeu_ps(b + 3 * ldd, r3);
+		}
+		for (; j < cols; ++j) {		/* Right edge of the tile */
+			dst[(size_t)j * ldd + i] = src[(size_t)i * lds + j];
+			dst[(size_t)j * ldd + i + 1] = src[(size_t)(i + 1) * lds + j];
+			dst[(size_t)j * ldd + i + 2] = src[(size_t)(i + 2) * lds + j];
+			dst[(size_t)j * ldd + i + 3] = src[(size_t)(i + 3) * lds + j];
+		}
+	}
+#endif
+	for (; i < rows; ++i) {
+		for (j = 0; j < cols; ++j) {
+			dst[(size_t)j * ldd + i] = src[(size_t)i * lds + j];
+		}
+	}
+}
+
+typedef struct {
+	const float *src;
+	float *dst;
+	int rows, cols;
+} bdla_TransposeCtx;
+
+/* Tile rows [begin, end) of an out of place transpose. */
+static void bdla_Mxf_transpose_tilerows(void *ctx, int begin, int end) {
+	bdla_TransposeCtx *c = ctx;
+	int ti, tj, h, w, i0;
+	for (ti = begin; ti < end; ++ti) {
+		i0 = ti * BDLA_TRANSPOSE_TILE;
+		h = c->rows - i0 < BDLA_TRANSPOSE_TILE ? c->rows - i0 : BDLA_TRANSPOSE_TILE;
+		for (tj = 0; tj < c->cols; tj += BDLA_TRANSPOSE_TILE) {
+			w = c->cols - tj < BDLA_TRANSPOSE_TILE ? c->cols - tj : BDLA_TRANSPOSE_TILE;
+			bdla_Mxf_transpose_tile(c->src + (size_t)i0 * c->cols + tj, c->cols,
+				c->dst + (size_t)tj * c->rows + i0, c->rows, h, w);
+		}
+	}
+}
+
+static void bdla_Mxf_transpose_outofplace(const float *src, int rows, int cols, float *dst) {
+	bdla_TransposeCtx c;
+	int ntiles = (rows + BDLA_TRANSPOSE_TILE - 1) / BDLA_TRANSPOSE_TILE;
+	c.src = src;
+	c.dst = dst;
+	c.rows = rows;
+	c.cols = cols;
+	bdla_parallel_for(ntiles, bdla_parallel_grain((size_t)BDLA_TRANSPOSE_TILE * cols),
+		bdla_Mxf_transpose_tilerows, &c);
+}
+
 BDLA_EXPORT void bdla_Mxf_transpose(bdla_Mxf A, bdla_Mxf *Y) {
 	assert(A.arr != NULL);
 	assert(A.dims[0] > 0);
@@ -63,25 +142,78 @@ BDLA_EXPORT void bdla_Mxf_transpose(bdla_Mxf A, bdla_Mxf *Y) {
 	assert(Y->arr != NULL);
 	assert(Y->dims[0] > 0);
 	assert(Y->dims[1] > 0);
-	int alias = 0, i, j, im, jm;
+	float *outarr;
 	if (Y->arr == A.arr) {
-		alias = 1;
-		Y->arr = malloc(sizeof(float) * A.dims[0] * A.dims[1]);
+		if (A.dims[0] == A.dims[1]) {
+			bdla_Mxf_transpose_inplace(Y);
+			return;
+		}
+		/* A non-square matrix can't be transposed tile by tile in place. */
+		outarr = malloc(sizeof(float) * A.dims[0] * A.dims[1]);
+		if (outarr == NULL) { return; }
+		bdla_Mxf_transpose_outofplace(A.arr, A.dims[0], A.dims[1], outarr);
+		memcpy(Y->arr, outarr, sizeof(float) * A.dims[0] * A.dims[1]);
+		free(outarr);
 		Y->dims[0] = A.dims[1];
 		Y->dims[1] = A.dims[0];
+		return;
 	}
-	im = A.dims[0];
-	jm = A.dims[1];
-	for (i = 0; i < im; ++i) {
-		for (j = 0; j < jm; ++j) {
-			bdla_Mxf_writevalue(*Y, j, i, bdla_Mxf_value(A, i, j));
-		}
+	if (Y->dims[0] != A.dims[1] || Y->dims[1] != A.dims[0]) {
+		if (bdla_Mxf_resize(Y, A.dims[1], A.dims[0]) != BDLA_GOOD) { return; }
 	}
-	if (alias) {
-		free(A.arr);
+	bdla_Mxf_transpose_outofplace(A.arr, A.dims[0], A.dims[1], Y->arr);
+}
+
+/* Tile rows [begin, end) of an in place square transpose. Tile (ti, tj) is
+swapped with tile (tj, ti) through a stack buffer; tiles on the diagonal
+are transposed element by element. */
+static void bdla_Mxf_transpose_swaprows(void *ctx, int begin, int end) {
+	bdla_TransposeCtx *c = ctx;
+	float tmp[BDLA_TRANSPOSE_TILE * BDLA_TRANSPOSE_TILE];
+	float *arr = c->dst, tswap;
+	int ti, tj, i, j, i0, j0, h, w, n = c->rows;
+	int ntiles = (n + BDLA_TRANSPOSE_TILE - 1) / BDLA_TRANSPOSE_TILE;
+	for (ti = begin; ti < end; ++ti) {
+		i0 = ti * BDLA_TRANSPOSE_TILE;
+		h = n - i0 < BDLA_TRANSPOSE_TILE ? n - i0 : BDLA_TRANSPOSE_TILE;
+		for (i = 0; i < h; ++i) {
+			for (j = i + 1; j < h; ++j) {
+				tswap = arr[(size_t)(i0 + i) * n + i0 + j];
+				arr[(size_t)(i0 + i) * n + i0 + j] = arr[(size_t)(i0 + j) * n + i0 + i];
+				arr[(size_t)(i0 + j) * n + i0 + i] = tswap;
+			}
+		}
+		for (tj = ti + 1; tj < ntiles; ++tj) {
+			j0 = tj * BDLA_TRANSPOSE_TILE;
+			w = n - j0 < BDLA_TRANSPOSE_TILE ? n - j0 : BDLA_TRANSPOSE_TILE;
+			/* tmp = (upper tile)^T, upper tile = (lower tile)^T, lower = tmp */
+			bdla_Mxf_transpose_tile(arr + (size_t)i0 * n + j0, n, tmp, h, h, w);
+			bdla_Mxf_transpose_tile(arr + (size_t)j0 * n + i0, n,
+				arr + (size_t)i0 * n + j0, n, w, h);
+			for (i = 0; i < w; ++i) {
+				memcpy(arr + (size_t)(j0 + i) * n + i0, tmp + i * h, sizeof(float) * h);
+			}
+		}
 	}
 }
 
+BDLA_EXPORT bdla_Status bdla_Mxf_transpose_inplace(bdla_Mxf *A) {
+	assert(A != NULL);
+	assert(A->arr != NULL);
+	assert(A->dims[0] > 0);
+	assert(A->dims[1] > 0);
+	if (A->dims[0] != A->dims[1]) { return BDLA_NONSQUARE; }
+	bdla_TransposeCtx c;
+	int n = A->dims[0];
+	int ntiles = (n + BDLA_TRANSPOSE_TILE - 1) / BDLA_TRANSPOSE_TILE;
+	c.src = c.dst = A->arr;
+	c.rows = c.cols = n;
+	/* Tile rows near the top do the most swaps; stealing evens it out. */
+	bdla_parallel_for(ntiles, bdla_parallel_grain((size_t)BDLA_TRANSPOSE_TILE * n),
+		bdla_Mxf_transpose_swaprows, &c);
+	return BDLA_GOOD;
+}
+
 BDLA_EXPORT bdla_Status bdla_Mxf_reshape(bdla_Mxf A, int rows, int cols, bdla_Mxf *Y){
 	assert(Y != NULL);
 	assert(Y->arr != NULL);
@@ -95,22 +227,29 @@ BDLA_EXPORT bdla_Status bdla_Mxf_reshape(bdla_Mxf A, int rows, int cols, bdla_Mx
 	if (rows * cols != A.dims[0] * A.dims[1]) {
 		return BDLA_DIMENSION_MISMATCH;
 	}
-	int alias = 0, i, im;
-	if (Y->arr = A.arr) {
-		alias = 1;
-		Y->arr = malloc(sizeof(float) * rows * cols);
-		if (Y->arr == NULL) { return BDLA_MEM_ERROR; }
+	/* Row-major storage is contiguous, so the element order doesn't change
+	and reshaping in place only needs new dimensions. */
+	if (Y->arr == A.arr) {
+		Y->dims[0] = rows;
+		Y->dims[1] = cols;
+		return BDLA_GOOD;
+	}
+	if (Y->dims[0] * Y->dims[1] != rows * cols) {
+		if (bdla_Mxf_resize(Y, rows, cols) != BDLA_GOOD) { return BDLA_MEM_ERROR; }
 	}
 	Y->dims[0] = rows;
 	Y->dims[1] = cols;
-	im = rows * cols;
-	for (i = 0; i < im; ++i) {
-		bdla_Mxf_writevalue(*Y, i%rows, i / rows,
-			bdla_Mxf_value(A, i%A.dims[0], i / A.dims[1]));
-	}
-	if (alias) {
-		free(A.arr);
-	}
+	memcpy(Y->arr, A.arr, sizeof(float) * rows * cols);
+	return BDLA_GOOD;
+}
+
+BDLA_EXPORT bdla_Status bdla_Mxf_asVxf(bdla_Mxf A, bdla_Vxf *y) {
+	assert(A.arr != NULL);
+	assert(A.dims[0] > 0);
+	assert(A.dims[1] > 0);
+	assert(y != NULL);
+	y->len = A.dims[0] * A.dims[1];
+	y->arr = A.arr;
 	return BDLA_GOOD;
 }
 
@@ -121,14 +260,12 @@ BDLA_EXPORT bdla_Status bdla_Mxf_resize(bdla_Mxf *A, int rows, int cols) {
 	assert(A->dims[1] > 0);
 	assert(rows > 0);
 	assert(cols > 0);
-	A->dims[0] = rows;
-	A->dims[1] = cols;
 	int size = rows * cols;
-	A->dims[0] = rows;
-	A->dims[1] = cols;
 	if (A->dims[0] * A->dims[1] != size) {
 		A->arr = realloc(A->arr, sizeof(float) * size);
 	}
+	A->dims[0] = rows;
+	A->dims[1] = cols;
 	if(A->arr == NULL){
 		return BDLA_MEM_ERROR;
 	}
@@ -281,7 +418,7 @@ BDLA_EXPORT int bdla_Mxf_istriupper(bdla_Mxf A) {
 BDLA_EXPORT bdla_Status bdla_Mxf_zero(bdla_Mxf *A) {
 	assert(A != NULL);
 	assert(A->arr != NULL);
-	memset(A->arr, 0x0, sizeof(float)*A->dims[1]*A->dims[0]);
+	bdla_parallel_fill(A->arr, A->dims[0], A->dims[1], 0.f);
 	return BDLA_GOOD;
 }
 
@@ -327,6 +464,105 @@ BDLA_EXPORT bdla_Status bdla_Mxf_fplus(bdla_Mxf A, float b, bdla_Mxf *Y) {
 	return BDLA_GOOD;
 }
 
+/* The length of the k-th diagonal of A. */
+static int bdla_Mxf_diaglength(bdla_Mxf A, int k) {
+	int len;
+	if (k >= 0) {
+		len = A.dims[1] - k < A.dims[0] ? A.dims[1] - k : A.dims[0];
+	}
+	else {
+		len = A.dims[0] + k < A.dims[1] ? A.dims[0] + k : A.dims[1];
+	}
+	return len > 0 ? len : 0;
+}
+
+/* Check that a vector of length len runs the k-th diagonal of A from
+edge to edge. */
+static int bdla_Mxf_diagfits(bdla_Mxf A, int len, int k) {
+	int i, j;
+	if (k >= 0) {
+		i = len;
+		j = k + len;
+	}
+	else {
+		i = len - k;
+		j = len;
+	}
+	return (i == A.dims[0] && j <= A.dims[1]) || (j == A.dims[1] && i <= A.dims[0]);
+}
+
+typedef struct {
+	bdla_Mxf A, Y;
+	int k, len;
+	float alpha, s;
+	const float *b;
+} bdla_DiagUpdateCtx;
+
+static void bdla_Mxf_diagupdate_rows(void *ctx, int begin, int end) {
+	bdla_DiagUpdateCtx *c = ctx;
+	int i, idx, cols = c->A.dims[1];
+	int first = c->k >= 0 ? 0 : -c->k;
+	size_t off;
+	for (i = begin; i < end; ++i) {
+		off = (size_t)i * cols;
+		memcpy(c->Y.arr + off, c->A.arr + off, sizeof(float) * cols);
+		idx = i - first;
+		if (idx >= 0 && idx < c->len) {
+			c->Y.arr[off + i + c->k] += c->b != NULL ? c->alpha * c->b[idx] : c->s;
+		}
+	}
+}
+
+/* Y = A + alpha * diag_k(b) (or + s where b is NULL) with the copy and
+the diagonal update done in the same pass over the rows. Y must already
+be A's size and must not alias it. */
+static void bdla_Mxf_diagupdate_copy(bdla_Mxf A, int k, int len, 
+	float alpha, const float *b, float s, bdla_Mxf Y) {
+	bdla_DiagUpdateCtx c;
+	c.A = A;
+	c.Y = Y;
+	c.k = k;
+	c.len = len;
+	c.alpha = alpha;
+	c.s = s;
+	c.b = b;
+	bdla_parallel_for(A.dims[0], bdla_parallel_grain(A.dims[1]), bdla_Mxf_diagupdate_rows, &c);
+}
+
+/* A += alpha * diag_k(b) (or + s where b is NULL), in place. Only the
+diagonal is touched: a stride of cols + 1 through the array. */
+static void bdla_Mxf_diagupdate_inplace(bdla_Mxf A, int k, int len,
+	float alpha, const float *b, float s) {
+	int idx;
+	size_t stride = (size_t)A.dims[1] + 1;
+	float *diag = A.arr + (k >= 0 ? (size_t)k : (size_t)(-k) * A.dims[1]);
+	if (b != NULL) {
+		for (idx = 0; idx < len; ++idx) {
+			diag[idx * stride] += alpha * b[idx];
+		}
+	}
+	else {
+		for (idx = 0; idx < len; ++idx) {
+			diag[idx * stride] += s;
+		}
+	}
+}
+
+static bdla_Status bdla_Mxf_diagupdate(bdla_Mxf A, int k, int len,
+	float alpha, const float *b, float s, bdla_Mxf *Y) {
+	if (Y->arr == A.arr) {
+		bdla_Mxf_diagupdate_inplace(A, k, len, alpha, b, s);
+		return BDLA_GOOD;
+	}
+	if (Y->dims[0] != A.dims[0] || Y->dims[1] != A.dims[1]) {
+		if (bdla_Mxf_resize(Y, A.dims[0], A.dims[1]) == BDLA_MEM_ERROR) {
+			return BDLA_MEM_ERROR;
+		}
+	}
+	bdla_Mxf_diagupdate_copy(A, k, len, alpha, b, s, *Y);
+	return BDLA_GOOD;
+}
+
 BDLA_EXPORT bdla_Status bdla_Mxf_diagplus(bdla_Mxf A, bdla_Vxf b, int k, bdla_Mxf *Y) {
 	assert(Y != NULL);
 	assert(Y->arr != NULL);
@@ -337,30 +573,43 @@ BDLA_EXPORT bdla_Status bdla_Mxf_diagplus(bdla_Mxf A, bdla_Vxf b, int k, bdla_Mx
 	assert(A.dims[0] > 0);
 	assert(b.arr != NULL);
 	assert(b.len > 0);
-	int i, j, iter;
-	/* Check that the diagonal fits within the matrix. */
-	if (k >= 0) {
-		i = b.len;
-		j = k + b.len;
-	}
-	else {
-		i = b.len - k;
-		j = b.len;
-	}
-	if (!(i == A.dims[0] && j <= A.dims[1]) && !(j == A.dims[1] && i <= A.dims[0])) {
-		return BDLA_DIMENSION_MISMATCH;
-	}
-	if (Y->arr != A.arr) {
-		bdla_Mxf_release(Y);
-		*Y = bdla_Mxf_copy(A);
-	}
-	i = j = 0;
-	if (k >= 0) { j = k; }
-	else { i = -k; }
-	for (iter = 0; iter < b.len; ++iter, ++i, ++j) {
-		bdla_Mxf_writevalue(*Y, i, j,
-			bdla_Mxf_value(*Y, i, j) + bdla_Vxf_value(b, iter));
-	}
+	if (!bdla_Mxf_diagfits(A, b.len, k)) { return BDLA_DIMENSION_MISMATCH; }
+	return bdla_Mxf_diagupdate(A, k, b.len, 1.f, b.arr, 0.f, Y);
+}
+
+BDLA_EXPORT bdla_Status bdla_Mxf_fdiagplus(bdla_Mxf A, float s, int k, bdla_Mxf *Y) {
+	assert(Y != NULL);
+	assert(Y->arr != NULL);
+	assert(Y->dims[1] > 0);
+	assert(Y->dims[0] > 0);
+	assert(A.arr != NULL);
+	assert(A.dims[1] > 0);
+	assert(A.dims[0] > 0);
+	int len = bdla_Mxf_diaglength(A, k);
+	if (len == 0) { return BDLA_BAD_INDEX; }
+	return bdla_Mxf_diagupdate(A, k, len, 0.f, NULL, s, Y);
+}
+
+BDLA_EXPORT bdla_Status bdla_Mxf_diagshift(bdla_Mxf *A, bdla_Vxf b, int k) {
+	assert(A != NULL);
+	assert(A->arr != NULL);
+	assert(A->dims[1] > 0);
+	assert(A->dims[0] > 0);
+	assert(b.arr != NULL);
+	assert(b.len > 0);
+	if (!bdla_Mxf_diagfits(*A, b.len, k)) { return BDLA_DIMENSION_MISMATCH; }
+	bdla_Mxf_diagupdate_inplace(*A, k, b.len, 1.f, b.arr, 0.f);
+	return BDLA_GOOD;
+}
+
+BDLA_EXPORT bdla_Status bdla_Mxf_fdiagshift(bdla_Mxf *A, float s, int k) {
+	assert(A != NULL);
+	assert(A->arr != NULL);
+	assert(A->dims[1] > 0);
+	assert(A->dims[0] > 0);
+	int len = bdla_Mxf_diaglength(*A, k);
+	if (len == 0) { return BDLA_BAD_INDEX; }
+	bdla_Mxf_diagupdate_inplace(*A, k, len, 0.f, NULL, s);
 	return BDLA_GOOD;
 }
 
@@ -416,31 +665,8 @@ BDLA_EXPORT bdla_Status bdla_Mxf_diagminus(bdla_Mxf A, bdla_Vxf b, int k, bdla_M
 	assert(A.dims[0] > 0);
 	assert(b.arr != NULL);
 	assert(b.len > 0);
-	int i, j, iter;
-	/* Check that the diagonal fits within the matrix. */
-	if (k >= 0) {
-		i = b.len;
-		j = k + b.len;
-	}
-	else {
-		i = b.len - k;
-		j = b.len;
-	}
-	if (!(i == A.dims[0] && j <= A.dims[1]) && !(j == A.dims[1] && i <= A.dims[0])) {
-		return BDLA_DIMENSION_MISMATCH;
-	}
-	if (Y->arr != A.arr) {
-		bdla_Mxf_release(Y);
-		*Y = bdla_Mxf_copy(A);
-	}
-	i = j = 0;
-	if (k >= 0) { j = k; }
-	else { i = -k; }
-	for (iter = 0; iter < b.len; ++iter, ++i, ++j) {
-		bdla_Mxf_writevalue(*Y, i, j,
-			bdla_Mxf_value(*Y, i, j) - bdla_Vxf_value(b, iter));
-	}
-	return BDLA_GOOD;
+	if (!bdla_Mxf_diagfits(A, b.len, k)) { return BDLA_DIMENSION_MISMATCH; }
+	return bdla_Mxf_diagupdate(A, k, b.len, -1.f, b.arr, 0.f, Y);
 }
 
 BDLA_EXPORT bdla_Status bdla_Mxf_fmult(bdla_Mxf A, float b, bdla_Mxf *Y) {
@@ -477,6 +703,36 @@ BDLA_EXPORT bdla_Status bdla_Mxf_ewmult(bdla_Mxf A, bdla_Mxf B, bdla_Mxf *Y) {
 }
 
 BDLA_EXPORT bdla_Status bdla_Mxf_mult(bdla_Mxf A, bdla_Mxf B, bdla_Mxf *Y) {
+	return bdla_Mxf_gemm(1.f, A, BDLA_NO_TRANS, B, BDLA_NO_TRANS, 0.f, Y);
+}
+
+/* OpenBLAS runs single threaded under the pool, so products are split
+into panels of rows of the output and each panel is one sgemm call. */
+#define BDLA_GEMM_MIN_ROWS 32
+
+typedef struct {
+	float alpha, beta;
+	const float *A, *B;
+	float *C;
+	int lda, ldb, n, k;
+	enum CBLAS_TRANSPOSE ta, tb;
+} bdla_GemmCtx;
+
+static void bdla_Mxf_gemm_rows(void *ctx, int begin, int end) {
+	bdla_GemmCtx *c = ctx;
+	/* Rows of op(A) are rows of A, or columns of A when transposed. */
+	const float *a = c->ta == CblasNoTrans ? c->A + (size_t)begin * c->lda : c->A + begin;
+	cblas_sgemm(CblasRowMajor, c->ta, c->tb, end - begin, c->n, c->k,
+		c->alpha, a, c->lda, c->B, c->ldb, c->beta, c->C + (size_t)begin * c->n, c->n);
+}
+
+static int bdla_Mxf_gemm_grain(int n, int k) {
+	int g = bdla_parallel_grain((size_t)n * k);
+	return g > BDLA_GEMM_MIN_ROWS ? g : BDLA_GEMM_MIN_ROWS;
+}
+
+BDLA_EXPORT bdla_Status bdla_Mxf_gemm(float alpha, bdla_Mxf A, bdla_Transpose A_trans,
+	bdla_Mxf B, bdla_Transpose B_trans, float beta, bdla_Mxf *Y) {
 	assert(Y != NULL);
 	assert(Y->arr != NULL);
 	assert(A.arr != NULL);
@@ -485,22 +741,52 @@ BDLA_EXPORT bdla_Status bdla_Mxf_mult(bdla_Mxf A, bdla_Mxf B, bdla_Mxf *Y) {
 	assert(B.arr != NULL);
 	assert(B.dims[0] > 0);
 	assert(B.dims[1] > 0);
-	if (A.dims[1] != B.dims[0]) { return BDLA_DIMENSION_MISMATCH; }
-	if (A.dims[0] != Y->dims[0] || B.dims[1] != Y->dims[1]) {
-		bdla_Mxf_resize(Y, A.dims[0], A.dims[1]);
+	int m, n, k, kb;
+	/* op(A) is m x k, op(B) is k x n. */
+	m = A_trans == BDLA_TRANS ? A.dims[1] : A.dims[0];
+	k = A_trans == BDLA_TRANS ? A.dims[0] : A.dims[1];
+	kb = B_trans == BDLA_TRANS ? B.dims[1] : B.dims[0];
+	n = B_trans == BDLA_TRANS ? B.dims[0] : B.dims[1];
+	if (k != kb) { return BDLA_DIMENSION_MISMATCH; }
+	if (Y->dims[0] != m || Y->dims[1] != n) {
+		/* Y's old contents only matter if they're accumulated into. */
+		if (beta != 0.f) { return BDLA_DIMENSION_MISMATCH; }
+		if (Y->arr != A.arr && Y->arr != B.arr) {
+			if (bdla_Mxf_resize(Y, m, n) != BDLA_GOOD) { return BDLA_MEM_ERROR; }
+		}
 	}
 	int alias = 0;
 	float *outarr = Y->arr;
-	if (Y->arr == A.arr) {
+	if (Y->arr == A.arr || Y->arr == B.arr) {
 		alias = 1;
-		outarr = malloc(sizeof(float) * Y->dims[1] * Y->dims[0]);
+		outarr = malloc(sizeof(float) * m * n);
 		if (outarr == NULL) { return BDLA_MEM_ERROR; }
+		if (beta != 0.f) {
+			memcpy(outarr, Y->arr, sizeof(float) * m * n);
+		}
 	}
-	cblas_sgemm(CblasRowMajor, CblasNoTrans, CblasNoTrans, A.dims[0],
-		B.dims[1], B.dims[0], 1.f, A.arr, A.dims[1], B.arr, B.dims[1], 0.f, outarr, Y->dims[1]);
+	bdla_GemmCtx c;
+	c.alpha = alpha;
+	c.beta = beta;
+	c.A = A.arr;
+	c.lda = A.dims[1];
+	c.ta = A_trans == BDLA_TRANS ? CblasTrans : CblasNoTrans;
+	c.B = B.arr;
+	c.ldb = B.dims[1];
+	c.tb = B_trans == BDLA_TRANS ? CblasTrans : CblasNoTrans;
+	c.C = outarr;
+	c.n = n;
+	c.k = k;
+	bdla_parallel_for(m, bdla_Mxf_gemm_grain(n, k), bdla_Mxf_gemm_rows, &c);
 	if (alias) {
-		Y->arr = outarr;
-		free(A.arr);
+		if (Y->dims[0] != m || Y->dims[1] != n) {
+			if (bdla_Mxf_resize(Y, m, n) != BDLA_GOOD) {
+				free(outarr);
+				return BDLA_MEM_ERROR;
+			}
+		}
+		memcpy(Y->arr, outarr, sizeof(float) * m * n);
+		free(outarr);
 	}
 	return BDLA_GOOD;
 }
@@ -589,28 +875,301 @@ BDLA_EXPORT bdla_Status bdla_Mxf_mult_ext(bdla_Mxf A, bdla_MatrixProperty A_prop
 }
 
 BDLA_EXPORT bdla_Status bdla_Mxf_vmult(bdla_Mxf A, bdla_Vxf b, bdla_Vxf *y) {
+	return bdla_Mxf_gemv(1.f, A, BDLA_NO_TRANS, b, 0.f, y);
+}
+
+/* Rank updates. Like gemm, they run as panels of rows of Y, each one BLAS
+call. The symmetric ones only write one triangle, so a panel's work grows
+towards the bottom (lower) or top (upper) and panels are handed out
+dynamically. */
+typedef struct {
+	float alpha, beta;
+	const float *a, *b, *A;
+	float *Y;
+	int n, k, lda;
+	enum CBLAS_UPLO uplo;
+	enum CBLAS_TRANSPOSE ta, tb;
+} bdla_RankCtx;
+
+static void bdla_Mxf_ger_rows(void *ctx, int begin, int end) {
+	bdla_RankCtx *c = ctx;
+	cblas_sger(CblasRowMajor, end - begin, c->n, c->alpha, c->a + begin, 1,
+		c->b, 1, c->Y + (size_t)begin * c->n, c->n);
+}
+
+BDLA_EXPORT bdla_Status bdla_Mxf_ger(float alpha, bdla_Vxf a, bdla_Vxf b, bdla_Mxf *Y) {
+	assert(a.arr != NULL);
+	assert(b.arr != NULL);
+	assert(Y != NULL);
+	assert(Y->arr != NULL);
+	if (Y->dims[0] != a.len || Y->dims[1] != b.len) { return BDLA_DIMENSION_MISMATCH; }
+	bdla_RankCtx c;
+	c.alpha = alpha;
+	c.a = a.arr;
+	c.b = b.arr;
+	c.Y = Y->arr;
+	c.n = b.len;
+	bdla_parallel_for_static(a.len, bdla_Mxf_gemm_grain(b.len, 1), bdla_Mxf_ger_rows, &c);
+	return BDLA_GOOD;
+}
+
+/* Rows [begin, end) of the triangle: a symmetric block on the diagonal and
+a general one beside it. With b NULL, the rank 1 update. */
+static void bdla_Mxf_syr_rows(void *ctx, int begin, int end) {
+	bdla_RankCtx *c = ctx;
+	int nb = end - begin, j0 = c->uplo == CblasLower ? 0 : end;
+	int nj = c->uplo == CblasLower ? begin : c->n - end;
+	float *Y = c->Y + (size_t)begin * c->n;
+	if (c->b == NULL) {
+		cblas_ssyr(CblasRowMajor, c->uplo, nb, c->alpha, c->a + begin, 1, Y + begin, c->n);
+	}
+	else {
+		cblas_ssyr2(CblasRowMajor, c->uplo, nb, c->alpha, c->a + begin, 1,
+			c->b + begin, 1, Y + begin, c->n);
+	}
+	if (nj == 0) { return; }
+	cblas_sger(CblasRowMajor, nb, nj, c->alpha, c->a + begin, 1,
+		c->b != NULL ? c->b + j0 : c->a + j0, 1, Y + j0, c->n);
+	if (c->b != NULL) {
+		cblas_sger(CblasRowMajor, nb, nj, c->alpha, c->b + begin, 1, c->a + j0, 1, Y + j0, c->n);
+	}
+}
+
+static bdla_Status bdla_Mxf_syr_impl(float alpha, bdla_Vxf a, const float *b,
+	bdla_MatrixProperty Y_prop, bdla_Mxf *Y) {
+	if (!bdla_Mxf_issquare(*Y)) { return BDLA_NONSQUARE; }
+	if (Y->dims[0] != a.len) { return BDLA_DIMENSION_MISMATCH; }
+	bdla_RankCtx c;
+	c.alpha = alpha;
+	c.a = a.arr;
+	c.b = b;
+	c.Y = Y->arr;
+	c.n = a.len;
+	c.uplo = Y_prop == BDLA_MATRIX_TRI_LOWER ? CblasLower : CblasUpper;
+	bdla_parallel_for(a.len, bdla_Mxf_gemm_grain(a.len / 2 + 1, 1), bdla_Mxf_syr_rows, &c);
+	return BDLA_GOOD;
+}
+
+BDLA_EXPORT bdla_Status bdla_Mxf_syr(float alpha, bdla_Vxf a,
+	bdla_MatrixProperty Y_prop, bdla_Mxf *Y) {
+	assert(a.arr != NULL);
+	assert(Y != NULL);
+	assert(Y->arr != NULL);
+	assert(Y_prop == BDLA_MATRIX_TRI_UPPER || Y_prop == BDLA_MATRIX_TRI_LOWER);
+	return bdla_Mxf_syr_impl(alpha, a, NULL, Y_prop, Y);
+}
+
+BDLA_EXPORT bdla_Status bdla_Mxf_syr2(float alpha, bdla_Vxf a, bdla_Vxf b,
+	bdla_MatrixProperty Y_prop, bdla_Mxf *Y) {
+	assert(a.arr != NULL);
+	assert(b.arr != NULL);
+	assert(Y != NULL);
+	assert(Y->arr != NULL);
+	assert(Y_prop == BDLA_MATRIX_TRI_UPPER || Y_prop == BDLA_MATRIX_TRI_LOWER);
+	if (a.len != b.len) { return BDLA_DIMENSION_MISMATCH; }
+	return bdla_Mxf_syr_impl(alpha, a, b.arr, Y_prop, Y);
+}
+
+/* Rows [begin, end) of op(A) op(A)^T. Rows of op(A) are rows of A, or
+columns of A when transposed. */
+static void bdla_Mxf_syrk_rows(void *ctx, int begin, int end) {
+	bdla_RankCtx *c = ctx;
+	int nb = end - begin, j0 = c->uplo == CblasLower ? 0 : end;
+	int nj = c->uplo == CblasLower ? begin : c->n - end;
+	size_t step = c->ta == CblasNoTrans ? (size_t)c->lda : 1;
+	float *Y = c->Y + (size_t)begin * c->n;
+	cblas_ssyrk(CblasRowMajor, c->uplo, c->ta, nb, c->k, c->alpha, c->A + begin * step,
+		c->lda, c->beta, Y + begin, c->n);
+	if (nj == 0) { return; }
+	cblas_sgemm(CblasRowMajor, c->ta, c->tb, nb, nj, c->k, c->alpha, c->A + begin * step,
+		c->lda, c->A + j0 * step, c->lda, c->beta, Y + j0, c->n);
+}
+
+BDLA_EXPORT bdla_Status bdla_Mxf_syrk(float alpha, bdla_Mxf A, bdla_Transpose A_trans,
+	float beta, bdla_MatrixProperty Y_prop, bdla_Mxf *Y) {
 	assert(A.arr != NULL);
-	assert(A.dims[1] >= 0);
-	assert(A.dims[0] >= 0);
+	assert(A.dims[0] > 0);
+	assert(A.dims[1] > 0);
+	assert(Y != NULL);
+	assert(Y->arr != NULL);
+	assert(Y_prop == BDLA_MATRIX_TRI_UPPER || Y_prop == BDLA_MATRIX_TRI_LOWER);
+	/* op(A) is n x k */
+	int n = A_trans == BDLA_TRANS ? A.dims[1] : A.dims[0];
+	int k = A_trans == BDLA_TRANS ? A.dims[0] : A.dims[1];
+	bdla_RankCtx c;
+	float *copy = NULL;
+	if (Y->arr == A.arr) {
+		copy = malloc(sizeof(float) * A.dims[0] * A.dims[1]);
+		if (copy == NULL) { return BDLA_MEM_ERROR; }
+		memcpy(copy, A.arr, sizeof(float) * A.dims[0] * A.dims[1]);
+		A.arr = copy;
+	}
+	if (Y->dims[0] != n || Y->dims[1] != n) {
+		/* Y's old contents only matter if they're accumulated into. */
+		if (beta != 0.f || bdla_Mxf_resize(Y, n, n) != BDLA_GOOD) {
+			free(copy);
+			return beta != 0.f ? BDLA_DIMENSION_MISMATCH : BDLA_MEM_ERROR;
+		}
+	}
+	c.alpha = alpha;
+	c.beta = beta;
+	c.A = A.arr;
+	c.lda = A.dims[1];
+	c.Y = Y->arr;
+	c.n = n;
+	c.k = k;
+	c.uplo = Y_prop == BDLA_MATRIX_TRI_LOWER ? CblasLower : CblasUpper;
+	c.ta = A_trans == BDLA_TRANS ? CblasTrans : CblasNoTrans;
+	c.tb = A_trans == BDLA_TRANS ? CblasNoTrans : CblasTrans;
+	bdla_parallel_for(n, bdla_Mxf_gemm_grain(n / 2 + 1, k), bdla_Mxf_syrk_rows, &c);
+	free(copy);
+	return BDLA_GOOD;
+}
+
+/* As for gemm: panels of the output, one sgemv each. A transposed product
+takes a panel of A's columns. */
+#define BDLA_GEMV_MIN_ROWS 64
+
+typedef struct {
+	float alpha, beta;
+	const float *A, *x;
+	float *y;
+	int rows, cols;
+	enum CBLAS_TRANSPOSE ta;
+} bdla_GemvCtx;
+
+static void bdla_Mxf_gemv_rows(void *ctx, int begin, int end) {
+	bdla_GemvCtx *c = ctx;
+	if (c->ta == CblasNoTrans) {
+		cblas_sgemv(CblasRowMajor, CblasNoTrans, end - begin, c->cols, c->alpha,
+			c->A + (size_t)begin * c->cols, c->cols, c->x, 1, c->beta, c->y + begin, 1);
+	}
+	else {
+		cblas_sgemv(CblasRowMajor, CblasTrans, c->rows, end - begin, c->alpha,
+			c->A + begin, c->cols, c->x, 1, c->beta, c->y + begin, 1);
+	}
+}
+
+BDLA_EXPORT bdla_Status bdla_Mxf_gemv(float alpha, bdla_Mxf A, bdla_Transpose A_trans,
+	bdla_Vxf x, float beta, bdla_Vxf *y) {
+	assert(A.arr != NULL);
+	assert(A.dims[0] > 0);
+	assert(A.dims[1] > 0);
+	assert(x.arr != NULL);
+	assert(y != NULL);
 	assert(y->arr != NULL);
-	assert(y->len >= 0);
-	assert(b.len >= 0);
-	assert(b.arr != NULL);
-	if (A.dims[0] != y->len || A.dims[1] != b.len) { 
-		return BDLA_DIMENSION_MISMATCH; 
+	int m, n;
+	/* op(A) is m x n */
+	m = A_trans == BDLA_TRANS ? A.dims[1] : A.dims[0];
+	n = A_trans == BDLA_TRANS ? A.dims[0] : A.dims[1];
+	if (x.len != n || y->len != m) { return BDLA_DIMENSION_MISMATCH; }
+	int alias = 0;
+	float *outarr = y->arr;
+	if (bdla_floats_overlap(y->arr, m, x.arr, n)
+		|| bdla_floats_overlap(y->arr, m, A.arr, (size_t)A.dims[0] * A.dims[1])) {
+		alias = 1;
+		outarr = malloc(sizeof(float) * m);
+		if (outarr == NULL) { return BDLA_MEM_ERROR; }
+		if (beta != 0.f) {
+			memcpy(outarr, y->arr, sizeof(float) * m);
+		}
+	}
+	bdla_GemvCtx c;
+	int grain = bdla_parallel_grain(n);
+	c.alpha = alpha;
+	c.beta = beta;
+	c.A = A.arr;
+	c.x = x.arr;
+	c.y = outarr;
+	c.rows = A.dims[0];
+	c.cols = A.dims[1];
+	c.ta = A_trans == BDLA_TRANS ? CblasTrans : CblasNoTrans;
+	grain = grain > BDLA_GEMV_MIN_ROWS ? grain : BDLA_GEMV_MIN_ROWS;
+	if (A_trans == BDLA_TRANS) {
+		bdla_parallel_for(m, grain, bdla_Mxf_gemv_rows, &c);
+	}
+	else {
+		/* Each thread reads the rows it first touched. */
+		bdla_parallel_for_static(m, grain, bdla_Mxf_gemv_rows, &c);
+	}
+	if (alias) {
+		memcpy(y->arr, outarr, sizeof(float) * m);
+		free(outarr);
+	}
+	return BDLA_GOOD;
+}
+
+/* Dot product with independent partial sums so the compiler can keep
+several vector accumulators in flight. */
+static float bdla_Mxf_rowdot(const float *a, const float *b, int n) {
+	float s0 = 0.f, s1 = 0.f, s2 = 0.f, s3 = 0.f;
+	int i;
+	for (i = 0; i + 3 < n; i += 4) {
+		s0 += a[i] * b[i];
+		s1 += a[i + 1] * b[i + 1];
+		s2 += a[i + 2] * b[i + 2];
+		s3 += a[i + 3] * b[i + 3];
+	}
+	for (; i < n; ++i) {
+		s0 += a[i] * b[i];
+	}
+	return (s0 + s1) + (s2 + s3);
+}
+
+typedef struct {
+	bdla_Mxf A;
+	const float *x, *b;
+	float *r;
+} bdla_ResidualCtx;
+
+/* One pass over A. Each residual is squared while it is still in a
+register rather than read back for a separate norm. */
+static double bdla_Mxf_residual_rows(void *ctx, int begin, int end) {
+	bdla_ResidualCtx *c = ctx;
+	double sumsq = 0.;
+	float ri;
+	int i;
+	for (i = begin; i < end; ++i) {
+		ri = c->b[i] - bdla_Mxf_rowdot(c->A.arr + (size_t)i * c->A.dims[1], c->x, c->A.dims[1]);
+		if (c->r != NULL) { c->r[i] = ri; }
+		sumsq += (double)ri * ri;
 	}
+	return sumsq;
+}
+
+BDLA_EXPORT bdla_Status bdla_Mxf_residual(bdla_Mxf A, bdla_Vxf x, bdla_Vxf b,
+	bdla_Vxf *r, float *rnorm) {
+	assert(A.arr != NULL);
+	assert(A.dims[0] > 0);
+	assert(A.dims[1] > 0);
+	assert(x.arr != NULL);
+	assert(b.arr != NULL);
+	assert(r == NULL || r->arr != NULL);
+	if (x.len != A.dims[1] || b.len != A.dims[0]) { return BDLA_DIMENSION_MISMATCH; }
+	if (r != NULL && r->len != A.dims[0]) { return BDLA_DIMENSION_MISMATCH; }
 	int alias = 0;
-	float *tmparr = y->arr;
-	if (y->arr == b.arr) {
+	double sumsq;
+	bdla_ResidualCtx c;
+	float *outarr = r != NULL ? r->arr : NULL;
+	/* Each row reads its own element of b before writing r, so r may be b. */
+	if (r != NULL && (bdla_floats_overlap(r->arr, r->len, x.arr, x.len)
+		|| bdla_floats_overlap(r->arr, r->len, A.arr, (size_t)A.dims[0] * A.dims[1])
+		|| (r->arr != b.arr && bdla_floats_overlap(r->arr, r->len, b.arr, b.len)))) {
 		alias = 1;
-		tmparr = malloc(sizeof(float) * y->len);
+		outarr = malloc(sizeof(float) * r->len);
+		if (outarr == NULL) { return BDLA_MEM_ERROR; }
 	}
-	cblas_sgemv(CblasRowMajor, CblasNoTrans, A.dims[0], A.dims[1], 1.f,
-		A.arr, A.dims[1], b.arr, 1, 0.f, tmparr, 1);
-	if(alias){
-		free(y->arr);
-		y->arr = tmparr;
+	c.A = A;
+	c.x = x.arr;
+	c.b = b.arr;
+	c.r = outarr;
+	sumsq = bdla_parallel_sum(A.dims[0], bdla_parallel_grain(A.dims[1]),
+		bdla_Mxf_residual_rows, &c);
+	if (alias) {
+		memcpy(r->arr, outarr, sizeof(float) * r->len);
+		free(outarr);
 	}
+	if (rnorm != NULL) { *rnorm = (float)sqrt(sumsq); }
 	return BDLA_GOOD;
 }
 
@@ -667,11 +1226,14 @@ BDLA_EXPORT bdla_Status bdla_Mxf_trisolve(bdla_Mxf A, bdla_MatrixProperty A_prop
 	assert(Y->dims[0] > 0);
 	assert(Y->dims[1] > 0);
 	assert(A_prop == BDLA_MATRIX_TRI_UPPER || A_prop == BDLA_MATRIX_TRI_LOWER);
-	int alias = 0;
-	if(A.arr == Y->arr){	/* Create buffers for aliased memory. */
-		alias = 1;
-		Y->arr = malloc(sizeof(float) * Y->dims[0] * Y->dims[1]);
-		if (Y->arr == NULL) { return BDLA_MEM_ERROR; }
+	if(A.arr == Y->arr){	/* Solve from a copy of the aliased A. */
+		float *acopy = malloc(sizeof(float) * A.dims[0] * A.dims[1]);
+		if (acopy == NULL) { return BDLA_MEM_ERROR; }
+		memcpy(acopy, A.arr, sizeof(float) * A.dims[0] * A.dims[1]);
+		A.arr = acopy;
+		bdla_Status ret = bdla_Mxf_trisolve(A, A_prop, B, Y);
+		free(acopy);
+		return ret;
 	}
 	if (Y->dims[0] != B.dims[0] || Y->dims[1] != B.dims[1]) {
 		if (bdla_Mxf_resize(Y, B.dims[0], B.dims[1]) != BDLA_GOOD) {
@@ -690,9 +1252,6 @@ BDLA_EXPORT bdla_Status bdla_Mxf_trisolve(bdla_Mxf A, bdla_MatrixProperty A_prop
 			Y->dims[0], Y->dims[1], 1.f, A.arr, A.dims[0], Y->arr, Y->dims[1]);
 	}
 	else { return BDLA_BAD_PROPERTY; }
-	if (alias == 1) {		/* Free swapped buffer due to aliasing. */
-		free(A.arr);
-	}
 	return BDLA_GOOD;
 }
 
@@ -708,29 +1267,19 @@ BDLA_EXPORT bdla_Status bdla_Mxf_vtrisolve(bdla_Mxf A, bdla_MatrixProperty A_pro
 	assert(y->len > 0);
 	assert(y->len == b.len);
 	assert(A_prop == BDLA_MATRIX_TRI_UPPER || A_prop == BDLA_MATRIX_TRI_LOWER);
-	int alias = 0;
-	float *outarr = y->arr;
-	if (y->arr == b.arr) {
-		assert(y->len == b.len);
-		alias = 1;
-		outarr = malloc(sizeof(float) * y->len);
-		if (outarr == NULL) { return BDLA_MEM_ERROR; }
+	if (A_prop != BDLA_MATRIX_TRI_UPPER && A_prop != BDLA_MATRIX_TRI_LOWER) {
+		return BDLA_BAD_PROPERTY;
+	}
+	if (y->arr != b.arr) {	/* strsv is an inplace operation */
+		memcpy(y->arr, b.arr, sizeof(float) * b.len);
 	}
-	memcpy(outarr, b.arr, sizeof(float) * b.len);
 	if (A_prop == BDLA_MATRIX_TRI_UPPER) {
 		cblas_strsv(CblasRowMajor, CblasUpper, CblasNoTrans, CblasNonUnit, 
-			A.dims[0], A.arr, A.dims[1], outarr, 1);
-	}
-	else if(A_prop == BDLA_MATRIX_TRI_LOWER){
-		cblas_strsv(CblasRowMajor, CblasLower, CblasNoTrans, CblasNonUnit,
-			A.dims[0], A.arr, A.dims[1], outarr, 1);
+			A.dims[0], A.arr, A.dims[1], y->arr, 1);
 	}
 	else {
-		return BDLA_BAD_PROPERTY;
-	}
-	if (alias) {
-		y->arr = outarr;
-		free(b.arr);
+		cblas_strsv(CblasRowMajor, CblasLower, CblasNoTrans, CblasNonUnit,
+			A.dims[0], A.arr, A.dims[1], y->arr, 1);
 	}
 	return BDLA_GOOD;
 }
@@ -952,6 +1501,58 @@ BDLA_EXPORT bdla_Status bdla_Mxf_writediag(bdla_Mxf A, int k, bdla_Vxf b) {
 	return BDLA_GOOD;
 }
 
+/* The columns [lo, hi) of row i that lie in the triangle on or above
+(upper) or on or below (lower) the k-th diagonal of an n x n matrix. */
+static void bdla_Mxf_trispan(int n, int i, int k, bdla_MatrixProperty prop,
+	int *lo, int *hi) {
+	if (prop == BDLA_MATRIX_TRI_UPPER) {
+		*lo = i + k < 0 ? 0 : (i + k > n ? n : i + k);
+		*hi = n;
+	}
+	else {
+		*lo = 0;
+		*hi = i + k + 1 < 0 ? 0 : (i + k + 1 > n ? n : i + k + 1);
+	}
+}
+
+typedef struct {
+	const float *src;	/* Triangle copied from here if not NULL. */
+	float *dst;
+	int n, k, zero;		/* Zero the rest of each row of dst? */
+	bdla_MatrixProperty prop;
+} bdla_TriCtx;
+
+/* At most one memset before, one memcpy of the triangle and one memset
+after, per row. */
+static void bdla_Mxf_tri_rows(void *ctx, int begin, int end) {
+	bdla_TriCtx *c = ctx;
+	int i, lo, hi, n = c->n;
+	float *row;
+	for (i = begin; i < end; ++i) {
+		row = c->dst + (size_t)i * n;
+		bdla_Mxf_trispan(n, i, c->k, c->prop, &lo, &hi);
+		if (c->zero) {
+			memset(row, 0x0, sizeof(float) * lo);
+			memset(row + hi, 0x0, sizeof(float) * (n - hi));
+		}
+		if (c->src != NULL) {
+			memcpy(row + lo, c->src + (size_t)i * n + lo, sizeof(float) * (hi - lo));
+		}
+	}
+}
+
+static void bdla_Mxf_tri_run(const float *src, float *dst, int n, int k,
+	bdla_MatrixProperty prop, int zero) {
+	bdla_TriCtx c;
+	c.src = src;
+	c.dst = dst;
+	c.n = n;
+	c.k = k;
+	c.zero = zero;
+	c.prop = prop;
+	bdla_parallel_for(n, bdla_parallel_grain(n), bdla_Mxf_tri_rows, &c);
+}
+
 BDLA_EXPORT bdla_Status bdla_Mxf_tri(bdla_Mxf A, int k, bdla_MatrixProperty prop, bdla_Mxf *Y) {
 	assert(A.arr != NULL);
 	assert(A.dims[0] > 0);
@@ -962,53 +1563,27 @@ BDLA_EXPORT bdla_Status bdla_Mxf_tri(bdla_Mxf A, int k, bdla_MatrixProperty prop
 	assert(Y->dims[1] > 0);
 	assert(prop == BDLA_MATRIX_TRI_UPPER || prop == BDLA_MATRIX_TRI_LOWER);
 	if (A.dims[0] != A.dims[1]) { return BDLA_NONSQUARE; }
+	if (Y->arr == A.arr) {
+		return bdla_Mxf_tri_inplace(Y, k, prop);
+	}
 	if (Y->dims[0] != A.dims[0] || Y->dims[1] != A.dims[1]) {
 		if (bdla_Mxf_resize(Y, A.dims[0], A.dims[1]) == BDLA_MEM_ERROR) {
 			return BDLA_MEM_ERROR;
 		}
 	}
-	int i, j, alias = 0;
-	if (Y->arr == A.arr) {
-		alias = 1;
-		Y->arr = malloc(sizeof(float) * A.dims[0] * A.dims[1]);
-		if(Y->arr == NULL){
-			Y->arr = A.arr;
-			return BDLA_MEM_ERROR;
-		}
-	}
-	bdla_Mxf_zero(Y);
-	if (k >= 0) {
-		if (prop == BDLA_MATRIX_TRI_UPPER) {
-			for (i = 0; i < A.dims[0] - k; ++i) {
-				for (j = k + i; j < A.dims[1]; ++j) {
-					bdla_Mxf_writevalue(*Y, i, j, bdla_Mxf_value(A, i, j));
-				}
-			}
-		} else {
-			for (i = 0; i < A.dims[0]; ++i) {
-				for (j = 0; j < (k + i < A.dims[1] ? k + i + 1: A.dims[1]); ++j) {
-					bdla_Mxf_writevalue(*Y, i, j, bdla_Mxf_value(A, i, j));
-				}
-			}
-		}
-	} else {
-		if (prop == BDLA_MATRIX_TRI_UPPER) {
-			for (i = 0; i <= A.dims[0]; ++i) {
-				for (j = (i < -k ? 0 : i + k ); j < A.dims[1]; ++j) {
-					bdla_Mxf_writevalue(*Y, i, j, bdla_Mxf_value(A, i, j));
-				}
-			}
-		} else {
-			for (i = -k; i < A.dims[0]; ++i) {
-				for (j = 0; j <= i + k; ++j) {
-					bdla_Mxf_writevalue(*Y, i, j, bdla_Mxf_value(A, i, j));
-				}
-			}
-		}
-	}
-	if (alias) {
-		free(A.arr);
-	}
+	bdla_Mxf_tri_run(A.arr, Y->arr, A.dims[0], k, prop, 1);
+	return BDLA_GOOD;
+}
+
+BDLA_EXPORT bdla_Status bdla_Mxf_tri_inplace(bdla_Mxf *A, int k, bdla_MatrixProperty prop) {
+	assert(A != NULL);
+	assert(A->arr != NULL);
+	assert(A->dims[0] > 0);
+	assert(A->dims[1] > 0);
+	assert(prop == BDLA_MATRIX_TRI_UPPER || prop == BDLA_MATRIX_TRI_LOWER);
+	if (A->dims[0] != A->dims[1]) { return BDLA_NONSQUARE; }
+	/* Only the other triangle is touched. */
+	bdla_Mxf_tri_run(NULL, A->arr, A->dims[0], k, prop, 1);
 	return BDLA_GOOD;
 }
 
@@ -1024,39 +1599,8 @@ BDLA_EXPORT bdla_Status bdla_Mxf_writetri(bdla_Mxf A, int k, bdla_MatrixProperty
 	if (Y.dims[0] != A.dims[0] || Y.dims[1] != A.dims[1]) {
 		return BDLA_DIMENSION_MISMATCH;
 	}
-	int i, j;
-	if (k >= 0) {
-		if (prop == BDLA_MATRIX_TRI_UPPER) {
-			for (i = 0; i < A.dims[0] - k; ++i) {
-				for (j = k + i; j < A.dims[1]; ++j) {
-					bdla_Mxf_writevalue(A, i, j, bdla_Mxf_value(Y, i, j));
-				}
-			}
-		}
-		else {
-			for (i = 0; i < A.dims[0]; ++i) {
-				for (j = 0; j < (k + i < A.dims[1] ? k + i + 1: A.dims[1]); ++j) {
-					bdla_Mxf_writevalue(A, i, j, bdla_Mxf_value(Y, i, j));
-				}
-			}
-		}
-	}
-	else {
-		if (prop == BDLA_MATRIX_TRI_UPPER) {
-			for (i = 0; i < A.dims[0]; ++i) {
-				for (j = (i < -k ? 0 : i + k); j < A.dims[1]; ++j) {
-					bdla_Mxf_writevalue(A, i, j, bdla_Mxf_value(Y, i, j));
-				}
-			}
-		}
-		else {
-			for (i = -k; i < A.dims[0]; ++i) {
-				for (j = 0; j <= i + k; ++j) {
-					bdla_Mxf_writevalue(A, i, j, bdla_Mxf_value(Y, i, j));
-				}
-			}
-		}
-	}
+	if (Y.arr == A.arr) { return BDLA_GOOD; }	/* Nothing to do */
+	bdla_Mxf_tri_run(Y.arr, A.arr, A.dims[0], k, prop, 0);
 	return BDLA_GOOD;
 }
 
@@ -1064,11 +1608,7 @@ BDLA_EXPORT bdla_Status bdla_Mxf_uniform(bdla_Mxf *A, float b) {
 	assert(A->arr != NULL);
 	assert(A->dims[0] >= 0);
 	assert(A->dims[1] >= 0);
-	int i, maxi;
-	maxi = A->dims[0] * A->dims[1];
-	for (i = 0; i < maxi; ++i) {
-		A->arr[i] = b;
-	}
+	bdla_parallel_fill(A->arr, A->dims[0], A->dims[1], b);
 	return BDLA_GOOD;
 }
 
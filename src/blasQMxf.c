@@ -0,0 +1,364 @@
+#include "libbdla.h"
+/*============================================================================
+blasQMxf.c
+
+Matrices quantised to 8 bits with a scale per row, for approximate products.
+
+Copyright(c) 2019 HJA Bird
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files(the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions :
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+============================================================================*/
+#include <assert.h>
+#include <math.h>
+#include <stdlib.h>
+
+#include "threadpool.h"
+
+/* Integer dot products run 64 bytes at a time with AVX-512 VNNI, 32 with
+AVX-VNNI or AVX2. VNNI multiplies unsigned by signed bytes, so the vector
+is offset by 128 and 128 * sum(a) taken off again. AVX2 has no such
+instruction; its maddubs would saturate on the offset vector, so it moves
+a's signs onto the vector instead and multiplies |a| by that. */
+#if defined(__AVX512VNNI__) && defined(__AVX512BW__)
+#include <immintrin.h>
+#define BDLA_QUANT_VNNI512
+#elif defined(__AVXVNNI__)
+#include <immintrin.h>
+#define BDLA_QUANT_VNNI256
+#elif defined(__AVX2__)
+#include <immintrin.h>
+#define BDLA_QUANT_AVX2
+#endif
+
+/* Dots are summed in 32 bits this many entries at a time, which can't
+overflow even with the 128 offset. */
+#define BDLA_QUANT_CHUNK 32768
+
+/* Round n values x[0], x[stride], ... to scale * q and return the scale.
+u, if not NULL, gets q + 128 for the unsigned side of VNNI. */
+static float bdla_quantize(const float *x, size_t stride, int n, int8_t *q, uint8_t *u) {
+	float m = 0.f, v, inv;
+	int j;
+	for (j = 0; j < n; ++j) {
+		v = fabsf(x[j * stride]);
+		m = v > m ? v : m;
+	}
+	inv = m > 0.f ? 127.f / m : 0.f;
+	for (j = 0; j < n; ++j) {
+		q[j] = (int8_t)lrintf(x[j * stride] * inv);
+	}
+	if (u != NULL) {
+		for (j = 0; j < n; ++j) { u[j] = (uint8_t)(q[j] + 128); }
+	}
+	return m / 127.f;
+}
+
+/* sum a[j] * x[j] for n <= BDLA_QUANT_CHUNK. xu is x + 128. */
+static int32_t bdla_QMxf_dot(const int8_t *a, const int8_t *x, const uint8_t *xu, int n) {
+	int32_t acc = 0;
+	int j = 0;
+#if defined(BDLA_QUANT_VNNI512)
+	__m512i sum = _mm512_setzero_si512(), off = _mm512_setzero_si512();
+	const __m512i c128 = _mm512_set1_epi8((char)128);
+	__m512i va;
+	for (; j + 64 <= n; j += 64) {
+		va = _mm512_loadu_si512((const void *)(a + j));
+		sum = _mm512_dpbusd_epi32(sum, _mm512_loadu_si512((const void *)(xu + j)), va);
+		off = _mm512_dpbusd_epi32(off, c128, va);
+	}
+	acc = _mm512_reduce_add_epi32(_mm512_sub_epi32(sum, off));
+	(void)x;
+#elif defined(BDLA_QUANT_VNNI256) || defined(BDLA_QUANT_AVX2)
+	__m256i sum = _mm256_setzero_si256(), va, vx;
+	__m128i s4;
+#if defined(BDLA_QUANT_VNNI256)
+	__m256i off = _mm256_setzero_si256();
+	const __m256i c128 = _mm256_set1_epi8((char)128);
+	for (; j + 32 <= n; j += 32) {
+		va = _mm256_loadu_si256((const __m256i *)(a + j));
+		vx = _mm256_loadu_si256((const __m256i *)(xu + j));
+		sum = _mm256_dpbusd_avx_epi32(sum, vx, va);
+		off = _mm256_dpbusd_avx_epi32(off, c128, va);
+	}
+	sum = _mm256_sub_epi32(sum, off);
+	(void)x;
+#else
+	const __m256i ones = _mm256_set1_epi16(1);
+	for (; j + 32 <= n; j += 32) {
+		va = _mm256_loadu_si256((const __m256i *)(a + j));
+		vx = _mm256_loadu_si256((const __m256i *)(x + j));
+		/* |a| * (x * sign(a)): pairs sum to at most 2 * 127 * 127. */
+		sum = _mm256_add_epi32(sum, _mm256_madd_epi16(_mm256_maddubs_epi16(
+			_mm256_sign_epi8(va, va), _mm256_sign_epi8(vx, va)), ones));
+	}
+	(void)xu;
+#endif
+	s4 = _mm_add_epi32(_mm256_castsi256_si128(sum), _mm256_extracti128_si256(sum, 1));
+	s4 = _mm_add_epi32(s4, _mm_shuffle_epi32(s4, _MM_SHUFFLE(1, 0, 3, 2)));
+	s4 = _mm_add_epi32(s4, _mm_shuffle_epi32(s4, _MM_SHUFFLE(2, 3, 0, 1)));
+	acc = _mm_cvtsi128_si32(s4);
+#else
+	(void)xu;
+#endif
+	for (; j < n; ++j) { acc += (int32_t)a[j] * x[j]; }
+	return acc;
+}
+
+/* The whole dot product of two length n rows, in chunks. */
+static float bdla_QMxf_rowdot(const int8_t *a, const int8_t *x, const uint8_t *xu, int n) {
+	int64_t acc = 0;
+	int j, len;
+	for (j = 0; j < n; j += BDLA_QUANT_CHUNK) {
+		len = n - j < BDLA_QUANT_CHUNK ? n - j : BDLA_QUANT_CHUNK;
+		acc += bdla_QMxf_dot(a + j, x + j, xu + j, len);
+	}
+	return (float)acc;
+}
+
+typedef struct {
+	bdla_Mxf A;
+	bdla_QMxf Q;
+	double *stats;		/* Per row: squared error, squared norm, largest error. */
+} bdla_QuantCtx;
+
+static void bdla_QMxf_quantrows(void *ctx, int begin, int end) {
+	bdla_QuantCtx *c = ctx;
+	const float *row;
+	int8_t *q;
+	double err2, norm2, maxerr, e;
+	float s;
+	int i, j, n = c->A.dims[1];
+	for (i = begin; i < end; ++i) {
+		row = c->A.arr + (size_t)i * n;
+		q = c->Q.arr + (size_t)i * n;
+		s = c->Q.scales[i] = bdla_quantize(row, 1, n, q, NULL);
+		if (c->stats == NULL) { continue; }
+		err2 = norm2 = maxerr = 0.;
+		for (j = 0; j < n; ++j) {
+			e = fabs((double)row[j] - (double)s * q[j]);
+			err2 += e * e;
+			norm2 += (double)row[j] * row[j];
+			maxerr = e > maxerr ? e : maxerr;
+		}
+		c->stats[3 * i] = err2;
+		c->stats[3 * i + 1] = norm2;
+		c->stats[3 * i + 2] = maxerr;
+	}
+}
+
+typedef struct {
+	bdla_QMxf A;
+	const int8_t *x;		/* Quantised operand, one row per column of B. */
+	const uint8_t *xu;
+	const float *xscales;
+	int ncols;			/* Columns of B, or 1 for vmult. */
+	float *y;
+} bdla_QuantMvCtx;
+
+static void bdla_QMxf_mult_rows(void *ctx, int begin, int end) {
+	bdla_QuantMvCtx *c = ctx;
+	const int8_t *a;
+	size_t off;
+	int i, j, jb, jend, k = c->A.dims[1];
+	/* Columns in blocks that stay in cache while every row passes by. */
+	int block = 262144 / k > 0 ? 262144 / k : 1;
+	for (jb = 0; jb < c->ncols; jb += block) {
+		jend = jb + block < c->ncols ? jb + block : c->ncols;
+		for (i = begin; i < end; ++i) {
+			a = c->A.arr + (size_t)i * k;
+			for (j = jb; j < jend; ++j) {
+				off = (size_t)j * k;
+				c->y[(size_t)i * c->ncols + j] = c->A.scales[i] * c->xscales[j]
+					* bdla_QMxf_rowdot(a, c->x + off, c->xu + off, k);
+			}
+		}
+	}
+}
+
+typedef struct {
+	bdla_Mxf B;
+	int8_t *q;
+	uint8_t *u;
+	float *scales;
+} bdla_QuantColsCtx;
+
+static void bdla_QMxf_quantcols(void *ctx, int begin, int end) {
+	bdla_QuantColsCtx *c = ctx;
+	size_t k = c->B.dims[0];
+	int j;
+	for (j = begin; j < end; ++j) {
+		c->scales[j] = bdla_quantize(c->B.arr + j, c->B.dims[1], (int)k,
+			c->q + j * k, c->u + j * k);
+	}
+}
+
+BDLA_EXPORT bdla_Status bdla_QMxf_fromMxf(bdla_Mxf A, bdla_QMxf *Y, bdla_QuantError *err) {
+	assert(A.arr != NULL);
+	assert(A.dims[0] > 0);
+	assert(A.dims[1] > 0);
+	assert(Y != NULL);
+	bdla_QuantCtx c;
+	double err2 = 0., norm2 = 0., maxerr = 0.;
+	int i;
+	Y->dims[0] = A.dims[0];
+	Y->dims[1] = A.dims[1];
+	Y->arr = malloc((size_t)A.dims[0] * A.dims[1]);
+	Y->scales = malloc(sizeof(float) * A.dims[0]);
+	c.stats = err != NULL ? malloc(sizeof(double) * 3 * A.dims[0]) : NULL;
+	if (Y->arr == NULL || Y->scales == NULL || (err != NULL && c.stats == NULL)) {
+		free(Y->arr);
+		free(Y->scales);
+		free(c.stats);
+		Y->arr = NULL;
+		Y->scales = NULL;
+		return BDLA_MEM_ERROR;
+	}
+	c.A = A;
+	c.Q = *Y;
+	bdla_parallel_for_static(A.dims[0], bdla_parallel_grain(A.dims[1]), bdla_QMxf_quantrows, &c);
+	if (err != NULL) {
+		for (i = 0; i < A.dims[0]; ++i) {
+			err2 += c.stats[3 * i];
+			norm2 += c.stats[3 * i + 1];
+			maxerr = c.stats[3 * i + 2] > maxerr ? c.stats[3 * i + 2] : maxerr;
+		}
+		err->max_abs = (float)maxerr;
+		err->rel_frobenius = norm2 > 0. ? (float)sqrt(err2 / norm2) : 0.f;
+		free(c.stats);
+	}
+	return BDLA_GOOD;
+}
+
+BDLA_EXPORT void bdla_QMxf_release(bdla_QMxf *mat) {
+	if (mat != NULL) {
+		assert(mat->arr != NULL);
+		free(mat->arr); mat->arr = NULL;
+		free(mat->scales); mat->scales = NULL;
+		mat->dims[0] = 0;
+		mat->dims[1] = 0;
+	}
+	return;
+}
+
+BDLA_EXPORT bdla_Status bdla_QMxf_toMxf(bdla_QMxf A, bdla_Mxf *Y) {
+	assert(A.arr != NULL);
+	assert(Y != NULL);
+	assert(Y->arr != NULL);
+	size_t i, j, n = A.dims[1];
+	if (A.dims[0] != Y->dims[0] || A.dims[1] != Y->dims[1]) {
+		if (bdla_Mxf_resize(Y, A.dims[0], A.dims[1]) != BDLA_GOOD) {
+			return BDLA_MEM_ERROR;
+		}
+	}
+	for (i = 0; i < (size_t)A.dims[0]; ++i) {
+		for (j = 0; j < n; ++j) {
+			Y->arr[i * n + j] = A.scales[i] * A.arr[i * n + j];
+		}
+	}
+	return BDLA_GOOD;
+}
+
+BDLA_EXPORT int bdla_QMxf_rows(bdla_QMxf A) {
+	assert(A.arr != NULL);
+	return A.dims[0];
+}
+
+BDLA_EXPORT int bdla_QMxf_cols(bdla_QMxf A) {
+	assert(A.arr != NULL);
+	return A.dims[1];
+}
+
+BDLA_EXPORT float bdla_QMxf_value(bdla_QMxf A, int row, int col) {
+	assert(A.arr != NULL);
+	assert(row >= 0 && row < A.dims[0] && "Bad row index");
+	assert(col >= 0 && col < A.dims[1] && "Bad column index");
+	return A.scales[row] * A.arr[(size_t)row * A.dims[1] + col];
+}
+
+BDLA_EXPORT bdla_Status bdla_QMxf_vmult(bdla_QMxf A, bdla_Vxf b, bdla_Vxf *y) {
+	assert(A.arr != NULL);
+	assert(b.arr != NULL);
+	assert(y != NULL);
+	assert(y->arr != NULL);
+	if (A.dims[0] != y->len || A.dims[1] != b.len) {
+		return BDLA_DIMENSION_MISMATCH;
+	}
+	bdla_QuantMvCtx c;
+	float xscale;
+	/* b is quantised before y is written, so they may alias. */
+	int8_t *q = malloc(b.len);
+	uint8_t *u = malloc(b.len);
+	if (q == NULL || u == NULL) {
+		free(q);
+		free(u);
+		return BDLA_MEM_ERROR;
+	}
+	xscale = bdla_quantize(b.arr, 1, b.len, q, u);
+	c.A = A;
+	c.x = q;
+	c.xu = u;
+	c.xscales = &xscale;
+	c.ncols = 1;
+	c.y = y->arr;
+	bdla_parallel_for_static(A.dims[0], bdla_parallel_grain(A.dims[1]), bdla_QMxf_mult_rows, &c);
+	free(q);
+	free(u);
+	return BDLA_GOOD;
+}
+
+BDLA_EXPORT bdla_Status bdla_QMxf_mult(bdla_QMxf A, bdla_Mxf B, bdla_Mxf *Y) {
+	assert(A.arr != NULL);
+	assert(B.arr != NULL);
+	assert(Y != NULL);
+	assert(Y->arr != NULL);
+	if (A.dims[1] != B.dims[0]) { return BDLA_DIMENSION_MISMATCH; }
+	bdla_QuantColsCtx qc;
+	bdla_QuantMvCtx c;
+	size_t k = B.dims[0], n = B.dims[1];
+	bdla_Status s = BDLA_GOOD;
+	/* Each column of B, quantised and stored contiguously. */
+	qc.B = B;
+	qc.q = malloc(k * n);
+	qc.u = malloc(k * n);
+	qc.scales = malloc(sizeof(float) * n);
+	if (qc.q == NULL || qc.u == NULL || qc.scales == NULL) {
+		s = BDLA_MEM_ERROR;
+		goto cleanup;
+	}
+	bdla_parallel_for(B.dims[1], bdla_parallel_grain(k), bdla_QMxf_quantcols, &qc);
+	/* B has been copied, so Y may be B. */
+	if (Y->dims[0] != A.dims[0] || Y->dims[1] != B.dims[1]) {
+		if (bdla_Mxf_resize(Y, A.dims[0], B.dims[1]) != BDLA_GOOD) {
+			s = BDLA_MEM_ERROR;
+			goto cleanup;
+		}
+	}
+	c.A = A;
+	c.x = qc.q;
+	c.xu = qc.u;
+	c.xscales = qc.scales;
+	c.ncols = B.dims[1];
+	c.y = Y->arr;
+	bdla_parallel_for_static(A.dims[0], bdla_parallel_grain(k * n), bdla_QMxf_mult_rows, &c);
+cleanup:
+	free(qc.q);
+	free(qc.u);
+	free(qc.scales);
+	return s;
+}
@@ -0,0 +1,387 @@
+#include "libbdla.h"
+/*============================================================================
+blasSMxf.c
+
+Compressed sparse row float matrix basic linear algebra.
+
+Copyright(c) 2019 HJA Bird
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files(the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions :
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+============================================================================*/
+#include <assert.h>
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "alloc.h"
+#include "threadpool.h"
+
+typedef struct {
+	int col;
+	float val;
+} bdla_SMxf_entry;
+
+static int bdla_SMxf_entry_compare(const void *a, const void *b) {
+	int ca = ((const bdla_SMxf_entry*)a)->col;
+	int cb = ((const bdla_SMxf_entry*)b)->col;
+	return (ca > cb) - (ca < cb);
+}
+
+BDLA_EXPORT bdla_SMxf bdla_SMxf_create(int r, int c, int nnz) {
+	assert(r > 0);
+	assert(c > 0);
+	assert(nnz >= 0);
+	bdla_SMxf ret;
+	ret.dims[0] = r;
+	ret.dims[1] = c;
+	ret.nnz = nnz;
+	ret.row_ptr = calloc(r + 1, sizeof(int));
+	/* Allocate at least one entry so that empty matrices are still valid. */
+	ret.col_idx = malloc(sizeof(int) * (nnz > 0 ? nnz : 1));
+	ret.arr = malloc(sizeof(float) * (nnz > 0 ? nnz : 1));
+	return ret;
+}
+
+BDLA_EXPORT void bdla_SMxf_release(bdla_SMxf *mat) {
+	if (mat != NULL) {
+		assert(mat->arr != NULL);
+		free(mat->row_ptr); mat->row_ptr = NULL;
+		free(mat->col_idx); mat->col_idx = NULL;
+		free(mat->arr); mat->arr = NULL;
+		mat->dims[0] = 0;
+		mat->dims[1] = 0;
+		mat->nnz = 0;
+	}
+	return;
+}
+
+BDLA_EXPORT bdla_SMxf bdla_SMxf_copy(bdla_SMxf mat) {
+	assert(mat.arr != NULL);
+	bdla_SMxf ret = bdla_SMxf_create(mat.dims[0], mat.dims[1], mat.nnz);
+	memcpy(ret.row_ptr, mat.row_ptr, sizeof(int) * (mat.dims[0] + 1));
+	memcpy(ret.col_idx, mat.col_idx, sizeof(int) * mat.nnz);
+	memcpy(ret.arr, mat.arr, sizeof(float) * mat.nnz);
+	return ret;
+}
+
+typedef struct {
+	bdla_Mxf A;
+	bdla_SMxf *Y;
+	int *counts;
+} bdla_FromMxfCtx;
+
+static void bdla_SMxf_countrows(void *ctx, int begin, int end) {
+	bdla_FromMxfCtx *c = ctx;
+	const float *row;
+	int i, j, count;
+	for (i = begin; i < end; ++i) {
+		row = c->A.arr + (size_t)i * c->A.dims[1];
+		for (count = 0, j = 0; j < c->A.dims[1]; ++j) {
+			count += row[j] != 0.f;
+		}
+		c->counts[i + 1] = count;
+	}
+}
+
+static void bdla_SMxf_fillrows(void *ctx, int begin, int end) {
+	bdla_FromMxfCtx *c = ctx;
+	const float *row;
+	int i, j, k;
+	for (i = begin; i < end; ++i) {
+		row = c->A.arr + (size_t)i * c->A.dims[1];
+		k = c->Y->row_ptr[i];
+		for (j = 0; j < c->A.dims[1]; ++j) {
+			if (row[j] != 0.f) {
+				c->Y->col_idx[k] = j;
+				c->Y->arr[k] = row[j];
+				++k;
+			}
+		}
+	}
+}
+
+BDLA_EXPORT bdla_Status bdla_SMxf_fromMxf(bdla_Mxf A, bdla_SMxf *Y) {
+	assert(A.arr != NULL);
+	assert(A.dims[0] > 0);
+	assert(A.dims[1] > 0);
+	assert(Y != NULL);
+	int i, nnz, grain = bdla_parallel_grain(A.dims[1]);
+	bdla_FromMxfCtx c;
+	int *counts = calloc(A.dims[0] + 1, sizeof(int));
+	if (counts == NULL) { return BDLA_MEM_ERROR; }
+	/* Count the non-zeros in each row, then scan to get row offsets. */
+	c.A = A;
+	c.Y = Y;
+	c.counts = counts;
+	bdla_parallel_for(A.dims[0], grain, bdla_SMxf_countrows, &c);
+	for (i = 0; i < A.dims[0]; ++i) {
+		counts[i + 1] += counts[i];
+	}
+	nnz = counts[A.dims[0]];
+	*Y = bdla_SMxf_create(A.dims[0], A.dims[1], nnz);
+	if (Y->row_ptr == NULL || Y->col_idx == NULL || Y->arr == NULL) {
+		free(counts);
+		return BDLA_MEM_ERROR;
+	}
+	memcpy(Y->row_ptr, counts, sizeof(int) * (A.dims[0] + 1));
+	free(counts);
+	bdla_parallel_for_static(A.dims[0], grain, bdla_SMxf_fillrows, &c);
+	return BDLA_GOOD;
+}
+
+BDLA_EXPORT bdla_Status bdla_SMxf_fromtriplets(int r, int c, int n,
+	const int *rows, const int *cols, const float *vals, bdla_SMxf *Y) {
+	assert(r > 0);
+	assert(c > 0);
+	assert(n >= 0);
+	assert(n == 0 || (rows != NULL && cols != NULL && vals != NULL));
+	assert(Y != NULL);
+	int i, j, k, start, end;
+	for (i = 0; i < n; ++i) {
+		if (rows[i] < 0 || rows[i] >= r || cols[i] < 0 || cols[i] >= c) {
+			return BDLA_BAD_INDEX;
+		}
+	}
+	int *offsets = calloc(r + 1, sizeof(int));
+	bdla_SMxf_entry *entries = malloc(sizeof(bdla_SMxf_entry) * (n > 0 ? n : 1));
+	if (offsets == NULL || entries == NULL) {
+		free(offsets);
+		free(entries);
+		return BDLA_MEM_ERROR;
+	}
+	/* Bucket the triplets by row. */
+	for (i = 0; i < n; ++i) {
+		offsets[rows[i] + 1] += 1;
+	}
+	for (i = 0; i < r; ++i) {
+		offsets[i + 1] += offsets[i];
+	}
+	for (i = 0; i < n; ++i) {
+		k = offsets[rows[i]]++;
+		entries[k].col = cols[i];
+		entries[k].val = vals[i];
+	}
+	/* offsets[i] now holds the end of row i. Shift back to get the starts. */
+	for (i = r; i > 0; --i) {
+		offsets[i] = offsets[i - 1];
+	}
+	offsets[0] = 0;
+	/* Sort each row by column and sum duplicates, compacting in place. */
+	k = 0;
+	for (i = 0; i < r; ++i) {
+		start = offsets[i];
+		end = offsets[i + 1];
+		qsort(entries + start, end - start, sizeof(bdla_SMxf_entry),
+			bdla_SMxf_entry_compare);
+		offsets[i] = k;
+		for (j = start; j < end; ++j) {
+			if (k > offsets[i] && entries[k - 1].col == entries[j].col) {
+				entries[k - 1].val += entries[j].val;
+			}
+			else {
+				entries[k++] = entries[j];
+			}
+		}
+	}
+	offsets[r] = k;
+	*Y = bdla_SMxf_create(r, c, k);
+	if (Y->row_ptr == NULL || Y->col_idx == NULL || Y->arr == NULL) {
+		free(offsets);
+		free(entries);
+		return BDLA_MEM_ERROR;
+	}
+	memcpy(Y->row_ptr, offsets, sizeof(int) * (r + 1));
+	for (i = 0; i < k; ++i) {
+		Y->col_idx[i] = entries[i].col;
+		Y->arr[i] = entries[i].val;
+	}
+	free(offsets);
+	free(entries);
+	return BDLA_GOOD;
+}
+
+BDLA_EXPORT bdla_Status bdla_SMxf_toMxf(bdla_SMxf A, bdla_Mxf *Y) {
+	assert(A.arr != NULL);
+	assert(A.dims[0] > 0);
+	assert(A.dims[1] > 0);
+	assert(Y != NULL);
+	assert(Y->arr != NULL);
+	int i, k;
+	if (A.dims[0] != Y->dims[0] || A.dims[1] != Y->dims[1]) {
+		if (bdla_Mxf_resize(Y, A.dims[0], A.dims[1]) != BDLA_GOOD) {
+			return BDLA_MEM_ERROR;
+		}
+	}
+	bdla_Mxf_zero(Y);
+	for (i = 0; i < A.dims[0]; ++i) {
+		for (k = A.row_ptr[i]; k < A.row_ptr[i + 1]; ++k) {
+			Y->arr[(size_t)i * A.dims[1] + A.col_idx[k]] = A.arr[k];
+		}
+	}
+	return BDLA_GOOD;
+}
+
+BDLA_EXPORT int bdla_SMxf_rows(bdla_SMxf A) {
+	assert(A.arr != NULL);
+	return A.dims[0];
+}
+
+BDLA_EXPORT int bdla_SMxf_cols(bdla_SMxf A) {
+	assert(A.arr != NULL);
+	return A.dims[1];
+}
+
+BDLA_EXPORT int bdla_SMxf_nnz(bdla_SMxf A) {
+	assert(A.arr != NULL);
+	return A.nnz;
+}
+
+BDLA_EXPORT float bdla_SMxf_value(bdla_SMxf A, int row, int col) {
+	assert(A.arr != NULL);
+	assert(row >= 0 && row < A.dims[0] && "Bad row index");
+	assert(col >= 0 && col < A.dims[1] && "Bad column index");
+	/* Binary search of the sorted column indices in the row. */
+	int lo = A.row_ptr[row], hi = A.row_ptr[row + 1] - 1, mid;
+	while (lo <= hi) {
+		mid = lo + (hi - lo) / 2;
+		if (A.col_idx[mid] == col) { return A.arr[mid]; }
+		else if (A.col_idx[mid] < col) { lo = mid + 1; }
+		else { hi = mid - 1; }
+	}
+	return 0.f;
+}
+
+typedef struct {
+	bdla_SMxf A;
+	const float *x, *b;
+	float *y;
+} bdla_SpmvCtx;
+
+/* Rows per chunk, from the average row length. */
+static int bdla_SMxf_grain(bdla_SMxf A) {
+	int per_row = A.dims[0] > 0 ? A.nnz / A.dims[0] : 0;
+	return bdla_parallel_grain(per_row > 0 ? per_row : 1);
+}
+
+static void bdla_SMxf_vmult_rows(void *ctx, int begin, int end) {
+	bdla_SpmvCtx *c = ctx;
+	float acc;
+	int i, k;
+	for (i = begin; i < end; ++i) {
+		acc = 0.f;
+		for (k = c->A.row_ptr[i]; k < c->A.row_ptr[i + 1]; ++k) {
+			acc += c->A.arr[k] * c->x[c->A.col_idx[k]];
+		}
+		c->y[i] = acc;
+	}
+}
+
+static double bdla_SMxf_residual_rows(void *ctx, int begin, int end) {
+	bdla_SpmvCtx *c = ctx;
+	double sumsq = 0.;
+	float ri;
+	int i, k;
+	for (i = begin; i < end; ++i) {
+		ri = c->b[i];
+		for (k = c->A.row_ptr[i]; k < c->A.row_ptr[i + 1]; ++k) {
+			ri -= c->A.arr[k] * c->x[c->A.col_idx[k]];
+		}
+		if (c->y != NULL) { c->y[i] = ri; }
+		sumsq += (double)ri * ri;
+	}
+	return sumsq;
+}
+
+BDLA_EXPORT bdla_Status bdla_SMxf_vmult(bdla_SMxf A, bdla_Vxf b, bdla_Vxf *y) {
+	assert(A.arr != NULL);
+	assert(b.arr != NULL);
+	assert(y != NULL);
+	assert(y->arr != NULL);
+	if (A.dims[0] != y->len || A.dims[1] != b.len) {
+		return BDLA_DIMENSION_MISMATCH;
+	}
+	int alias = 0;
+	bdla_SpmvCtx c;
+	float *outarr = y->arr;
+	if (bdla_floats_overlap(y->arr, y->len, b.arr, b.len)
+		|| bdla_floats_overlap(y->arr, y->len, A.arr, A.nnz)) {
+		alias = 1;
+		outarr = malloc(sizeof(float) * y->len);
+		if (outarr == NULL) { return BDLA_MEM_ERROR; }
+	}
+	c.A = A;
+	c.x = b.arr;
+	c.b = NULL;
+	c.y = outarr;
+	bdla_parallel_for_static(A.dims[0], bdla_SMxf_grain(A), bdla_SMxf_vmult_rows, &c);
+	if (alias) {
+		memcpy(y->arr, outarr, sizeof(float) * y->len);
+		free(outarr);
+	}
+	return BDLA_GOOD;
+}
+
+BDLA_EXPORT bdla_Status bdla_SMxf_residual(bdla_SMxf A, bdla_Vxf x, bdla_Vxf b,
+	bdla_Vxf *r, float *rnorm) {
+	assert(A.arr != NULL);
+	assert(x.arr != NULL);
+	assert(b.arr != NULL);
+	assert(r == NULL || r->arr != NULL);
+	if (x.len != A.dims[1] || b.len != A.dims[0]) { return BDLA_DIMENSION_MISMATCH; }
+	if (r != NULL && r->len != A.dims[0]) { return BDLA_DIMENSION_MISMATCH; }
+	int alias = 0;
+	double sumsq;
+	bdla_SpmvCtx c;
+	float *outarr = r != NULL ? r->arr : NULL;
+	/* Each row reads its own element of b before writing r, so r may be b. */
+	if (r != NULL && (bdla_floats_overlap(r->arr, r->len, x.arr, x.len)
+		|| bdla_floats_overlap(r->arr, r->len, A.arr, A.nnz)
+		|| (r->arr != b.arr && bdla_floats_overlap(r->arr, r->len, b.arr, b.len)))) {
+		alias = 1;
+		outarr = malloc(sizeof(float) * r->len);
+		if (outarr == NULL) { return BDLA_MEM_ERROR; }
+	}
+	c.A = A;
+	c.x = x.arr;
+	c.b = b.arr;
+	c.y = outarr;
+	sumsq = bdla_parallel_sum(A.dims[0], bdla_SMxf_grain(A), bdla_SMxf_residual_rows, &c);
+	if (alias) {
+		memcpy(r->arr, outarr, sizeof(float) * r->len);
+		free(outarr);
+	}
+	if (rnorm != NULL) { *rnorm = (float)sqrt(sumsq); }
+	return BDLA_GOOD;
+}
+
+BDLA_EXPORT bdla_Status bdla_SMxf_diag(bdla_SMxf A, bdla_Vxf *b) {
+	assert(A.arr != NULL);
+	assert(b != NULL);
+	assert(b->arr != NULL);
+	int i, len;
+	len = A.dims[0] < A.dims[1] ? A.dims[0] : A.dims[1];
+	if (b->len != len) {
+		if (bdla_Vxf_resize(b, len) != BDLA_GOOD) { return BDLA_MEM_ERROR; }
+	}
+	/* A binary search per row: cheap enough not to bother threading. */
+	for (i = 0; i < len; ++i) {
+		b->arr[i] = bdla_SMxf_value(A, i, i);
+	}
+	return BDLA_GOOD;
+}
@@ -29,11 +29,13 @@ SOFTWARE.
 #include <string.h>
 
 #include <openblas/cblas.h>
+#include "alloc.h"
 #include "nanimpl.h"
+#include "threadpool.h"
 
 BDLA_EXPORT bdla_Vxf bdla_Vxf_create(int len) {
 	assert(len > 0);
-	bdla_Vxf r = { len, malloc(sizeof(float)*len) };
+	bdla_Vxf r = { len, bdla_alloc_floats(len) };
 	return r;
 }
 
@@ -49,7 +51,7 @@ BDLA_EXPORT void bdla_Vxf_release(bdla_Vxf *mat) {
 BDLA_EXPORT bdla_Vxf bdla_Vxf_copy(bdla_Vxf vec) {
 	assert(vec.arr != NULL);
 	bdla_Vxf ret = vec;
-	ret.arr = malloc(sizeof(float) * ret.len);
+	ret.arr = bdla_alloc_floats(ret.len);
 	memcpy(ret.arr, vec.arr, sizeof(float) * ret.len);
 	return ret;
 }
@@ -83,6 +85,19 @@ BDLA_EXPORT bdla_Status bdla_Vxf_copyin(bdla_Vxf *dest, bdla_Vxf source) {
 	return BDLA_GOOD;
 }
 
+BDLA_EXPORT bdla_Status bdla_Vxf_asMxf(bdla_Vxf a, int rows, int cols, bdla_Mxf *Y) {
+	assert(a.arr != NULL);
+	assert(a.len > 0);
+	assert(Y != NULL);
+	assert(rows > 0);
+	assert(cols > 0);
+	if (rows * cols != a.len) { return BDLA_DIMENSION_MISMATCH; }
+	Y->dims[0] = rows;
+	Y->dims[1] = cols;
+	Y->arr = a.arr;
+	return BDLA_GOOD;
+}
+
 BDLA_EXPORT int bdla_Vxf_length(bdla_Vxf A) {
 	assert(A.arr != NULL);
 	assert(A.arr >= 0);
@@ -231,6 +246,26 @@ BDLA_EXPORT bdla_Status bdla_Vxf_ewdiv(bdla_Vxf a, bdla_Vxf b, bdla_Vxf *y) {
 	return BDLA_GOOD;
 }
 
+/* Each row of Y is a scaled copy of b: written once, with nothing read
+back, which a rank 1 sgemm doesn't manage. bdla_Mxf_ger accumulates. */
+typedef struct {
+	const float *a, *b;
+	float *Y;
+	int n;
+} bdla_OuterCtx;
+
+static void bdla_Vxf_outer_rows(void *ctx, int begin, int end) {
+	bdla_OuterCtx *c = ctx;
+	float *y;
+	int i, j;
+	for (i = begin; i < end; ++i) {
+		y = c->Y + (size_t)i * c->n;
+		for (j = 0; j < c->n; ++j) {
+			y[j] = c->a[i] * c->b[j];
+		}
+	}
+}
+
 BDLA_EXPORT bdla_Status bdla_Vxf_outer(bdla_Vxf a, bdla_Vxf b, bdla_Mxf *Y) {
 	assert(a.arr != NULL);
 	assert(a.len >= 0);
@@ -243,9 +278,12 @@ BDLA_EXPORT bdla_Status bdla_Vxf_outer(bdla_Vxf a, bdla_Vxf b, bdla_Mxf *Y) {
 	if (a.len != Y->dims[0] || Y->dims[1] != b.len ) { 
 		return BDLA_DIMENSION_MISMATCH; 
 	}
-	/* Since we want to overwrite whatever is in Y. */
-	cblas_sgemm(CblasRowMajor, CblasNoTrans, CblasNoTrans,
-		a.len, b.len, 1, 1.f, a.arr, 1, b.arr, b.len, 0.f, Y->arr, b.len);
+	bdla_OuterCtx c;
+	c.a = a.arr;
+	c.b = b.arr;
+	c.Y = Y->arr;
+	c.n = b.len;
+	bdla_parallel_for_static(a.len, bdla_parallel_grain(b.len), bdla_Vxf_outer_rows, &c);
 	return BDLA_GOOD;
 }
 
@@ -376,7 +414,7 @@ BDLA_EXPORT bdla_Status bdla_Vxf_zero(bdla_Vxf *a) {
 	assert(a != NULL);
 	assert(a->len >= 0);
 	assert(a->arr != NULL);
-	memset(a->arr, 0x00, sizeof(float) * a->len);
+	bdla_parallel_fill(a->arr, a->len, 1, 0.f);
 	return BDLA_GOOD;
 }
 
@@ -384,10 +422,7 @@ BDLA_EXPORT bdla_Status bdla_Vxf_uniform(bdla_Vxf *a, float b) {
 	assert(a != NULL);
 	assert(a->len >= 0);
 	assert(a->arr != NULL);
-	int i;
-	for (i = 0; i < a->len; ++i) {
-		a->arr[i] = b;
-	}
+	bdla_parallel_fill(a->arr, a->len, 1, b);
 	return BDLA_GOOD;
 }
 
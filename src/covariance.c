@@ -0,0 +1,241 @@
+#include "libbdla.h"
+/*============================================================================
+covariance.c
+
+Streaming covariance: samples are buffered into blocks that are centred and
+folded in by syrk, and the blocks combined in double.
+
+Copyright(c) 2019 HJA Bird
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files(the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions :
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+============================================================================*/
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "alloc.h"
+
+#define BDLA_COVF_BLOCK 256
+
+BDLA_EXPORT bdla_Covf bdla_Covf_create(int dim, int block) {
+	assert(dim > 0);
+	assert(block >= 0);
+	bdla_Covf ret;
+	ret.dim = dim;
+	ret.block = block > 0 ? block : BDLA_COVF_BLOCK;
+	ret.buffered = 0;
+	ret.count = 0;
+	ret.buf = bdla_alloc_floats((size_t)ret.block * dim);
+	ret.gram = bdla_alloc_floats((size_t)dim * dim);
+	/* The second half of mean is room for a block's mean. */
+	ret.mean = calloc((size_t)2 * dim, sizeof(double));
+	ret.m2 = calloc((size_t)dim * dim, sizeof(double));
+	if (ret.buf == NULL || ret.gram == NULL || ret.mean == NULL || ret.m2 == NULL) {
+		free(ret.buf);
+		free(ret.gram);
+		free(ret.mean);
+		free(ret.m2);
+		ret.buf = NULL;
+		ret.gram = NULL;
+		ret.mean = NULL;
+		ret.m2 = NULL;
+	}
+	return ret;
+}
+
+BDLA_EXPORT void bdla_Covf_release(bdla_Covf *acc) {
+	if (acc != NULL) {
+		assert(acc->buf != NULL);
+		free(acc->buf); acc->buf = NULL;
+		free(acc->gram); acc->gram = NULL;
+		free(acc->mean); acc->mean = NULL;
+		free(acc->m2); acc->m2 = NULL;
+		acc->dim = 0;
+		acc->buffered = 0;
+		acc->count = 0;
+	}
+	return;
+}
+
+BDLA_EXPORT int64_t bdla_Covf_count(bdla_Covf acc) {
+	assert(acc.buf != NULL);
+	return acc.count + acc.buffered;
+}
+
+/* Takes in nb samples with mean mb, whose centred sum of squares the
+caller has already added to m2. The pairwise update of Chan, Golub and
+LeVeque: the difference of the means accounts for the rest. */
+static void bdla_Covf_combine(bdla_Covf *acc, int64_t nb, const double *mb) {
+	int i, j, d = acc->dim;
+	int64_t n = acc->count + nb;
+	double f = (double)acc->count * (double)nb / (double)n, di;
+	for (i = 0; i < d; ++i) {
+		di = f * (mb[i] - acc->mean[i]);
+		for (j = 0; j <= i; ++j) {
+			acc->m2[(size_t)i * d + j] += di * (mb[j] - acc->mean[j]);
+		}
+	}
+	for (i = 0; i < d; ++i) {
+		acc->mean[i] += (mb[i] - acc->mean[i]) * ((double)nb / (double)n);
+	}
+	acc->count = n;
+}
+
+/* Centres the buffered block on its own mean, so that the float syrk
+only sees deviations, then folds it in. */
+static bdla_Status bdla_Covf_flush(bdla_Covf *acc) {
+	int i, j, b = acc->buffered, d = acc->dim;
+	double *mb = acc->mean + d;
+	float *x;
+	if (b == 0) { return BDLA_GOOD; }
+	for (j = 0; j < d; ++j) { mb[j] = 0.; }
+	for (i = 0; i < b; ++i) {
+		x = acc->buf + (size_t)i * d;
+		for (j = 0; j < d; ++j) { mb[j] += x[j]; }
+	}
+	for (j = 0; j < d; ++j) { mb[j] /= b; }
+	for (i = 0; i < b; ++i) {
+		x = acc->buf + (size_t)i * d;
+		for (j = 0; j < d; ++j) { x[j] -= (float)mb[j]; }
+	}
+	bdla_Mxf X = { { b, d }, acc->buf };
+	bdla_Mxf G = { { d, d }, acc->gram };
+	bdla_Status stat = bdla_Mxf_syrk(1.f, X, BDLA_TRANS, 0.f, BDLA_MATRIX_TRI_LOWER, &G);
+	if (stat != BDLA_GOOD) { return stat; }
+	for (i = 0; i < d; ++i) {
+		for (j = 0; j <= i; ++j) {
+			acc->m2[(size_t)i * d + j] += G.arr[(size_t)i * d + j];
+		}
+	}
+	bdla_Covf_combine(acc, b, mb);
+	acc->buffered = 0;
+	return BDLA_GOOD;
+}
+
+/* Copies rows into the block, flushing it whenever it fills. */
+static bdla_Status bdla_Covf_push(bdla_Covf *acc, const float *rows, int n) {
+	int take, d = acc->dim;
+	bdla_Status stat;
+	while (n > 0) {
+		take = acc->block - acc->buffered;
+		take = take < n ? take : n;
+		memcpy(acc->buf + (size_t)acc->buffered * d, rows, sizeof(float) * take * d);
+		acc->buffered += take;
+		rows += (size_t)take * d;
+		n -= take;
+		if (acc->buffered == acc->block) {
+			stat = bdla_Covf_flush(acc);
+			if (stat != BDLA_GOOD) { return stat; }
+		}
+	}
+	return BDLA_GOOD;
+}
+
+BDLA_EXPORT bdla_Status bdla_Covf_add(bdla_Covf *acc, bdla_Vxf x) {
+	assert(acc != NULL);
+	assert(acc->buf != NULL);
+	assert(x.arr != NULL);
+	if (x.len != acc->dim) { return BDLA_DIMENSION_MISMATCH; }
+	return bdla_Covf_push(acc, x.arr, 1);
+}
+
+BDLA_EXPORT bdla_Status bdla_Covf_addrows(bdla_Covf *acc, bdla_Mxf X) {
+	assert(acc != NULL);
+	assert(acc->buf != NULL);
+	assert(X.arr != NULL);
+	if (X.dims[1] != acc->dim) { return BDLA_DIMENSION_MISMATCH; }
+	return bdla_Covf_push(acc, X.arr, X.dims[0]);
+}
+
+BDLA_EXPORT bdla_Status bdla_Covf_merge(bdla_Covf *acc, bdla_Covf *other) {
+	assert(acc != NULL);
+	assert(acc->buf != NULL);
+	assert(other != NULL);
+	assert(other->buf != NULL);
+	assert(acc != other);
+	int i, j, d = acc->dim;
+	bdla_Status stat;
+	if (other->dim != d) { return BDLA_DIMENSION_MISMATCH; }
+	stat = bdla_Covf_flush(acc);
+	if (stat != BDLA_GOOD) { return stat; }
+	stat = bdla_Covf_flush(other);
+	if (stat != BDLA_GOOD) { return stat; }
+	if (other->count == 0) { return BDLA_GOOD; }
+	for (i = 0; i < d; ++i) {
+		for (j = 0; j <= i; ++j) {
+			acc->m2[(size_t)i * d + j] += other->m2[(size_t)i * d + j];
+		}
+	}
+	bdla_Covf_combine(acc, other->count, other->mean);
+	return BDLA_GOOD;
+}
+
+BDLA_EXPORT bdla_Status bdla_Covf_finalise(bdla_Covf *acc, int ddof,
+	bdla_Vxf *mean, bdla_Mxf *cov) {
+	assert(acc != NULL);
+	assert(acc->buf != NULL);
+	assert(ddof >= 0);
+	assert(mean != NULL ? mean->arr != NULL : 1);
+	assert(cov != NULL ? cov->arr != NULL : 1);
+	int i, j, d = acc->dim;
+	double scale;
+	bdla_Status stat = bdla_Covf_flush(acc);
+	if (stat != BDLA_GOOD) { return stat; }
+	if (acc->count <= ddof) { return BDLA_UNDERSIZED; }
+	if (mean != NULL) {
+		if (mean->len != d && bdla_Vxf_resize(mean, d) != BDLA_GOOD) { return BDLA_MEM_ERROR; }
+		for (i = 0; i < d; ++i) { mean->arr[i] = (float)acc->mean[i]; }
+	}
+	if (cov != NULL) {
+		if ((cov->dims[0] != d || cov->dims[1] != d)
+			&& bdla_Mxf_resize(cov, d, d) != BDLA_GOOD) {
+			return BDLA_MEM_ERROR;
+		}
+		scale = 1. / (double)(acc->count - ddof);
+		for (i = 0; i < d; ++i) {
+			for (j = 0; j <= i; ++j) {
+				cov->arr[(size_t)i * d + j] = cov->arr[(size_t)j * d + i] =
+					(float)(acc->m2[(size_t)i * d + j] * scale);
+			}
+		}
+	}
+	return BDLA_GOOD;
+}
+
+BDLA_EXPORT bdla_Status bdla_Covf_gram(bdla_Covf *acc, bdla_Mxf *G) {
+	assert(acc != NULL);
+	assert(acc->buf != NULL);
+	assert(G != NULL);
+	assert(G->arr != NULL);
+	int i, j, d = acc->dim;
+	double n;
+	bdla_Status stat = bdla_Covf_flush(acc);
+	if (stat != BDLA_GOOD) { return stat; }
+	if ((G->dims[0] != d || G->dims[1] != d) && bdla_Mxf_resize(G, d, d) != BDLA_GOOD) {
+		return BDLA_MEM_ERROR;
+	}
+	n = (double)acc->count;
+	for (i = 0; i < d; ++i) {
+		for (j = 0; j <= i; ++j) {
+			G->arr[(size_t)i * d + j] = G->arr[(size_t)j * d + i] = (float)(
+				acc->m2[(size_t)i * d + j] + n * acc->mean[i] * acc->mean[j]);
+		}
+	}
+	return BDLA_GOOD;
+}
@@ -0,0 +1,111 @@
+#ifndef BDLA_EIGSOLVE_COMMON_H
+#define BDLA_EIGSOLVE_COMMON_H
+/*============================================================================
+eigsolve_common.h
+
+Shared pieces of the symmetric eigensolvers.
+
+Copyright(c) 2019 HJA Bird
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files(the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions :
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+============================================================================*/
+#include "libbdla.h"
+
+#include <assert.h>
+#include <math.h>
+#include <stdint.h>
+
+/* Checks A is square and symmetric and clamps silly tolerances. */
+static inline bdla_Status bdla_eigsolve_checkargs(
+	bdla_Mxf A, bdla_MatrixProperty A_prop, float *tol) {
+	assert(tol != NULL);
+	if (A.dims[0] != A.dims[1]) { return BDLA_NONSQUARE; }
+	if (A_prop != BDLA_MATRIX_SYMMETRIC && A_prop != BDLA_MATRIX_POSITIVE_DEFINITE) {
+		return BDLA_BAD_PROPERTY;
+	}
+	if (*tol > 1.f) { *tol = 1e-5f; }
+	return BDLA_GOOD;
+}
+
+/* Fills x with values in [-1, 1). The same state gives the same vector, so
+runs are repeatable. */
+static inline void bdla_eigsolve_random(float *x, int n, uint32_t *state) {
+	int i;
+	for (i = 0; i < n; ++i) {
+		*state ^= *state << 13;
+		*state ^= *state >> 17;
+		*state ^= *state << 5;
+		x[i] = (float)(*state >> 8) * (2.f / 16777216.f) - 1.f;
+	}
+}
+
+/* Cyclic Jacobi on the symmetric m x m matrix S, which is overwritten.
+Eigenvalues go to w and eigenvectors to the columns of Q. Only meant for
+the small projected problems of the iterative solvers. */
+static inline void bdla_eigsolve_jacobi(double *S, int m, double *w, double *Q) {
+	double off, diag, tau, t, c, s, a, b;
+	int sweep, p, q, i;
+	for (i = 0; i < m * m; ++i) { Q[i] = 0.; }
+	for (i = 0; i < m; ++i) { Q[i * m + i] = 1.; }
+	for (sweep = 0; sweep < 64; ++sweep) {
+		off = diag = 0.;
+		for (p = 0; p < m; ++p) {
+			diag += S[p * m + p] * S[p * m + p];
+			for (q = p + 1; q < m; ++q) { off += S[p * m + q] * S[p * m + q]; }
+		}
+		if (!(off > 1e-30 * diag)) { break; }
+		for (p = 0; p < m - 1; ++p) {
+			for (q = p + 1; q < m; ++q) {
+				if (S[p * m + q] == 0.) { continue; }
+				tau = (S[q * m + q] - S[p * m + p]) / (2. * S[p * m + q]);
+				t = (tau >= 0. ? 1. : -1.) / (fabs(tau) + sqrt(1. + tau * tau));
+				c = 1. / sqrt(1. + t * t);
+				s = t * c;
+				/* S = J^T S J and Q = Q J, J rotating the (p, q) plane. */
+				for (i = 0; i < m; ++i) {
+					a = S[i * m + p]; b = S[i * m + q];
+					S[i * m + p] = c * a - s * b;
+					S[i * m + q] = s * a + c * b;
+				}
+				for (i = 0; i < m; ++i) {
+					a = S[p * m + i]; b = S[q * m + i];
+					S[p * m + i] = c * a - s * b;
+					S[q * m + i] = s * a + c * b;
+					a = Q[i * m + p]; b = Q[i * m + q];
+					Q[i * m + p] = c * a - s * b;
+					Q[i * m + q] = s * a + c * b;
+				}
+				S[p * m + q] = S[q * m + p] = 0.;
+			}
+		}
+	}
+	for (i = 0; i < m; ++i) { w[i] = S[i * m + i]; }
+}
+
+/* idx[0..m) gets the indices of w from largest to smallest magnitude. */
+static inline void bdla_eigsolve_order(const double *w, int m, int *idx) {
+	int i, j, t;
+	for (i = 0; i < m; ++i) {
+		t = i;
+		for (j = i; j > 0 && fabs(w[idx[j - 1]]) < fabs(w[t]); --j) { idx[j] = idx[j - 1]; }
+		idx[j] = t;
+	}
+}
+
+#endif /* BDLA_EIGSOLVE_COMMON_H */
@@ -0,0 +1,761 @@
+#include "libbdla.h"
+/*============================================================================
+eigsolve_dense.c
+
+All eigenvalues and eigenvectors of a dense symmetric matrix, by blocked
+Householder tridiagonalisation and divide and conquer.
+
+Copyright(c) 2019 HJA Bird
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files(the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions :
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+============================================================================*/
+#include <assert.h>
+#include <float.h>
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <openblas/cblas.h>
+
+#include "eigsolve_common.h"
+#include "householder.h"
+#include "threadpool.h"
+
+/* Columns per panel of the tridiagonalisation and per block of reflectors
+applied in the back transformation. */
+#define BDLA_TRD_BLOCK 32
+/* Tridiagonals up to this size are solved outright rather than split. */
+#define BDLA_DC_LEAF 32
+/* Below this size the halves of a split aren't worth running in parallel. */
+#define BDLA_DC_PARALLEL 256
+
+/* Householder tridiagonalisation ------------------------------------------*/
+/* Everything here is column-major and only the lower triangle is used.
+The reflectors are left below the subdiagonal of a, reflector j being
+I - tau[j] v v^T with v zero down to row j, one at row j + 1 and
+a(j + 2 :, j) below that. */
+
+typedef struct {
+	const float *a, *x;
+	float *y;			/* parts x rows partial products. */
+	int lda, rows, parts;
+} bdla_TrdSymvCtx;
+
+/* First column of part p of the lower triangle, cut so each part has
+about the same area. */
+static int bdla_trd_symv_split(int rows, int parts, int p) {
+	return p >= parts ? rows : (int)(rows - rows * sqrt(1. - (double)p / parts));
+}
+
+/* y_p = A x over the columns of part p. Entries above the part's first
+column stay zero. */
+static void bdla_trd_symv_parts(void *ctx, int begin, int end) {
+	bdla_TrdSymvCtx *c = ctx;
+	int p, c0, c1;
+	float *y;
+	for (p = begin; p < end; ++p) {
+		c0 = bdla_trd_symv_split(c->rows, c->parts, p);
+		c1 = bdla_trd_symv_split(c->rows, c->parts, p + 1);
+		y = c->y + (size_t)p * c->rows;
+		memset(y + c0, 0, sizeof(float) * (c->rows - c0));
+		if (c1 == c0) { continue; }
+		cblas_ssymv(CblasColMajor, CblasLower, c1 - c0, 1.f, c->a + c0 + (size_t)c0 * c->lda,
+			c->lda, c->x + c0, 1, 0.f, y + c0, 1);
+		if (c1 == c->rows) { continue; }
+		cblas_sgemv(CblasColMajor, CblasNoTrans, c->rows - c1, c1 - c0, 1.f,
+			c->a + c1 + (size_t)c0 * c->lda, c->lda, c->x + c0, 1, 1.f, y + c1, 1);
+		cblas_sgemv(CblasColMajor, CblasTrans, c->rows - c1, c1 - c0, 1.f,
+			c->a + c1 + (size_t)c0 * c->lda, c->lda, c->x + c1, 1, 1.f, y + c0, 1);
+	}
+}
+
+/* y = A x for the symmetric rows x rows trailing matrix a. With more than
+one thread it's split into parts whose partial sums land in work. */
+static void bdla_trd_symv(const float *a, int lda, int rows, const float *x, float *y,
+	float *work, int parts) {
+	bdla_TrdSymvCtx c;
+	int p, i, c0;
+	parts = rows / 64 < parts ? rows / 64 : parts;
+	if (parts < 2) {
+		cblas_ssymv(CblasColMajor, CblasLower, rows, 1.f, a, lda, x, 1, 0.f, y, 1);
+		return;
+	}
+	c.a = a;
+	c.lda = lda;
+	c.rows = rows;
+	c.x = x;
+	c.y = work;
+	c.parts = parts;
+	bdla_parallel_for(parts, 1, bdla_trd_symv_parts, &c);
+	memcpy(y, work, sizeof(float) * rows);
+	for (p = 1; p < parts; ++p) {
+		c0 = bdla_trd_symv_split(rows, parts, p);
+		for (i = c0; i < rows; ++i) { y[i] += work[(size_t)p * rows + i]; }
+	}
+}
+
+typedef struct {
+	float *a;
+	const float *v, *w;
+	int ld, rows, nb;
+} bdla_TrdUpdateCtx;
+
+/* A -= V W^T + W V^T over some columns of the trailing matrix's lower
+triangle. */
+static void bdla_trd_update_cols(void *ctx, int begin, int end) {
+	bdla_TrdUpdateCtx *c = ctx;
+	float *a = c->a + begin + (size_t)begin * c->ld;
+	cblas_ssyr2k(CblasColMajor, CblasLower, CblasNoTrans, end - begin, c->nb,
+		-1.f, c->v + begin, c->ld, c->w + begin, c->ld, 1.f, a, c->ld);
+	if (end == c->rows) { return; }
+	a += end - begin;
+	cblas_sgemm(CblasColMajor, CblasNoTrans, CblasTrans, c->rows - end, end - begin, c->nb,
+		-1.f, c->v + end, c->ld, c->w + begin, c->ld, 1.f, a, c->ld);
+	cblas_sgemm(CblasColMajor, CblasNoTrans, CblasTrans, c->rows - end, end - begin, c->nb,
+		-1.f, c->w + end, c->ld, c->v + begin, c->ld, 1.f, a, c->ld);
+}
+
+/* Reduces columns k to k + nb - 1, leaving in W what the trailing matrix
+needs taken off it: A22 - V W^T - W V^T. */
+static void bdla_trd_panel(float *a, int n, int k, int nb, float *W, float *t,
+	float *work, int parts, float *d, float *e, float *tau) {
+	float *v, *wc;
+	int i, j, nn;
+	for (i = 0; i < nb; ++i) {
+		j = k + i;
+		/* Bring column j up to date with the panel so far. */
+		if (i > 0) {
+			cblas_sgemv(CblasColMajor, CblasNoTrans, n - j, i, -1.f, a + j + (size_t)k * n, n,
+				W + j, n, 1.f, a + j + (size_t)j * n, 1);
+			cblas_sgemv(CblasColMajor, CblasNoTrans, n - j, i, -1.f, W + j, n,
+				a + j + (size_t)k * n, n, 1.f, a + j + (size_t)j * n, 1);
+		}
+		d[j] = a[j + (size_t)j * n];
+		nn = n - j - 1;
+		v = a + (j + 1) + (size_t)j * n;
+		tau[j] = bdla_householder(nn, v, v + 1, 1);
+		e[j] = *v;
+		*v = 1.f;
+		/* w = tau (A22 v - V W^T v - W V^T v), A22 as it was before the panel. */
+		wc = W + (j + 1) + (size_t)i * n;
+		bdla_trd_symv(a + (j + 1) + (size_t)(j + 1) * n, n, nn, v, wc, work, parts);
+		if (i > 0) {
+			cblas_sgemv(CblasColMajor, CblasTrans, nn, i, 1.f, W + j + 1, n, v, 1, 0.f, t, 1);
+			cblas_sgemv(CblasColMajor, CblasNoTrans, nn, i, -1.f, a + (j + 1) + (size_t)k * n, n,
+				t, 1, 1.f, wc, 1);
+			cblas_sgemv(CblasColMajor, CblasTrans, nn, i, 1.f, a + (j + 1) + (size_t)k * n, n,
+				v, 1, 0.f, t, 1);
+			cblas_sgemv(CblasColMajor, CblasNoTrans, nn, i, -1.f, W + j + 1, n, t, 1, 1.f, wc, 1);
+		}
+		cblas_sscal(nn, tau[j], wc, 1);
+		cblas_saxpy(nn, -0.5f * tau[j] * cblas_sdot(nn, wc, 1, v, 1), v, 1, wc, 1);
+	}
+}
+
+/* Q^T A Q = tridiagonal(d, e), Q being held in a and tau as above. */
+static bdla_Status bdla_tridiagonalise(float *a, int n, float *d, float *e, float *tau) {
+	bdla_TrdUpdateCtx uc;
+	int k, nb, K, parts = bdla_pool_nthreads();
+	float *W = malloc(sizeof(float) * n * BDLA_TRD_BLOCK);
+	float *t = malloc(sizeof(float) * BDLA_TRD_BLOCK);
+	float *work = malloc(sizeof(float) * n * parts);
+	if (W == NULL || t == NULL || work == NULL) {
+		free(W);
+		free(t);
+		free(work);
+		return BDLA_MEM_ERROR;
+	}
+	for (k = 0; k < n - 1; k += nb) {
+		nb = n - 1 - k < BDLA_TRD_BLOCK ? n - 1 - k : BDLA_TRD_BLOCK;
+		bdla_trd_panel(a, n, k, nb, W, t, work, parts, d, e, tau);
+		K = k + nb;
+		uc.a = a + K + (size_t)K * n;
+		uc.v = a + K + (size_t)k * n;
+		uc.w = W + K;
+		uc.ld = n;
+		uc.rows = n - K;
+		uc.nb = nb;
+		bdla_parallel_for(n - K, BDLA_TRD_BLOCK, bdla_trd_update_cols, &uc);
+	}
+	d[n - 1] = a[(size_t)(n - 1) * (n + 1)];
+	free(W);
+	free(t);
+	free(work);
+	return BDLA_GOOD;
+}
+
+typedef struct {
+	const float *V, *T;
+	float *Z, *Wt;
+	int n, m, nb;
+} bdla_TrdBackCtx;
+
+/* Z -= V T V^T Z over some columns of Z. */
+static void bdla_trd_back_cols(void *ctx, int begin, int end) {
+	bdla_TrdBackCtx *c = ctx;
+	float *z = c->Z + (size_t)begin * c->n, *wt = c->Wt + (size_t)begin * c->nb;
+	cblas_sgemm(CblasColMajor, CblasTrans, CblasNoTrans, c->nb, end - begin, c->m,
+		1.f, c->V, c->m, z, c->n, 0.f, wt, c->nb);
+	cblas_strmm(CblasColMajor, CblasLeft, CblasUpper, CblasNoTrans, CblasNonUnit,
+		c->nb, end - begin, 1.f, c->T, c->nb, wt, c->nb);
+	cblas_sgemm(CblasColMajor, CblasNoTrans, CblasNoTrans, c->m, end - begin, c->nb,
+		-1.f, c->V, c->m, wt, c->nb, 1.f, z, c->n);
+}
+
+/* Z = Q Z, a block of reflectors at a time as I - V T V^T. */
+static bdla_Status bdla_trd_backtransform(const float *a, const float *tau, int n, float *Z) {
+	bdla_TrdBackCtx c;
+	int k, nb, i, r, m;
+	float *V = malloc(sizeof(float) * n * BDLA_TRD_BLOCK);
+	float *T = malloc(sizeof(float) * BDLA_TRD_BLOCK * BDLA_TRD_BLOCK);
+	float *Wt = malloc(sizeof(float) * n * BDLA_TRD_BLOCK);
+	if (V == NULL || T == NULL || Wt == NULL) {
+		free(V);
+		free(T);
+		free(Wt);
+		return BDLA_MEM_ERROR;
+	}
+	for (k = n < 2 ? -1 : ((n - 2) / BDLA_TRD_BLOCK) * BDLA_TRD_BLOCK; k >= 0; k -= BDLA_TRD_BLOCK) {
+		nb = n - 1 - k < BDLA_TRD_BLOCK ? n - 1 - k : BDLA_TRD_BLOCK;
+		/* Reflectors k to k + nb - 1 act on rows k + 1 onwards. */
+		m = n - k - 1;
+		for (i = 0; i < nb; ++i) {
+			for (r = 0; r < m; ++r) {
+				V[r + (size_t)i * m] = r < i ? 0.f : (r == i ? 1.f
+					: a[(k + 1 + r) + (size_t)(k + i) * n]);
+			}
+			T[i + i * nb] = tau[k + i];
+			if (i > 0) {
+				cblas_sgemv(CblasColMajor, CblasTrans, m, i, 1.f, V, m, V + (size_t)i * m, 1,
+					0.f, T + i * nb, 1);
+				cblas_strmv(CblasColMajor, CblasUpper, CblasNoTrans, CblasNonUnit, i,
+					T, nb, T + i * nb, 1);
+				cblas_sscal(i, -tau[k + i], T + i * nb, 1);
+			}
+		}
+		c.V = V;
+		c.T = T;
+		c.Z = Z + k + 1;
+		c.Wt = Wt;
+		c.n = n;
+		c.m = m;
+		c.nb = nb;
+		bdla_parallel_for(n, bdla_parallel_grain((size_t)4 * m * nb), bdla_trd_back_cols, &c);
+	}
+	free(V);
+	free(T);
+	free(Wt);
+	return BDLA_GOOD;
+}
+
+/* Symmetric tridiagonal eigenproblems -------------------------------------*/
+/* In double, column-major. d holds the diagonal and e the n - 1 entries
+below it. */
+
+/* Eigenvalues only, by implicit QL. e is used as scratch and needs room
+for n entries. Returns nonzero if it failed to converge. */
+static int bdla_tql_values(double *d, double *e, int n) {
+	double g, r, s, c, p, f, b, dd;
+	int l, m, i, iter;
+	e[n - 1] = 0.;
+	for (l = 0; l < n; ++l) {
+		iter = 0;
+		do {
+			for (m = l; m < n - 1; ++m) {
+				dd = fabs(d[m]) + fabs(d[m + 1]);
+				if (fabs(e[m]) <= DBL_EPSILON * dd) { break; }
+			}
+			if (m != l) {
+				if (iter++ == 64) { return 1; }
+				g = (d[l + 1] - d[l]) / (2. * e[l]);
+				r = sqrt(g * g + 1.);
+				g = d[m] - d[l] + e[l] / (g + copysign(r, g));
+				s = c = 1.;
+				p = 0.;
+				for (i = m - 1; i >= l; --i) {
+					f = s * e[i];
+					b = c * e[i];
+					e[i + 1] = r = sqrt(f * f + g * g);
+					if (r == 0.) {
+						d[i + 1] -= p;
+						e[m] = 0.;
+						break;
+					}
+					s = f / r;
+					c = g / r;
+					g = d[i + 1] - p;
+					r = (d[i] - g) * s + 2. * c * b;
+					p = s * r;
+					d[i + 1] = g + p;
+					g = c * r - b;
+				}
+				if (r == 0. && i >= l) { continue; }
+				d[l] -= p;
+				e[l] = g;
+				e[m] = 0.;
+			}
+		} while (m != l);
+	}
+	return 0;
+}
+
+/* Sorts idx[0..n) so that w[idx[i]] ascends. */
+static void bdla_dc_sort(const double *w, int n, int *idx) {
+	int i, j, t;
+	for (i = 0; i < n; ++i) {
+		t = i;
+		for (j = i; j > 0 && w[idx[j - 1]] > w[t]; --j) { idx[j] = idx[j - 1]; }
+		idx[j] = t;
+	}
+}
+
+/* Root i of the secular equation 1 + sum_j z2[j] / (delta_j - lambda) = 0,
+for ascending poles delta and z2 > 0, returned as lambda = delta[*org] +
+*tau with *org the nearer pole, so delta_j - lambda keeps its precision.
+Each step fits one pole either side of the root and solves the quadratic
+(the fixed weight method), falling back to bisection when that leaves the
+bracket. diff is left holding delta_j - delta[*org]. */
+static void bdla_dc_root(int K, const double *delta, const double *z2, double zsum,
+	int i, int *org, double *tau, double *diff) {
+	double lo, hi, x, f, mid, psi, dpsi, phi, dphi, r, t, d1, d2, A, B, C, D, E;
+	double qa, qb, qc, disc, r1, r2, eta;
+	int o, j, it;
+	if (i < K - 1) {
+		mid = 0.5 * (delta[i + 1] - delta[i]);
+		f = 1.;
+		for (j = 0; j < K; ++j) { f += z2[j] / ((delta[j] - delta[i]) - mid); }
+		if (f >= 0.) { o = i; lo = 0.; hi = mid; }
+		else { o = i + 1; lo = -mid; hi = 0.; }
+	}
+	else {
+		o = i;
+		lo = 0.;
+		hi = zsum;
+	}
+	for (j = 0; j < K; ++j) { diff[j] = delta[j] - delta[o]; }
+	x = 0.5 * (lo + hi);
+	for (it = 0; it < 100; ++it) {
+		psi = dpsi = phi = dphi = 0.;
+		for (j = 0; j <= i; ++j) {
+			r = 1. / (diff[j] - x);
+			t = z2[j] * r;
+			psi += t;
+			dpsi += t * r;
+		}
+		for (j = i + 1; j < K; ++j) {
+			r = 1. / (diff[j] - x);
+			t = z2[j] * r;
+			phi += t;
+			dphi += t * r;
+		}
+		f = 1. + psi + phi;
+		if (fabs(f) <= 8. * DBL_EPSILON * (1. + phi - psi)) { break; }
+		if (f < 0.) { lo = x; }
+		else { hi = x; }
+		if (hi - lo <= 2. * DBL_EPSILON * fmax(fabs(lo), fabs(hi))) { break; }
+		/* psi ~ A + B / (d1 - eta) and phi ~ C + D / (d2 - eta). */
+		d1 = diff[i] - x;
+		B = dpsi * d1 * d1;
+		A = psi - B / d1;
+		eta = NAN;
+		if (i < K - 1) {
+			d2 = diff[i + 1] - x;
+			D = dphi * d2 * d2;
+			C = phi - D / d2;
+			E = 1. + A + C;
+			qa = E;
+			qb = -(E * (d1 + d2) + B + D);
+			qc = d1 * d2 * f;
+			disc = qb * qb - 4. * qa * qc;
+			if (disc >= 0. && qb != 0.) {
+				r1 = (-qb - copysign(sqrt(disc), qb)) / (2. * qa);
+				r2 = qc / (qa * r1);
+				eta = (x + r2 > lo && x + r2 < hi) ? r2 : r1;
+			}
+		}
+		else {
+			E = 1. + A;
+			eta = d1 + B / E;
+		}
+		x = (x + eta > lo && x + eta < hi) ? x + eta : 0.5 * (lo + hi);
+	}
+	*org = o;
+	*tau = x;
+}
+
+typedef struct {
+	const double *delta, *z2;
+	double zsum, *U, *tau;
+	int K, *org;
+} bdla_DcRootsCtx;
+
+/* Roots [begin, end), with column i of U getting delta_j - lambda_i. */
+static void bdla_dc_roots(void *ctx, int begin, int end) {
+	bdla_DcRootsCtx *c = ctx;
+	int i, j, K = c->K;
+	double *diff;
+	for (i = begin; i < end; ++i) {
+		diff = c->U + (size_t)i * K;
+		bdla_dc_root(K, c->delta, c->z2, c->zsum, i, c->org + i, c->tau + i, diff);
+		for (j = 0; j < K; ++j) { diff[j] -= c->tau[i]; }
+	}
+}
+
+typedef struct {
+	const float *A, *B;
+	float *C;
+	int lda, ldb, ldc, k, cols;
+} bdla_DcGemmCtx;
+
+static void bdla_dc_gemm_rows(void *ctx, int begin, int end) {
+	bdla_DcGemmCtx *c = ctx;
+	cblas_sgemm(CblasColMajor, CblasNoTrans, CblasNoTrans, end - begin, c->cols, c->k,
+		1.f, c->A + begin, c->lda, c->B, c->ldb, 0.f, c->C + begin, c->ldc);
+}
+
+/* Eigenpairs of diag(d) + rho z z^T with Q's columns (the eigenvectors of
+the two halves) rotated to suit. z is the last row of the first half's
+vectors and the first row of the second's. Deflation and the secular
+equation follow Gu and Eisenstat, so the vectors come out orthogonal
+however close the eigenvalues. Results are left unsorted. The vectors
+are only float, like the reduction they came from; the secular equation
+is solved in double. */
+static bdla_Status bdla_dc_merge(double *d, int n, int m, double rho, float *Q, int ldq) {
+	float *Qs = malloc(sizeof(float) * n * n);
+	double *work = malloc(sizeof(double) * 6 * n);
+	int *iwork = malloc(sizeof(int) * 4 * n);
+	float *G = NULL, *Ug = NULL;
+	double *U = NULL, *ds, *zs, *delta, *z2, *tau, *diff, flip, dmax, tol, c, s, t, prod, zsum;
+	int *perm, *keep, *nd, *org, *half, i, j, h, r0, rows, Kh, K, prev, nd_count;
+	bdla_DcRootsCtx rc;
+	bdla_DcGemmCtx gc;
+	if (Qs == NULL || work == NULL || iwork == NULL) { goto fail; }
+	ds = work; zs = work + n; delta = work + 2 * n; z2 = work + 3 * n;
+	tau = work + 4 * n; diff = work + 5 * n;
+	perm = iwork; keep = iwork + n; org = iwork + 2 * n; half = iwork + 3 * n;
+
+	/* A negative rho is the same problem for -d. */
+	flip = rho < 0. ? -1. : 1.;
+	rho = 2. * fabs(rho);
+	for (i = 0; i < n; ++i) {
+		perm[i] = i;
+		diff[i] = flip * d[i];
+	}
+	bdla_dc_sort(diff, n, perm);
+	dmax = rho;
+	for (i = 0; i < n; ++i) {
+		ds[i] = diff[perm[i]];
+		zs[i] = Q[(perm[i] < m ? m - 1 : m) + (size_t)perm[i] * ldq] / sqrt(2.);
+		memcpy(Qs + (size_t)i * n, Q + (size_t)perm[i] * ldq, sizeof(float) * n);
+		/* Which halves of the rows the column can be nonzero in. */
+		half[i] = perm[i] < m ? 1 : 2;
+		dmax = fabs(ds[i]) > dmax ? fabs(ds[i]) : dmax;
+	}
+
+	/* Deflate small z and, by rotating pairs, nearly equal d. */
+	tol = 8. * FLT_EPSILON * dmax;
+	K = 0;
+	prev = -1;
+	for (i = 0; i < n; ++i) {
+		keep[i] = 0;
+		if (rho * fabs(zs[i]) <= tol) { continue; }
+		if (prev >= 0) {
+			t = hypot(zs[i], zs[prev]);
+			c = zs[i] / t;
+			s = -zs[prev] / t;
+			if (fabs((ds[i] - ds[prev]) * c * s) <= tol) {
+				zs[i] = t;
+				zs[prev] = 0.;
+				cblas_srot(n, Qs + (size_t)prev * n, 1, Qs + (size_t)i * n, 1, (float)c, (float)s);
+				half[i] |= half[prev];
+				t = ds[prev] * c * c + ds[i] * s * s;
+				ds[i] = ds[prev] * s * s + ds[i] * c * c;
+				ds[prev] = t;
+				keep[prev] = 0;
+				--K;
+			}
+		}
+		keep[i] = 1;
+		++K;
+		prev = i;
+	}
+	/* Deflated pairs go straight to the end of Q; perm becomes the list of
+	those left. */
+	nd_count = 0;
+	j = K;
+	for (i = 0; i < n; ++i) {
+		if (keep[i]) {
+			perm[nd_count++] = i;
+		}
+		else {
+			d[j] = flip * ds[i];
+			memcpy(Q + (size_t)j * ldq, Qs + (size_t)i * n, sizeof(float) * n);
+			++j;
+		}
+	}
+	nd = perm;
+	if (K == 0) { goto done; }
+
+	/* The secular equation over the K that are left. */
+	zsum = 0.;
+	for (j = 0; j < K; ++j) {
+		delta[j] = ds[nd[j]];
+		z2[j] = rho * zs[nd[j]] * zs[nd[j]];
+		zsum += z2[j];
+	}
+	U = malloc(sizeof(double) * K * K);
+	if (U == NULL) { goto fail; }
+	rc.delta = delta;
+	rc.z2 = z2;
+	rc.zsum = zsum;
+	rc.U = U;
+	rc.tau = tau;
+	rc.K = K;
+	rc.org = org;
+	bdla_parallel_for(K, bdla_parallel_grain((size_t)16 * K), bdla_dc_roots, &rc);
+	/* z recomputed from the roots, so that the vectors are orthogonal to
+	working precision. */
+	for (j = 0; j < K; ++j) {
+		prod = -U[j + (size_t)j * K] / rho;
+		for (i = 0; i < K; ++i) {
+			if (i != j) { prod *= U[j + (size_t)i * K] / (delta[j] - delta[i]); }
+		}
+		diff[j] = copysign(sqrt(fmax(prod, 0.)), zs[nd[j]]);
+	}
+	for (i = 0; i < K; ++i) {
+		for (j = 0; j < K; ++j) { U[j + (size_t)i * K] = diff[j] / U[j + (size_t)i * K]; }
+		t = cblas_dnrm2(K, U + (size_t)i * K, 1);
+		cblas_dscal(K, 1. / t, U + (size_t)i * K, 1);
+		d[i] = flip * (delta[org[i]] + tau[i]);
+	}
+	/* Q[:, 0:K] = Qs[:, nd] U, a half of the rows at a time, leaving out
+	columns that are zero there. */
+	G = malloc(sizeof(float) * (n - m) * K);
+	Ug = malloc(sizeof(float) * K * K);
+	if (G == NULL || Ug == NULL) { goto fail; }
+	for (h = 0; h < 2; ++h) {
+		r0 = h == 0 ? 0 : m;
+		rows = h == 0 ? m : n - m;
+		Kh = 0;
+		for (j = 0; j < K; ++j) {
+			if (!(half[nd[j]] & (1 << h))) { continue; }
+			memcpy(G + (size_t)Kh * rows, Qs + (size_t)nd[j] * n + r0, sizeof(float) * rows);
+			for (i = 0; i < K; ++i) { Ug[Kh + (size_t)i * K] = (float)U[j + (size_t)i * K]; }
+			++Kh;
+		}
+		if (Kh == 0) {
+			for (j = 0; j < K; ++j) { memset(Q + r0 + (size_t)j * ldq, 0, sizeof(float) * rows); }
+			continue;
+		}
+		gc.A = G;
+		gc.lda = rows;
+		gc.B = Ug;
+		gc.ldb = K;
+		gc.C = Q + r0;
+		gc.ldc = ldq;
+		gc.k = Kh;
+		gc.cols = K;
+		bdla_parallel_for(rows, bdla_parallel_grain((size_t)2 * Kh * K), bdla_dc_gemm_rows, &gc);
+	}
+done:
+	free(Qs);
+	free(work);
+	free(iwork);
+	free(U);
+	free(G);
+	free(Ug);
+	return BDLA_GOOD;
+fail:
+	free(Qs);
+	free(work);
+	free(iwork);
+	free(U);
+	free(G);
+	free(Ug);
+	return BDLA_MEM_ERROR;
+}
+
+static bdla_Status bdla_dc_leaf(double *d, const double *e, int n, float *Q, int ldq) {
+	double *S = calloc((size_t)n * n, sizeof(double));
+	double *Qj = malloc(sizeof(double) * n * n);
+	int i, j;
+	if (S == NULL || Qj == NULL) {
+		free(S);
+		free(Qj);
+		return BDLA_MEM_ERROR;
+	}
+	for (i = 0; i < n; ++i) {
+		S[i * n + i] = d[i];
+		if (i < n - 1) { S[i * n + i + 1] = S[(i + 1) * n + i] = e[i]; }
+	}
+	bdla_eigsolve_jacobi(S, n, d, Qj);
+	for (j = 0; j < n; ++j) {
+		for (i = 0; i < n; ++i) { Q[i + (size_t)j * ldq] = (float)Qj[i * n + j]; }
+	}
+	free(S);
+	free(Qj);
+	return BDLA_GOOD;
+}
+
+static bdla_Status bdla_dc(double *d, const double *e, int n, float *Q, int ldq);
+
+typedef struct {
+	double *d[2];
+	float *Q[2];
+	const double *e[2];
+	int n[2], ldq;
+	bdla_Status stat[2];
+} bdla_DcHalvesCtx;
+
+static void bdla_dc_halves(void *ctx, int begin, int end) {
+	bdla_DcHalvesCtx *c = ctx;
+	int h;
+	for (h = begin; h < end; ++h) {
+		c->stat[h] = bdla_dc(c->d[h], c->e[h], c->n[h], c->Q[h], c->ldq);
+	}
+}
+
+/* Cuppen's split: T = diag(T1, T2) + rho u u^T with u one at rows m - 1
+and m, so the halves can be solved independently. */
+static bdla_Status bdla_dc(double *d, const double *e, int n, float *Q, int ldq) {
+	bdla_DcHalvesCtx c;
+	int m = n / 2, i;
+	double rho;
+	if (n <= BDLA_DC_LEAF) { return bdla_dc_leaf(d, e, n, Q, ldq); }
+	rho = e[m - 1];
+	d[m - 1] -= rho;
+	d[m] -= rho;
+	c.d[0] = d;
+	c.e[0] = e;
+	c.n[0] = m;
+	c.Q[0] = Q;
+	c.d[1] = d + m;
+	c.e[1] = e + m;
+	c.n[1] = n - m;
+	c.Q[1] = Q + m + (size_t)m * ldq;
+	c.ldq = ldq;
+	bdla_parallel_for(2, n >= BDLA_DC_PARALLEL ? 1 : 2, bdla_dc_halves, &c);
+	if (c.stat[0] != BDLA_GOOD || c.stat[1] != BDLA_GOOD) { return BDLA_MEM_ERROR; }
+	for (i = 0; i < m; ++i) {
+		memset(Q + m + (size_t)i * ldq, 0, sizeof(float) * (n - m));
+	}
+	for (i = m; i < n; ++i) {
+		memset(Q + (size_t)i * ldq, 0, sizeof(float) * m);
+	}
+	return bdla_dc_merge(d, n, m, rho, Q, ldq);
+}
+
+/* Driver -------------------------------------------------------------------*/
+
+/* dst[j * n + i] = src[i * n + j], for j <= i only if lower is set. Done in
+tiles, so that neither side is walked down a column of a large matrix. */
+static void bdla_eig_transpose(const float *src, float *dst, int n, int lower) {
+	int i0, j0, i, j, iend, jend;
+	for (i0 = 0; i0 < n; i0 += 32) {
+		iend = i0 + 32 < n ? i0 + 32 : n;
+		for (j0 = 0; j0 < (lower ? iend : n); j0 += 32) {
+			jend = j0 + 32 < n ? j0 + 32 : n;
+			for (i = i0; i < iend; ++i) {
+				for (j = j0; j < (lower && jend > i + 1 ? i + 1 : jend); ++j) {
+					dst[(size_t)j * n + i] = src[(size_t)i * n + j];
+				}
+			}
+		}
+	}
+}
+
+BDLA_EXPORT bdla_Status bdla_Mxf_eig_sym(bdla_Mxf A, bdla_MatrixProperty A_prop,
+	bdla_Vxf *lambda, bdla_Mxf *V) {
+	assert(A.arr != NULL);
+	assert(lambda != NULL);
+	assert(lambda->arr != NULL);
+	assert(V != NULL ? V->arr != NULL : 1);
+	float tol = 0.f;
+	bdla_Status stat = bdla_eigsolve_checkargs(A, A_prop, &tol);
+	if (stat != BDLA_GOOD) { return stat; }
+	int n = A.dims[0], i, j;
+	float *a = malloc(sizeof(float) * n * n);
+	float *fd = malloc(sizeof(float) * n);
+	float *fe = malloc(sizeof(float) * n);
+	float *tau = malloc(sizeof(float) * n);
+	double *d = malloc(sizeof(double) * n);
+	double *e = malloc(sizeof(double) * n);
+	int *idx = malloc(sizeof(int) * n);
+	float *Qd = NULL, *Z = NULL;
+	stat = BDLA_MEM_ERROR;
+	if (a == NULL || fd == NULL || fe == NULL || tau == NULL || d == NULL
+		|| e == NULL || idx == NULL) {
+		goto cleanup;
+	}
+	if (lambda->len != n && bdla_Vxf_resize(lambda, n) != BDLA_GOOD) { goto cleanup; }
+	if (V != NULL && (V->dims[0] != n || V->dims[1] != n)
+		&& bdla_Mxf_resize(V, n, n) != BDLA_GOOD) {
+		goto cleanup;
+	}
+
+	/* Only the lower triangle is read. */
+	bdla_eig_transpose(A.arr, a, n, 1);
+	if (bdla_tridiagonalise(a, n, fd, fe, tau) != BDLA_GOOD) { goto cleanup; }
+	for (i = 0; i < n; ++i) {
+		d[i] = fd[i];
+		e[i] = i < n - 1 ? fe[i] : 0.;
+	}
+
+	if (V == NULL) {
+		if (bdla_tql_values(d, e, n) != 0) {
+			/* QL didn't converge, so fall back on divide and conquer. */
+			for (i = 0; i < n; ++i) {
+				d[i] = fd[i];
+				e[i] = i < n - 1 ? fe[i] : 0.;
+			}
+			Qd = malloc(sizeof(float) * n * n);
+			if (Qd == NULL || bdla_dc(d, e, n, Qd, n) != BDLA_GOOD) { goto cleanup; }
+		}
+		bdla_dc_sort(d, n, idx);
+		for (i = 0; i < n; ++i) { lambda->arr[i] = (float)d[idx[i]]; }
+		stat = BDLA_GOOD;
+		goto cleanup;
+	}
+
+	Qd = malloc(sizeof(float) * n * n);
+	Z = malloc(sizeof(float) * n * n);
+	if (Qd == NULL || Z == NULL) { goto cleanup; }
+	if (bdla_dc(d, e, n, Qd, n) != BDLA_GOOD) { goto cleanup; }
+	bdla_dc_sort(d, n, idx);
+	for (j = 0; j < n; ++j) {
+		lambda->arr[j] = (float)d[idx[j]];
+		memcpy(Z + (size_t)j * n, Qd + (size_t)idx[j] * n, sizeof(float) * n);
+	}
+	free(Qd);
+	Qd = NULL;
+	if (bdla_trd_backtransform(a, tau, n, Z) != BDLA_GOOD) { goto cleanup; }
+	bdla_eig_transpose(Z, V->arr, n, 0);
+	stat = BDLA_GOOD;
+cleanup:
+	free(a);
+	free(fd);
+	free(fe);
+	free(tau);
+	free(d);
+	free(e);
+	free(idx);
+	free(Qd);
+	free(Z);
+	return stat;
+}
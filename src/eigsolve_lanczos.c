@@ -0,0 +1,335 @@
+#include "libbdla.h"
+/*============================================================================
+eigsolve_lanczos.c
+
+Thick restart Lanczos, one vector or a block at a time, for the dominant
+eigenpairs of a symmetric matrix.
+
+Copyright(c) 2019 HJA Bird
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files(the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions :
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+============================================================================*/
+#include <assert.h>
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <openblas/cblas.h>
+
+#include "eigsolve_common.h"
+
+/* The basis is kept fully orthogonal, so the projected matrix H = V^T A V
+is built from the Gram-Schmidt coefficients directly rather than assumed
+tridiagonal. That makes thick restarts, which leave an arrowhead in H, and
+blocks, which make it banded, the same code. */
+typedef struct {
+	bdla_Mxf A;
+	int n, b, cap;		/* cap is the most basis vectors held. */
+	float *V;			/* Orthonormal basis, one vector per row. */
+	float *W;			/* b x n, A applied to a block. */
+	float *Wt;			/* n x b, the same before transposing. */
+	float *C, *Ct;		/* cap x b Gram-Schmidt coefficients. */
+	float *pre;			/* Norms of W's rows before orthogonalising. */
+	double *H;			/* cap x cap projected matrix. */
+	double *R;			/* b x b coupling of the newest block to the last. */
+	uint32_t seed;
+	int matvecs;
+} bdla_Lanczos;
+
+/* Takes V[0, cur) out of the rows of W twice over, adding the
+coefficients to C (cur x rows) if it isn't NULL. */
+static void bdla_lanczos_orth(bdla_Lanczos *L, float *W, int rows, int cur, float *C) {
+	int pass, i, n = L->n;
+	if (cur == 0) { return; }
+	for (pass = 0; pass < 2; ++pass) {
+		cblas_sgemm(CblasRowMajor, CblasNoTrans, CblasTrans, cur, rows, n,
+			1.f, L->V, n, W, n, 0.f, L->Ct, rows);
+		cblas_sgemm(CblasRowMajor, CblasTrans, CblasNoTrans, rows, n, cur,
+			-1.f, L->Ct, rows, L->V, n, 1.f, W, n);
+		if (C != NULL) {
+			for (i = 0; i < cur * rows; ++i) { C[i] += L->Ct[i]; }
+		}
+	}
+}
+
+/* Orthonormalises the rows of W, already orthogonal to V[0, cur), into
+V[cur, cur + b), recording W = V[cur, cur + b)^T R. A row that was
+(nearly) in the span already is swapped for a random direction. */
+static void bdla_lanczos_newblock(bdla_Lanczos *L, int cur) {
+	int s, t, pass, n = L->n, b = L->b;
+	float *w, *v, d, na, nb;
+	memset(L->R, 0, sizeof(double) * b * b);
+	for (t = 0; t < b; ++t) {
+		w = L->W + (size_t)t * n;
+		for (pass = 0; pass < 2; ++pass) {
+			for (s = 0; s < t; ++s) {
+				v = L->V + (size_t)(cur + s) * n;
+				d = cblas_sdot(n, v, 1, w, 1);
+				cblas_saxpy(n, -d, v, 1, w, 1);
+				L->R[s * b + t] += d;
+			}
+		}
+		/* Cancellation leaves w less orthogonal than it looks, so go again
+		while it keeps shrinking. */
+		nb = L->pre[t];
+		for (pass = 0; pass < 4; ++pass) {
+			na = cblas_snrm2(n, w, 1);
+			if (na > 0.5f * nb || !(na > 1e-6f * L->pre[t])) { break; }
+			bdla_lanczos_orth(L, w, 1, cur + t, NULL);
+			nb = na;
+		}
+		if (!(na > 1e-6f * L->pre[t])) {
+			bdla_eigsolve_random(w, n, &L->seed);
+			bdla_lanczos_orth(L, w, 1, cur + t, NULL);
+			na = cblas_snrm2(n, w, 1);
+		}
+		else {
+			L->R[t * b + t] = na;
+		}
+		v = L->V + (size_t)(cur + t) * n;
+		for (s = 0; s < n; ++s) { v[s] = w[s] / na; }
+	}
+}
+
+/* Applies A to the block at c and adds the next block after it. */
+static void bdla_lanczos_expand(bdla_Lanczos *L, int c) {
+	int i, s, t, n = L->n, b = L->b, cur = c + b;
+	float *X = L->V + (size_t)c * n;
+	if (b == 1) {
+		bdla_Vxf x = { n, X }, w = { n, L->W };
+		bdla_Mxf_vmult(L->A, x, &w);
+	}
+	else {
+		/* A X^T rather than X A, so the gemm splits over A's rows. */
+		bdla_Mxf Xm = { { b, n }, X }, Wm = { { n, b }, L->Wt };
+		bdla_Mxf_gemm(1.f, L->A, BDLA_NO_TRANS, Xm, BDLA_TRANS, 0.f, &Wm);
+		for (i = 0; i < n; ++i) {
+			for (t = 0; t < b; ++t) { L->W[(size_t)t * n + i] = L->Wt[(size_t)i * b + t]; }
+		}
+	}
+	L->matvecs += b;
+	for (t = 0; t < b; ++t) { L->pre[t] = cblas_snrm2(n, L->W + (size_t)t * n, 1); }
+	memset(L->C, 0, sizeof(float) * cur * b);
+	bdla_lanczos_orth(L, L->W, b, cur, L->C);
+	for (i = 0; i < cur; ++i) {
+		for (t = 0; t < b; ++t) {
+			L->H[i * L->cap + c + t] = L->H[(c + t) * L->cap + i] = L->C[i * b + t];
+		}
+	}
+	bdla_lanczos_newblock(L, cur);
+	for (s = 0; s < b; ++s) {
+		for (t = 0; t < b; ++t) {
+			L->H[(cur + s) * L->cap + c + t] = L->H[(c + t) * L->cap + cur + s] = L->R[s * b + t];
+		}
+	}
+}
+
+/* Writes k eigenpairs, w[idx[i]] with vector vecs[i * n, (i + 1) * n). */
+static bdla_Status bdla_eigsolve_output(int n, int k, const double *w, const int *idx,
+	const float *vecs, bdla_Vxf *lambda, bdla_Mxf *Y) {
+	int i, r;
+	if (lambda->len != k && bdla_Vxf_resize(lambda, k) != BDLA_GOOD) { return BDLA_MEM_ERROR; }
+	for (i = 0; i < k; ++i) { lambda->arr[i] = (float)w[idx[i]]; }
+	if (Y == NULL) { return BDLA_GOOD; }
+	if ((Y->dims[0] != n || Y->dims[1] != k) && bdla_Mxf_resize(Y, n, k) != BDLA_GOOD) {
+		return BDLA_MEM_ERROR;
+	}
+	for (r = 0; r < n; ++r) {
+		for (i = 0; i < k; ++i) { Y->arr[(size_t)r * k + i] = vecs[(size_t)i * n + r]; }
+	}
+	return BDLA_GOOD;
+}
+
+/* Too small for a Krylov space to pay, so solve it outright. */
+static bdla_Status bdla_eigsolve_small(bdla_Mxf A, int k, bdla_Vxf *lambda, bdla_Mxf *Y) {
+	int i, j, n = A.dims[0];
+	bdla_Status stat = BDLA_MEM_ERROR;
+	double *S = malloc(sizeof(double) * n * n);
+	double *Q = malloc(sizeof(double) * n * n);
+	double *w = malloc(sizeof(double) * n);
+	int *idx = malloc(sizeof(int) * n);
+	float *vecs = malloc(sizeof(float) * k * n);
+	if (S != NULL && Q != NULL && w != NULL && idx != NULL && vecs != NULL) {
+		for (i = 0; i < n; ++i) {
+			for (j = 0; j < n; ++j) {
+				S[i * n + j] = 0.5 * ((double)A.arr[i * n + j] + A.arr[j * n + i]);
+			}
+		}
+		bdla_eigsolve_jacobi(S, n, w, Q);
+		bdla_eigsolve_order(w, n, idx);
+		for (i = 0; i < k; ++i) {
+			for (j = 0; j < n; ++j) { vecs[i * n + j] = (float)Q[j * n + idx[i]]; }
+		}
+		stat = bdla_eigsolve_output(n, k, w, idx, vecs, lambda, Y);
+	}
+	free(S);
+	free(Q);
+	free(w);
+	free(idx);
+	free(vecs);
+	return stat;
+}
+
+static bdla_Status bdla_eigsolve_lanczos(bdla_Mxf A, int k, int b,
+	bdla_Vxf *lambda, bdla_Mxf *Y, float tol, int *max_iter) {
+	bdla_Lanczos L;
+	bdla_Status stat = BDLA_MEM_ERROR;
+	int n = A.dims[0], i, j, s, t, m, l, cur, conv, limit;
+	/* Project onto mwant vectors (give or take a block) before restarting. */
+	int mwant = k + (k > 20 ? k : 20);
+	double *S, *Q, *w, res, r, scale;
+	float *Sf, *Yb;
+	int *idx;
+	if (k > n) { return BDLA_DIMENSION_MISMATCH; }
+	mwant = mwant > k + 2 * b ? mwant : k + 2 * b;
+	if (mwant + 2 * b > n) { return bdla_eigsolve_small(A, k, lambda, Y); }
+	limit = max_iter != NULL ? *max_iter : 100 * mwant;
+
+	memset(&L, 0, sizeof(L));
+	L.A = A;
+	L.n = n;
+	L.b = b;
+	L.cap = mwant + 2 * b;
+	L.seed = 2463534242u;
+	L.V = malloc(sizeof(float) * L.cap * n);
+	L.W = malloc(sizeof(float) * b * n);
+	L.Wt = malloc(sizeof(float) * b * n);
+	L.C = malloc(sizeof(float) * L.cap * b);
+	L.Ct = malloc(sizeof(float) * L.cap * b);
+	L.pre = malloc(sizeof(float) * b);
+	L.H = calloc((size_t)L.cap * L.cap, sizeof(double));
+	L.R = malloc(sizeof(double) * b * b);
+	S = malloc(sizeof(double) * L.cap * L.cap);
+	Q = malloc(sizeof(double) * L.cap * L.cap);
+	w = malloc(sizeof(double) * L.cap);
+	idx = malloc(sizeof(int) * L.cap);
+	Sf = malloc(sizeof(float) * L.cap * L.cap);
+	Yb = malloc(sizeof(float) * L.cap * n);
+	if (L.V == NULL || L.W == NULL || L.Wt == NULL || L.C == NULL || L.Ct == NULL
+		|| L.pre == NULL || L.H == NULL || L.R == NULL || S == NULL || Q == NULL
+		|| w == NULL || idx == NULL || Sf == NULL || Yb == NULL) {
+		goto cleanup;
+	}
+
+	/* Start from a random block. */
+	bdla_eigsolve_random(L.W, b * n, &L.seed);
+	for (t = 0; t < b; ++t) { L.pre[t] = cblas_snrm2(n, L.W + (size_t)t * n, 1); }
+	bdla_lanczos_newblock(&L, 0);
+	cur = b;
+	for (;;) {
+		while (cur - b < mwant && (L.matvecs < limit || cur - b < k)) {
+			bdla_lanczos_expand(&L, cur - b);
+			cur += b;
+		}
+		/* Rayleigh-Ritz on the expanded part of the basis. */
+		m = cur - b;
+		for (i = 0; i < m; ++i) {
+			for (j = 0; j < m; ++j) {
+				S[i * m + j] = 0.5 * (L.H[i * L.cap + j] + L.H[j * L.cap + i]);
+			}
+		}
+		bdla_eigsolve_jacobi(S, m, w, Q);
+		bdla_eigsolve_order(w, m, idx);
+		/* A V s - theta V s is the next block times R s's last b entries. */
+		scale = fabs(w[idx[0]]) > 1e-30 ? fabs(w[idx[0]]) : 1e-30;
+		conv = 1;
+		for (i = 0; i < k && conv; ++i) {
+			res = 0.;
+			for (s = 0; s < b; ++s) {
+				r = 0.;
+				for (t = s; t < b; ++t) { r += L.R[s * b + t] * Q[(m - b + t) * m + idx[i]]; }
+				res += r * r;
+			}
+			conv = sqrt(res) <= tol * scale;
+		}
+		if (conv || L.matvecs >= limit) { break; }
+
+		/* Thick restart: keep the best l Ritz vectors and the next block. */
+		l = k + (m - k) / 2;
+		for (i = 0; i < l; ++i) {
+			for (j = 0; j < m; ++j) { Sf[i * m + j] = (float)Q[j * m + idx[i]]; }
+		}
+		cblas_sgemm(CblasRowMajor, CblasNoTrans, CblasNoTrans, l, n, m,
+			1.f, Sf, m, L.V, n, 0.f, Yb, n);
+		memcpy(L.V, Yb, sizeof(float) * l * n);
+		memmove(L.V + (size_t)l * n, L.V + (size_t)m * n, sizeof(float) * b * n);
+		memset(L.H, 0, sizeof(double) * L.cap * L.cap);
+		for (i = 0; i < l; ++i) {
+			L.H[i * L.cap + i] = w[idx[i]];
+			for (s = 0; s < b; ++s) {
+				r = 0.;
+				for (t = s; t < b; ++t) { r += L.R[s * b + t] * Q[(m - b + t) * m + idx[i]]; }
+				L.H[(l + s) * L.cap + i] = L.H[i * L.cap + l + s] = r;
+			}
+		}
+		cur = l + b;
+	}
+
+	for (i = 0; i < k; ++i) {
+		for (j = 0; j < m; ++j) { Sf[i * m + j] = (float)Q[j * m + idx[i]]; }
+	}
+	cblas_sgemm(CblasRowMajor, CblasNoTrans, CblasNoTrans, k, n, m,
+		1.f, Sf, m, L.V, n, 0.f, Yb, n);
+	stat = bdla_eigsolve_output(n, k, w, idx, Yb, lambda, Y);
+cleanup:
+	free(L.V);
+	free(L.W);
+	free(L.Wt);
+	free(L.C);
+	free(L.Ct);
+	free(L.pre);
+	free(L.H);
+	free(L.R);
+	free(S);
+	free(Q);
+	free(w);
+	free(idx);
+	free(Sf);
+	free(Yb);
+	return stat;
+}
+
+BDLA_EXPORT bdla_Status bdla_Mxf_eig_lanczos(bdla_Mxf A, bdla_MatrixProperty A_prop,
+	int k, bdla_Vxf *lambda, bdla_Mxf *V, float tol, int *max_iter) {
+	assert(A.arr != NULL);
+	assert(k > 0);
+	assert(lambda != NULL);
+	assert(lambda->arr != NULL);
+	assert(V != NULL ? V->arr != NULL : 1);
+	assert(tol != 0.f);
+	assert(max_iter != NULL ? *max_iter > 0 : 1);
+	bdla_Status stat = bdla_eigsolve_checkargs(A, A_prop, &tol);
+	if (stat != BDLA_GOOD) { return stat; }
+	return bdla_eigsolve_lanczos(A, k, 1, lambda, V, tol, max_iter);
+}
+
+BDLA_EXPORT bdla_Status bdla_Mxf_eig_lanczos_block(bdla_Mxf A, bdla_MatrixProperty A_prop,
+	int k, int block, bdla_Vxf *lambda, bdla_Mxf *V, float tol, int *max_iter) {
+	assert(A.arr != NULL);
+	assert(k > 0);
+	assert(block > 0);
+	assert(lambda != NULL);
+	assert(lambda->arr != NULL);
+	assert(V != NULL ? V->arr != NULL : 1);
+	assert(tol != 0.f);
+	assert(max_iter != NULL ? *max_iter > 0 : 1);
+	bdla_Status stat = bdla_eigsolve_checkargs(A, A_prop, &tol);
+	if (stat != BDLA_GOOD) { return stat; }
+	return bdla_eigsolve_lanczos(A, k, block, lambda, V, tol, max_iter);
+}
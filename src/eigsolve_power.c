@@ -0,0 +1,80 @@
+#include "libbdla.h"
+/*============================================================================
+eigsolve_power.c
+
+Power iteration for the dominant eigenpair of a symmetric matrix.
+
+Copyright(c) 2019 HJA Bird
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files(the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions :
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+============================================================================*/
+#include <assert.h>
+#include <math.h>
+
+#include <openblas/cblas.h>
+
+#include "eigsolve_common.h"
+
+BDLA_EXPORT bdla_Status bdla_Mxf_eig_power(bdla_Mxf A, bdla_MatrixProperty A_prop,
+	float shift, float *lambda, bdla_Vxf *x, float tol, int *max_iter) {
+	assert(A.arr != NULL);
+	assert(lambda != NULL);
+	assert(x != NULL);
+	assert(x->arr != NULL);
+	assert(tol != 0.f);
+	assert(max_iter != NULL ? *max_iter > 0 : 1);
+	bdla_Status stat = bdla_eigsolve_checkargs(A, A_prop, &tol);
+	if (stat != BDLA_GOOD) { return stat; }
+	if (x->len != A.dims[0]) { return BDLA_DIMENSION_MISMATCH; }
+	int n = A.dims[0], iter, limit = max_iter != NULL ? *max_iter : 1000;
+	uint32_t seed = 2463534242u;
+	float mu = 0.f, xnorm, ynorm;
+	bdla_Vxf y = bdla_Vxf_create(n);
+	bdla_Vxf r = bdla_Vxf_create(n);
+	if (y.arr == NULL || r.arr == NULL) {
+		bdla_Vxf_release(&y);
+		bdla_Vxf_release(&r);
+		return BDLA_MEM_ERROR;
+	}
+
+	/* A zero start can't go anywhere, so make one up. */
+	xnorm = bdla_Vxf_norm2(*x);
+	if (xnorm == 0.f) {
+		bdla_eigsolve_random(x->arr, n, &seed);
+		xnorm = bdla_Vxf_norm2(*x);
+	}
+	bdla_Vxf_fmult(*x, 1.f / xnorm, x);
+	for (iter = 0; iter < limit; ++iter) {
+		/* y = (A - shift I) x, whose Rayleigh quotient is mu. */
+		bdla_Mxf_vmult(A, *x, &y);
+		if (shift != 0.f) { cblas_saxpy(n, -shift, x->arr, 1, y.arr, 1); }
+		mu = bdla_Vxf_dot(*x, y);
+		bdla_Vxf_copyin(&r, y);
+		cblas_saxpy(n, -mu, x->arr, 1, r.arr, 1);
+		if (bdla_Vxf_norm2(r) <= tol * fabsf(mu)) { break; }
+		ynorm = bdla_Vxf_norm2(y);
+		/* Stop with the last x, which mu belongs to. */
+		if (ynorm == 0.f || iter + 1 == limit) { break; }
+		bdla_Vxf_fmult(y, 1.f / ynorm, x);
+	}
+	*lambda = mu + shift;
+	bdla_Vxf_release(&y);
+	bdla_Vxf_release(&r);
+	return BDLA_GOOD;
+}
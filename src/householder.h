@@ -0,0 +1,65 @@
+#ifndef BDLA_HOUSEHOLDER_H
+#define BDLA_HOUSEHOLDER_H
+/*============================================================================
+householder.h
+
+Householder reflectors, shared by the dense factorisations.
+
+Copyright(c) 2019 HJA Bird
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files(the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions :
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+============================================================================*/
+#include "libbdla.h"
+
+#include <float.h>
+#include <math.h>
+
+#include <openblas/cblas.h>
+
+/* The reflector I - tau v v^T taking [*alpha; x] to [beta; 0], for a vector
+of length m with v = [1; x']. x's elements are incx apart. alpha gets beta,
+x gets v's tail and the return value is tau. As in LAPACK's slarfg, a
+vector too small for 1 / (alpha - beta) to be representable is scaled up
+first and beta scaled back down after, rather than overflowing to NaN. */
+static inline float bdla_householder(int m, float *alpha, float *x, int incx) {
+	const float safmin = FLT_MIN / FLT_EPSILON;
+	float xnorm, beta, tau;
+	int i, knt = 0;
+	if (m < 2) { return 0.f; }
+	xnorm = cblas_snrm2(m - 1, x, incx);
+	if (xnorm == 0.f) { return 0.f; }
+	beta = -copysignf(hypotf(*alpha, xnorm), *alpha);
+	if (fabsf(beta) < safmin) {
+		do {
+			++knt;
+			cblas_sscal(m - 1, 1.f / safmin, x, incx);
+			beta /= safmin;
+			*alpha /= safmin;
+		} while (fabsf(beta) < safmin && knt < 20);
+		xnorm = cblas_snrm2(m - 1, x, incx);
+		beta = -copysignf(hypotf(*alpha, xnorm), *alpha);
+	}
+	tau = (beta - *alpha) / beta;
+	cblas_sscal(m - 1, 1.f / (*alpha - beta), x, incx);
+	for (i = 0; i < knt; ++i) { beta *= safmin; }
+	*alpha = beta;
+	return tau;
+}
+
+#endif /* BDLA_HOUSEHOLDER_H */
@@ -0,0 +1,147 @@
+#include "libbdla.h"
+/*============================================================================
+linsolve_cg.c
+
+Conjugate gradient solvers for symmetric positive definite systems.
+
+Copyright(c) 2019 HJA Bird
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files(the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions :
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+============================================================================*/
+#include <assert.h>
+#include <math.h>
+#include <stdlib.h>
+
+#include <openblas/cblas.h>
+
+#include "linsolve_common.h"
+
+/* The iteration itself. Only touches A through matvec, once per step. */
+static bdla_Status bdla_solve_cg(bdla_Matvec matvec, const void *A, int rows, int cols,
+	bdla_Vxf b, bdla_Vxf *y, bdla_Vxf *guess, const bdla_SolveOptions *opts,
+	bdla_SolveResult *result) {
+	bdla_SolveOptions o = opts != NULL ? *opts : bdla_SolveOptions_default();
+	bdla_linsolve_checkopts(&o);
+	/* Check shapes */
+	bdla_Status stat = bdla_linsolve_checkargs(rows, cols, b, guess, &o.rtol);
+	if (stat != BDLA_GOOD) { return stat; }
+	int n = rows;
+	double rr, rrnew, pap;
+	float alpha, dxnorm, xnorm = 0.f;
+	bdla_Vxf x = bdla_linsolve_initialx(b, guess);
+	bdla_Vxf r = bdla_Vxf_create(n);
+	bdla_Vxf p = bdla_Vxf_create(n);
+	bdla_Vxf ap = bdla_Vxf_create(n);
+	bdla_IterMonitor mon;
+	bdla_itermonitor_init_ext(&mon, b, &o);
+
+	/* r = b - A x, p = r */
+	matvec(A, x, &ap);
+	bdla_Vxf_minus(b, ap, &r);
+	bdla_Vxf_copyin(&p, r);
+	rr = cblas_dsdot(n, r.arr, 1, r.arr, 1);
+	/* The updated r is the residual, so it is always on hand to report. */
+	if (!bdla_itermonitor_initial(&mon, (float)sqrt(rr))) {
+		do {
+			matvec(A, p, &ap);
+			pap = cblas_dsdot(n, p.arr, 1, ap.arr, 1);
+			if (!(pap > 0.)) {
+				stat = BDLA_BAD_PROPERTY;	/* Not positive definite. */
+				break;
+			}
+			alpha = (float)(rr / pap);
+			cblas_saxpy(n, alpha, p.arr, 1, x.arr, 1);
+			cblas_saxpy(n, -alpha, ap.arr, 1, r.arr, 1);
+			rrnew = cblas_dsdot(n, r.arr, 1, r.arr, 1);
+			dxnorm = -1.f;
+			if (bdla_itermonitor_due(&mon, BDLA_CONVERGE_UPDATE)) {
+				dxnorm = fabsf(alpha) * cblas_snrm2(n, p.arr, 1);
+				xnorm = cblas_snrm2(n, x.arr, 1);
+			}
+			/* p = r + (rr_new / rr) p */
+			cblas_sscal(n, (float)(rrnew / rr), p.arr, 1);
+			cblas_saxpy(n, 1.f, r.arr, 1, p.arr, 1);
+			rr = rrnew;
+		} while (!bdla_itermonitor_done_ext(&mon, (float)sqrt(rr), dxnorm, xnorm));
+	}
+
+	if (stat == BDLA_GOOD) {
+		bdla_itermonitor_report(&mon, result);
+		bdla_Vxf_copyin(y, x);
+	}
+	bdla_Vxf_release(&x);
+	bdla_Vxf_release(&r);
+	bdla_Vxf_release(&p);
+	bdla_Vxf_release(&ap);
+	return stat;
+}
+
+BDLA_EXPORT bdla_Status bdla_Mxf_solve_cg(
+	bdla_Mxf A, bdla_Vxf b, bdla_Vxf *y, float tol, bdla_Vxf *guess, int *max_iter) {
+	assert(tol != 0.f);
+	assert(max_iter != NULL ? *max_iter > 0 : 1);
+	bdla_SolveOptions opts = bdla_linsolve_options(tol, max_iter);
+	return bdla_Mxf_solve_cg_ext(A, b, y, guess, &opts, NULL);
+}
+
+BDLA_EXPORT bdla_Status bdla_Mxf_solve_cg_ext(bdla_Mxf A, bdla_Vxf b, bdla_Vxf *y,
+	bdla_Vxf *guess, const bdla_SolveOptions *opts, bdla_SolveResult *result) {
+	assert(A.arr != NULL);
+	assert(b.arr != NULL);
+	assert(y != NULL);
+	assert(y->arr != NULL);
+	assert(guess != NULL ? (guess->arr != NULL && guess->len > 0) : 1);
+	return bdla_solve_cg(bdla_matvec_Mxf, &A, A.dims[0], A.dims[1], b, y, guess, opts, result);
+}
+
+BDLA_EXPORT bdla_Status bdla_SMxf_solve_cg(
+	bdla_SMxf A, bdla_Vxf b, bdla_Vxf *y, float tol, bdla_Vxf *guess, int *max_iter) {
+	assert(tol != 0.f);
+	assert(max_iter != NULL ? *max_iter > 0 : 1);
+	bdla_SolveOptions opts = bdla_linsolve_options(tol, max_iter);
+	return bdla_SMxf_solve_cg_ext(A, b, y, guess, &opts, NULL);
+}
+
+BDLA_EXPORT bdla_Status bdla_SMxf_solve_cg_ext(bdla_SMxf A, bdla_Vxf b, bdla_Vxf *y,
+	bdla_Vxf *guess, const bdla_SolveOptions *opts, bdla_SolveResult *result) {
+	assert(A.arr != NULL);
+	assert(b.arr != NULL);
+	assert(y != NULL);
+	assert(y->arr != NULL);
+	assert(guess != NULL ? (guess->arr != NULL && guess->len > 0) : 1);
+	return bdla_solve_cg(bdla_matvec_SMxf, &A, A.dims[0], A.dims[1], b, y, guess, opts, result);
+}
+
+BDLA_EXPORT bdla_Status bdla_HMxf_solve_cg(
+	bdla_HMxf A, bdla_Vxf b, bdla_Vxf *y, float tol, bdla_Vxf *guess, int *max_iter) {
+	assert(tol != 0.f);
+	assert(max_iter != NULL ? *max_iter > 0 : 1);
+	bdla_SolveOptions opts = bdla_linsolve_options(tol, max_iter);
+	return bdla_HMxf_solve_cg_ext(A, b, y, guess, &opts, NULL);
+}
+
+BDLA_EXPORT bdla_Status bdla_HMxf_solve_cg_ext(bdla_HMxf A, bdla_Vxf b, bdla_Vxf *y,
+	bdla_Vxf *guess, const bdla_SolveOptions *opts, bdla_SolveResult *result) {
+	assert(A.arr != NULL);
+	assert(b.arr != NULL);
+	assert(y != NULL);
+	assert(y->arr != NULL);
+	assert(guess != NULL ? (guess->arr != NULL && guess->len > 0) : 1);
+	return bdla_solve_cg(bdla_matvec_HMxf, &A, A.dims[0], A.dims[1], b, y, guess, opts, result);
+}
@@ -0,0 +1,173 @@
+#include "libbdla.h"
+/*============================================================================
+linsolve_chebyshev.c
+
+Chebyshev semi-iteration. Given bounds on the spectrum it needs no inner
+products, so the only synchronisation in a step is the product with A.
+
+Copyright(c) 2019 HJA Bird
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files(the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions :
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+============================================================================*/
+#include <assert.h>
+#include <math.h>
+#include <stdlib.h>
+
+#include <openblas/cblas.h>
+
+#include "linsolve_common.h"
+#include "threadpool.h"
+
+typedef struct {
+	float *x, *r, *d;
+	const float *ad;
+	float c_d, c_r;
+} bdla_ChebyshevCtx;
+
+/* x += d, r -= A d and d = c_d d + c_r r in one pass. */
+static void bdla_chebyshev_update(void *ctx, int begin, int end) {
+	bdla_ChebyshevCtx *c = ctx;
+	int i;
+	for (i = begin; i < end; ++i) {
+		c->x[i] += c->d[i];
+		c->r[i] -= c->ad[i];
+		c->d[i] = c->c_d * c->d[i] + c->c_r * c->r[i];
+	}
+}
+
+/* Steps for the residual to fall by factor, from |r_k| <= |r_0| / T_k(sigma)
+with T_k the Chebyshev polynomial. */
+static int bdla_chebyshev_steps(double factor, double sigma) {
+	double k = ceil(acosh(factor) / acosh(sigma));
+	return k < 1. ? 1 : (k > 1e9 ? 1000000000 : (int)k);
+}
+
+static bdla_Status bdla_solve_chebyshev(bdla_Matvec matvec, const void *A, int rows, int cols,
+	bdla_Vxf b, bdla_Vxf *y, float lmin, float lmax, float tol, bdla_Vxf *guess,
+	int *max_iter) {
+	bdla_Status stat = bdla_linsolve_checkargs(rows, cols, b, guess, &tol);
+	if (stat != BDLA_GOOD) { return stat; }
+	int n = rows, k, steps, full;
+	double theta = 0.5 * ((double)lmax + lmin), delta = 0.5 * ((double)lmax - lmin);
+	double sigma = theta / delta, rho, rhonew, rnorm0, rnorm;
+	bdla_Vxf x = bdla_linsolve_initialx(b, guess);
+	bdla_Vxf r = bdla_Vxf_create(n);
+	bdla_Vxf d = bdla_Vxf_create(n);
+	bdla_Vxf ad = bdla_Vxf_create(n);
+	bdla_ChebyshevCtx c;
+	bdla_IterMonitor mon;
+	bdla_itermonitor_init(&mon, b, tol, max_iter);
+	c.x = x.arr;
+	c.r = r.arr;
+	c.d = d.arr;
+	c.ad = ad.arr;
+
+	matvec(A, x, &ad);
+	bdla_Vxf_minus(b, ad, &r);
+	rnorm = rnorm0 = guess != NULL ? sqrt(cblas_dsdot(n, r.arr, 1, r.arr, 1)) : mon.bnorm;
+	/* Each pass runs as many steps as the bounds say are needed, then
+	measures the residual once. A pass that falls short restarts from
+	where it got to. */
+	while (rnorm > bdla_itermonitor_target(&mon)
+		&& (mon.opts.max_iter == 0 || mon.iter < mon.opts.max_iter)) {
+		steps = bdla_chebyshev_steps(rnorm / bdla_itermonitor_target(&mon), sigma);
+		full = 1;
+		if (mon.opts.max_iter != 0 && steps > mon.opts.max_iter - mon.iter) {
+			steps = mon.opts.max_iter - mon.iter;
+			full = 0;
+		}
+		cblas_scopy(n, r.arr, 1, d.arr, 1);
+		cblas_sscal(n, (float)(1. / theta), d.arr, 1);
+		rho = 1. / sigma;
+		for (k = 0; k < steps; ++k) {
+			matvec(A, d, &ad);
+			rhonew = 1. / (2. * sigma - rho);
+			c.c_d = (float)(rhonew * rho);
+			c.c_r = (float)(2. * rhonew / delta);
+			bdla_parallel_for_static(n, bdla_parallel_grain(4), bdla_chebyshev_update, &c);
+			rho = rhonew;
+		}
+		mon.iter += steps;
+		/* The updated r drifts from b - A x, so measure that instead. */
+		matvec(A, x, &ad);
+		bdla_Vxf_minus(b, ad, &r);
+		rnorm = sqrt(cblas_dsdot(n, r.arr, 1, r.arr, 1));
+		if (!(rnorm <= rnorm0)) {
+			stat = BDLA_BAD_PROPERTY;	/* The spectrum isn't inside the bounds. */
+			break;
+		}
+		/* A whole pass should have reached tol. One that didn't even halve
+		the residual has met rounding error, or a smallest eigenvalue below
+		lmin: stop rather than spin, and say so unless it got there. */
+		if (full && rnorm > 0.5 * rnorm0) {
+			if (rnorm > bdla_itermonitor_target(&mon)) { stat = BDLA_BAD_PROPERTY; }
+			break;
+		}
+		rnorm0 = rnorm;
+	}
+
+	if (stat == BDLA_GOOD) { bdla_Vxf_copyin(y, x); }
+	bdla_Vxf_release(&x);
+	bdla_Vxf_release(&r);
+	bdla_Vxf_release(&d);
+	bdla_Vxf_release(&ad);
+	return stat;
+}
+
+BDLA_EXPORT bdla_Status bdla_Mxf_solve_chebyshev(bdla_Mxf A, bdla_Vxf b, bdla_Vxf *y,
+	float lmin, float lmax, float tol, bdla_Vxf *guess, int *max_iter) {
+	assert(A.arr != NULL);
+	assert(b.arr != NULL);
+	assert(y != NULL);
+	assert(y->arr != NULL);
+	assert(0.f < lmin && lmin < lmax);
+	assert(tol != 0.f);
+	assert(guess != NULL ? (guess->arr != NULL && guess->len > 0) : 1);
+	assert(max_iter != NULL ? *max_iter > 0 : 1);
+	return bdla_solve_chebyshev(bdla_matvec_Mxf, &A, A.dims[0], A.dims[1], b, y,
+		lmin, lmax, tol, guess, max_iter);
+}
+
+BDLA_EXPORT bdla_Status bdla_SMxf_solve_chebyshev(bdla_SMxf A, bdla_Vxf b, bdla_Vxf *y,
+	float lmin, float lmax, float tol, bdla_Vxf *guess, int *max_iter) {
+	assert(A.arr != NULL);
+	assert(b.arr != NULL);
+	assert(y != NULL);
+	assert(y->arr != NULL);
+	assert(0.f < lmin && lmin < lmax);
+	assert(tol != 0.f);
+	assert(guess != NULL ? (guess->arr != NULL && guess->len > 0) : 1);
+	assert(max_iter != NULL ? *max_iter > 0 : 1);
+	return bdla_solve_chebyshev(bdla_matvec_SMxf, &A, A.dims[0], A.dims[1], b, y,
+		lmin, lmax, tol, guess, max_iter);
+}
+
+BDLA_EXPORT bdla_Status bdla_HMxf_solve_chebyshev(bdla_HMxf A, bdla_Vxf b, bdla_Vxf *y,
+	float lmin, float lmax, float tol, bdla_Vxf *guess, int *max_iter) {
+	assert(A.arr != NULL);
+	assert(b.arr != NULL);
+	assert(y != NULL);
+	assert(y->arr != NULL);
+	assert(0.f < lmin && lmin < lmax);
+	assert(tol != 0.f);
+	assert(guess != NULL ? (guess->arr != NULL && guess->len > 0) : 1);
+	assert(max_iter != NULL ? *max_iter > 0 : 1);
+	return bdla_solve_chebyshev(bdla_matvec_HMxf, &A, A.dims[0], A.dims[1], b, y,
+		lmin, lmax, tol, guess, max_iter);
+}
@@ -0,0 +1,41 @@
+#include "libbdla.h"
+/*============================================================================
+linsolve_common.c
+
+Options shared by the iterative linear solvers.
+
+Copyright(c) 2019 HJA Bird
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files(the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions :
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+============================================================================*/
+#include <stddef.h>
+
+BDLA_EXPORT bdla_SolveOptions bdla_SolveOptions_default(void) {
+	bdla_SolveOptions opts;
+	opts.rtol = 1e-6f;
+	opts.atol = 0.f;
+	opts.max_iter = 0;
+	opts.check_every = 1;
+	opts.test = BDLA_CONVERGE_RESIDUAL;
+	opts.time_limit = 0.;
+	opts.callback = NULL;
+	opts.callback_data = NULL;
+	opts.history = NULL;
+	return opts;
+}
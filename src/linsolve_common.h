@@ -0,0 +1,242 @@
+#ifndef BDLA_LINSOLVE_COMMON_H
+#define BDLA_LINSOLVE_COMMON_H
+/*============================================================================
+linsolve_common.h
+
+Argument checking and convergence logic shared by the iterative solvers, so
+that the dense and sparse variants stop under exactly the same conditions.
+
+Copyright(c) 2019 HJA Bird
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files(the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions :
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+============================================================================*/
+#include "libbdla.h"
+
+#include <assert.h>
+#include <math.h>
+
+#include "threads.h"
+
+typedef struct {
+	bdla_SolveOptions opts;
+	float bnorm;
+	double start;		/* bdla_seconds() at the start, if anything needs it. */
+	double deadline;	/* bdla_seconds() to stop at, or 0 for never. */
+	int iter;
+	bdla_StopReason reason;
+	float resnorm;		/* The last |b - A x| seen, and the iteration it was of. */
+	int resiter;
+} bdla_IterMonitor;
+
+/* y = A x for whichever matrix type A points to, so that the Krylov
+solvers are written once for all of them. */
+typedef bdla_Status(*bdla_Matvec)(const void *A, bdla_Vxf x, bdla_Vxf *y);
+
+static inline bdla_Status bdla_matvec_Mxf(const void *A, bdla_Vxf x, bdla_Vxf *y) {
+	return bdla_Mxf_vmult(*(const bdla_Mxf *)A, x, y);
+}
+
+static inline bdla_Status bdla_matvec_SMxf(const void *A, bdla_Vxf x, bdla_Vxf *y) {
+	return bdla_SMxf_vmult(*(const bdla_SMxf *)A, x, y);
+}
+
+static inline bdla_Status bdla_matvec_HMxf(const void *A, bdla_Vxf x, bdla_Vxf *y) {
+	return bdla_HMxf_vmult(*(const bdla_HMxf *)A, x, y);
+}
+
+/* Checks the shapes of a square system of size rows x cols and clamps
+silly tolerances. */
+static inline bdla_Status bdla_linsolve_checkargs(
+	int rows, int cols, bdla_Vxf b, bdla_Vxf *guess, float *tol) {
+	assert(tol != NULL);
+	if (rows != cols) { return BDLA_NONSQUARE; }
+	if (b.len != rows) { return BDLA_DIMENSION_MISMATCH; }
+	if (guess != NULL && guess->len != b.len) { return BDLA_DIMENSION_MISMATCH; }
+	if (*tol > 1.f) { *tol = 1e-6f; }
+	return BDLA_GOOD;
+}
+
+/* A copy of the guess, or a zero vector if there isn't one. */
+static inline bdla_Vxf bdla_linsolve_initialx(bdla_Vxf b, bdla_Vxf *guess) {
+	bdla_Vxf x;
+	if (guess != NULL) {
+		x = bdla_Vxf_copy(*guess);
+	}
+	else {
+		x = bdla_Vxf_create(b.len);
+		bdla_Vxf_zero(&x);
+	}
+	return x;
+}
+
+static inline void bdla_linsolve_checkopts(const bdla_SolveOptions *opts) {
+	assert(opts->rtol >= 0.f);
+	assert(opts->atol >= 0.f);
+	assert(opts->max_iter >= 0);
+	assert(opts->check_every > 0);
+	assert(opts->test == BDLA_CONVERGE_RESIDUAL || opts->test == BDLA_CONVERGE_UPDATE);
+	assert(opts->time_limit >= 0.);
+	assert(opts->history != NULL ? opts->history->records != NULL
+		&& opts->history->capacity > 0 && opts->history->count >= 0 : 1);
+}
+
+/* The options the (tol, max_iter) interface stands for. */
+static inline bdla_SolveOptions bdla_linsolve_options(float tol, int *max_iter) {
+	bdla_SolveOptions opts = bdla_SolveOptions_default();
+	opts.rtol = tol;
+	opts.max_iter = max_iter != NULL ? *max_iter : 0;
+	return opts;
+}
+
+static inline void bdla_itermonitor_init_ext(bdla_IterMonitor *mon,
+	bdla_Vxf b, const bdla_SolveOptions *opts) {
+	mon->opts = *opts;
+	mon->bnorm = bdla_Vxf_norm2(b);
+	mon->start = opts->time_limit > 0. || opts->callback != NULL || opts->history != NULL
+		? bdla_seconds() : 0.;
+	mon->deadline = opts->time_limit > 0. ? mon->start + opts->time_limit : 0.;
+	mon->iter = 0;
+	mon->reason = BDLA_STOP_MAX_ITER;
+	mon->resnorm = -1.f;
+	mon->resiter = -1;
+}
+
+static inline void bdla_itermonitor_init(bdla_IterMonitor *mon,
+	bdla_Vxf b, float tol, int *max_iter) {
+	bdla_SolveOptions opts = bdla_linsolve_options(tol, max_iter);
+	bdla_itermonitor_init_ext(mon, b, &opts);
+}
+
+/* The residual norm that counts as converged. */
+static inline float bdla_itermonitor_target(const bdla_IterMonitor *mon) {
+	return fmaxf(mon->opts.atol, mon->opts.rtol * mon->bnorm);
+}
+
+/* For solvers that know the residual norm of the starting x: nonzero if
+that x needs no iterations at all. */
+static inline int bdla_itermonitor_initial(bdla_IterMonitor *mon, float resnorm) {
+	mon->resnorm = resnorm;
+	mon->resiter = 0;
+	if (resnorm > 0.f && !(mon->opts.test == BDLA_CONVERGE_RESIDUAL
+		&& resnorm <= bdla_itermonitor_target(mon))) {
+		return 0;
+	}
+	mon->reason = BDLA_STOP_CONVERGED;
+	return 1;
+}
+
+/* Nonzero if the iteration under way is tested for convergence with test,
+so the solver has to measure what that test needs. */
+static inline int bdla_itermonitor_due(const bdla_IterMonitor *mon, bdla_ConvergeTest test) {
+	return mon->opts.test == test && (mon->iter + 1) % mon->opts.check_every == 0;
+}
+
+/* Hands the iteration just counted to the telemetry. Returns the
+callback's wish to stop. */
+static inline int bdla_itermonitor_record(bdla_IterMonitor *mon, float resnorm, float dxnorm) {
+	bdla_SolveRecord rec;
+	bdla_SolveHistory *hist = mon->opts.history;
+	rec.iteration = mon->iter;
+	rec.residual = resnorm >= 0.f ? resnorm : -1.f;
+	rec.update = dxnorm >= 0.f ? dxnorm : -1.f;
+	rec.elapsed = bdla_seconds() - mon->start;
+	if (hist != NULL) {
+		hist->records[hist->count % hist->capacity] = rec;
+		++hist->count;
+	}
+	return mon->opts.callback != NULL && mon->opts.callback(&rec, mon->opts.callback_data);
+}
+
+/* Call once per iteration, with the residual norm |Ax - b| and the update
+norm |x_k - x_k-1| and |x_k| of the new iterate. Each may be negative when
+it wasn't measured, unless bdla_itermonitor_due asked for it. Returns
+nonzero when the solver should stop. */
+static inline int bdla_itermonitor_done_ext(bdla_IterMonitor *mon,
+	float resnorm, float dxnorm, float xnorm) {
+	int converged = 0, stop;
+	if (resnorm >= 0.f) {
+		mon->resnorm = resnorm;
+		mon->resiter = mon->iter + 1;
+	}
+	if (bdla_itermonitor_due(mon, BDLA_CONVERGE_RESIDUAL)) {
+		assert(resnorm >= 0.f);
+		converged = !(resnorm > bdla_itermonitor_target(mon));
+	}
+	else if (bdla_itermonitor_due(mon, BDLA_CONVERGE_UPDATE)) {
+		assert(dxnorm >= 0.f);
+		converged = !(dxnorm > fmaxf(mon->opts.atol, mon->opts.rtol * xnorm));
+	}
+	++mon->iter;
+	stop = 1;
+	if (converged) {
+		mon->reason = BDLA_STOP_CONVERGED;
+	}
+	else if (mon->opts.max_iter > 0 && mon->iter >= mon->opts.max_iter) {
+		mon->reason = BDLA_STOP_MAX_ITER;
+	}
+	else if (mon->deadline > 0. && bdla_seconds() >= mon->deadline) {
+		mon->reason = BDLA_STOP_TIME_LIMIT;
+	}
+	else {
+		stop = 0;
+	}
+	if (mon->opts.callback != NULL || mon->opts.history != NULL) {
+		if (bdla_itermonitor_record(mon, resnorm, dxnorm) && !stop) {
+			mon->reason = BDLA_STOP_CALLBACK;
+			stop = 1;
+		}
+	}
+	return stop;
+}
+
+/* As bdla_itermonitor_done_ext, for solvers that only measure the residual. */
+static inline int bdla_itermonitor_done(bdla_IterMonitor *mon, float resnorm) {
+	return bdla_itermonitor_done_ext(mon, resnorm, -1.f, 0.f);
+}
+
+/* Nonzero if the residual of the final iterate still has to be measured
+for the report. */
+static inline int bdla_itermonitor_needs_residual(const bdla_IterMonitor *mon,
+	const bdla_SolveResult *result) {
+	return result != NULL && mon->resiter != mon->iter;
+}
+
+static inline void bdla_itermonitor_report(const bdla_IterMonitor *mon,
+	bdla_SolveResult *result) {
+	if (result == NULL) { return; }
+	result->reason = mon->reason;
+	result->iterations = mon->iter;
+	result->residual = mon->resnorm;
+}
+
+/* |a - b| and |a|, accumulated in double. */
+static inline void bdla_linsolve_diffnorm(int n, const float *a, const float *b,
+	float *dnorm, float *anorm) {
+	double dd = 0., aa = 0., d;
+	int i;
+	for (i = 0; i < n; ++i) {
+		d = (double)a[i] - b[i];
+		dd += d * d;
+		aa += (double)a[i] * a[i];
+	}
+	*dnorm = (float)sqrt(dd);
+	*anorm = (float)sqrt(aa);
+}
+
+#endif /* BDLA_LINSOLVE_COMMON_H */
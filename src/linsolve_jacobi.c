@@ -25,9 +25,44 @@ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
 SOFTWARE.
 ============================================================================*/
 #include <assert.h>
+#include <stdlib.h>
+
+#include "linsolve_common.h"
+#include "threadpool.h"
+
+typedef struct {
+	bdla_SMxf A;
+	const float *b, *diag, *x;
+	float *xnew;
+} bdla_JacobiCtx;
+
+/* x_new = D^-1 (b - R x) for rows [begin, end), walking the off-diagonal
+of each row. */
+static void bdla_SMxf_jacobi_rows(void *ctx, int begin, int end) {
+	bdla_JacobiCtx *c = ctx;
+	float acc;
+	int i, k;
+	for (i = begin; i < end; ++i) {
+		acc = c->b[i];
+		for (k = c->A.row_ptr[i]; k < c->A.row_ptr[i + 1]; ++k) {
+			if (c->A.col_idx[k] != i) {
+				acc -= c->A.arr[k] * c->x[c->A.col_idx[k]];
+			}
+		}
+		c->xnew[i] = acc / c->diag[i];
+	}
+}
 
 BDLA_EXPORT bdla_Status bdla_Mxf_solve_jacobi(
 	bdla_Mxf A, bdla_Vxf b, bdla_Vxf *y, float tol, bdla_Vxf *guess, int *max_iter) {
+	assert(tol != 0.f);
+	assert(max_iter != NULL ? *max_iter > 0 : 1);
+	bdla_SolveOptions opts = bdla_linsolve_options(tol, max_iter);
+	return bdla_Mxf_solve_jacobi_ext(A, b, y, guess, &opts, NULL);
+}
+
+BDLA_EXPORT bdla_Status bdla_Mxf_solve_jacobi_ext(bdla_Mxf A, bdla_Vxf b, bdla_Vxf *y,
+	bdla_Vxf *guess, const bdla_SolveOptions *opts, bdla_SolveResult *result) {
 	assert(A.arr != NULL);
 	assert(A.dims[0] > 0);
 	assert(A.dims[0] > 0);
@@ -35,53 +70,186 @@ BDLA_EXPORT bdla_Status bdla_Mxf_solve_jacobi(
 	assert(b.len >= 0);
 	assert(y != NULL);
 	assert(y->arr != NULL);
-	assert(tol != 0.f);
 	assert(guess != NULL ? (guess->arr != NULL && guess->len > 0) : 1);
-	assert(max_iter != NULL ? *max_iter > 0 : 1);
+	bdla_SolveOptions o = opts != NULL ? *opts : bdla_SolveOptions_default();
+	bdla_linsolve_checkopts(&o);
 	/* Check shapes */
-	if (!bdla_Mxf_issquare(A)) { return BDLA_NONSQUARE; }
-	if (b.len != A.dims[0]) { return BDLA_DIMENSION_MISMATCH; }
-	if (guess != NULL && guess->len != b.len) { return BDLA_DIMENSION_MISMATCH; }
-	if (tol > 1.f) { tol = 1e-6f; }
+	bdla_Status stat = bdla_linsolve_checkargs(A.dims[0], A.dims[1], b, guess, &o.rtol);
+	if (stat != BDLA_GOOD) { return stat; }
 	/* Setup matrices: 
-			D is diagonal matrix
+			D is diagonal matrix, kept as a vector
 			R is nondiagonal matrix
 	*/
-	bdla_Vxf x;
-	if (guess != NULL) {
-		x = bdla_Vxf_copy(*guess);
-	}
-	else {
-		x = bdla_Vxf_create(b.len);
-		bdla_Vxf_zero(&x);
-	}
-	bdla_Vxf diag = bdla_Vxf_create(A.dims[0]);
+	int i, n = A.dims[0];
+	bdla_Vxf x = bdla_linsolve_initialx(b, guess);
+	bdla_Vxf diag = bdla_Vxf_create(n);
 	bdla_Mxf_diag(A, 0, &diag);
-	bdla_Mxf D = bdla_Mxf_create(A.dims[0], A.dims[1]);
 	bdla_Mxf R = bdla_Mxf_copy(A);
-	bdla_Mxf_diagonal(&D, diag, 0);
 	bdla_Mxf_diagminus(R, diag, 0, &R);
-	bdla_Vxf diff = bdla_Vxf_create(A.dims[0]);
-	float relerror = 9999999999.f;
-	float bnorm = bdla_Vxf_norm2(b);
-	int iter = 0;
+	bdla_Vxf rhs = bdla_Vxf_create(n);
+	bdla_Vxf tmp;
+	float rnorm, dxnorm, xnorm = 0.f;
+	bdla_IterMonitor mon;
+	bdla_itermonitor_init_ext(&mon, b, &o);
 
 	do {
-		bdla_Mxf_vmult(R, x, &x);
-		bdla_Vxf_minus(b, x, &x);
-		bdla_Mxf_vdiagsolve(D, x, &x);
-		bdla_Mxf_vmult(A, x, &diff);
-		bdla_Vxf_minus(diff, b, &diff);
-		relerror = bdla_Vxf_norm2(diff) / bnorm;
-		if (max_iter != NULL && iter >= *max_iter) { break; }
-		++iter;
-	} while (relerror > tol);
+		/* x = D^-1 (b - R x) */
+		bdla_Vxf_copyin(&rhs, b);
+		bdla_Mxf_gemv(-1.f, R, BDLA_NO_TRANS, x, 1.f, &rhs);
+		for (i = 0; i < n; ++i) {
+			rhs.arr[i] /= diag.arr[i];
+		}
+		dxnorm = -1.f;
+		if (bdla_itermonitor_due(&mon, BDLA_CONVERGE_UPDATE)) {
+			bdla_linsolve_diffnorm(n, rhs.arr, x.arr, &dxnorm, &xnorm);
+		}
+		tmp = x; x = rhs; rhs = tmp;
+		rnorm = -1.f;
+		if (bdla_itermonitor_due(&mon, BDLA_CONVERGE_RESIDUAL)) {
+			bdla_Mxf_residual(A, x, b, NULL, &rnorm);
+		}
+	} while (!bdla_itermonitor_done_ext(&mon, rnorm, dxnorm, xnorm));
 
+	if (bdla_itermonitor_needs_residual(&mon, result)) {
+		bdla_Mxf_residual(A, x, b, NULL, &mon.resnorm);
+	}
+	bdla_itermonitor_report(&mon, result);
 	bdla_Vxf_copyin(y, x);
 	bdla_Vxf_release(&x);
 	bdla_Vxf_release(&diag);
-	bdla_Vxf_release(&diff);
-	bdla_Mxf_release(&D);
+	bdla_Vxf_release(&rhs);
 	bdla_Mxf_release(&R);
 	return BDLA_GOOD;
 }
+
+BDLA_EXPORT bdla_Status bdla_SMxf_solve_jacobi(
+	bdla_SMxf A, bdla_Vxf b, bdla_Vxf *y, float tol, bdla_Vxf *guess, int *max_iter) {
+	assert(tol != 0.f);
+	assert(max_iter != NULL ? *max_iter > 0 : 1);
+	bdla_SolveOptions opts = bdla_linsolve_options(tol, max_iter);
+	return bdla_SMxf_solve_jacobi_ext(A, b, y, guess, &opts, NULL);
+}
+
+BDLA_EXPORT bdla_Status bdla_SMxf_solve_jacobi_ext(bdla_SMxf A, bdla_Vxf b, bdla_Vxf *y,
+	bdla_Vxf *guess, const bdla_SolveOptions *opts, bdla_SolveResult *result) {
+	assert(A.arr != NULL);
+	assert(A.dims[0] > 0);
+	assert(A.dims[1] > 0);
+	assert(b.arr != NULL);
+	assert(b.len >= 0);
+	assert(y != NULL);
+	assert(y->arr != NULL);
+	assert(guess != NULL ? (guess->arr != NULL && guess->len > 0) : 1);
+	bdla_SolveOptions o = opts != NULL ? *opts : bdla_SolveOptions_default();
+	bdla_linsolve_checkopts(&o);
+	/* Check shapes */
+	bdla_Status stat = bdla_linsolve_checkargs(A.dims[0], A.dims[1], b, guess, &o.rtol);
+	if (stat != BDLA_GOOD) { return stat; }
+	int i, n = A.dims[0], grain;
+	bdla_JacobiCtx c;
+	bdla_Vxf diag = bdla_Vxf_create(n);
+	bdla_SMxf_diag(A, &diag);
+	for (i = 0; i < n; ++i) {
+		if (diag.arr[i] == 0.f) {
+			bdla_Vxf_release(&diag);
+			return BDLA_BAD_PROPERTY;
+		}
+	}
+	bdla_Vxf x = bdla_linsolve_initialx(b, guess);
+	bdla_Vxf xnew = bdla_Vxf_create(n);
+	bdla_Vxf tmp;
+	float rnorm, dxnorm, xnorm = 0.f;
+	bdla_IterMonitor mon;
+	bdla_itermonitor_init_ext(&mon, b, &o);
+	c.A = A;
+	c.b = b.arr;
+	c.diag = diag.arr;
+	grain = bdla_parallel_grain(A.nnz / n > 0 ? A.nnz / n : 1);
+
+	do {
+		c.x = x.arr;
+		c.xnew = xnew.arr;
+		bdla_parallel_for_static(n, grain, bdla_SMxf_jacobi_rows, &c);
+		dxnorm = -1.f;
+		if (bdla_itermonitor_due(&mon, BDLA_CONVERGE_UPDATE)) {
+			bdla_linsolve_diffnorm(n, xnew.arr, x.arr, &dxnorm, &xnorm);
+		}
+		tmp = x; x = xnew; xnew = tmp;
+		rnorm = -1.f;
+		if (bdla_itermonitor_due(&mon, BDLA_CONVERGE_RESIDUAL)) {
+			bdla_SMxf_residual(A, x, b, NULL, &rnorm);
+		}
+	} while (!bdla_itermonitor_done_ext(&mon, rnorm, dxnorm, xnorm));
+
+	if (bdla_itermonitor_needs_residual(&mon, result)) {
+		bdla_SMxf_residual(A, x, b, NULL, &mon.resnorm);
+	}
+	bdla_itermonitor_report(&mon, result);
+	bdla_Vxf_copyin(y, x);
+	bdla_Vxf_release(&x);
+	bdla_Vxf_release(&xnew);
+	bdla_Vxf_release(&diag);
+	return BDLA_GOOD;
+}
+
+BDLA_EXPORT bdla_Status bdla_HMxf_solve_jacobi(
+	bdla_HMxf A, bdla_Vxf b, bdla_Vxf *y, float tol, bdla_Vxf *guess, int *max_iter) {
+	assert(tol != 0.f);
+	assert(max_iter != NULL ? *max_iter > 0 : 1);
+	bdla_SolveOptions opts = bdla_linsolve_options(tol, max_iter);
+	return bdla_HMxf_solve_jacobi_ext(A, b, y, guess, &opts, NULL);
+}
+
+BDLA_EXPORT bdla_Status bdla_HMxf_solve_jacobi_ext(bdla_HMxf A, bdla_Vxf b, bdla_Vxf *y,
+	bdla_Vxf *guess, const bdla_SolveOptions *opts, bdla_SolveResult *result) {
+	assert(A.arr != NULL);
+	assert(A.dims[0] > 0);
+	assert(A.dims[1] > 0);
+	assert(b.arr != NULL);
+	assert(b.len >= 0);
+	assert(y != NULL);
+	assert(y->arr != NULL);
+	assert(guess != NULL ? (guess->arr != NULL && guess->len > 0) : 1);
+	bdla_SolveOptions o = opts != NULL ? *opts : bdla_SolveOptions_default();
+	bdla_linsolve_checkopts(&o);
+	/* Check shapes */
+	bdla_Status stat = bdla_linsolve_checkargs(A.dims[0], A.dims[1], b, guess, &o.rtol);
+	if (stat != BDLA_GOOD) { return stat; }
+	int i, n = A.dims[0];
+	bdla_Vxf diag = bdla_Vxf_create(n);
+	bdla_HMxf_diag(A, &diag);
+	for (i = 0; i < n; ++i) {
+		if (diag.arr[i] == 0.f) {
+			bdla_Vxf_release(&diag);
+			return BDLA_BAD_PROPERTY;
+		}
+	}
+	bdla_Vxf x = bdla_linsolve_initialx(b, guess);
+	bdla_Vxf r = bdla_Vxf_create(n);
+	float rnorm, dxnorm, xnorm = 0.f;
+	double dd;
+	bdla_IterMonitor mon;
+	bdla_itermonitor_init_ext(&mon, b, &o);
+
+	/* D^-1 (b - R x) = x + D^-1 (b - A x), so each sweep is a single pass
+	over the 16 bit matrix that also gives the residual of the new x. */
+	bdla_HMxf_residual(A, x, b, &r, &rnorm);
+	do {
+		dd = 0.;
+		for (i = 0; i < n; ++i) {
+			r.arr[i] /= diag.arr[i];
+			dd += (double)r.arr[i] * r.arr[i];
+			x.arr[i] += r.arr[i];
+		}
+		dxnorm = (float)sqrt(dd);
+		xnorm = bdla_itermonitor_due(&mon, BDLA_CONVERGE_UPDATE) ? bdla_Vxf_norm2(x) : 0.f;
+		bdla_HMxf_residual(A, x, b, &r, &rnorm);
+	} while (!bdla_itermonitor_done_ext(&mon, rnorm, dxnorm, xnorm));
+
+	bdla_itermonitor_report(&mon, result);
+	bdla_Vxf_copyin(y, x);
+	bdla_Vxf_release(&x);
+	bdla_Vxf_release(&r);
+	bdla_Vxf_release(&diag);
+	return BDLA_GOOD;
+}
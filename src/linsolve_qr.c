@@ -0,0 +1,291 @@
+#include "libbdla.h"
+/*============================================================================
+linsolve_qr.c
+
+Blocked Householder QR, and least squares by it.
+
+Copyright(c) 2019 HJA Bird
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files(the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions :
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+============================================================================*/
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <openblas/cblas.h>
+
+#include "householder.h"
+#include "threadpool.h"
+
+/* Reflectors per compact WY block. */
+#define BDLA_QR_BLOCK 32
+
+/* Everything here is row-major. Reflector j is I - tau_j v v^T, v being
+zero above row j, one at row j and QR(j + 1 :, j) below. The block of jb
+reflectors from column j0 is I - V T V^T, V being the rows x jb unit lower
+trapezoid at QR(j0, j0) and T the upper triangular jb x jb at T(0, j0). */
+
+/* Copies the rows x cols row-major A to or from the column-major P. */
+static void bdla_qr_panel_copy(float *A, int lda, float *P, int rows, int cols, int to_p) {
+	int ib, i, j, ie;
+	for (ib = 0; ib < rows; ib += 64) {
+		ie = ib + 64 < rows ? ib + 64 : rows;
+		for (j = 0; j < cols; ++j) {
+			for (i = ib; i < ie; ++i) {
+				if (to_p) {
+					P[(size_t)j * rows + i] = A[(size_t)i * lda + j];
+				} else {
+					A[(size_t)i * lda + j] = P[(size_t)j * rows + i];
+				}
+			}
+		}
+	}
+}
+
+/* C = (I - V T V^T)^T C, column-major, for the rows x cols C, the rows x nv
+unit lower trapezoid V and the upper triangular T. W has nv x cols floats. */
+static void bdla_qr_apply_cm(int rows, int nv, const float *V, int ldv, const float *T,
+	int ldt, float *C, int ldc, int cols, float *W) {
+	int i, j, rest = rows - nv;
+	for (j = 0; j < cols; ++j) { memcpy(W + (size_t)j * nv, C + (size_t)j * ldc, sizeof(float) * nv); }
+	cblas_strmm(CblasColMajor, CblasLeft, CblasLower, CblasTrans, CblasUnit, nv, cols,
+		1.f, V, ldv, W, nv);
+	if (rest > 0) {
+		cblas_sgemm(CblasColMajor, CblasTrans, CblasNoTrans, nv, cols, rest, 1.f, V + nv, ldv,
+			C + nv, ldc, 1.f, W, nv);
+	}
+	cblas_strmm(CblasColMajor, CblasLeft, CblasUpper, CblasTrans, CblasNonUnit, nv, cols,
+		1.f, T, ldt, W, nv);
+	if (rest > 0) {
+		cblas_sgemm(CblasColMajor, CblasNoTrans, CblasNoTrans, rest, cols, nv, -1.f, V + nv, ldv,
+			W, nv, 1.f, C + nv, ldc);
+	}
+	cblas_strmm(CblasColMajor, CblasLeft, CblasLower, CblasNoTrans, CblasUnit, nv, cols,
+		1.f, V, ldv, W, nv);
+	for (j = 0; j < cols; ++j) {
+		for (i = 0; i < nv; ++i) { C[(size_t)j * ldc + i] -= W[(size_t)j * nv + i]; }
+	}
+}
+
+/* QR of the column-major rows x cols P by recursive halving, as LAPACK's
+sgeqrt3, so that even a panel's own updates are gemm. T is column-major
+here. W has cols * cols / 4 floats. */
+static void bdla_qr_recursive(float *P, int ldp, int rows, int cols, float *T, int ldt,
+	float *W) {
+	int n1 = cols / 2, n2 = cols - n1, i, j;
+	float *T12 = T + (size_t)n1 * ldt, *V2 = P + (size_t)n1 * ldp + n1;
+	if (cols == 1) {
+		T[0] = bdla_householder(rows, P, P + 1, 1);
+		return;
+	}
+	bdla_qr_recursive(P, ldp, rows, n1, T, ldt, W);
+	bdla_qr_apply_cm(rows, n1, P, ldp, T, ldt, P + (size_t)n1 * ldp, ldp, n2, W);
+	bdla_qr_recursive(V2, ldp, rows - n1, n2, T12 + n1, ldt, W);
+	/* T12 = -T11 V1^T V2 T22. */
+	for (j = 0; j < n2; ++j) {
+		for (i = 0; i < n1; ++i) { T12[(size_t)j * ldt + i] = P[(size_t)i * ldp + n1 + j]; }
+	}
+	cblas_strmm(CblasColMajor, CblasRight, CblasLower, CblasNoTrans, CblasUnit, n1, n2,
+		1.f, V2, ldp, T12, ldt);
+	if (rows > cols) {
+		cblas_sgemm(CblasColMajor, CblasTrans, CblasNoTrans, n1, n2, rows - cols, 1.f,
+			P + cols, ldp, V2 + n2, ldp, 1.f, T12, ldt);
+	}
+	cblas_strmm(CblasColMajor, CblasLeft, CblasUpper, CblasNoTrans, CblasNonUnit, n1, n2,
+		-1.f, T, ldt, T12, ldt);
+	cblas_strmm(CblasColMajor, CblasRight, CblasUpper, CblasNoTrans, CblasNonUnit, n1, n2,
+		1.f, T12 + n1, ldt, T12, ldt);
+}
+
+/* Factors the rows x jb panel at A and writes its T. The panel is worked on
+column-major, so the reflectors are contiguous. P has rows * jb + 2 * jb * jb
+floats. */
+static void bdla_qr_panel(float *A, int lda, int rows, int jb, float *T, int ldt, float *P) {
+	float *Tp = P + (size_t)rows * jb, *W = Tp + jb * jb;
+	int i, j;
+	bdla_qr_panel_copy(A, lda, P, rows, jb, 1);
+	bdla_qr_recursive(P, rows, rows, jb, Tp, jb, W);
+	bdla_qr_panel_copy(A, lda, P, rows, jb, 0);
+	for (j = 0; j < jb; ++j) {
+		for (i = 0; i <= j; ++i) { T[(size_t)i * ldt + j] = Tp[(size_t)j * jb + i]; }
+	}
+}
+
+typedef struct {
+	const float *V, *T;
+	float *C, *W;		/* rows x cols to update, and jb x cols work */
+	int ldv, ldt, ldc, ldw, rows, jb;
+} bdla_QrApplyCtx;
+
+/* C = (I - V T V^T)^T C for columns [begin, end) of C. */
+static void bdla_qr_apply_cols(void *ctx, int begin, int end) {
+	bdla_QrApplyCtx *c = ctx;
+	float *C = c->C + begin, *W = c->W + begin;
+	const float *Vb = c->V + (size_t)c->jb * c->ldv;
+	int i, j, nc = end - begin, jb = c->jb, rest = c->rows - c->jb;
+	/* W = V^T C. */
+	for (i = 0; i < jb; ++i) {
+		memcpy(W + (size_t)i * c->ldw, C + (size_t)i * c->ldc, sizeof(float) * nc);
+	}
+	cblas_strmm(CblasRowMajor, CblasLeft, CblasLower, CblasTrans, CblasUnit, jb, nc,
+		1.f, c->V, c->ldv, W, c->ldw);
+	if (rest > 0) {
+		cblas_sgemm(CblasRowMajor, CblasTrans, CblasNoTrans, jb, nc, rest, 1.f, Vb, c->ldv,
+			C + (size_t)jb * c->ldc, c->ldc, 1.f, W, c->ldw);
+	}
+	/* W = T^T W, then C -= V W. */
+	cblas_strmm(CblasRowMajor, CblasLeft, CblasUpper, CblasTrans, CblasNonUnit, jb, nc,
+		1.f, c->T, c->ldt, W, c->ldw);
+	if (rest > 0) {
+		cblas_sgemm(CblasRowMajor, CblasNoTrans, CblasNoTrans, rest, nc, jb, -1.f, Vb, c->ldv,
+			W, c->ldw, 1.f, C + (size_t)jb * c->ldc, c->ldc);
+	}
+	cblas_strmm(CblasRowMajor, CblasLeft, CblasLower, CblasNoTrans, CblasUnit, jb, nc,
+		1.f, c->V, c->ldv, W, c->ldw);
+	for (i = 0; i < jb; ++i) {
+		for (j = 0; j < nc; ++j) { C[(size_t)i * c->ldc + j] -= W[(size_t)i * c->ldw + j]; }
+	}
+}
+
+/* Applies the block of jb reflectors at QR(j0, j0) to the rows j0 onwards of
+the cols columns of C, in parallel over the columns. W has jb x cols floats. */
+static void bdla_qr_apply_block(bdla_Mxf QR, bdla_Mxf T, int j0, int jb,
+	float *C, int ldc, int cols, float *W) {
+	bdla_QrApplyCtx c;
+	c.V = QR.arr + (size_t)j0 * QR.dims[1] + j0;
+	c.T = T.arr + j0;
+	c.C = C + (size_t)j0 * ldc;
+	c.W = W;
+	c.ldv = QR.dims[1];
+	c.ldt = T.dims[1];
+	c.ldc = ldc;
+	c.ldw = cols;
+	c.rows = QR.dims[0] - j0;
+	c.jb = jb;
+	bdla_parallel_for(cols, BDLA_QR_BLOCK, bdla_qr_apply_cols, &c);
+}
+
+/* C = Q^T C for the rows x cols C, rows being QR's row count. */
+static bdla_Status bdla_qr_qt(bdla_Mxf QR, bdla_Mxf T, float *C, int ldc, int cols) {
+	int k = T.dims[1], nb = T.dims[0], j0;
+	float *W = malloc(sizeof(float) * nb * cols);
+	if (W == NULL) { return BDLA_MEM_ERROR; }
+	for (j0 = 0; j0 < k; j0 += nb) {
+		bdla_qr_apply_block(QR, T, j0, k - j0 < nb ? k - j0 : nb, C, ldc, cols, W);
+	}
+	free(W);
+	return BDLA_GOOD;
+}
+
+/* Checks T belongs with QR. */
+static bdla_Status bdla_qr_checkargs(bdla_Mxf QR, bdla_Mxf T) {
+	int k = QR.dims[0] < QR.dims[1] ? QR.dims[0] : QR.dims[1];
+	if (T.dims[1] != k || T.dims[0] < 1 || T.dims[0] > k) { return BDLA_DIMENSION_MISMATCH; }
+	return BDLA_GOOD;
+}
+
+/* Solves R X = C(0 : n, :) for the cols columns of C. */
+static bdla_Status bdla_qr_rsolve(bdla_Mxf QR, float *C, int ldc, int cols) {
+	int n = QR.dims[1], j;
+	for (j = 0; j < n; ++j) {
+		if (QR.arr[(size_t)j * n + j] == 0.f) { return BDLA_BAD_PROPERTY; }
+	}
+	cblas_strsm(CblasRowMajor, CblasLeft, CblasUpper, CblasNoTrans, CblasNonUnit, n, cols,
+		1.f, QR.arr, n, C, ldc);
+	return BDLA_GOOD;
+}
+
+BDLA_EXPORT bdla_Status bdla_Mxf_qr(bdla_Mxf *A, bdla_Mxf *T) {
+	assert(A != NULL);
+	assert(A->arr != NULL);
+	assert(T != NULL);
+	assert(T->arr != NULL);
+	int m = A->dims[0], n = A->dims[1], k = m < n ? m : n;
+	int nb = k < BDLA_QR_BLOCK ? k : BDLA_QR_BLOCK, j0, jb;
+	float *W, *P;
+	if ((T->dims[0] != nb || T->dims[1] != k) && bdla_Mxf_resize(T, nb, k) != BDLA_GOOD) {
+		return BDLA_MEM_ERROR;
+	}
+	bdla_Mxf_zero(T);
+	W = malloc(sizeof(float) * nb * n);
+	P = malloc(sizeof(float) * nb * (m + 2 * nb));
+	if (W == NULL || P == NULL) {
+		free(W);
+		free(P);
+		return BDLA_MEM_ERROR;
+	}
+	for (j0 = 0; j0 < k; j0 += nb) {
+		jb = k - j0 < nb ? k - j0 : nb;
+		bdla_qr_panel(A->arr + (size_t)j0 * n + j0, n, m - j0, jb, T->arr + j0, k, P);
+		if (j0 + jb < n) {
+			bdla_qr_apply_block(*A, *T, j0, jb, A->arr + j0 + jb, n, n - j0 - jb, W);
+		}
+	}
+	free(W);
+	free(P);
+	return BDLA_GOOD;
+}
+
+BDLA_EXPORT bdla_Status bdla_Mxf_qtmult(bdla_Mxf QR, bdla_Mxf T, bdla_Mxf *B) {
+	assert(QR.arr != NULL);
+	assert(T.arr != NULL);
+	assert(B != NULL);
+	assert(B->arr != NULL);
+	bdla_Status stat = bdla_qr_checkargs(QR, T);
+	if (stat != BDLA_GOOD) { return stat; }
+	if (B->dims[0] != QR.dims[0]) { return BDLA_DIMENSION_MISMATCH; }
+	return bdla_qr_qt(QR, T, B->arr, B->dims[1], B->dims[1]);
+}
+
+BDLA_EXPORT bdla_Status bdla_Mxf_vqtmult(bdla_Mxf QR, bdla_Mxf T, bdla_Vxf *b) {
+	assert(QR.arr != NULL);
+	assert(T.arr != NULL);
+	assert(b != NULL);
+	assert(b->arr != NULL);
+	bdla_Status stat = bdla_qr_checkargs(QR, T);
+	if (stat != BDLA_GOOD) { return stat; }
+	if (b->len != QR.dims[0]) { return BDLA_DIMENSION_MISMATCH; }
+	return bdla_qr_qt(QR, T, b->arr, 1, 1);
+}
+
+BDLA_EXPORT bdla_Status bdla_Mxf_qrsolve(bdla_Mxf QR, bdla_Mxf T, bdla_Mxf *B) {
+	assert(QR.arr != NULL);
+	assert(T.arr != NULL);
+	assert(B != NULL);
+	assert(B->arr != NULL);
+	bdla_Status stat = bdla_qr_checkargs(QR, T);
+	if (stat != BDLA_GOOD) { return stat; }
+	if (QR.dims[0] < QR.dims[1] || B->dims[0] != QR.dims[0]) { return BDLA_DIMENSION_MISMATCH; }
+	stat = bdla_qr_qt(QR, T, B->arr, B->dims[1], B->dims[1]);
+	if (stat != BDLA_GOOD) { return stat; }
+	return bdla_qr_rsolve(QR, B->arr, B->dims[1], B->dims[1]);
+}
+
+BDLA_EXPORT bdla_Status bdla_Mxf_vqrsolve(bdla_Mxf QR, bdla_Mxf T, bdla_Vxf *b) {
+	assert(QR.arr != NULL);
+	assert(T.arr != NULL);
+	assert(b != NULL);
+	assert(b->arr != NULL);
+	bdla_Status stat = bdla_qr_checkargs(QR, T);
+	if (stat != BDLA_GOOD) { return stat; }
+	if (QR.dims[0] < QR.dims[1] || b->len != QR.dims[0]) { return BDLA_DIMENSION_MISMATCH; }
+	stat = bdla_qr_qt(QR, T, b->arr, 1, 1);
+	if (stat != BDLA_GOOD) { return stat; }
+	return bdla_qr_rsolve(QR, b->arr, 1, 1);
+}
@@ -0,0 +1,351 @@
+#include "libbdla.h"
+/*============================================================================
+linsolve_sstep.c
+
+s-step conjugate gradients. Each block of s steps is taken from a basis of s
+products with A, and all of its inner products are gathered in one pass.
+
+Copyright(c) 2019 HJA Bird
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files(the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions :
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+============================================================================*/
+#include <assert.h>
+#include <math.h>
+#include <stdlib.h>
+
+#include <openblas/cblas.h>
+
+#include "eigsolve_common.h"
+#include "linsolve_common.h"
+#include "threadpool.h"
+
+/* Most steps in a block. The basis is close to a monomial one, whose
+columns become dependent quickly in single precision. */
+#define BDLA_SSTEP_MAX 8
+/* Rows per chunk of the inner products. Chunks are summed in single
+precision by gemm and across chunks in double. */
+#define BDLA_SSTEP_CHUNK 1024
+/* Leading dimension of the small row-major matrices. */
+#define BDLA_SSTEP_LD (BDLA_SSTEP_MAX + 1)
+
+/* Everything n-long is a column of Y = [AP | R], both column-major. AP
+holds A times the previous block's directions, and R = [r_0 ... r_s] the
+basis r_0 = r, r_{j+1} = (A r_j - theta r_j) / sigma, so that
+A R(:, 0 : s) = R T for the (s + 1) x s bidiagonal T. */
+typedef struct {
+	float *Y, *P, *x, *partial;
+	const float *B, *a;	/* sp x sc conjugation, and sc step lengths */
+	float theta, sigma;
+	int n, s, sp, sc;
+} bdla_SstepCtx;
+
+/* r_{j+1} = (r_{j+1} - theta r_j) / sigma, with r_{j+1} holding A r_j. */
+static void bdla_sstep_basis(void *ctx, int begin, int end) {
+	bdla_SstepCtx *c = ctx;
+	const float *rj = c->Y + (size_t)(c->s + c->sc) * c->n;
+	float *rj1 = (float *)rj + c->n, inv = 1.f / c->sigma;
+	int i;
+	for (i = begin; i < end; ++i) { rj1[i] = (rj1[i] - c->theta * rj[i]) * inv; }
+}
+
+/* Chunk k's part of Y(:, 0 : s + sc + 1)^T R(:, 0 : sc + 1). */
+static void bdla_sstep_gram(void *ctx, int begin, int end) {
+	bdla_SstepCtx *c = ctx;
+	int k, i0, rows, ld = 2 * c->s + 1;
+	for (k = begin; k < end; ++k) {
+		i0 = k * BDLA_SSTEP_CHUNK;
+		rows = c->n - i0 < BDLA_SSTEP_CHUNK ? c->n - i0 : BDLA_SSTEP_CHUNK;
+		cblas_sgemm(CblasColMajor, CblasTrans, CblasNoTrans, c->s + c->sc + 1, c->sc + 1, rows,
+			1.f, c->Y + i0, c->n, c->Y + (size_t)c->s * c->n + i0, c->n, 0.f,
+			c->partial + (size_t)k * ld * (c->s + 1), ld);
+	}
+}
+
+/* P = R(:, 0 : sc) + P B, AP = R T + AP B, x += P a and r -= AP a, a row
+at a time so that it's one pass and in place. */
+static void bdla_sstep_update(void *ctx, int begin, int end) {
+	bdla_SstepCtx *c = ctx;
+	float p[BDLA_SSTEP_MAX], ap[BDLA_SSTEP_MAX], dx, dr;
+	const float *R = c->Y + (size_t)c->s * c->n;
+	size_t n = c->n;
+	int i, j, l;
+	for (i = begin; i < end; ++i) {
+		dx = dr = 0.f;
+		for (j = 0; j < c->sc; ++j) {
+			p[j] = R[j * n + i];
+			ap[j] = c->theta * R[j * n + i] + c->sigma * R[(j + 1) * n + i];
+			for (l = 0; l < c->sp; ++l) {
+				p[j] += c->P[l * n + i] * c->B[j * c->s + l];
+				ap[j] += c->Y[l * n + i] * c->B[j * c->s + l];
+			}
+			dx += p[j] * c->a[j];
+			dr += ap[j] * c->a[j];
+		}
+		for (j = 0; j < c->sc; ++j) {
+			c->P[j * n + i] = p[j];
+			c->Y[j * n + i] = ap[j];
+		}
+		c->x[i] += dx;
+		c->Y[(size_t)c->s * n + i] -= dr;
+	}
+}
+
+/* Cholesky of the m x m W into L, stopping at the first pivot too small to
+trust. Returns how many columns it got through. */
+static int bdla_sstep_cholesky(const double *W, int m, double *L) {
+	const int ld = BDLA_SSTEP_LD;
+	double d;
+	int i, j, k;
+	for (j = 0; j < m; ++j) {
+		d = W[j * ld + j];
+		for (k = 0; k < j; ++k) { d -= L[j * ld + k] * L[j * ld + k]; }
+		if (!(d > 1e-6 * W[j * ld + j])) { return j; }
+		L[j * ld + j] = sqrt(d);
+		for (i = j + 1; i < m; ++i) {
+			d = W[i * ld + j];
+			for (k = 0; k < j; ++k) { d -= L[i * ld + k] * L[j * ld + k]; }
+			L[i * ld + j] = d / L[j * ld + j];
+		}
+	}
+	return m;
+}
+
+/* x = (L L^T)^-1 x for the m x m L from bdla_sstep_cholesky. */
+static void bdla_sstep_cholsolve(const double *L, int m, double *x) {
+	const int ld = BDLA_SSTEP_LD;
+	int i, k;
+	for (i = 0; i < m; ++i) {
+		for (k = 0; k < i; ++k) { x[i] -= L[i * ld + k] * x[k]; }
+		x[i] /= L[i * ld + i];
+	}
+	for (i = m - 1; i >= 0; --i) {
+		for (k = i + 1; k < m; ++k) { x[i] -= L[k * ld + i] * x[k]; }
+		x[i] /= L[i * ld + i];
+	}
+}
+
+/* Widens [*lo, *hi] to take in the Ritz values of A on span R(:, 0 : m),
+from the Gram matrix G of R and RAR = R^T A R. */
+static void bdla_sstep_ritz(const double *G, const double *RAR, int m,
+	double *lo, double *hi) {
+	const int ld = BDLA_SSTEP_LD;
+	double L[BDLA_SSTEP_LD * BDLA_SSTEP_LD], M[BDLA_SSTEP_MAX * BDLA_SSTEP_MAX];
+	double Q[BDLA_SSTEP_MAX * BDLA_SSTEP_MAX], w[BDLA_SSTEP_MAX];
+	int i, j, k;
+	m = bdla_sstep_cholesky(G, m, L);
+	if (m == 0) { return; }
+	/* M = L^-1 RAR L^-T, by columns then rows. */
+	for (j = 0; j < m; ++j) {
+		for (i = 0; i < m; ++i) {
+			M[i * m + j] = RAR[i * ld + j];
+			for (k = 0; k < i; ++k) { M[i * m + j] -= L[i * ld + k] * M[k * m + j]; }
+			M[i * m + j] /= L[i * ld + i];
+		}
+	}
+	for (i = 0; i < m; ++i) {
+		for (j = 0; j < m; ++j) {
+			for (k = 0; k < j; ++k) { M[i * m + j] -= L[j * ld + k] * M[i * m + k]; }
+			M[i * m + j] /= L[j * ld + j];
+		}
+	}
+	bdla_eigsolve_jacobi(M, m, w, Q);
+	for (i = 0; i < m; ++i) {
+		*lo = w[i] < *lo ? w[i] : *lo;
+		*hi = w[i] > *hi ? w[i] : *hi;
+	}
+}
+
+static bdla_Status bdla_solve_cg_sstep(bdla_Matvec matvec, const void *A, int rows, int cols,
+	bdla_Vxf b, bdla_Vxf *y, int s, float tol, bdla_Vxf *guess, int *max_iter) {
+	bdla_Status stat = bdla_linsolve_checkargs(rows, cols, b, guess, &tol);
+	if (stat != BDLA_GOOD) { return stat; }
+	const int ld = BDLA_SSTEP_LD;
+	int n = rows, nchunks = (rows + BDLA_SSTEP_CHUNK - 1) / BDLA_SSTEP_CHUNK;
+	int grain = bdla_parallel_grain(4 * (size_t)s * s), i, j, k, l, q;
+	/* G(i, j) = Y(:, i)^T R(:, j), and Gr its rows for R. */
+	double G[(2 * BDLA_SSTEP_MAX + 1) * BDLA_SSTEP_LD], *Gr = G + s * ld;
+	double RAR[BDLA_SSTEP_LD * BDLA_SSTEP_LD], W[BDLA_SSTEP_LD * BDLA_SSTEP_LD];
+	double L[BDLA_SSTEP_LD * BDLA_SSTEP_LD], Bd[BDLA_SSTEP_LD * BDLA_SSTEP_LD];
+	double ad[BDLA_SSTEP_MAX], lo = 0., hi = 0., mean, spread;
+	float B[BDLA_SSTEP_MAX * BDLA_SSTEP_MAX], a[BDLA_SSTEP_MAX];
+	bdla_Vxf x = bdla_linsolve_initialx(b, guess);
+	bdla_Vxf r = { n, NULL }, rnext = { n, NULL };
+	bdla_SstepCtx c;
+	bdla_IterMonitor mon;
+	bdla_itermonitor_init(&mon, b, tol, max_iter);
+	c.Y = calloc((size_t)n * (2 * s + 1), sizeof(float));
+	c.P = malloc(sizeof(float) * n * s);
+	c.partial = malloc(sizeof(float) * nchunks * (2 * s + 1) * (s + 1));
+	if (c.Y == NULL || c.P == NULL || c.partial == NULL) {
+		stat = BDLA_MEM_ERROR;
+		goto cleanup;
+	}
+	c.x = x.arr;
+	c.B = B;
+	c.a = a;
+	c.n = n;
+	c.s = s;
+	/* The first block is a single step from the monomial basis, which
+	gives the Rayleigh quotient and spread of A to shift and scale the
+	later bases by. */
+	c.theta = 0.f;
+	c.sigma = 1.f;
+	c.sp = 0;
+	c.sc = 1;
+
+	/* r = b - A x */
+	r.arr = c.Y + (size_t)s * n;
+	matvec(A, x, &r);
+	for (i = 0; i < n; ++i) { r.arr[i] = b.arr[i] - r.arr[i]; }
+	for (;;) {
+		k = c.sc;
+		for (c.sc = 0; c.sc < k; ++c.sc) {
+			r.arr = c.Y + (size_t)(s + c.sc) * n;
+			rnext.arr = r.arr + n;
+			matvec(A, r, &rnext);
+			bdla_parallel_for_static(n, bdla_parallel_grain(2), bdla_sstep_basis, &c);
+		}
+		/* The only reduction of the block. */
+		bdla_parallel_for(nchunks, 1, bdla_sstep_gram, &c);
+		for (i = 0; i < s + c.sc + 1; ++i) {
+			for (j = 0; j <= c.sc; ++j) {
+				G[i * ld + j] = 0.;
+				for (l = 0; l < nchunks; ++l) {
+					G[i * ld + j] += c.partial[((size_t)l * (s + 1) + j) * (2 * s + 1) + i];
+				}
+			}
+		}
+		if (bdla_itermonitor_done(&mon, (float)sqrt(Gr[0]))) { break; }
+		mon.iter += c.sc - 1;
+
+		/* R^T A R = Gr T, and the conjugation against the previous block is
+		B = -W_old^-1 AP^T R. */
+		for (i = 0; i < c.sc; ++i) {
+			for (j = 0; j < c.sc; ++j) {
+				RAR[i * ld + j] = c.theta * Gr[i * ld + j] + c.sigma * Gr[i * ld + j + 1];
+			}
+		}
+		/* If rounding has cost the block its conjugacy to the previous one,
+		restart from the residual basis alone, as CG would on a restart. */
+	conjugate:
+		for (j = 0; j < c.sc; ++j) {
+			for (l = 0; l < c.sp; ++l) { ad[l] = -G[l * ld + j]; }
+			bdla_sstep_cholsolve(L, c.sp, ad);
+			for (l = 0; l < c.sp; ++l) { Bd[l * ld + j] = ad[l]; }
+		}
+		/* W = P^T A P = R^T A R + R^T AP B, symmetrised. */
+		for (i = 0; i < c.sc; ++i) {
+			for (j = 0; j < c.sc; ++j) {
+				W[i * ld + j] = RAR[i * ld + j];
+				for (l = 0; l < c.sp; ++l) { W[i * ld + j] += G[l * ld + i] * Bd[l * ld + j]; }
+			}
+		}
+		for (i = 0; i < c.sc; ++i) {
+			for (j = 0; j < i; ++j) {
+				W[i * ld + j] = W[j * ld + i] = 0.5 * (W[i * ld + j] + W[j * ld + i]);
+			}
+		}
+		/* Steps along P: W a = P^T r = R^T r. Directions the basis can't
+		resolve are dropped. */
+		q = bdla_sstep_cholesky(W, c.sc, L);
+		if (q == 0 && c.sp > 0) {
+			c.sp = 0;
+			goto conjugate;
+		}
+		if (q == 0) {
+			stat = BDLA_BAD_PROPERTY;	/* Not positive definite. */
+			break;
+		}
+		for (j = 0; j < q; ++j) { ad[j] = Gr[j * ld]; }
+		bdla_sstep_cholsolve(L, q, ad);
+		for (j = 0; j < c.sc; ++j) {
+			a[j] = j < q ? (float)ad[j] : 0.f;
+			for (l = 0; l < c.sp; ++l) { B[j * s + l] = (float)Bd[l * ld + j]; }
+		}
+
+		/* Spectrum estimates for the next basis. */
+		if (c.sp == 0 && c.sc == 1) {
+			mean = RAR[0] / Gr[0];
+			spread = Gr[ld + 1] / Gr[0] - mean * mean;
+			spread = spread > 0. ? sqrt(spread) : 0.;
+			lo = mean - spread;
+			hi = mean + spread;
+		} else {
+			bdla_sstep_ritz(Gr, RAR, c.sc, &lo, &hi);
+		}
+		bdla_parallel_for_static(n, grain, bdla_sstep_update, &c);
+		c.sp = q;
+		c.sc = s;
+		c.theta = (float)(0.5 * (hi + lo));
+		c.sigma = (float)(0.5 * (hi - lo));
+		if (!(c.sigma > 1e-3f * fabsf(c.theta))) {
+			c.sigma = c.theta != 0.f ? fabsf(c.theta) : 1.f;
+		}
+	}
+
+	if (stat == BDLA_GOOD) { bdla_Vxf_copyin(y, x); }
+cleanup:
+	bdla_Vxf_release(&x);
+	free(c.Y);
+	free(c.P);
+	free(c.partial);
+	return stat;
+}
+
+BDLA_EXPORT bdla_Status bdla_Mxf_solve_cg_sstep(bdla_Mxf A, bdla_Vxf b, bdla_Vxf *y,
+	int s, float tol, bdla_Vxf *guess, int *max_iter) {
+	assert(A.arr != NULL);
+	assert(b.arr != NULL);
+	assert(y != NULL);
+	assert(y->arr != NULL);
+	assert(s > 0 && s <= BDLA_SSTEP_MAX);
+	assert(tol != 0.f);
+	assert(guess != NULL ? (guess->arr != NULL && guess->len > 0) : 1);
+	assert(max_iter != NULL ? *max_iter > 0 : 1);
+	return bdla_solve_cg_sstep(bdla_matvec_Mxf, &A, A.dims[0], A.dims[1], b, y,
+		s, tol, guess, max_iter);
+}
+
+BDLA_EXPORT bdla_Status bdla_SMxf_solve_cg_sstep(bdla_SMxf A, bdla_Vxf b, bdla_Vxf *y,
+	int s, float tol, bdla_Vxf *guess, int *max_iter) {
+	assert(A.arr != NULL);
+	assert(b.arr != NULL);
+	assert(y != NULL);
+	assert(y->arr != NULL);
+	assert(s > 0 && s <= BDLA_SSTEP_MAX);
+	assert(tol != 0.f);
+	assert(guess != NULL ? (guess->arr != NULL && guess->len > 0) : 1);
+	assert(max_iter != NULL ? *max_iter > 0 : 1);
+	return bdla_solve_cg_sstep(bdla_matvec_SMxf, &A, A.dims[0], A.dims[1], b, y,
+		s, tol, guess, max_iter);
+}
+
+BDLA_EXPORT bdla_Status bdla_HMxf_solve_cg_sstep(bdla_HMxf A, bdla_Vxf b, bdla_Vxf *y,
+	int s, float tol, bdla_Vxf *guess, int *max_iter) {
+	assert(A.arr != NULL);
+	assert(b.arr != NULL);
+	assert(y != NULL);
+	assert(y->arr != NULL);
+	assert(s > 0 && s <= BDLA_SSTEP_MAX);
+	assert(tol != 0.f);
+	assert(guess != NULL ? (guess->arr != NULL && guess->len > 0) : 1);
+	assert(max_iter != NULL ? *max_iter > 0 : 1);
+	return bdla_solve_cg_sstep(bdla_matvec_HMxf, &A, A.dims[0], A.dims[1], b, y,
+		s, tol, guess, max_iter);
+}
@@ -26,8 +26,18 @@ SOFTWARE.
 ============================================================================*/
 #include <assert.h>
 
+#include "linsolve_common.h"
+
 BDLA_EXPORT bdla_Status bdla_Mxf_solve_gauss_seidel(
 	bdla_Mxf A, bdla_Vxf b, bdla_Vxf *y, float tol, bdla_Vxf *guess, int *max_iter) {
+	assert(tol != 0.f);
+	assert(max_iter != NULL ? *max_iter > 0 : 1);
+	bdla_SolveOptions opts = bdla_linsolve_options(tol, max_iter);
+	return bdla_Mxf_solve_gauss_seidel_ext(A, b, y, guess, &opts, NULL);
+}
+
+BDLA_EXPORT bdla_Status bdla_Mxf_solve_gauss_seidel_ext(bdla_Mxf A, bdla_Vxf b, bdla_Vxf *y,
+	bdla_Vxf *guess, const bdla_SolveOptions *opts, bdla_SolveResult *result) {
 	assert(A.arr != NULL);
 	assert(A.dims[0] > 0);
 	assert(A.dims[0] > 0);
@@ -35,47 +45,125 @@ BDLA_EXPORT bdla_Status bdla_Mxf_solve_gauss_seidel(
 	assert(b.len >= 0);
 	assert(y != NULL);
 	assert(y->arr != NULL);
-	assert(tol != 0.f);
 	assert(guess != NULL ? (guess->arr != NULL && guess->len > 0) : 1);
-	assert(max_iter != NULL ? *max_iter > 0 : 1);
+	bdla_SolveOptions o = opts != NULL ? *opts : bdla_SolveOptions_default();
+	bdla_linsolve_checkopts(&o);
 	/* Check shapes */
-	if (!bdla_Mxf_issquare(A)) { return BDLA_NONSQUARE; }
-	if (b.len != A.dims[0]) { return BDLA_DIMENSION_MISMATCH; }
-	if (guess != NULL && guess->len != b.len) { return BDLA_DIMENSION_MISMATCH; }
-	if (tol > 1.f) { tol = 1e-6; }
+	bdla_Status stat = bdla_linsolve_checkargs(A.dims[0], A.dims[1], b, guess, &o.rtol);
+	if (stat != BDLA_GOOD) { return stat; }
 
-	bdla_Vxf x;
-	if (guess != NULL) {
-		x = bdla_Vxf_copy(*guess);
-	}
-	else {
-		x = bdla_Vxf_create(b.len);
-		bdla_Vxf_zero(&x);
-	}
+	bdla_Vxf x = bdla_linsolve_initialx(b, guess);
 	bdla_Mxf Ls = bdla_Mxf_create(A.dims[0], A.dims[1]);	/* Lower & diag matrix*/
 	bdla_Mxf U = bdla_Mxf_create(A.dims[0], A.dims[1]);		/* Upper matrix*/
 	bdla_Mxf_tri(A, 0, BDLA_MATRIX_TRI_LOWER, &Ls);
 	bdla_Mxf_tri(A, 1, BDLA_MATRIX_TRI_UPPER, &U);
-	bdla_Vxf diff = bdla_Vxf_create(A.dims[0]);
-	float relerror = 9999999999.f;
-	float bnorm = bdla_Vxf_norm2(b);
-	int iter = 0;
+	bdla_Vxf rhs = bdla_Vxf_create(A.dims[0]);
+	bdla_Vxf xold = bdla_Vxf_create(A.dims[0]);
+	float rnorm, dxnorm, xnorm = 0.f;
+	bdla_IterMonitor mon;
+	bdla_itermonitor_init_ext(&mon, b, &o);
 
 	do {
-		bdla_Mxf_vmult(U, x, &x);
-		bdla_Vxf_minus(b, x, &x);
-		bdla_Mxf_vtrisolve(Ls, BDLA_MATRIX_TRI_LOWER, x, &x);
-		bdla_Mxf_vmult(A, x, &diff);
-		bdla_Vxf_minus(diff, b, &diff);
-		relerror = bdla_Vxf_norm2(diff) / bnorm;
-		if (max_iter != NULL && iter >= *max_iter) { break; }
-		++iter;
-	} while (relerror > tol);
+		/* x = Ls^-1 (b - U x) */
+		bdla_Vxf_copyin(&rhs, b);
+		bdla_Mxf_gemv(-1.f, U, BDLA_NO_TRANS, x, 1.f, &rhs);
+		dxnorm = -1.f;
+		if (bdla_itermonitor_due(&mon, BDLA_CONVERGE_UPDATE)) {
+			bdla_Vxf_copyin(&xold, x);
+			bdla_Mxf_vtrisolve(Ls, BDLA_MATRIX_TRI_LOWER, rhs, &x);
+			bdla_linsolve_diffnorm(A.dims[0], x.arr, xold.arr, &dxnorm, &xnorm);
+		}
+		else {
+			bdla_Mxf_vtrisolve(Ls, BDLA_MATRIX_TRI_LOWER, rhs, &x);
+		}
+		rnorm = -1.f;
+		if (bdla_itermonitor_due(&mon, BDLA_CONVERGE_RESIDUAL)) {
+			bdla_Mxf_residual(A, x, b, NULL, &rnorm);
+		}
+	} while (!bdla_itermonitor_done_ext(&mon, rnorm, dxnorm, xnorm));
 
+	if (bdla_itermonitor_needs_residual(&mon, result)) {
+		bdla_Mxf_residual(A, x, b, NULL, &mon.resnorm);
+	}
+	bdla_itermonitor_report(&mon, result);
 	bdla_Vxf_copyin(y, x);
 	bdla_Vxf_release(&x);
-	bdla_Vxf_release(&diff);
+	bdla_Vxf_release(&rhs);
+	bdla_Vxf_release(&xold);
 	bdla_Mxf_release(&Ls);
 	bdla_Mxf_release(&U);
 	return BDLA_GOOD;
 }
+
+BDLA_EXPORT bdla_Status bdla_SMxf_solve_gauss_seidel(
+	bdla_SMxf A, bdla_Vxf b, bdla_Vxf *y, float tol, bdla_Vxf *guess, int *max_iter) {
+	assert(tol != 0.f);
+	assert(max_iter != NULL ? *max_iter > 0 : 1);
+	bdla_SolveOptions opts = bdla_linsolve_options(tol, max_iter);
+	return bdla_SMxf_solve_gauss_seidel_ext(A, b, y, guess, &opts, NULL);
+}
+
+BDLA_EXPORT bdla_Status bdla_SMxf_solve_gauss_seidel_ext(bdla_SMxf A, bdla_Vxf b, bdla_Vxf *y,
+	bdla_Vxf *guess, const bdla_SolveOptions *opts, bdla_SolveResult *result) {
+	assert(A.arr != NULL);
+	assert(A.dims[0] > 0);
+	assert(A.dims[1] > 0);
+	assert(b.arr != NULL);
+	assert(b.len >= 0);
+	assert(y != NULL);
+	assert(y->arr != NULL);
+	assert(guess != NULL ? (guess->arr != NULL && guess->len > 0) : 1);
+	bdla_SolveOptions o = opts != NULL ? *opts : bdla_SolveOptions_default();
+	bdla_linsolve_checkopts(&o);
+	/* Check shapes */
+	bdla_Status stat = bdla_linsolve_checkargs(A.dims[0], A.dims[1], b, guess, &o.rtol);
+	if (stat != BDLA_GOOD) { return stat; }
+	int i, k, n = A.dims[0];
+	bdla_Vxf diag = bdla_Vxf_create(n);
+	bdla_SMxf_diag(A, &diag);
+	for (i = 0; i < n; ++i) {
+		if (diag.arr[i] == 0.f) {
+			bdla_Vxf_release(&diag);
+			return BDLA_BAD_PROPERTY;
+		}
+	}
+	bdla_Vxf x = bdla_linsolve_initialx(b, guess);
+	float rnorm, dxnorm, xnorm;
+	double dd, xx, d;
+	bdla_IterMonitor mon;
+	bdla_itermonitor_init_ext(&mon, b, &o);
+
+	do {
+		/* Forward sweep in place: each row sees the already updated values
+		of the rows before it. This is inherently sequential. */
+		dd = xx = 0.;
+		for (i = 0; i < n; ++i) {
+			float acc = b.arr[i];
+			for (k = A.row_ptr[i]; k < A.row_ptr[i + 1]; ++k) {
+				if (A.col_idx[k] != i) {
+					acc -= A.arr[k] * x.arr[A.col_idx[k]];
+				}
+			}
+			acc /= diag.arr[i];
+			d = (double)acc - x.arr[i];
+			dd += d * d;
+			xx += (double)acc * acc;
+			x.arr[i] = acc;
+		}
+		dxnorm = (float)sqrt(dd);
+		xnorm = (float)sqrt(xx);
+		rnorm = -1.f;
+		if (bdla_itermonitor_due(&mon, BDLA_CONVERGE_RESIDUAL)) {
+			bdla_SMxf_residual(A, x, b, NULL, &rnorm);
+		}
+	} while (!bdla_itermonitor_done_ext(&mon, rnorm, dxnorm, xnorm));
+
+	if (bdla_itermonitor_needs_residual(&mon, result)) {
+		bdla_SMxf_residual(A, x, b, NULL, &mon.resnorm);
+	}
+	bdla_itermonitor_report(&mon, result);
+	bdla_Vxf_copyin(y, x);
+	bdla_Vxf_release(&x);
+	bdla_Vxf_release(&diag);
+	return BDLA_GOOD;
+}
@@ -0,0 +1,444 @@
+#include "libbdla.h"
+/*============================================================================
+svd_jacobi.c
+
+Singular value decomposition by one-sided Jacobi, with column pairs
+rotated in parallel.
+
+Copyright(c) 2019 HJA Bird
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files(the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions :
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+============================================================================*/
+#include <assert.h>
+#include <float.h>
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <openblas/cblas.h>
+
+#include "eigsolve_common.h"
+#include "householder.h"
+#include "threadpool.h"
+
+/* Sweeps over every column pair before giving up on convergence. */
+#define BDLA_SVD_SWEEPS 60
+/* Blocks of columns are kept to about this many floats, so that a pair of
+blocks stays in cache while every column pair between them is rotated. */
+#define BDLA_SVD_BLOCK_FLOATS 16384
+/* Rows of A taken at a time when only R of A = QR is wanted. */
+#define BDLA_SVD_STREAM_ROWS 256
+
+/* The matrix decomposed is B, which is A when A is tall and A^T when it's
+wide, so B never has more columns than rows. Element (i, j) of B is
+src[i * rs + j * cs]. Everything inside is column-major, so columns are
+contiguous. */
+
+/* Copies rows [r0, r0 + rows) of B into dst, with leading dimension ld. */
+static void bdla_svd_gather(const float *src, int rs, int cs, int r0, int rows,
+	int cols, float *dst, int ld) {
+	int ib, jb, i, j, ie, je;
+	for (ib = 0; ib < rows; ib += 32) {
+		ie = ib + 32 < rows ? ib + 32 : rows;
+		for (jb = 0; jb < cols; jb += 32) {
+			je = jb + 32 < cols ? jb + 32 : cols;
+			for (i = ib; i < ie; ++i) {
+				for (j = jb; j < je; ++j) {
+					dst[(size_t)j * ld + i] = src[(size_t)(r0 + i) * rs + (size_t)j * cs];
+				}
+			}
+		}
+	}
+}
+
+/* Row-major rows x cols dst gets the columns idx[0], idx[1]... of W, or
+the columns in order if idx is NULL. */
+static void bdla_svd_scatter(const float *W, int ld, int rows, int cols,
+	const int *idx, float *dst) {
+	int ib, jb, i, j, ie, je;
+	const float *w;
+	for (jb = 0; jb < cols; jb += 32) {
+		je = jb + 32 < cols ? jb + 32 : cols;
+		for (ib = 0; ib < rows; ib += 32) {
+			ie = ib + 32 < rows ? ib + 32 : rows;
+			for (j = jb; j < je; ++j) {
+				w = W + (size_t)(idx != NULL ? idx[j] : j) * ld;
+				for (i = ib; i < ie; ++i) { dst[(size_t)i * cols + j] = w[i]; }
+			}
+		}
+	}
+}
+
+/* Householder QR ----------------------------------------------------------*/
+typedef struct {
+	float *head, *tail;	/* first element and rest of each column */
+	const float *v;		/* reflector tail */
+	int ldh, ldt, len, first;
+	float tau;
+} bdla_SvdReflectCtx;
+
+/* Applies I - tau [1; v] [1; v]^T to columns first + [begin, end). */
+static void bdla_svd_reflect(void *ctx, int begin, int end) {
+	bdla_SvdReflectCtx *c = ctx;
+	float w, *h, *t;
+	int col;
+	for (col = c->first + begin; col < c->first + end; ++col) {
+		h = c->head + (size_t)col * c->ldh;
+		t = c->tail + (size_t)col * c->ldt;
+		w = c->tau * (*h + cblas_sdot(c->len, c->v, 1, t, 1));
+		*h -= w;
+		cblas_saxpy(c->len, -w, c->v, 1, t, 1);
+	}
+}
+
+/* B = QR in place, reflector j being left below the diagonal of column j. */
+static void bdla_svd_qr(float *B, int ld, int rows, int cols, float *tau) {
+	bdla_SvdReflectCtx c;
+	float *x;
+	int j;
+	for (j = 0; j < cols; ++j) {
+		x = B + (size_t)j * ld + j;
+		tau[j] = bdla_householder(rows - j, x, x + 1, 1);
+		if (tau[j] == 0.f || j == cols - 1) { continue; }
+		c.head = B + j;
+		c.tail = B + j + 1;
+		c.ldh = c.ldt = ld;
+		c.v = x + 1;
+		c.len = rows - j - 1;
+		c.first = j + 1;
+		c.tau = tau[j];
+		bdla_parallel_for(cols - j - 1, bdla_parallel_grain(4 * (size_t)c.len),
+			bdla_svd_reflect, &c);
+	}
+}
+
+/* U = Q U, for Q from bdla_svd_qr. */
+static void bdla_svd_apply_q(const float *B, int ld, int rows, int cols,
+	const float *tau, float *U, int ldu) {
+	bdla_SvdReflectCtx c;
+	int j;
+	for (j = cols - 1; j >= 0; --j) {
+		if (tau[j] == 0.f) { continue; }
+		c.head = U + j;
+		c.tail = U + j + 1;
+		c.ldh = c.ldt = ldu;
+		c.v = B + (size_t)j * ld + j + 1;
+		c.len = rows - j - 1;
+		c.first = 0;
+		c.tau = tau[j];
+		bdla_parallel_for(cols, bdla_parallel_grain(4 * (size_t)c.len),
+			bdla_svd_reflect, &c);
+	}
+}
+
+/* Folds rows more rows of B, held in Y, into the cols x cols upper
+triangular R, so that [R; Y] = Q [R'; 0]. Only R' is kept. */
+static void bdla_svd_qr_fold(float *R, int cols, float *Y, int ldy, int rows) {
+	bdla_SvdReflectCtx c;
+	float tau;
+	int j;
+	for (j = 0; j < cols; ++j) {
+		tau = bdla_householder(rows + 1, R + (size_t)j * cols + j,
+			Y + (size_t)j * ldy, 1);
+		if (tau == 0.f || j == cols - 1) { continue; }
+		c.head = R + j;
+		c.tail = Y;
+		c.ldh = cols;
+		c.ldt = ldy;
+		c.v = Y + (size_t)j * ldy;
+		c.len = rows;
+		c.first = j + 1;
+		c.tau = tau;
+		bdla_parallel_for(cols - j - 1, bdla_parallel_grain(4 * (size_t)rows),
+			bdla_svd_reflect, &c);
+	}
+}
+
+/* One-sided Jacobi -------------------------------------------------------*/
+/* Columns are split into blocks, and each round of a sweep pairs every
+block with another so that the pairs touch different columns and can be
+rotated in parallel. A round robin over the rounds meets every pair of
+blocks once per sweep. */
+typedef struct {
+	float *W, *V;		/* columns to orthogonalise, and rotations or NULL */
+	double *norm2;		/* squared column norms of W */
+	const int *pairs;	/* blocks paired this round */
+	int *rotations;		/* rotations made by each pair */
+	int ldw, rows, cols, nb, intra;
+	double tol;
+} bdla_SvdSweepCtx;
+
+static void bdla_svd_norms(void *ctx, int begin, int end) {
+	bdla_SvdSweepCtx *c = ctx;
+	const float *w;
+	int j;
+	for (j = begin; j < end; ++j) {
+		w = c->W + (size_t)j * c->ldw;
+		c->norm2[j] = cblas_dsdot(c->rows, w, 1, w, 1);
+	}
+}
+
+/* Rotates columns p and q to be orthogonal. Returns 1 if they weren't
+already. */
+static int bdla_svd_rotate(bdla_SvdSweepCtx *c, int p, int q) {
+	float *x = c->W + (size_t)p * c->ldw, *y = c->W + (size_t)q * c->ldw;
+	double a = c->norm2[p], b = c->norm2[q], g, zeta, t, cs, sn;
+	if (a == 0. || b == 0.) { return 0; }
+	g = cblas_dsdot(c->rows, x, 1, y, 1);
+	if (fabs(g) <= c->tol * sqrt(a * b)) { return 0; }
+	zeta = (b - a) / (2. * g);
+	t = (zeta >= 0. ? 1. : -1.) / (fabs(zeta) + sqrt(1. + zeta * zeta));
+	cs = 1. / sqrt(1. + t * t);
+	sn = cs * t;
+	cblas_srot(c->rows, x, 1, y, 1, (float)cs, (float)-sn);
+	if (c->V != NULL) {
+		cblas_srot(c->cols, c->V + (size_t)p * c->cols, 1, c->V + (size_t)q * c->cols, 1,
+			(float)cs, (float)-sn);
+	}
+	/* The norm that shrinks may have lost its digits to cancellation, in
+	which case it is measured again. */
+	a -= t * g;
+	b += t * g;
+	c->norm2[p] = a < 0.25 * c->norm2[p] ? cblas_dsdot(c->rows, x, 1, x, 1) : a;
+	c->norm2[q] = b < 0.25 * c->norm2[q] ? cblas_dsdot(c->rows, y, 1, y, 1) : b;
+	return 1;
+}
+
+static void bdla_svd_pairs(void *ctx, int begin, int end) {
+	bdla_SvdSweepCtx *c = ctx;
+	int k, p, q, i0, i1, j0, j1, count;
+	for (k = begin; k < end; ++k) {
+		i0 = c->pairs[2 * k] * c->nb;
+		j0 = c->pairs[2 * k + 1] * c->nb;
+		i1 = i0 + c->nb < c->cols ? i0 + c->nb : c->cols;
+		j1 = j0 + c->nb < c->cols ? j0 + c->nb : c->cols;
+		count = 0;
+		if (c->intra) {
+			for (p = i0; p < i1; ++p) {
+				for (q = p + 1; q < i1; ++q) { count += bdla_svd_rotate(c, p, q); }
+			}
+			for (p = j0; p < j1; ++p) {
+				for (q = p + 1; q < j1; ++q) { count += bdla_svd_rotate(c, p, q); }
+			}
+		}
+		for (p = i0; p < i1; ++p) {
+			for (q = j0; q < j1; ++q) { count += bdla_svd_rotate(c, p, q); }
+		}
+		c->rotations[k] = count;
+	}
+}
+
+/* Rotates the columns of the rows x cols W until they are orthogonal,
+accumulating the rotations in the cols x cols V unless it is NULL. norm2
+gets the squared column norms. */
+static bdla_Status bdla_svd_jacobi(float *W, int ldw, int rows, int cols,
+	float *V, double *norm2) {
+	bdla_SvdSweepCtx c;
+	int nthreads = bdla_pool_nthreads(), nb, nblk, sweep, round, k, total, last;
+	int *order, *pairs, *rotations;
+	nb = BDLA_SVD_BLOCK_FLOATS / rows;
+	k = (cols + 2 * nthreads - 1) / (2 * nthreads);
+	if (nb > k) { nb = k; }
+	if (nb < 1) { nb = 1; }
+	nblk = (cols + nb - 1) / nb;
+	nblk += nblk & 1;
+	order = malloc(sizeof(int) * nblk);
+	pairs = malloc(sizeof(int) * nblk);
+	rotations = malloc(sizeof(int) * nblk);
+	if (order == NULL || pairs == NULL || rotations == NULL) {
+		free(order);
+		free(pairs);
+		free(rotations);
+		return BDLA_MEM_ERROR;
+	}
+	if (V != NULL) {
+		memset(V, 0, sizeof(float) * cols * cols);
+		for (k = 0; k < cols; ++k) { V[(size_t)k * cols + k] = 1.f; }
+	}
+	c.W = W;
+	c.V = V;
+	c.norm2 = norm2;
+	c.pairs = pairs;
+	c.rotations = rotations;
+	c.ldw = ldw;
+	c.rows = rows;
+	c.cols = cols;
+	c.nb = nb;
+	c.tol = sqrt((double)rows) * FLT_EPSILON;
+	for (sweep = 0; sweep < BDLA_SVD_SWEEPS; ++sweep) {
+		bdla_parallel_for(cols, bdla_parallel_grain(2 * (size_t)rows), bdla_svd_norms, &c);
+		for (k = 0; k < nblk; ++k) { order[k] = k; }
+		total = 0;
+		for (round = 0; round < nblk - 1; ++round) {
+			for (k = 0; k < nblk / 2; ++k) {
+				pairs[2 * k] = order[k];
+				pairs[2 * k + 1] = order[nblk - 1 - k];
+			}
+			c.intra = round == 0;
+			bdla_parallel_for(nblk / 2, 1, bdla_svd_pairs, &c);
+			for (k = 0; k < nblk / 2; ++k) { total += rotations[k]; }
+			last = order[nblk - 1];
+			memmove(order + 2, order + 1, sizeof(int) * (nblk - 2));
+			order[1] = last;
+		}
+		if (total == 0) { break; }
+	}
+	bdla_parallel_for(cols, bdla_parallel_grain(2 * (size_t)rows), bdla_svd_norms, &c);
+	free(order);
+	free(pairs);
+	free(rotations);
+	return BDLA_GOOD;
+}
+
+/* Transposes the n x n W in place. */
+static void bdla_svd_transpose(float *W, int n) {
+	float t;
+	int i, j;
+	for (j = 0; j < n; ++j) {
+		for (i = j + 1; i < n; ++i) {
+			t = W[(size_t)j * n + i];
+			W[(size_t)j * n + i] = W[(size_t)i * n + j];
+			W[(size_t)i * n + j] = t;
+		}
+	}
+}
+
+/* Column j of the rows x cols U becomes a unit vector orthogonal to
+columns [0, j), for singular values of zero. */
+static void bdla_svd_complete(float *U, int ldu, int rows, int j) {
+	float *u = U + (size_t)j * ldu, norm;
+	int e, i, pass;
+	for (e = 0; e < rows; ++e) {
+		memset(u, 0, sizeof(float) * rows);
+		u[e] = 1.f;
+		for (pass = 0; pass < 2; ++pass) {
+			for (i = 0; i < j; ++i) {
+				cblas_saxpy(rows, -cblas_sdot(rows, U + (size_t)i * ldu, 1, u, 1),
+					U + (size_t)i * ldu, 1, u, 1);
+			}
+		}
+		norm = cblas_snrm2(rows, u, 1);
+		if (norm > 0.5f) {
+			cblas_sscal(rows, 1.f / norm, u, 1);
+			return;
+		}
+	}
+}
+
+BDLA_EXPORT bdla_Status bdla_Mxf_svd(bdla_Mxf A, bdla_Vxf *s, bdla_Mxf *U, bdla_Mxf *V) {
+	assert(A.arr != NULL);
+	assert(A.dims[0] > 0 && A.dims[1] > 0);
+	assert(s != NULL);
+	assert(s->arr != NULL);
+	assert(U != NULL ? U->arr != NULL : 1);
+	assert(V != NULL ? V->arr != NULL : 1);
+	int m = A.dims[0], n = A.dims[1], tall = m >= n;
+	int rows = tall ? m : n, cols = tall ? n : m;
+	int rs = tall ? n : 1, cs = tall ? 1 : n;
+	int wrows, r0, r, j, stream = BDLA_SVD_STREAM_ROWS > cols ? BDLA_SVD_STREAM_ROWS : cols;
+	/* B's left and right singular vectors. */
+	bdla_Mxf *Ub = tall ? U : V, *Vb = tall ? V : U;
+	float *B = NULL, *tau = NULL, *W = NULL, *Y = NULL, *Vw = NULL, *Uw = NULL;
+	double *norm2 = malloc(sizeof(double) * cols);
+	int *idx = malloc(sizeof(int) * cols);
+	bdla_Status stat = BDLA_MEM_ERROR;
+	if (norm2 == NULL || idx == NULL) { goto cleanup; }
+	if (s->len != cols && bdla_Vxf_resize(s, cols) != BDLA_GOOD) { goto cleanup; }
+	if (U != NULL && (U->dims[0] != m || U->dims[1] != cols)
+		&& bdla_Mxf_resize(U, m, cols) != BDLA_GOOD) {
+		goto cleanup;
+	}
+	if (V != NULL && (V->dims[0] != n || V->dims[1] != cols)
+		&& bdla_Mxf_resize(V, n, cols) != BDLA_GOOD) {
+		goto cleanup;
+	}
+	if (Ub == NULL) {
+		/* Only R of B = QR matters to the singular values and right vectors,
+		so B is streamed through a few rows at a time. Jacobi then works on
+		R^T, which takes fewer sweeps, and its normalised columns are the
+		right singular vectors. */
+		W = calloc((size_t)cols * cols, sizeof(float));
+		Y = malloc(sizeof(float) * stream * cols);
+		if (W == NULL || Y == NULL) { goto cleanup; }
+		for (r0 = 0; r0 < rows; r0 += stream) {
+			r = rows - r0 < stream ? rows - r0 : stream;
+			bdla_svd_gather(A.arr, rs, cs, r0, r, cols, Y, stream);
+			bdla_svd_qr_fold(W, cols, Y, stream, r);
+		}
+		bdla_svd_transpose(W, cols);
+		wrows = cols;
+	} else if (rows >= 2 * cols) {
+		/* Jacobi on R of B = QR is much cheaper, and converges faster. */
+		B = malloc(sizeof(float) * rows * cols);
+		tau = malloc(sizeof(float) * cols);
+		W = calloc((size_t)cols * cols, sizeof(float));
+		if (B == NULL || tau == NULL || W == NULL) { goto cleanup; }
+		bdla_svd_gather(A.arr, rs, cs, 0, rows, cols, B, rows);
+		bdla_svd_qr(B, rows, rows, cols, tau);
+		for (j = 0; j < cols; ++j) {
+			memcpy(W + (size_t)j * cols, B + (size_t)j * rows, sizeof(float) * (j + 1));
+		}
+		wrows = cols;
+	} else {
+		W = malloc(sizeof(float) * rows * cols);
+		if (W == NULL) { goto cleanup; }
+		bdla_svd_gather(A.arr, rs, cs, 0, rows, cols, W, rows);
+		wrows = rows;
+	}
+	if (Ub != NULL && Vb != NULL && (Vw = malloc(sizeof(float) * cols * cols)) == NULL) {
+		goto cleanup;
+	}
+	if (bdla_svd_jacobi(W, wrows, wrows, cols, Vw, norm2) != BDLA_GOOD) { goto cleanup; }
+
+	/* Descending singular values. */
+	bdla_eigsolve_order(norm2, cols, idx);
+	for (j = 0; j < cols; ++j) { s->arr[j] = (float)sqrt(norm2[idx[j]]); }
+	if (Vw != NULL) { bdla_svd_scatter(Vw, cols, cols, cols, idx, Vb->arr); }
+	if (Ub == NULL) {
+		/* W was R^T, so its columns are along B's short side. */
+		Ub = Vb;
+		rows = cols;
+	}
+	if (Ub != NULL) {
+		Uw = calloc((size_t)rows * cols, sizeof(float));
+		if (Uw == NULL) { goto cleanup; }
+		/* Below FLT_MIN / FLT_EPSILON, 1 / s overflows: those count as zero. */
+		for (j = 0; j < cols; ++j) {
+			if (s->arr[j] > FLT_MIN / FLT_EPSILON) {
+				cblas_saxpy(wrows, 1.f / s->arr[j], W + (size_t)idx[j] * wrows, 1,
+					Uw + (size_t)j * rows, 1);
+			} else {
+				bdla_svd_complete(Uw, rows, wrows, j);
+			}
+		}
+		if (B != NULL) { bdla_svd_apply_q(B, rows, rows, cols, tau, Uw, rows); }
+		bdla_svd_scatter(Uw, rows, rows, cols, NULL, Ub->arr);
+	}
+	stat = BDLA_GOOD;
+cleanup:
+	free(B);
+	free(tau);
+	free(W);
+	free(Y);
+	free(Vw);
+	free(Uw);
+	free(norm2);
+	free(idx);
+	return stat;
+}
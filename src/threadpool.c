@@ -0,0 +1,480 @@
+#include "libbdla.h"
+/*============================================================================
+threadpool.c
+
+The shared work-stealing thread pool. Each worker owns a deque of jobs: it
+pushes and pops at the back, and idle threads steal from the front of the
+others, where the largest pieces of split loops sit. Threads that aren't
+pool workers share one extra deque.
+
+Copyright(c) 2019 HJA Bird
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files(the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions :
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+============================================================================*/
+#include <assert.h>
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <openblas/cblas.h>
+
+#include "threads.h"
+#include "threadpool.h"
+
+typedef struct {
+	bdla_RangeFn body;
+	void *ctx;
+	int grain;
+	volatile long remaining;	/* Iterations not yet finished. */
+} bdla_PoolLoop;
+
+/* Part of a loop, or a one-off call when loop is NULL. */
+typedef struct {
+	bdla_PoolLoop *loop;
+	int begin, end;
+	void(*fn)(void *arg);
+	void *arg;
+} bdla_PoolJob;
+
+typedef struct {
+	bdla_Mutex lock;
+	bdla_PoolJob *jobs;		/* Queued jobs are jobs[head] to jobs[tail - 1]. */
+	int head, tail, cap;
+} bdla_PoolDeque;
+
+static struct {
+	bdla_Mutex lock;
+	bdla_Cond wake;
+	volatile long started;
+	int stop;
+	int nthreads;			/* Including a calling thread. */
+	int nworkers;
+	int sleepers;
+	int pin;				/* Workers keep to one processor each. */
+	long version;			/* Bumped whenever there's something new to look at. */
+	bdla_Thread *threads;
+	bdla_PoolDeque *deques;	/* nworkers + 1: the last is for other threads. */
+} bdla_pool = { BDLA_MUTEX_INIT, BDLA_COND_INIT, 0, 0, 0, 0, 0, 0, 0, NULL, NULL };
+
+/* Index of this thread's deque if it is a worker, else -1. */
+static BDLA_THREAD_LOCAL int bdla_pool_self = -1;
+
+static int bdla_pool_mydeque(void) {
+	return bdla_pool_self >= 0 ? bdla_pool_self : bdla_pool.nworkers;
+}
+
+static int bdla_pool_push(int d, bdla_PoolJob job) {
+	bdla_PoolDeque *q = bdla_pool.deques + d;
+	bdla_PoolJob *grown;
+	int cap;
+	bdla_mutex_lock(&q->lock);
+	if (q->tail == q->cap) {
+		if (q->head > 0) {
+			memmove(q->jobs, q->jobs + q->head, sizeof(bdla_PoolJob) * (q->tail - q->head));
+			q->tail -= q->head;
+			q->head = 0;
+		}
+		else {
+			cap = 2 * q->cap + 16;
+			grown = realloc(q->jobs, sizeof(bdla_PoolJob) * cap);
+			if (grown == NULL) {
+				bdla_mutex_unlock(&q->lock);
+				return 0;
+			}
+			q->jobs = grown;
+			q->cap = cap;
+		}
+	}
+	q->jobs[q->tail++] = job;
+	bdla_mutex_unlock(&q->lock);
+	return 1;
+}
+
+static int bdla_pool_pop_back(int d, bdla_PoolJob *job) {
+	bdla_PoolDeque *q = bdla_pool.deques + d;
+	int found = 0;
+	bdla_mutex_lock(&q->lock);
+	if (q->tail > q->head) {
+		*job = q->jobs[--q->tail];
+		found = 1;
+	}
+	bdla_mutex_unlock(&q->lock);
+	return found;
+}
+
+static int bdla_pool_steal_front(int d, bdla_PoolJob *job) {
+	bdla_PoolDeque *q = bdla_pool.deques + d;
+	int found = 0;
+	bdla_mutex_lock(&q->lock);
+	if (q->tail > q->head) {
+		*job = q->jobs[q->head++];
+		if (q->head == q->tail) { q->head = q->tail = 0; }
+		found = 1;
+	}
+	bdla_mutex_unlock(&q->lock);
+	return found;
+}
+
+/* Own work first, then steal from the others in turn. */
+static int bdla_pool_take(int self, bdla_PoolJob *job) {
+	int k, n = bdla_pool.nworkers + 1;
+	if (bdla_pool_pop_back(self, job)) { return 1; }
+	for (k = 1; k < n; ++k) {
+		if (bdla_pool_steal_front((self + k) % n, job)) { return 1; }
+	}
+	return 0;
+}
+
+static void bdla_pool_notify(void) {
+	bdla_mutex_lock(&bdla_pool.lock);
+	++bdla_pool.version;
+	if (bdla_pool.sleepers > 0) { bdla_cond_broadcast(&bdla_pool.wake); }
+	bdla_mutex_unlock(&bdla_pool.lock);
+}
+
+static long bdla_pool_version(void) {
+	long v;
+	bdla_mutex_lock(&bdla_pool.lock);
+	v = bdla_pool.version;
+	bdla_mutex_unlock(&bdla_pool.lock);
+	return v;
+}
+
+/* Sleep until something changes since version seen, unless done says we
+needn't. */
+static void bdla_pool_sleep(long seen, volatile long *remaining) {
+	bdla_mutex_lock(&bdla_pool.lock);
+	if (bdla_pool.version == seen && !bdla_pool.stop
+		&& (remaining == NULL || bdla_atomic_load(remaining) > 0)) {
+		++bdla_pool.sleepers;
+		bdla_cond_wait(&bdla_pool.wake, &bdla_pool.lock);
+		--bdla_pool.sleepers;
+	}
+	bdla_mutex_unlock(&bdla_pool.lock);
+}
+
+/* Halve a loop job until it is no bigger than the grain, leaving the upper
+halves to be stolen, then run what's left. */
+static void bdla_pool_run(int self, bdla_PoolJob job) {
+	bdla_PoolLoop *loop = job.loop;
+	bdla_PoolJob half;
+	int split = 0;
+	if (loop == NULL) {
+		job.fn(job.arg);
+		return;
+	}
+	while (job.end - job.begin > loop->grain) {
+		half = job;
+		half.begin = job.begin + (job.end - job.begin) / 2;
+		if (!bdla_pool_push(self, half)) { break; }
+		job.end = half.begin;
+		split = 1;
+	}
+	if (split) { bdla_pool_notify(); }
+	loop->body(loop->ctx, job.begin, job.end);
+	/* The loop may be gone as soon as remaining reaches zero. */
+	if (bdla_atomic_add(&loop->remaining, -(long)(job.end - job.begin)) == 0) {
+		bdla_pool_notify();
+	}
+}
+
+static bdla_ThreadRet BDLA_THREAD_CALL bdla_pool_worker(void *arg) {
+	int self = (int)(size_t)arg;
+	long seen;
+	bdla_PoolJob job;
+	bdla_pool_self = self;
+	/* Worker self takes processor self, leaving the last for the caller
+	when there's a worker per core. */
+	if (bdla_pool.pin) { bdla_thread_pin(self); }
+	for (;;) {
+		bdla_mutex_lock(&bdla_pool.lock);
+		seen = bdla_pool.version;
+		if (bdla_pool.stop) {
+			bdla_mutex_unlock(&bdla_pool.lock);
+			break;
+		}
+		bdla_mutex_unlock(&bdla_pool.lock);
+		while (bdla_pool_take(self, &job)) {
+			bdla_pool_run(self, job);
+		}
+		bdla_pool_sleep(seen, NULL);
+	}
+	return 0;
+}
+
+bdla_Status bdla_pool_start(int nthreads) {
+	int i;
+	const char *env;
+	if (bdla_atomic_load(&bdla_pool.started)) { return BDLA_GOOD; }
+	bdla_mutex_lock(&bdla_pool.lock);
+	if (bdla_pool.started) {
+		bdla_mutex_unlock(&bdla_pool.lock);
+		return BDLA_GOOD;
+	}
+	if (nthreads <= 0) {
+		env = getenv("BDLA_NUM_THREADS");
+		nthreads = env != NULL ? atoi(env) : 0;
+	}
+	if (nthreads <= 0) { nthreads = bdla_thread_ncores(); }
+	env = getenv("BDLA_PIN_THREADS");
+	bdla_pool.pin = env != NULL && atoi(env) != 0;
+	/* Always at least one worker, so that queued tasks make progress. */
+	bdla_pool.nworkers = nthreads > 1 ? nthreads - 1 : 1;
+	bdla_pool.deques = calloc(bdla_pool.nworkers + 1, sizeof(bdla_PoolDeque));
+	bdla_pool.threads = malloc(sizeof(bdla_Thread) * bdla_pool.nworkers);
+	if (bdla_pool.deques == NULL || bdla_pool.threads == NULL) {
+		free(bdla_pool.deques);
+		free(bdla_pool.threads);
+		bdla_mutex_unlock(&bdla_pool.lock);
+		return BDLA_MEM_ERROR;
+	}
+	for (i = 0; i <= bdla_pool.nworkers; ++i) {
+		bdla_Mutex m = BDLA_MUTEX_INIT;
+		bdla_pool.deques[i].lock = m;
+	}
+	openblas_set_num_threads(1);
+	for (i = 0; i < bdla_pool.nworkers; ++i) {
+		if (!bdla_thread_create(bdla_pool.threads + i, bdla_pool_worker, (void *)(size_t)i)) {
+			break;
+		}
+	}
+	if (i == 0) {
+		free(bdla_pool.deques);
+		free(bdla_pool.threads);
+		bdla_mutex_unlock(&bdla_pool.lock);
+		return BDLA_MEM_ERROR;
+	}
+	/* The deques of workers that failed to start are still searched, but
+	stay empty. */
+	bdla_pool.nthreads = i < nthreads - 1 ? i + 1 : nthreads;
+	bdla_pool.stop = 0;
+	bdla_atomic_add(&bdla_pool.started, 1);
+	bdla_mutex_unlock(&bdla_pool.lock);
+	return BDLA_GOOD;
+}
+
+void bdla_pool_stop(void) {
+	int i, nworkers;
+	bdla_mutex_lock(&bdla_pool.lock);
+	if (!bdla_pool.started) {
+		bdla_mutex_unlock(&bdla_pool.lock);
+		return;
+	}
+	bdla_pool.stop = 1;
+	bdla_cond_broadcast(&bdla_pool.wake);
+	nworkers = bdla_pool.nworkers;
+	bdla_mutex_unlock(&bdla_pool.lock);
+	for (i = 0; i < nworkers; ++i) {
+		bdla_thread_join(bdla_pool.threads[i]);
+	}
+	bdla_mutex_lock(&bdla_pool.lock);
+	for (i = 0; i <= bdla_pool.nworkers; ++i) {
+		free(bdla_pool.deques[i].jobs);
+	}
+	free(bdla_pool.deques);
+	free(bdla_pool.threads);
+	bdla_pool.deques = NULL;
+	bdla_pool.threads = NULL;
+	bdla_pool.nworkers = bdla_pool.nthreads = 0;
+	bdla_atomic_add(&bdla_pool.started, -1);
+	bdla_mutex_unlock(&bdla_pool.lock);
+}
+
+int bdla_pool_nthreads(void) {
+	if (bdla_pool_start(0) != BDLA_GOOD) { return 1; }
+	return bdla_pool.nthreads;
+}
+
+/* Help out until every piece of loop has finished. */
+static void bdla_pool_finish(int self, bdla_PoolLoop *loop) {
+	bdla_PoolJob job;
+	long seen;
+	while (bdla_atomic_load(&loop->remaining) > 0) {
+		seen = bdla_pool_version();
+		if (bdla_pool_take(self, &job)) {
+			bdla_pool_run(self, job);
+			continue;
+		}
+		bdla_pool_sleep(seen, &loop->remaining);
+	}
+}
+
+void bdla_parallel_for(int n, int grain, bdla_RangeFn body, void *ctx) {
+	bdla_PoolLoop loop;
+	bdla_PoolJob job;
+	int self;
+	assert(body != NULL);
+	if (n <= 0) { return; }
+	if (grain < 1) { grain = 1; }
+	if (n <= grain || bdla_pool_nthreads() == 1) {
+		body(ctx, 0, n);
+		return;
+	}
+	loop.body = body;
+	loop.ctx = ctx;
+	loop.grain = grain;
+	loop.remaining = n;
+	job.loop = &loop;
+	job.begin = 0;
+	job.end = n;
+	job.fn = NULL;
+	job.arg = NULL;
+	self = bdla_pool_mydeque();
+	bdla_pool_run(self, job);
+	bdla_pool_finish(self, &loop);
+}
+
+void bdla_parallel_for_static(int n, int grain, bdla_RangeFn body, void *ctx) {
+	bdla_PoolLoop loop;
+	bdla_PoolJob job, mine;
+	int t, nparts, self;
+	assert(body != NULL);
+	if (n <= 0) { return; }
+	if (grain < 1) { grain = 1; }
+	if (n <= grain || bdla_pool_nthreads() == 1) {
+		body(ctx, 0, n);
+		return;
+	}
+	/* Parts aren't split, so that one thread runs all of each. */
+	nparts = bdla_pool.nworkers + 1;
+	loop.body = body;
+	loop.ctx = ctx;
+	loop.grain = n;
+	loop.remaining = n;
+	job.loop = &loop;
+	job.fn = NULL;
+	job.arg = NULL;
+	mine = job;
+	mine.begin = mine.end = 0;
+	/* Part t goes to the back of deque t, so its owner runs it next. The
+	last part belongs to the calling thread when it isn't a worker. */
+	self = bdla_pool_mydeque();
+	for (t = 0; t < nparts; ++t) {
+		job.begin = (int)((long long)n * t / nparts);
+		job.end = (int)((long long)n * (t + 1) / nparts);
+		if (t == self) {
+			mine = job;
+		}
+		else if (job.end > job.begin && !bdla_pool_push(t, job)) {
+			bdla_pool_run(self, job);
+		}
+	}
+	bdla_pool_notify();
+	if (mine.end > mine.begin) { bdla_pool_run(self, mine); }
+	bdla_pool_finish(self, &loop);
+}
+
+typedef struct {
+	bdla_RangeSumFn body;
+	void *ctx;
+	int n, chunk;
+	double *partial;
+} bdla_PoolSum;
+
+static void bdla_pool_sumchunks(void *ctx, int begin, int end) {
+	bdla_PoolSum *s = ctx;
+	int c, last;
+	for (c = begin; c < end; ++c) {
+		last = s->n - c * s->chunk < s->chunk ? s->n : (c + 1) * s->chunk;
+		s->partial[c] = s->body(s->ctx, c * s->chunk, last);
+	}
+}
+
+#define BDLA_PARALLEL_SUM_MAXCHUNKS 1024
+
+double bdla_parallel_sum(int n, int grain, bdla_RangeSumFn body, void *ctx) {
+	double stackpartial[64], total = 0.;
+	bdla_PoolSum s;
+	int c, nchunks;
+	assert(body != NULL);
+	if (n <= 0) { return 0.; }
+	if (grain < 1) { grain = 1; }
+	if (grain < (n + BDLA_PARALLEL_SUM_MAXCHUNKS - 1) / BDLA_PARALLEL_SUM_MAXCHUNKS) {
+		grain = (n + BDLA_PARALLEL_SUM_MAXCHUNKS - 1) / BDLA_PARALLEL_SUM_MAXCHUNKS;
+	}
+	nchunks = (n + grain - 1) / grain;
+	s.body = body;
+	s.ctx = ctx;
+	s.n = n;
+	s.chunk = grain;
+	s.partial = nchunks <= 64 ? stackpartial : malloc(sizeof(double) * nchunks);
+	if (s.partial == NULL) {
+		/* Same chunks, one at a time. */
+		for (c = 0; c < nchunks; ++c) {
+			total += body(ctx, c * grain, n - c * grain < grain ? n : (c + 1) * grain);
+		}
+		return total;
+	}
+	bdla_parallel_for_static(nchunks, 1, bdla_pool_sumchunks, &s);
+	for (c = 0; c < nchunks; ++c) { total += s.partial[c]; }
+	if (s.partial != stackpartial) { free(s.partial); }
+	return total;
+}
+
+typedef struct {
+	float *arr;
+	size_t rowlen;
+	float value;
+	int zero;
+} bdla_PoolFill;
+
+static void bdla_pool_fillrows(void *ctx, int begin, int end) {
+	bdla_PoolFill *f = ctx;
+	float *p = f->arr + (size_t)begin * f->rowlen;
+	float *last = f->arr + (size_t)end * f->rowlen;
+	if (f->zero) {
+		memset(p, 0, sizeof(float) * (last - p));
+		return;
+	}
+	for (; p < last; ++p) { *p = f->value; }
+}
+
+void bdla_parallel_fill(float *arr, int rows, size_t rowlen, float value) {
+	bdla_PoolFill f;
+	assert(arr != NULL || rows == 0);
+	f.arr = arr;
+	f.rowlen = rowlen;
+	f.value = value;
+	/* memset gives +0, so only use it when that's what was asked for. */
+	f.zero = value == 0.f && !signbit(value);
+	bdla_parallel_for_static(rows, bdla_parallel_grain(rowlen), bdla_pool_fillrows, &f);
+}
+
+bdla_Status bdla_pool_submit(void(*fn)(void *arg), void *arg) {
+	bdla_PoolJob job;
+	bdla_Status s = bdla_pool_start(0);
+	if (s != BDLA_GOOD) { return s; }
+	job.loop = NULL;
+	job.begin = job.end = 0;
+	job.fn = fn;
+	job.arg = arg;
+	if (!bdla_pool_push(bdla_pool_mydeque(), job)) { return BDLA_MEM_ERROR; }
+	bdla_pool_notify();
+	return BDLA_GOOD;
+}
+
+int bdla_pool_run_one(void) {
+	bdla_PoolJob job;
+	int self;
+	if (!bdla_atomic_load(&bdla_pool.started)) { return 0; }
+	self = bdla_pool_mydeque();
+	if (!bdla_pool_take(self, &job)) { return 0; }
+	bdla_pool_run(self, job);
+	return 1;
+}
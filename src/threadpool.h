@@ -0,0 +1,84 @@
+#ifndef BDLA_THREADPOOL_H
+#define BDLA_THREADPOOL_H
+/*============================================================================
+threadpool.h
+
+The work-stealing thread pool that every parallel bdla kernel runs on.
+
+Copyright(c) 2019 HJA Bird
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files(the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions :
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+============================================================================*/
+#include "libbdla.h"
+
+#include <stddef.h>
+
+/* Roughly how many element operations make a chunk worth handing to
+another thread. */
+#define BDLA_PARALLEL_GRAIN_WORK 16384
+
+/* Handles iterations [begin, end) of a parallel loop. */
+typedef void(*bdla_RangeFn)(void *ctx, int begin, int end);
+/* Partial result of a reduction over iterations [begin, end). */
+typedef double(*bdla_RangeSumFn)(void *ctx, int begin, int end);
+
+/* Start the pool with nthreads threads, counting the calling thread. Zero
+means BDLA_NUM_THREADS from the environment or the number of cores. Does
+nothing if it has already been started. OpenBLAS is set single threaded
+so that it doesn't compete with the pool. With BDLA_PIN_THREADS set
+nonzero, worker t keeps to the t-th processor the process may use. */
+bdla_Status bdla_pool_start(int nthreads);
+void bdla_pool_stop(void);
+int bdla_pool_nthreads(void);
+
+/* Iterations per chunk so that each chunk does about
+BDLA_PARALLEL_GRAIN_WORK operations. */
+static inline int bdla_parallel_grain(size_t work_per_item) {
+	size_t g = work_per_item > 0 ? BDLA_PARALLEL_GRAIN_WORK / work_per_item : 0;
+	return g > 0 ? (g < 0x7fffffff ? (int)g : 0x7fffffff) : 1;
+}
+
+/* Run body over [0, n), split into pieces of no fewer than grain
+iterations that idle threads steal. Returns once every iteration is done;
+the caller works on the loop (or on other queued work) while it waits.
+Safe to call from inside another parallel loop or task. */
+void bdla_parallel_for(int n, int grain, bdla_RangeFn body, void *ctx);
+/* As bdla_parallel_for, but [0, n) is cut into one contiguous part per
+thread and part t is queued whole to thread t. Rows written by a static
+loop are then read by the same thread in later static loops over the same
+range, so on NUMA machines first-touched pages stay local, more so with
+BDLA_PIN_THREADS set. An idle thread can still take a whole part that its
+owner hasn't got to. grain only decides whether to go parallel at all. */
+void bdla_parallel_for_static(int n, int grain, bdla_RangeFn body, void *ctx);
+/* As bdla_parallel_for_static, with the sum of body's results. The range
+is cut into the same chunks however many threads there are, and the chunks
+are summed in order, so the result is reproducible. */
+double bdla_parallel_sum(int n, int grain, bdla_RangeSumFn body, void *ctx);
+
+/* Set rows * rowlen floats to value with a static loop over the rows, so
+that on NUMA machines each row's pages are placed with the thread that
+will work on it. */
+void bdla_parallel_fill(float *arr, int rows, size_t rowlen, float value);
+
+/* Queue fn(arg) to run once on the pool. */
+bdla_Status bdla_pool_submit(void(*fn)(void *arg), void *arg);
+/* Run one piece of queued work if there is any. Returns nonzero if it did. */
+int bdla_pool_run_one(void);
+
+#endif /* BDLA_THREADPOOL_H */
@@ -0,0 +1,181 @@
+#ifndef BDLA_THREADS_H
+#define BDLA_THREADS_H
+/*============================================================================
+threads.h
+
+Internal portable threads, mutexes, condition variables, thread locals,
+atomic counters and processor affinity: pthreads and GCC builtins on POSIX,
+slim reader/writer locks, condition variables and Interlocked functions on
+Windows. Both mutexes and condition variables can be statically
+initialised.
+
+Copyright(c) 2019 HJA Bird
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files(the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions :
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+============================================================================*/
+#include "libbdla.h"
+
+#ifdef _WIN32
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#include <windows.h>
+#include <process.h>
+
+typedef SRWLOCK bdla_Mutex;
+typedef CONDITION_VARIABLE bdla_Cond;
+typedef HANDLE bdla_Thread;
+typedef unsigned bdla_ThreadRet;
+#define BDLA_THREAD_CALL __stdcall
+#define BDLA_MUTEX_INIT SRWLOCK_INIT
+#define BDLA_COND_INIT CONDITION_VARIABLE_INIT
+
+static inline void bdla_mutex_lock(bdla_Mutex *m) { AcquireSRWLockExclusive(m); }
+static inline void bdla_mutex_unlock(bdla_Mutex *m) { ReleaseSRWLockExclusive(m); }
+static inline void bdla_cond_wait(bdla_Cond *c, bdla_Mutex *m) {
+	SleepConditionVariableSRW(c, m, INFINITE, 0);
+}
+static inline void bdla_cond_signal(bdla_Cond *c) { WakeConditionVariable(c); }
+static inline void bdla_cond_broadcast(bdla_Cond *c) { WakeAllConditionVariable(c); }
+
+/* Returns nonzero on success. */
+static inline int bdla_thread_create(bdla_Thread *t,
+	bdla_ThreadRet (BDLA_THREAD_CALL *fn)(void *), void *arg) {
+	*t = (HANDLE)_beginthreadex(NULL, 0, fn, arg, 0, NULL);
+	return *t != 0;
+}
+static inline void bdla_thread_join(bdla_Thread t) {
+	WaitForSingleObject(t, INFINITE);
+	CloseHandle(t);
+}
+static inline int bdla_thread_ncores(void) {
+	SYSTEM_INFO info;
+	GetSystemInfo(&info);
+	return info.dwNumberOfProcessors > 0 ? (int)info.dwNumberOfProcessors : 1;
+}
+/* Keep the calling thread on the k-th processor, counting round those it
+may run on. Returns nonzero on success. */
+static inline int bdla_thread_pin(int k) {
+	DWORD_PTR proc, sys, bit;
+	int count = 0, i;
+	if (!GetProcessAffinityMask(GetCurrentProcess(), &proc, &sys) || proc == 0) { return 0; }
+	for (bit = proc; bit != 0; bit &= bit - 1) { ++count; }
+	k %= count;
+	for (i = 0; ; ++i) {
+		bit = (DWORD_PTR)1 << i;
+		if ((proc & bit) != 0 && k-- == 0) { break; }
+	}
+	return SetThreadAffinityMask(GetCurrentThread(), bit) != 0;
+}
+
+#define BDLA_THREAD_LOCAL __declspec(thread)
+/* Atomically add v to *p, returning the new value. */
+static inline long bdla_atomic_add(volatile long *p, long v) {
+	return InterlockedExchangeAdd(p, v) + v;
+}
+static inline long bdla_atomic_load(volatile long *p) {
+	return InterlockedCompareExchange(p, 0, 0);
+}
+static inline void bdla_atomic_store(volatile long *p, long v) {
+	InterlockedExchange(p, v);
+}
+/* Monotonic wall clock seconds, from an arbitrary origin. */
+static inline double bdla_seconds(void) {
+	LARGE_INTEGER t, f;
+	QueryPerformanceCounter(&t);
+	QueryPerformanceFrequency(&f);
+	return (double)t.QuadPart / (double)f.QuadPart;
+}
+#else
+#include <pthread.h>
+#include <time.h>
+#include <unistd.h>
+#ifdef __linux__
+#include <sys/syscall.h>
+#endif
+
+typedef pthread_mutex_t bdla_Mutex;
+typedef pthread_cond_t bdla_Cond;
+typedef pthread_t bdla_Thread;
+typedef void *bdla_ThreadRet;
+#define BDLA_THREAD_CALL
+#define BDLA_MUTEX_INIT PTHREAD_MUTEX_INITIALIZER
+#define BDLA_COND_INIT PTHREAD_COND_INITIALIZER
+
+static inline void bdla_mutex_lock(bdla_Mutex *m) { pthread_mutex_lock(m); }
+static inline void bdla_mutex_unlock(bdla_Mutex *m) { pthread_mutex_unlock(m); }
+static inline void bdla_cond_wait(bdla_Cond *c, bdla_Mutex *m) { pthread_cond_wait(c, m); }
+static inline void bdla_cond_signal(bdla_Cond *c) { pthread_cond_signal(c); }
+static inline void bdla_cond_broadcast(bdla_Cond *c) { pthread_cond_broadcast(c); }
+
+/* Returns nonzero on success. */
+static inline int bdla_thread_create(bdla_Thread *t,
+	bdla_ThreadRet (BDLA_THREAD_CALL *fn)(void *), void *arg) {
+	return pthread_create(t, NULL, fn, arg) == 0;
+}
+static inline void bdla_thread_join(bdla_Thread t) {
+	pthread_join(t, NULL);
+}
+static inline int bdla_thread_ncores(void) {
+	long n = sysconf(_SC_NPROCESSORS_ONLN);
+	return n > 0 ? (int)n : 1;
+}
+/* Keep the calling thread on the k-th processor, counting round those it
+may run on. Returns nonzero on success, which needs Linux here. */
+static inline int bdla_thread_pin(int k) {
+#ifdef __linux__
+	unsigned long mask[16] = { 0 }, one[16] = { 0 };
+	const int bits = 8 * sizeof(mask[0]);
+	int count = 0, i;
+	/* The raw calls need no _GNU_SOURCE. Zero is the calling thread. */
+	if (syscall(SYS_sched_getaffinity, 0, sizeof(mask), mask) < 0) { return 0; }
+	for (i = 0; i < 16 * bits; ++i) { count += (mask[i / bits] >> (i % bits)) & 1; }
+	if (count == 0) { return 0; }
+	k %= count;
+	for (i = 0; i < 16 * bits; ++i) {
+		if (((mask[i / bits] >> (i % bits)) & 1) && k-- == 0) { break; }
+	}
+	one[i / bits] = 1ul << (i % bits);
+	return syscall(SYS_sched_setaffinity, 0, sizeof(one), one) == 0;
+#else
+	(void)k;
+	return 0;
+#endif
+}
+
+#define BDLA_THREAD_LOCAL __thread
+/* Atomically add v to *p, returning the new value. */
+static inline long bdla_atomic_add(volatile long *p, long v) {
+	return __atomic_add_fetch(p, v, __ATOMIC_ACQ_REL);
+}
+static inline long bdla_atomic_load(volatile long *p) {
+	return __atomic_load_n(p, __ATOMIC_ACQUIRE);
+}
+static inline void bdla_atomic_store(volatile long *p, long v) {
+	__atomic_store_n(p, v, __ATOMIC_RELEASE);
+}
+/* Monotonic wall clock seconds, from an arbitrary origin. */
+static inline double bdla_seconds(void) {
+	struct timespec t;
+	clock_gettime(CLOCK_MONOTONIC, &t);
+	return (double)t.tv_sec + 1e-9 * (double)t.tv_nsec;
+}
+#endif
+
+#endif /* BDLA_THREADS_H */
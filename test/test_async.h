@@ -0,0 +1,220 @@
+#ifndef BSV_TEST_ASYNC_H
+#define BSV_TEST_ASYNC_H
+/*============================================================================
+test_async.h
+
+Test asynchronous tasks and their dependencies.
+
+Copyright(c) 2019 HJA Bird
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files(the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions :
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+============================================================================*/
+#include "../include/bdla/libbdla.h"
+
+#include <math.h>
+#include <stdlib.h>
+#ifdef __linux__
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+typedef struct {
+	bdla_Vxf in, out;
+	float f;
+} bdla_TestAsyncArg;
+
+static bdla_Status bdla_test_async_fill(void *arg) {
+	bdla_TestAsyncArg *a = arg;
+	bdla_Vxf_uniform(&a->out, a->f);
+	return BDLA_GOOD;
+}
+
+static bdla_Status bdla_test_async_plus(void *arg) {
+	bdla_TestAsyncArg *a = arg;
+	bdla_Vxf_fplus(a->in, a->f, &a->out);
+	return BDLA_GOOD;
+}
+
+#ifdef __linux__
+/* How many processors the thread running it may use, or -1. */
+static bdla_Status bdla_test_async_cpus(void *arg) {
+	unsigned long mask[16] = { 0 };
+	int *count = arg, i;
+	*count = -1;
+	if (syscall(SYS_sched_getaffinity, 0, sizeof(mask), mask) < 0) { return BDLA_GOOD; }
+	for (*count = 0, i = 0; i < 16; ++i) { *count += __builtin_popcountl(mask[i]); }
+	return BDLA_GOOD;
+}
+#endif
+
+void testAsync(){
+	SECTION("Async tasks");
+	int i, ok, n = 64, iters = 100;
+	bdla_Mxf A = bdla_Mxf_create(n, n), B = bdla_Mxf_create(n, n);
+	bdla_Mxf C = bdla_Mxf_create(n, n), D = bdla_Mxf_create(n, n), R = bdla_Mxf_create(n, n);
+	bdla_Vxf x = bdla_Vxf_create(n), y1 = bdla_Vxf_create(n), y2 = bdla_Vxf_create(n);
+	bdla_Vxf r = bdla_Vxf_create(n), b = bdla_Vxf_create(2), y = bdla_Vxf_create(2);
+	bdla_Vxf big = bdla_Vxf_create(2 * n), lo, mid;
+	bdla_Mxf N = bdla_Mxf_create(2, 3);
+	bdla_Task *t1, *t2, *t3, *ts[16];
+	bdla_TestAsyncArg a1, a2, a3;
+	float *p;
+	bdla_Vxf reads[1], writes[1];
+
+	TEST(bdla_async_init(2) == BDLA_GOOD);
+	for (i = 0; i < n * n; ++i) {
+		A.arr[i] = (float)((i * 7) % 11) - 5.f;
+		B.arr[i] = (float)((i * 3) % 5) - 2.f;
+	}
+	for (i = 0; i < n; ++i) { x.arr[i] = (float)(i % 3); }
+	/* Chain */						/* y2 = A(Ax) alongside C = AB */
+	TEST(bdla_Mxf_vmult_async(A, x, y1, &t1) == BDLA_GOOD);
+	TEST(bdla_Mxf_vmult_async(A, y1, y2, &t2) == BDLA_GOOD);
+	TEST(bdla_Mxf_mult_async(A, B, C, &t3) == BDLA_GOOD);
+	TEST(bdla_Task_wait(t2) == BDLA_GOOD);
+	TEST(bdla_Task_done(t1));
+	TEST(bdla_Task_wait(t3) == BDLA_GOOD);
+	bdla_Task_release(&t1);
+	bdla_Task_release(&t2);
+	bdla_Task_release(&t3);
+	TEST(t1 == NULL);
+	bdla_Mxf_vmult(A, x, &r);
+	bdla_Mxf_vmult(A, r, &r);
+	TEST(bdla_Vxf_isequal(r, y2));
+	bdla_Mxf_mult(A, B, &R);
+	TEST(bdla_Mxf_isequal(R, C));
+	/* Many independent products, no handles. */
+	for (i = 0; i < iters; ++i) {
+		TEST(bdla_Mxf_gemm_async(1.f, A, BDLA_TRANS, B, BDLA_NO_TRANS, 0.f,
+			i % 2 ? C : D, NULL) == BDLA_GOOD);
+	}
+	bdla_async_waitall();
+	bdla_Mxf_gemm(1.f, A, BDLA_TRANS, B, BDLA_NO_TRANS, 0.f, &R);
+	TEST(bdla_Mxf_isequal(R, C));
+	TEST(bdla_Mxf_isequal(R, D));
+	/* Read / write ordering through user tasks */
+	a1.out = y1; a1.f = 1.f;
+	a2.in = y1; a2.out = y2; a2.f = 1.f;
+	a3.out = y1; a3.f = 5.f;
+	writes[0] = y1;
+	TEST(bdla_call_async(bdla_test_async_fill, &a1, NULL, 0, writes, 1, &ts[0]) == BDLA_GOOD);
+	reads[0] = y1;
+	writes[0] = y2;
+	TEST(bdla_call_async(bdla_test_async_plus, &a2, reads, 1, writes, 1, &ts[1]) == BDLA_GOOD);
+	writes[0] = y1;
+	TEST(bdla_call_async(bdla_test_async_fill, &a3, NULL, 0, writes, 1, &ts[2]) == BDLA_GOOD);
+	TEST(bdla_Task_wait(ts[2]) == BDLA_GOOD);
+	TEST(bdla_Task_done(ts[0]) && bdla_Task_done(ts[1]));
+	for (ok = 1, i = 0; i < n; ++i) {
+		ok &= y1.arr[i] == 5.f && y2.arr[i] == 2.f;
+	}
+	TEST(ok);
+	for (i = 0; i < 3; ++i) { bdla_Task_release(&ts[i]); }
+	/* User tasks are ordered by the whole of each array, not its start. */
+	a1.out.len = n; a1.out.arr = big.arr; a1.f = 1.f;
+	a3.out.len = 2; a3.out.arr = big.arr + n - 1; a3.f = 3.f;
+	writes[0] = a1.out;
+	TEST(bdla_call_async(bdla_test_async_fill, &a1, NULL, 0, writes, 1, &ts[0]) == BDLA_GOOD);
+	writes[0] = a3.out;
+	TEST(bdla_call_async(bdla_test_async_fill, &a3, NULL, 0, writes, 1, &ts[1]) == BDLA_GOOD);
+	TEST(bdla_Task_wait(ts[1]) == BDLA_GOOD);
+	TEST(bdla_Task_done(ts[0]));
+	TEST(big.arr[n - 2] == 1.f && big.arr[n - 1] == 3.f && big.arr[n] == 3.f);
+	for (i = 0; i < 2; ++i) { bdla_Task_release(&ts[i]); }
+	/* Views overlapping an earlier output wait for it. */
+	lo.len = mid.len = n;
+	lo.arr = big.arr;
+	mid.arr = big.arr + n / 2;
+	bdla_Vxf_uniform(&big, 0.f);
+	TEST(bdla_Mxf_vmult_async(A, x, lo, NULL) == BDLA_GOOD);
+	TEST(bdla_Mxf_vmult_async(A, mid, y1, NULL) == BDLA_GOOD);
+	bdla_async_waitall();
+	bdla_Mxf_vmult(A, x, &r);
+	for (ok = 1, i = 0; i < n / 2; ++i) { ok &= r.arr[n / 2 + i] == mid.arr[i]; }
+	TEST(ok);
+	bdla_Mxf_vmult(A, mid, &r);
+	TEST(bdla_Vxf_isequal(r, y1));
+	/* Writing over an input leaves the output where it was. */
+	bdla_Vxf_copyin(&y2, x);
+	p = y2.arr;
+	bdla_Mxf_vmult(A, x, &r);
+	TEST(bdla_Mxf_vmult_async(A, y2, y2, &t1) == BDLA_GOOD);
+	TEST(bdla_Task_wait(t1) == BDLA_GOOD);
+	bdla_Task_release(&t1);
+	TEST(y2.arr == p);
+	TEST(bdla_Vxf_isequal(r, y2));
+	bdla_Mxf_vmult(A, mid, &r);
+	TEST(bdla_Mxf_vmult_async(A, mid, lo, &t1) == BDLA_GOOD);
+	TEST(bdla_Task_wait(t1) == BDLA_GOOD);
+	bdla_Task_release(&t1);
+	TEST(bdla_Vxf_isequal(r, lo));
+	/* Errors */
+	p = y.arr;
+	TEST(bdla_Mxf_vmult_async(A, b, y1, &t1) == BDLA_DIMENSION_MISMATCH);
+	TEST(t1 == NULL);
+	TEST(bdla_Mxf_mult_async(A, B, N, NULL) == BDLA_DIMENSION_MISMATCH);
+	bdla_Vxf_uniform(&b, 1.f);
+	TEST(bdla_Mxf_solve_jacobi_async(N, b, y, 1e-5f, NULL, NULL, &t1) == BDLA_GOOD);
+	TEST(bdla_Task_wait(t1) == BDLA_NONSQUARE);
+	bdla_Task_release(&t1);
+	TEST(y.arr == p);
+	/* Solve */
+	bdla_Mxf_resize(&N, 2, 2);
+	bdla_Mxf_eye(&N);
+	bdla_Mxf_writevalue(N, 0, 0, 4.f);
+	bdla_Mxf_writevalue(N, 0, 1, 1.f);
+	bdla_Mxf_writevalue(N, 1, 1, 3.f);
+	TEST(bdla_Mxf_solve_gauss_seidel_async(N, b, y, 1e-6f, NULL, NULL, &t1) == BDLA_GOOD);
+	TEST(bdla_Task_wait(t1) == BDLA_GOOD);
+	bdla_Task_release(&t1);
+	TEST(fabsf(bdla_Vxf_value(y, 1) - 1.f / 3.f) < 1e-5f);
+	TEST(fabsf(bdla_Vxf_value(y, 0) - 1.f / 6.f) < 1e-5f);
+	bdla_async_shutdown();
+	/* Restarts on demand */
+	TEST(bdla_Mxf_vmult_async(A, x, y1, &t1) == BDLA_GOOD);
+	TEST(bdla_Task_wait(t1) == BDLA_GOOD);
+	bdla_Task_release(&t1);
+	bdla_async_shutdown();
+#ifdef __linux__
+	/* Pinned workers keep to one processor. Polling rather than waiting
+	leaves the task to a worker. */
+	setenv("BDLA_PIN_THREADS", "1", 1);
+	TEST(bdla_call_async(bdla_test_async_cpus, &ok, NULL, 0, NULL, 0, &t1) == BDLA_GOOD);
+	while (!bdla_Task_done(t1)) {}
+	bdla_Task_release(&t1);
+	TEST(ok == 1);
+	bdla_async_shutdown();
+	unsetenv("BDLA_PIN_THREADS");
+#endif
+
+	bdla_Mxf_release(&A);
+	bdla_Mxf_release(&B);
+	bdla_Mxf_release(&C);
+	bdla_Mxf_release(&D);
+	bdla_Mxf_release(&R);
+	bdla_Mxf_release(&N);
+	bdla_Vxf_release(&x);
+	bdla_Vxf_release(&y1);
+	bdla_Vxf_release(&y2);
+	bdla_Vxf_release(&r);
+	bdla_Vxf_release(&b);
+	bdla_Vxf_release(&y);
+	bdla_Vxf_release(&big);
+}
+#endif /* BSV_TEST_ASYNC_H */
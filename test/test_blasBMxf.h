@@ -0,0 +1,138 @@
+#ifndef BSV_TEST_BMXF_H
+#define BSV_TEST_BMXF_H
+/*============================================================================
+test_blasBMxf.h
+
+Test functionality of batches of small float matrices.
+
+Copyright(c) 2019 HJA Bird
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files(the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions :
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+============================================================================*/
+#include "../include/bdla/libbdla.h"
+
+#include <math.h>
+
+void testBMxf(){
+	SECTION("Batched matrix float");
+	int i, count = 37;
+	int piv[37 * 3];
+	bdla_BMxf A, B, C, L, x, y;
+	bdla_Mxf m;
+	bdla_Vxf v;
+	A = bdla_BMxf_create(count, 3, 3);
+	B = bdla_BMxf_create(count, 3, 3);
+	C = bdla_BMxf_create(count, 3, 3);
+	x = bdla_BMxf_create(count, 3, 1);
+	y = bdla_BMxf_create(count, 3, 1);
+	TEST(bdla_BMxf_count(A) == 37);
+	TEST(bdla_BMxf_rows(A) == 3);
+	TEST(bdla_BMxf_cols(x) == 1);
+	/* Matrix i is [i+4, 1, 0; 1, 3, 1; 0, 1, 2], which is SPD. */
+	for (i = 0; i < count; ++i) {
+		m = bdla_BMxf_matrix(A, i);
+		bdla_Mxf_eye(&m);
+		bdla_Mxf_writevalue(m, 0, 0, (float)i + 4.f);
+		bdla_Mxf_writevalue(m, 1, 1, 3.f);
+		bdla_Mxf_writevalue(m, 2, 2, 2.f);
+		bdla_Mxf_writevalue(m, 0, 1, 1.f);
+		bdla_Mxf_writevalue(m, 1, 0, 1.f);
+		bdla_Mxf_writevalue(m, 1, 2, 1.f);
+		bdla_Mxf_writevalue(m, 2, 1, 1.f);
+		m = bdla_BMxf_matrix(B, i);
+		bdla_Mxf_eye(&m);
+		bdla_Mxf_writevalue(m, 0, 2, 2.f);
+		m = bdla_BMxf_matrix(x, i);
+		bdla_Mxf_uniform(&m, 1.f);
+		bdla_Mxf_writevalue(m, 2, 0, (float)i);
+	}
+	/* Multiplication */
+	TEST(bdla_BMxf_mult(A, B, &C) == BDLA_GOOD);
+	m = bdla_BMxf_matrix(C, 5);
+	TEST(bdla_Mxf_value(m, 0, 0) == 9.f);
+	TEST(bdla_Mxf_value(m, 0, 2) == 18.f);
+	TEST(bdla_Mxf_value(m, 1, 2) == 3.f);
+	TEST(bdla_Mxf_value(m, 2, 2) == 2.f);
+	TEST(bdla_BMxf_mult(A, x, &C) == BDLA_DIMENSION_MISMATCH);
+	bdla_BMxf_release(&C);
+	C = bdla_BMxf_copy(A);
+	TEST(bdla_BMxf_mult(C, B, &C) == BDLA_GOOD);
+	TEST(bdla_Mxf_value(bdla_BMxf_matrix(C, 5), 0, 2) == 18.f);
+	/* Matrix-vector */
+	TEST(bdla_BMxf_vmult(A, x, &y) == BDLA_GOOD);
+	m = bdla_BMxf_matrix(y, 10);
+	TEST(bdla_Mxf_value(m, 0, 0) == 15.f);
+	TEST(bdla_Mxf_value(m, 1, 0) == 14.f);
+	TEST(bdla_Mxf_value(m, 2, 0) == 21.f);
+	TEST(bdla_BMxf_vmult(A, B, &y) == BDLA_DIMENSION_MISMATCH);
+	TEST(bdla_BMxf_vmult(A, x, &C) == BDLA_DIMENSION_MISMATCH);
+	/* In place on a member writes inside the batch's buffer */
+	m = bdla_BMxf_matrix(x, 10);
+	TEST(bdla_Mxf_asVxf(m, &v) == BDLA_GOOD);
+	TEST(bdla_Mxf_vmult(bdla_BMxf_matrix(A, 10), v, &v) == BDLA_GOOD);
+	TEST(v.arr == m.arr);
+	TEST(bdla_Mxf_value(m, 0, 0) == 15.f);
+	TEST(bdla_Mxf_value(m, 2, 0) == 21.f);
+	TEST(bdla_Mxf_value(bdla_BMxf_matrix(x, 11), 2, 0) == 11.f);
+	bdla_Mxf_transpose(m, &m);
+	TEST(m.arr == bdla_BMxf_matrix(x, 10).arr);
+	TEST(bdla_Mxf_cols(m) == 3);
+	TEST(bdla_Mxf_value(m, 0, 1) == 14.f);
+	bdla_Mxf_uniform(&m, 1.f);
+	bdla_Mxf_writevalue(m, 0, 2, 10.f);
+	/* LU solve recovers x */
+	L = bdla_BMxf_copy(A);
+	TEST(bdla_BMxf_lu(&L, piv) == BDLA_GOOD);
+	TEST(bdla_BMxf_lusolve(L, piv, y, &y) == BDLA_GOOD);
+	for (i = 0; i < count; ++i) {
+		m = bdla_BMxf_matrix(y, i);
+		TEST(fabsf(bdla_Mxf_value(m, 0, 0) - 1.f) < 1e-4f);
+		TEST(fabsf(bdla_Mxf_value(m, 2, 0) - (float)i) < 1e-4f * (i + 1));
+	}
+	/* Cholesky solve recovers x */
+	bdla_BMxf_vmult(A, x, &y);
+	bdla_BMxf_release(&L);
+	L = bdla_BMxf_copy(A);
+	TEST(bdla_BMxf_cholesky(&L) == BDLA_GOOD);
+	TEST(bdla_Mxf_istrilower(bdla_BMxf_matrix(L, 3)));
+	TEST(bdla_BMxf_cholsolve(L, y, &y) == BDLA_GOOD);
+	m = bdla_BMxf_matrix(y, 20);
+	TEST(fabsf(bdla_Mxf_value(m, 1, 0) - 1.f) < 1e-4f);
+	TEST(fabsf(bdla_Mxf_value(m, 2, 0) - 20.f) < 1e-3f);
+	/* One shot solves leave A alone */
+	bdla_BMxf_vmult(A, x, &y);
+	TEST(bdla_BMxf_solve(A, BDLA_MATRIX_POSITIVE_DEFINITE, y, &C) == BDLA_DIMENSION_MISMATCH);
+	TEST(bdla_BMxf_solve(A, BDLA_MATRIX_GENERAL, y, &y) == BDLA_GOOD);
+	TEST(fabsf(bdla_Mxf_value(bdla_BMxf_matrix(y, 7), 2, 0) - 7.f) < 1e-4f);
+	TEST(bdla_Mxf_value(bdla_BMxf_matrix(A, 7), 0, 0) == 11.f);
+	bdla_BMxf_vmult(A, x, &y);
+	TEST(bdla_BMxf_solve(A, BDLA_MATRIX_POSITIVE_DEFINITE, y, &y) == BDLA_GOOD);
+	TEST(fabsf(bdla_Mxf_value(bdla_BMxf_matrix(y, 7), 2, 0) - 7.f) < 1e-4f);
+	/* Not positive definite */
+	bdla_Mxf_writevalue(bdla_BMxf_matrix(A, 2), 2, 2, -5.f);
+	TEST(bdla_BMxf_cholesky(&A) == BDLA_BAD_PROPERTY);
+
+	bdla_BMxf_release(&A);
+	bdla_BMxf_release(&B);
+	bdla_BMxf_release(&C);
+	bdla_BMxf_release(&L);
+	bdla_BMxf_release(&x);
+	bdla_BMxf_release(&y);
+}
+#endif /* BSV_TEST_BMXF_H */
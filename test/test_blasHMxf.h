@@ -0,0 +1,136 @@
+#ifndef BSV_TEST_HMXF_H
+#define BSV_TEST_HMXF_H
+/*============================================================================
+test_blasHMxf.h
+
+Test functionality of 16 bit storage matrices.
+
+Copyright(c) 2019 HJA Bird
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files(the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions :
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+============================================================================*/
+#include "../include/bdla/libbdla.h"
+
+#include <math.h>
+
+void testHMxf(){
+	SECTION("Half precision matrix float");
+	bdla_HalfFormat formats[2] = { BDLA_HALF_FP16, BDLA_HALF_BF16 };
+	bdla_HMxf h;
+	bdla_Mxf a, b;
+	bdla_Vxf x, y, z;
+	int i, j, f, ok;
+	float err;
+
+	/* Conversion rounding */
+	a = bdla_Mxf_create(2, 4);
+	bdla_Mxf_writevalue(a, 0, 0, 1.5f);
+	bdla_Mxf_writevalue(a, 0, 1, -2.25f);
+	bdla_Mxf_writevalue(a, 0, 2, 65504.f);
+	bdla_Mxf_writevalue(a, 0, 3, 1e5f);
+	bdla_Mxf_writevalue(a, 1, 0, 2049.f);		/* Ties go to even. */
+	bdla_Mxf_writevalue(a, 1, 1, 2051.f);
+	bdla_Mxf_writevalue(a, 1, 2, ldexpf(3.f, -25));	/* Subnormal tie. */
+	bdla_Mxf_writevalue(a, 1, 3, ldexpf(1.f, -25));
+	TEST(bdla_HMxf_fromMxf(a, BDLA_HALF_FP16, &h) == BDLA_GOOD);
+	TEST(bdla_HMxf_rows(h) == 2);
+	TEST(bdla_HMxf_cols(h) == 4);
+	TEST(bdla_HMxf_value(h, 0, 0) == 1.5f);
+	TEST(bdla_HMxf_value(h, 0, 1) == -2.25f);
+	TEST(bdla_HMxf_value(h, 0, 2) == 65504.f);
+	TEST(isinf(bdla_HMxf_value(h, 0, 3)));
+	TEST(bdla_HMxf_value(h, 1, 0) == 2048.f);
+	TEST(bdla_HMxf_value(h, 1, 1) == 2052.f);
+	TEST(bdla_HMxf_value(h, 1, 2) == ldexpf(1.f, -23));
+	TEST(bdla_HMxf_value(h, 1, 3) == 0.f);
+	bdla_HMxf_release(&h);
+	TEST(bdla_HMxf_fromMxf(a, BDLA_HALF_BF16, &h) == BDLA_GOOD);
+	TEST(bdla_HMxf_value(h, 0, 1) == -2.25f);
+	TEST(bdla_HMxf_value(h, 0, 3) == 99840.f);
+	TEST(bdla_HMxf_value(h, 1, 0) == 2048.f);
+	TEST(bdla_HMxf_value(h, 1, 3) == ldexpf(1.f, -25));
+	b = bdla_Mxf_create(1, 1);
+	TEST(bdla_HMxf_toMxf(h, &b) == BDLA_GOOD);
+	TEST(bdla_Mxf_rows(b) == 2 && bdla_Mxf_cols(b) == 4);
+	TEST(bdla_Mxf_value(b, 0, 3) == 99840.f);
+	bdla_HMxf_release(&h);
+
+	/* Matvecs. Entries that both formats hold exactly, and odd widths
+	to leave a tail after the vector loads. */
+	for (f = 0; f < 2; ++f) {
+		bdla_Mxf_resize(&a, 45, 37);
+		for (i = 0; i < 45; ++i) {
+			for (j = 0; j < 37; ++j) {
+				bdla_Mxf_writevalue(a, i, j, (float)((i * 7 + j * 3) % 11 - 5) * 0.5f);
+			}
+		}
+		x = bdla_Vxf_create(37);
+		y = bdla_Vxf_create(45);
+		z = bdla_Vxf_create(45);
+		for (j = 0; j < 37; ++j) { bdla_Vxf_writevalue(x, j, (float)(j % 4) - 1.5f); }
+		TEST(bdla_HMxf_fromMxf(a, formats[f], &h) == BDLA_GOOD);
+		TEST(bdla_HMxf_vmult(h, x, &y) == BDLA_GOOD);
+		bdla_Mxf_vmult(a, x, &z);
+		for (ok = 1, i = 0; i < 45; ++i) { ok &= bdla_Vxf_value(y, i) == bdla_Vxf_value(z, i); }
+		TEST(ok);
+		TEST(bdla_HMxf_vmult(h, y, &y) == BDLA_DIMENSION_MISMATCH);
+		TEST(bdla_HMxf_residual(h, x, z, &y, &err) == BDLA_GOOD);
+		TEST(err == 0.f);
+		TEST(bdla_HMxf_diag(h, &y) == BDLA_GOOD);
+		TEST(bdla_Vxf_length(y) == 37);
+		TEST(bdla_Vxf_value(y, 10) == bdla_Mxf_value(a, 10, 10));
+		bdla_HMxf_release(&h);
+		bdla_Vxf_release(&x);
+		bdla_Vxf_release(&y);
+		bdla_Vxf_release(&z);
+	}
+
+	/* A big, diagonally dominant system. Rounded storage, so compare
+	with the float matrix it rounds to. */
+	for (f = 0; f < 2; ++f) {
+		bdla_Mxf_resize(&a, 300, 300);
+		for (i = 0; i < 300; ++i) {
+			for (j = 0; j < 300; ++j) {
+				bdla_Mxf_writevalue(a, i, j, i == j ? 400.f : sinf((float)(i * 300 + j)));
+			}
+		}
+		x = bdla_Vxf_create(300);
+		y = bdla_Vxf_create(300);
+		z = bdla_Vxf_create(300);
+		for (j = 0; j < 300; ++j) { bdla_Vxf_writevalue(x, j, cosf((float)j)); }
+		TEST(bdla_HMxf_fromMxf(a, formats[f], &h) == BDLA_GOOD);
+		TEST(bdla_HMxf_toMxf(h, &b) == BDLA_GOOD);
+		bdla_HMxf_vmult(h, x, &y);
+		bdla_Mxf_vmult(b, x, &z);
+		bdla_Vxf_minus(y, z, &z);
+		TEST(bdla_Vxf_norm2(z) / bdla_Vxf_norm2(y) < 1e-6f);
+		bdla_Vxf_copyin(&z, y);
+		TEST(bdla_HMxf_solve_jacobi(h, z, &y, 1e-6f, NULL, NULL) == BDLA_GOOD);
+		bdla_Vxf_minus(y, x, &z);
+		TEST(bdla_Vxf_norm2(z) / bdla_Vxf_norm2(x) < 1e-5f);
+		bdla_HMxf_release(&h);
+		bdla_Vxf_release(&x);
+		bdla_Vxf_release(&y);
+		bdla_Vxf_release(&z);
+	}
+
+	bdla_Mxf_release(&a);
+	bdla_Mxf_release(&b);
+}
+#endif /* BSV_TEST_HMXF_H */
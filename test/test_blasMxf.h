@@ -28,6 +28,33 @@ SOFTWARE.
 #include "../include/bdla/libbdla.h"
 
 #include <math.h>
+#ifdef __linux__
+#include <stdio.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+#ifdef __linux__
+/* Whether there's more than one NUMA node online. */
+static int bdla_test_multinode(void) {
+	FILE *f = fopen("/sys/devices/system/node/online", "r");
+	char line[64] = { 0 };
+	if (f == NULL) { return 0; }
+	if (fgets(line, sizeof(line), f) == NULL) { line[0] = 0; }
+	fclose(f);
+	return strchr(line, '-') != NULL || strchr(line, ',') != NULL;
+}
+
+/* Whether transparent huge pages can be had at all. */
+static int bdla_test_thp(void) {
+	FILE *f = fopen("/sys/kernel/mm/transparent_hugepage/enabled", "r");
+	char line[64] = { 0 };
+	if (f == NULL) { return 0; }
+	if (fgets(line, sizeof(line), f) == NULL) { line[0] = 0; }
+	fclose(f);
+	return line[0] != 0 && strstr(line, "[never]") == NULL;
+}
+#endif
 
 void testMxf(){
 	SECTION("Matrix float");
@@ -98,6 +125,124 @@ void testMxf(){
 	TEST(bdla_Mxf_value(a, 1, 0) == 4.f);
 	TEST(bdla_Mxf_value(a, 0, 0) == 2.f);
 	TEST(bdla_Mxf_value(a, 3, 2) == 9.f);
+	/* Operations */				/* blocked transpose */
+	{
+		int i, j, ok = 1;
+		bdla_Mxf big = bdla_Mxf_create(45, 70);
+		bdla_Mxf bigt = bdla_Mxf_create(1, 1);
+		for (i = 0; i < 45; ++i) {
+			for (j = 0; j < 70; ++j) {
+				bdla_Mxf_writevalue(big, i, j, (float)(i * 100 + j));
+			}
+		}
+		bdla_Mxf_transpose(big, &bigt);
+		TEST(bdla_Mxf_rows(bigt) == 70);
+		TEST(bdla_Mxf_cols(bigt) == 45);
+		for (i = 0; i < 45; ++i) {
+			for (j = 0; j < 70; ++j) {
+				ok &= bdla_Mxf_value(bigt, j, i) == (float)(i * 100 + j);
+			}
+		}
+		TEST(ok);
+		bdla_Mxf_transpose(big, &big);
+		TEST(bdla_Mxf_isequal(big, bigt));
+		/* In place, square */
+		bdla_Mxf_resize(&big, 67, 67);
+		for (i = 0; i < 67; ++i) {
+			for (j = 0; j < 67; ++j) {
+				bdla_Mxf_writevalue(big, i, j, (float)(i * 100 + j));
+			}
+		}
+		TEST(bdla_Mxf_transpose_inplace(&big) == BDLA_GOOD);
+		for (ok = 1, i = 0; i < 67; ++i) {
+			for (j = 0; j < 67; ++j) {
+				ok &= bdla_Mxf_value(big, j, i) == (float)(i * 100 + j);
+			}
+		}
+		TEST(ok);
+		TEST(bdla_Mxf_transpose_inplace(&bigt) == BDLA_NONSQUARE);
+		bdla_Mxf_release(&big);
+		bdla_Mxf_release(&bigt);
+	}
+	/* Operations */				/* reshape */
+	{
+		float *arr;
+		bdla_Vxf flat;
+		bdla_Mxf view, twice;
+		bdla_Mxf_resize(&a, 3, 4);
+		bdla_Mxf_writevalue(a, 1, 2, 7.f);
+		bdla_Mxf_writevalue(a, 2, 3, -1.f);
+		arr = a.arr;
+		TEST(bdla_Mxf_reshape(a, 5, 2, &a) == BDLA_DIMENSION_MISMATCH);
+		TEST(bdla_Mxf_reshape(a, 6, 2, &a) == BDLA_GOOD);
+		TEST(a.arr == arr);
+		TEST(bdla_Mxf_rows(a) == 6);
+		TEST(bdla_Mxf_value(a, 3, 0) == 7.f);
+		TEST(bdla_Mxf_reshape(a, 2, 6, &b) == BDLA_GOOD);
+		TEST(bdla_Mxf_cols(b) == 6);
+		TEST(bdla_Mxf_value(b, 1, 0) == 7.f);
+		TEST(bdla_Mxf_value(b, 1, 5) == -1.f);
+		TEST(b.arr != a.arr);
+		TEST(bdla_Mxf_asVxf(a, &flat) == BDLA_GOOD);
+		TEST(bdla_Vxf_length(flat) == 12);
+		TEST(bdla_Vxf_value(flat, 6) == 7.f);
+		TEST(bdla_Vxf_asMxf(flat, 4, 4, &view) == BDLA_DIMENSION_MISMATCH);
+		TEST(bdla_Vxf_asMxf(flat, 12, 1, &view) == BDLA_GOOD);
+		TEST(view.arr == a.arr);
+		TEST(bdla_Mxf_value(view, 11, 0) == -1.f);
+		/* In place through the view leaves a owning its array. */
+		twice = bdla_Mxf_create(12, 12);
+		bdla_Mxf_eye(&twice);
+		bdla_Mxf_fmult(twice, 2.f, &twice);
+		TEST(bdla_Mxf_vmult(twice, flat, &flat) == BDLA_GOOD);
+		TEST(flat.arr == a.arr);
+		TEST(bdla_Mxf_value(a, 3, 0) == 14.f);
+		TEST(bdla_Mxf_value(a, 5, 1) == -2.f);
+		bdla_Mxf_release(&twice);
+	}
+	/* Operations */				/* triangles */
+	{
+		int i, j, ok;
+		bdla_Mxf_resize(&a, 4, 4);
+		for (i = 0; i < 4; ++i) {
+			for (j = 0; j < 4; ++j) {
+				bdla_Mxf_writevalue(a, i, j, (float)(i * 4 + j + 1));
+			}
+		}
+		TEST(bdla_Mxf_tri(a, 1, BDLA_MATRIX_TRI_UPPER, &b) == BDLA_GOOD);
+		for (ok = 1, i = 0; i < 4; ++i) {
+			for (j = 0; j < 4; ++j) {
+				ok &= bdla_Mxf_value(b, i, j) == (j - i >= 1 ? bdla_Mxf_value(a, i, j) : 0.f);
+			}
+		}
+		TEST(ok);
+		TEST(bdla_Mxf_tri(a, -1, BDLA_MATRIX_TRI_LOWER, &b) == BDLA_GOOD);
+		for (ok = 1, i = 0; i < 4; ++i) {
+			for (j = 0; j < 4; ++j) {
+				ok &= bdla_Mxf_value(b, i, j) == (j - i <= -1 ? bdla_Mxf_value(a, i, j) : 0.f);
+			}
+		}
+		TEST(ok);
+		TEST(bdla_Mxf_tri(a, -2, BDLA_MATRIX_TRI_UPPER, &b) == BDLA_GOOD);
+		TEST(bdla_Mxf_value(b, 3, 0) == 0.f);
+		TEST(bdla_Mxf_value(b, 2, 0) == 9.f);
+		TEST(bdla_Mxf_value(b, 3, 3) == 16.f);
+		bdla_Mxf_zero(&b);			/* Writing triangles */
+		TEST(bdla_Mxf_writetri(b, 0, BDLA_MATRIX_TRI_LOWER, a) == BDLA_GOOD);
+		TEST(bdla_Mxf_value(b, 3, 0) == 13.f);
+		TEST(bdla_Mxf_value(b, 2, 2) == 11.f);
+		TEST(bdla_Mxf_value(b, 2, 3) == 0.f);
+		bdla_Mxf_copyin(&b, a);		/* In place masking */
+		TEST(bdla_Mxf_tri_inplace(&b, 0, BDLA_MATRIX_TRI_UPPER) == BDLA_GOOD);
+		TEST(bdla_Mxf_istriupper(b) == 1);
+		TEST(bdla_Mxf_value(b, 1, 1) == 6.f);
+		TEST(bdla_Mxf_tri(b, 0, BDLA_MATRIX_TRI_LOWER, &b) == BDLA_GOOD);
+		TEST(bdla_Mxf_value(b, 1, 1) == 6.f);
+		TEST(bdla_Mxf_value(b, 0, 1) == 0.f);
+		TEST(bdla_Mxf_value(b, 0, 0) == 1.f);
+		bdla_Mxf_resize(&b, 2, 3);
+		TEST(bdla_Mxf_tri_inplace(&b, 0, BDLA_MATRIX_TRI_UPPER) == BDLA_NONSQUARE);
+	}
 	/* Operations */				/* scalar plus */
 	bdla_Mxf_release(&a);
 	bdla_Mxf_release(&b);
@@ -123,6 +268,28 @@ void testMxf(){
 	TEST(bdla_Mxf_diagplus(a, va, -2, &b) == BDLA_DIMENSION_MISMATCH);
 	TEST(bdla_Mxf_diagplus(a, va, -1, &b) == BDLA_GOOD);
 	TEST(bdla_Mxf_value(b, 2, 1) == 100.f);
+	TEST(bdla_Mxf_value(b, 0, 0) == 1.f);
+	TEST(bdla_Mxf_value(b, 3, 2) == bdla_Vxf_value(va, 2) + 1.f);
+	/* Operations */				/* diagonal shift */
+	bdla_Mxf_copyin(&b, a);
+	TEST(bdla_Mxf_diagshift(&b, va, -1) == BDLA_GOOD);
+	TEST(bdla_Mxf_value(b, 2, 1) == 100.f);
+	TEST(bdla_Mxf_value(b, 1, 1) == 1.f);
+	TEST(bdla_Mxf_diagshift(&b, va, 2) == BDLA_DIMENSION_MISMATCH);
+	TEST(bdla_Mxf_fdiagshift(&b, -1.f, 0) == BDLA_GOOD);
+	TEST(bdla_Mxf_value(b, 1, 1) == 0.f);
+	TEST(bdla_Mxf_value(b, 2, 2) == 0.f);
+	TEST(bdla_Mxf_value(b, 3, 2) == bdla_Vxf_value(va, 2) + 1.f);
+	TEST(bdla_Mxf_fdiagshift(&b, 1.f, 3) == BDLA_BAD_INDEX);
+	TEST(bdla_Mxf_fdiagplus(a, 2.f, 1, &c) == BDLA_GOOD);
+	TEST(bdla_Mxf_rows(c) == 4);
+	TEST(bdla_Mxf_value(c, 0, 1) == 3.f);
+	TEST(bdla_Mxf_value(c, 1, 2) == 3.f);
+	TEST(bdla_Mxf_value(c, 1, 1) == 1.f);
+	TEST(bdla_Mxf_value(a, 0, 1) == 1.f);
+	TEST(bdla_Mxf_fdiagplus(a, 2.f, -3, &a) == BDLA_GOOD);
+	TEST(bdla_Mxf_value(a, 3, 0) == 3.f);
+	bdla_Mxf_uniform(&a, 1.f);
 	/* Operations */				/* plus */	
 	bdla_Mxf_resize(&a, 3, 4);
 	bdla_Mxf_resize(&b, 3, 4);
@@ -197,6 +364,27 @@ void testMxf(){
 	TEST(bdla_Mxf_value(d, 1, 2) == -3.f);
 	TEST(bdla_Mxf_value(d, 2, 0) == 12.f);
 	TEST(bdla_Mxf_value(d, 2, 2) == 4.f);
+	/* Operation */				/* Extended general matrix mult */
+	bdla_Mxf_resize(&c, 3, 3);
+	bdla_Mxf_uniform(&c, 1.f);
+	TEST(bdla_Mxf_gemm(0.5f, a, BDLA_TRANS, a, BDLA_NO_TRANS, 2.f, &c) == BDLA_GOOD);
+	TEST(bdla_Mxf_value(c, 0, 0) == 2.5f);
+	TEST(bdla_Mxf_value(c, 0, 2) == 3.5f);
+	TEST(bdla_Mxf_value(c, 2, 2) == 15.f);
+	TEST(bdla_Mxf_value(c, 2, 0) == 3.5f);
+	TEST(bdla_Mxf_gemm(1.f, b, BDLA_NO_TRANS, a, BDLA_NO_TRANS, 1.f, &c) == BDLA_DIMENSION_MISMATCH);
+	TEST(bdla_Mxf_gemm(1.f, b, BDLA_TRANS, a, BDLA_TRANS, 1.f, &c) == BDLA_DIMENSION_MISMATCH);
+	TEST(bdla_Mxf_gemm(1.f, b, BDLA_TRANS, a, BDLA_TRANS, 0.f, &c) == BDLA_GOOD);
+	TEST(bdla_Mxf_rows(c) == 4);
+	TEST(bdla_Mxf_cols(c) == 3);
+	TEST(bdla_Mxf_value(c, 2, 1) == -3.f);
+	TEST(bdla_Mxf_value(c, 2, 2) == 4.f);
+	TEST(bdla_Mxf_value(c, 0, 2) == 12.f);
+	bdla_Mxf_copyin(&c, a);
+	TEST(bdla_Mxf_gemm(1.f, c, BDLA_NO_TRANS, a, BDLA_TRANS, -1.f, &c) == BDLA_GOOD);
+	TEST(bdla_Mxf_value(c, 0, 0) == 9.f);
+	TEST(bdla_Mxf_value(c, 0, 2) == 9.f);
+	TEST(bdla_Mxf_value(c, 2, 2) == 12.f);
 	/* Operation */				/* General matrix -vector multiplication */
 	bdla_Vxf_release(&va);
 	va = bdla_Vxf_create(3);
@@ -206,6 +394,31 @@ void testMxf(){
 	TEST(bdla_Vxf_value(va, 0) == 17.f);
 	TEST(bdla_Vxf_value(va, 1) == 7.f);
 	TEST(bdla_Vxf_value(va, 2) == 20.f);
+	/* Operation */				/* Extended matrix-vector multiplication */
+	bdla_Vxf_resize(&vb, 3);
+	bdla_Vxf_uniform(&vb, 1.f);
+	TEST(bdla_Mxf_gemv(2.f, a, BDLA_TRANS, va, -1.f, &vb) == BDLA_GOOD);
+	TEST(bdla_Vxf_value(vb, 0) == 33.f);
+	TEST(bdla_Vxf_value(vb, 1) == 13.f);
+	TEST(bdla_Vxf_value(vb, 2) == 275.f);
+	TEST(bdla_Mxf_gemv(1.f, a, BDLA_NO_TRANS, va, 1.f, &va) == BDLA_GOOD);
+	TEST(bdla_Vxf_value(va, 0) == 94.f);
+	TEST(bdla_Vxf_value(va, 2) == 100.f);
+	TEST(bdla_Mxf_gemv(1.f, b, BDLA_NO_TRANS, va, 0.f, &vb) == BDLA_DIMENSION_MISMATCH);
+	/* Operation */				/* Residual */
+	{
+		float rnorm = 0.f;
+		bdla_Vxf_uniform(&vb, 1.f);
+		bdla_Vxf_uniform(&va, 2.f);
+		TEST(bdla_Mxf_residual(a, vb, va, &vb, &rnorm) == BDLA_GOOD);
+		TEST(bdla_Vxf_value(vb, 0) == -2.f);
+		TEST(bdla_Vxf_value(vb, 1) == 0.f);
+		TEST(bdla_Vxf_value(vb, 2) == -2.f);
+		TEST(fabsf(rnorm - sqrtf(8.f)) < 1e-6f);
+		rnorm = 0.f;
+		TEST(bdla_Mxf_residual(a, va, va, NULL, &rnorm) == BDLA_GOOD);
+		TEST(fabsf(rnorm - sqrtf(36.f + 4.f + 36.f)) < 1e-5f);
+	}
 	/* Operation */				/* Hinted matrix-matrix multiplication */
 	bdla_Mxf_release(&a);
 	bdla_Mxf_release(&b);
@@ -366,6 +579,226 @@ void testMxf(){
 	TEST(bdla_Vxf_value(vb, 1) == -0.5);
 	TEST(bdla_Vxf_value(vb, 2) == 4.f);
 
+	/* Products big enough to be split across threads. Small integer
+	entries keep every sum exact. */
+	{
+		int i, j, k, ok = 1;
+		float acc;
+		bdla_Mxf_resize(&a, 300, 200);
+		bdla_Mxf_resize(&b, 200, 250);
+		for (i = 0; i < 300; ++i) {
+			for (j = 0; j < 200; ++j) { bdla_Mxf_writevalue(a, i, j, (float)((i + 2 * j) % 7 - 3)); }
+		}
+		for (i = 0; i < 200; ++i) {
+			for (j = 0; j < 250; ++j) { bdla_Mxf_writevalue(b, i, j, (float)((3 * i + j) % 5 - 2)); }
+		}
+		TEST(bdla_Mxf_mult(a, b, &c) == BDLA_GOOD);
+		for (i = 0; i < 300; ++i) {
+			for (j = 0; j < 250; ++j) {
+				for (acc = 0.f, k = 0; k < 200; ++k) {
+					acc += bdla_Mxf_value(a, i, k) * bdla_Mxf_value(b, k, j);
+				}
+				ok &= bdla_Mxf_value(c, i, j) == acc;
+			}
+		}
+		TEST(ok);
+		/* Same product with A stored transposed. */
+		bdla_Mxf_transpose(a, &d);
+		TEST(bdla_Mxf_value(d, 150, 250) == bdla_Mxf_value(a, 250, 150));
+		bdla_Mxf_uniform(&c, 1.f);
+		TEST(bdla_Mxf_gemm(1.f, d, BDLA_TRANS, b, BDLA_NO_TRANS, -1.f, &c) == BDLA_GOOD);
+		for (i = 0; i < 300; ++i) {
+			for (j = 0; j < 250; ++j) {
+				for (acc = -1.f, k = 0; k < 200; ++k) {
+					acc += bdla_Mxf_value(a, i, k) * bdla_Mxf_value(b, k, j);
+				}
+				ok &= bdla_Mxf_value(c, i, j) == acc;
+			}
+		}
+		TEST(ok);
+		bdla_Vxf_resize(&va, 300);
+		bdla_Vxf_resize(&vb, 200);
+		for (i = 0; i < 300; ++i) { bdla_Vxf_writevalue(va, i, (float)(i % 3 - 1)); }
+		TEST(bdla_Mxf_gemv(1.f, d, BDLA_NO_TRANS, va, 0.f, &vb) == BDLA_GOOD);
+		for (j = 0; j < 200; ++j) {
+			for (acc = 0.f, i = 0; i < 300; ++i) {
+				acc += bdla_Mxf_value(a, i, j) * bdla_Vxf_value(va, i);
+			}
+			ok &= bdla_Vxf_value(vb, j) == acc;
+		}
+		TEST(ok);
+		TEST(bdla_Mxf_gemv(1.f, a, BDLA_TRANS, va, 0.f, &vb) == BDLA_GOOD);
+		for (j = 0; j < 200; ++j) {
+			for (acc = 0.f, i = 0; i < 300; ++i) {
+				acc += bdla_Mxf_value(a, i, j) * bdla_Vxf_value(va, i);
+			}
+			ok &= bdla_Vxf_value(vb, j) == acc;
+		}
+		TEST(ok);
+	}
+
+	/* NUMA placed allocation starts zeroed whatever the policy. */
+	{
+		bdla_NumaPolicy policy;
+		bdla_Mxf na;
+		bdla_Vxf nx, ny;
+		int i, ok;
+		for (policy = BDLA_NUMA_DEFAULT; policy <= BDLA_NUMA_INTERLEAVE; ++policy) {
+			na = bdla_Mxf_create_numa(400, 300, policy);
+			nx = bdla_Vxf_create_numa(300, policy);
+			ny = bdla_Vxf_create_numa(400, policy);
+			TEST(na.arr != NULL && nx.arr != NULL && ny.arr != NULL);
+			for (ok = 1, i = 0; i < 400 * 300; ++i) { ok &= na.arr[i] == 0.f; }
+			for (i = 0; i < 300; ++i) { ok &= nx.arr[i] == 0.f; }
+			TEST(ok);
+			bdla_Mxf_uniform(&na, 0.5f);
+			bdla_Vxf_uniform(&nx, 2.f);
+			TEST(bdla_Mxf_vmult(na, nx, &ny) == BDLA_GOOD);
+			for (ok = 1, i = 0; i < 400; ++i) { ok &= ny.arr[i] == 300.f; }
+			TEST(ok);
+			TEST(bdla_Mxf_resize(&na, 500, 500) == BDLA_GOOD);
+			bdla_Mxf_release(&na);
+			bdla_Vxf_release(&nx);
+			bdla_Vxf_release(&ny);
+		}
+	}
+#ifdef __linux__
+	/* Only interleaved arrays carry a policy, which shows with more than one
+	node to interleave over. */
+	{
+		bdla_NumaPolicy policy;
+		bdla_Mxf na;
+		int mode, expect;
+		for (policy = BDLA_NUMA_DEFAULT; policy <= BDLA_NUMA_INTERLEAVE; ++policy) {
+			na = bdla_Mxf_create_numa(1024, 256, policy);
+			mode = -1;
+			expect = policy == BDLA_NUMA_INTERLEAVE && bdla_test_multinode() ? 3 : 0;
+			/* MPOL_F_ADDR: the policy of the page holding the address. */
+			if (syscall(SYS_get_mempolicy, &mode, NULL, 0, na.arr + 100000, 2) == 0) {
+				TEST(mode == expect);
+			}
+			bdla_Mxf_release(&na);
+		}
+	}
+#endif
+
+	/* Huge pages, asked for per array or above a global threshold. */
+	{
+		bdla_HugePageStats before, after;
+		bdla_Mxf ha, hb;
+		int i, ok;
+		before = bdla_hugepage_stats();
+		ha = bdla_Mxf_create_ext(1024, 1024, BDLA_NUMA_DEFAULT, BDLA_PAGES_HUGE);
+		TEST(ha.arr != NULL);
+		for (ok = 1, i = 0; i < 1024 * 1024; i += 4099) { ok &= ha.arr[i] == 0.f; }
+		TEST(ok);
+		after = bdla_hugepage_stats();
+#ifdef __linux__
+		if (bdla_test_thp()) {
+			TEST(after.requested >= before.requested + 4 * 1024 * 1024);
+		}
+#endif
+		bdla_hugepage_threshold(1024 * 1024);
+		before = after;
+		hb = bdla_Mxf_create(512, 1024);
+		bdla_Mxf_uniform(&hb, 1.f);
+		TEST(bdla_Mxf_value(hb, 511, 1023) == 1.f);
+		bdla_Mxf_release(&hb);
+		hb = bdla_Mxf_create_ext(512, 1024, BDLA_NUMA_DEFAULT, BDLA_PAGES_SMALL);
+		bdla_Mxf_release(&hb);
+		hb = bdla_Mxf_create(16, 16);
+		bdla_Mxf_release(&hb);
+		after = bdla_hugepage_stats();
+#ifdef __linux__
+		if (bdla_test_thp()) {
+			TEST(after.requested == before.requested + 2 * 1024 * 1024);
+		}
+#endif
+		bdla_hugepage_threshold(0);
+		bdla_Mxf_release(&ha);
+	}
+
+	/* Rank updates, checked entry by entry. The symmetric ones mustn't
+	touch the other triangle. */
+	{
+		bdla_Mxf ra, ry, rz;
+		bdla_Vxf ru, rv;
+		int i, j, l, ok, lower, trans, n = 150, k = 70;
+		double acc;
+		ra = bdla_Mxf_create(n, k);
+		ry = bdla_Mxf_create(n, n);
+		rz = bdla_Mxf_create(n, n);
+		ru = bdla_Vxf_create(n);
+		rv = bdla_Vxf_create(n);
+		for (i = 0; i < n * k; ++i) { ra.arr[i] = (float)((i * 7) % 13) - 6.f; }
+		for (i = 0; i < n; ++i) {
+			ru.arr[i] = (float)(i % 5) - 2.f;
+			rv.arr[i] = (float)(i % 3) + 0.5f;
+		}
+		for (i = 0; i < n * n; ++i) { rz.arr[i] = (float)(i % 11); }
+
+		bdla_Mxf_copyin(&ry, rz);
+		TEST(bdla_Mxf_ger(2.f, ru, rv, &ry) == BDLA_GOOD);
+		for (ok = 1, i = 0; i < n; ++i) {
+			for (j = 0; j < n; ++j) {
+				ok &= ry.arr[i * n + j] == rz.arr[i * n + j] + 2.f * ru.arr[i] * rv.arr[j];
+			}
+		}
+		TEST(ok);
+		for (lower = 0; lower < 2; ++lower) {
+			bdla_MatrixProperty prop = lower ? BDLA_MATRIX_TRI_LOWER : BDLA_MATRIX_TRI_UPPER;
+			bdla_Mxf_copyin(&ry, rz);
+			TEST(bdla_Mxf_syr(0.5f, ru, prop, &ry) == BDLA_GOOD);
+			TEST(bdla_Mxf_syr2(-1.f, ru, rv, prop, &ry) == BDLA_GOOD);
+			for (ok = 1, i = 0; i < n; ++i) {
+				for (j = 0; j < n; ++j) {
+					float want = rz.arr[i * n + j];
+					if (lower ? j <= i : j >= i) {
+						want += 0.5f * ru.arr[i] * ru.arr[j]
+							- (ru.arr[i] * rv.arr[j] + rv.arr[i] * ru.arr[j]);
+					}
+					ok &= fabsf(ry.arr[i * n + j] - want) < 1e-4f;
+				}
+			}
+			TEST(ok);
+			for (trans = 0; trans < 2; ++trans) {
+				int m = trans ? k : n, kk = trans ? n : k;
+				bdla_Mxf_resize(&ry, m, m);
+				for (i = 0; i < m * m; ++i) { ry.arr[i] = (float)(i % 11); }
+				TEST(bdla_Mxf_syrk(0.5f, ra, trans ? BDLA_TRANS : BDLA_NO_TRANS,
+					2.f, prop, &ry) == BDLA_GOOD);
+				for (ok = 1, i = 0; i < m; ++i) {
+					for (j = 0; j < m; ++j) {
+						acc = (double)(((i * m + j) % 11));
+						if (lower ? j <= i : j >= i) {
+							acc *= 2.;
+							for (l = 0; l < kk; ++l) {
+								acc += 0.5 * (trans
+									? (double)ra.arr[l * k + i] * ra.arr[l * k + j]
+									: (double)ra.arr[i * k + l] * ra.arr[j * k + l]);
+							}
+						}
+						ok &= fabs(ry.arr[i * m + j] - acc) < 1e-3 * (1. + fabs(acc));
+					}
+				}
+				TEST(ok);
+			}
+		}
+		/* beta = 0 sizes Y; otherwise Y's shape has to fit. */
+		bdla_Mxf_resize(&ry, 3, 3);
+		TEST(bdla_Mxf_syrk(1.f, ra, BDLA_TRANS, 0.f, BDLA_MATRIX_TRI_LOWER, &ry) == BDLA_GOOD);
+		TEST(ry.dims[0] == k && ry.dims[1] == k);
+		TEST(bdla_Mxf_syrk(1.f, ra, BDLA_NO_TRANS, 1.f, BDLA_MATRIX_TRI_LOWER, &ry)
+			== BDLA_DIMENSION_MISMATCH);
+		TEST(bdla_Mxf_ger(1.f, ru, rv, &ry) == BDLA_DIMENSION_MISMATCH);
+		TEST(bdla_Mxf_syr(1.f, ru, BDLA_MATRIX_TRI_UPPER, &ry) == BDLA_DIMENSION_MISMATCH);
+		bdla_Mxf_release(&ra);
+		bdla_Mxf_release(&ry);
+		bdla_Mxf_release(&rz);
+		bdla_Vxf_release(&ru);
+		bdla_Vxf_release(&rv);
+	}
+
 	bdla_Mxf_release(&a);
 	bdla_Mxf_release(&b);
 	bdla_Mxf_release(&c);
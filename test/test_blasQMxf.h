@@ -0,0 +1,152 @@
+#ifndef BSV_TEST_QMXF_H
+#define BSV_TEST_QMXF_H
+/*============================================================================
+test_blasQMxf.h
+
+Test functionality of 8 bit quantised matrices.
+
+Copyright(c) 2019 HJA Bird
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files(the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions :
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+============================================================================*/
+#include "../include/bdla/libbdla.h"
+
+#include <math.h>
+
+void testQMxf(){
+	SECTION("Quantised matrix float");
+	bdla_QMxf q;
+	bdla_QuantError qe;
+	bdla_Mxf a, b, c, d;
+	bdla_Vxf x, y, z;
+	int i, j, ok;
+	float err, bound, xmax;
+
+	/* Exactly representable rows. */
+	a = bdla_Mxf_create(2, 3);
+	bdla_Mxf_writevalue(a, 0, 0, 127.f);
+	bdla_Mxf_writevalue(a, 0, 1, -3.f);
+	bdla_Mxf_writevalue(a, 0, 2, 0.f);
+	bdla_Mxf_writevalue(a, 1, 0, 0.f);
+	bdla_Mxf_writevalue(a, 1, 1, 0.f);
+	bdla_Mxf_writevalue(a, 1, 2, 0.f);
+	TEST(bdla_QMxf_fromMxf(a, &q, &qe) == BDLA_GOOD);
+	TEST(bdla_QMxf_rows(q) == 2);
+	TEST(bdla_QMxf_cols(q) == 3);
+	TEST(bdla_QMxf_value(q, 0, 0) == 127.f);
+	TEST(bdla_QMxf_value(q, 0, 1) == -3.f);
+	TEST(bdla_QMxf_value(q, 1, 2) == 0.f);
+	TEST(qe.max_abs == 0.f);
+	TEST(qe.rel_frobenius == 0.f);
+	bdla_QMxf_release(&q);
+	TEST(q.arr == NULL);
+	bdla_Mxf_release(&a);
+
+	/* Error report against a round trip. Odd sizes leave SIMD tails. */
+	a = bdla_Mxf_create(37, 70);
+	for (i = 0; i < 37; ++i) {
+		for (j = 0; j < 70; ++j) {
+			bdla_Mxf_writevalue(a, i, j, sinf(0.37f * i + 1.3f * j) * (1.f + i));
+		}
+	}
+	TEST(bdla_QMxf_fromMxf(a, &q, &qe) == BDLA_GOOD);
+	b = bdla_Mxf_create(1, 1);
+	TEST(bdla_QMxf_toMxf(q, &b) == BDLA_GOOD);
+	TEST(b.dims[0] == 37 && b.dims[1] == 70);
+	err = 0.f;
+	ok = 1;
+	for (i = 0; i < 37; ++i) {
+		for (j = 0; j < 70; ++j) {
+			float e = fabsf(bdla_Mxf_value(a, i, j) - bdla_Mxf_value(b, i, j));
+			err = e > err ? e : err;
+			ok = ok && bdla_QMxf_value(q, i, j) == bdla_Mxf_value(b, i, j);
+			/* Half a step of the row's scale at most. */
+			ok = ok && e <= 0.5f * (1.f + i) / 127.f * 1.001f;
+		}
+	}
+	TEST(ok);
+	TEST(fabsf(err - qe.max_abs) <= 1e-6f * err);
+	TEST(qe.rel_frobenius > 0.f && qe.rel_frobenius < 0.01f);
+
+	/* vmult is within the stated bound of the float product. */
+	x = bdla_Vxf_create(70);
+	y = bdla_Vxf_create(37);
+	z = bdla_Vxf_create(37);
+	xmax = 0.f;
+	for (j = 0; j < 70; ++j) {
+		bdla_Vxf_writevalue(x, j, cosf(0.7f * j) - 0.2f);
+		xmax = fabsf(cosf(0.7f * j) - 0.2f) > xmax ? fabsf(cosf(0.7f * j) - 0.2f) : xmax;
+	}
+	TEST(bdla_QMxf_vmult(q, x, &y) == BDLA_GOOD);
+	bdla_Mxf_vmult(b, x, &z);
+	ok = 1;
+	for (i = 0; i < 37; ++i) {
+		bound = 0.f;
+		for (j = 0; j < 70; ++j) { bound += fabsf(bdla_Mxf_value(b, i, j)); }
+		bound = bound * xmax / 254.f * 1.01f + 1e-4f * (1.f + i);
+		ok = ok && fabsf(bdla_Vxf_value(y, i) - bdla_Vxf_value(z, i)) <= bound;
+	}
+	TEST(ok);
+	TEST(bdla_QMxf_vmult(q, y, &z) == BDLA_DIMENSION_MISMATCH);
+
+	/* mult agrees with vmult column by column, and Y may be B. */
+	c = bdla_Mxf_create(70, 5);
+	for (i = 0; i < 70; ++i) {
+		for (j = 0; j < 5; ++j) {
+			bdla_Mxf_writevalue(c, i, j, j == 2 ? bdla_Vxf_value(x, i) : sinf(1.1f * i * (j + 1)));
+		}
+	}
+	d = bdla_Mxf_create(1, 1);
+	TEST(bdla_QMxf_mult(q, c, &d) == BDLA_GOOD);
+	TEST(d.dims[0] == 37 && d.dims[1] == 5);
+	ok = 1;
+	for (i = 0; i < 37; ++i) {
+		ok = ok && bdla_Mxf_value(d, i, 2) == bdla_Vxf_value(y, i);
+	}
+	TEST(ok);
+	TEST(bdla_QMxf_mult(q, c, &c) == BDLA_GOOD);
+	TEST(c.dims[0] == 37 && c.dims[1] == 5);
+	TEST(memcmp(c.arr, d.arr, sizeof(float) * 37 * 5) == 0);
+	TEST(bdla_QMxf_mult(q, d, &c) == BDLA_DIMENSION_MISMATCH);
+	bdla_QMxf_release(&q);
+	bdla_Mxf_release(&a);
+	bdla_Mxf_release(&b);
+	bdla_Mxf_release(&c);
+	bdla_Mxf_release(&d);
+	bdla_Vxf_release(&x);
+	bdla_Vxf_release(&y);
+	bdla_Vxf_release(&z);
+
+	/* Long rows are summed in several chunks. */
+	a = bdla_Mxf_create(2, 70001);
+	x = bdla_Vxf_create(70001);
+	y = bdla_Vxf_create(2);
+	bdla_Mxf_uniform(&a, 1.f);
+	bdla_Mxf_writevalue(a, 1, 5, -1.f);
+	bdla_Vxf_uniform(&x, -1.f);
+	TEST(bdla_QMxf_fromMxf(a, &q, NULL) == BDLA_GOOD);
+	TEST(bdla_QMxf_vmult(q, x, &y) == BDLA_GOOD);
+	TEST(bdla_Vxf_value(y, 0) == -70001.f);
+	TEST(bdla_Vxf_value(y, 1) == -69999.f);
+	bdla_QMxf_release(&q);
+	bdla_Mxf_release(&a);
+	bdla_Vxf_release(&x);
+	bdla_Vxf_release(&y);
+}
+#endif /* BSV_TEST_QMXF_H */
@@ -0,0 +1,121 @@
+#ifndef BSV_TEST_SMXF_H
+#define BSV_TEST_SMXF_H
+/*============================================================================
+test_blasSMxf.h
+
+Test functionality of compressed sparse row float matrices.
+
+Copyright(c) 2019 HJA Bird
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files(the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions :
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+============================================================================*/
+#include "../include/bdla/libbdla.h"
+
+void testSMxf(){
+	SECTION("Sparse matrix float");
+	int sx = 4;
+	bdla_Mxf mat = bdla_Mxf_create(sx, sx);
+	bdla_Mxf back = bdla_Mxf_create(sx, sx);
+	bdla_SMxf sa, sb;
+	bdla_Vxf a, b, c, d;
+	a = bdla_Vxf_create(sx);
+	b = bdla_Vxf_create(sx);
+	c = bdla_Vxf_create(sx);
+	d = bdla_Vxf_create(sx);
+	/* The same system as the dense solver tests. */
+	bdla_Mxf_uniform(&mat, -1.f);
+	bdla_Mxf_writevalue(mat, 0, 0, 10.f);
+	bdla_Mxf_writevalue(mat, 1, 1, 11.f);
+	bdla_Mxf_writevalue(mat, 2, 2, 10.f);
+	bdla_Mxf_writevalue(mat, 3, 3, 8.f);
+	bdla_Mxf_writevalue(mat, 0, 2, 2.f);
+	bdla_Mxf_writevalue(mat, 0, 3, 0.f);
+	bdla_Mxf_writevalue(mat, 1, 3, 3.f);
+	bdla_Mxf_writevalue(mat, 2, 0, 2.f);
+	bdla_Mxf_writevalue(mat, 3, 0, 0.f);
+	bdla_Mxf_writevalue(mat, 3, 1, 3.f);
+	bdla_Vxf_writevalue(a, 0, 6.f);
+	bdla_Vxf_writevalue(a, 1, 25.f);
+	bdla_Vxf_writevalue(a, 2, -11.f);
+	bdla_Vxf_writevalue(a, 3, 15.f);
+	bdla_Vxf_writevalue(d, 0, 1.f);
+	bdla_Vxf_writevalue(d, 1, 2.f);
+	bdla_Vxf_writevalue(d, 2, -1.f);
+	bdla_Vxf_writevalue(d, 3, 1.f);
+
+	/* Conversion from dense */
+	TEST(bdla_SMxf_fromMxf(mat, &sa) == BDLA_GOOD);
+	TEST(bdla_SMxf_rows(sa) == 4);
+	TEST(bdla_SMxf_cols(sa) == 4);
+	TEST(bdla_SMxf_nnz(sa) == 14);
+	TEST(bdla_SMxf_value(sa, 0, 2) == 2.f);
+	TEST(bdla_SMxf_value(sa, 0, 3) == 0.f);
+	TEST(bdla_SMxf_value(sa, 3, 3) == 8.f);
+	TEST(bdla_SMxf_toMxf(sa, &back) == BDLA_GOOD);
+	TEST(bdla_Mxf_isequal(mat, back));
+	/* Sparse matrix - vector multiplication */
+	bdla_Mxf_vmult(mat, a, &b);
+	TEST(bdla_SMxf_vmult(sa, a, &c) == BDLA_GOOD);
+	TEST(bdla_Vxf_isequal(b, c));
+	bdla_Vxf_copyin(&c, a);
+	TEST(bdla_SMxf_vmult(sa, c, &c) == BDLA_GOOD);
+	TEST(bdla_Vxf_isequal(b, c));
+	{
+		float rnorm = -1.f;
+		TEST(bdla_SMxf_residual(sa, d, a, &c, &rnorm) == BDLA_GOOD);
+		TEST(bdla_Vxf_norm2(c) == 0.f);
+		TEST(rnorm == 0.f);
+		TEST(bdla_SMxf_residual(sa, a, b, NULL, &rnorm) == BDLA_GOOD);
+		TEST(rnorm == 0.f);
+	}
+
+	/* Conversion from triplets, with a duplicate to be summed. */
+	{
+		int rows[5] = { 2, 0, 2, 1, 2 };
+		int cols[5] = { 1, 0, 0, 2, 1 };
+		float vals[5] = { 1.f, 4.f, 3.f, -2.f, 0.5f };
+		TEST(bdla_SMxf_fromtriplets(3, 3, 5, rows, cols, vals, &sb) == BDLA_GOOD);
+		TEST(bdla_SMxf_nnz(sb) == 4);
+		TEST(bdla_SMxf_value(sb, 2, 1) == 1.5f);
+		TEST(bdla_SMxf_value(sb, 2, 0) == 3.f);
+		TEST(bdla_SMxf_value(sb, 1, 2) == -2.f);
+		TEST(bdla_SMxf_value(sb, 1, 1) == 0.f);
+		TEST(sb.col_idx[sb.row_ptr[2]] == 0);
+		bdla_SMxf_release(&sb);
+		rows[3] = 3;
+		TEST(bdla_SMxf_fromtriplets(3, 3, 5, rows, cols, vals, &sb) == BDLA_BAD_INDEX);
+	}
+
+	/* Iterative solvers */
+	TEST(bdla_SMxf_solve_jacobi(sa, a, &c, 0.0000001f, NULL, NULL) == BDLA_GOOD);
+	bdla_Vxf_minus(c, d, &b);
+	TEST(bdla_Vxf_norm2(b) / bdla_Vxf_norm2(d) < 0.0000001f);
+	TEST(bdla_SMxf_solve_gauss_seidel(sa, a, &c, 0.0001f, NULL, NULL) == BDLA_GOOD);
+	bdla_Vxf_minus(c, d, &b);
+	TEST(bdla_Vxf_norm2(b) / bdla_Vxf_norm2(d) < 0.0001f);
+
+	bdla_SMxf_release(&sa);
+	bdla_Mxf_release(&mat);
+	bdla_Mxf_release(&back);
+	bdla_Vxf_release(&a);
+	bdla_Vxf_release(&b);
+	bdla_Vxf_release(&c);
+	bdla_Vxf_release(&d);
+}
+#endif /* BSV_TEST_SMXF_H */
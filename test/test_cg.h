@@ -0,0 +1,95 @@
+#ifndef BSV_TEST_CG_H
+#define BSV_TEST_CG_H
+/*============================================================================
+test_cg.h
+
+Test the conjugate gradient solvers.
+
+Copyright(c) 2019 HJA Bird
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files(the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions :
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+============================================================================*/
+#include "../include/bdla/libbdla.h"
+
+void testCG(){
+	SECTION("Conjugate gradient solver");
+	bdla_Mxf a;
+	bdla_SMxf s;
+	bdla_HMxf h;
+	bdla_Vxf x, b, y, e;
+	int i, iters, n = 200;
+
+	/* The 1D Laplacian plus a little on the diagonal: SPD, but nowhere
+	near diagonally dominant enough for Jacobi to be quick. */
+	a = bdla_Mxf_create(n, n);
+	bdla_Mxf_zero(&a);
+	for (i = 0; i < n; ++i) {
+		bdla_Mxf_writevalue(a, i, i, 2.01f);
+		if (i > 0) { bdla_Mxf_writevalue(a, i, i - 1, -1.f); }
+		if (i < n - 1) { bdla_Mxf_writevalue(a, i, i + 1, -1.f); }
+	}
+	x = bdla_Vxf_create(n);
+	b = bdla_Vxf_create(n);
+	y = bdla_Vxf_create(n);
+	e = bdla_Vxf_create(n);
+	for (i = 0; i < n; ++i) { bdla_Vxf_writevalue(x, i, (float)(i % 5) - 2.f); }
+	bdla_Mxf_vmult(a, x, &b);
+
+	TEST(bdla_Mxf_solve_cg(a, b, &y, 1e-6f, NULL, NULL) == BDLA_GOOD);
+	bdla_Vxf_minus(y, x, &e);
+	TEST(bdla_Vxf_norm2(e) / bdla_Vxf_norm2(x) < 1e-4f);
+
+	TEST(bdla_SMxf_fromMxf(a, &s) == BDLA_GOOD);
+	bdla_Vxf_zero(&y);
+	TEST(bdla_SMxf_solve_cg(s, b, &y, 1e-6f, NULL, NULL) == BDLA_GOOD);
+	bdla_Vxf_minus(y, x, &e);
+	TEST(bdla_Vxf_norm2(e) / bdla_Vxf_norm2(x) < 1e-4f);
+
+	/* The off-diagonal entries are exact in FP16, but 2.01 rounds to
+	2.0097656, so this solves a slightly different system: hence the looser
+	tolerance. */
+	TEST(bdla_HMxf_fromMxf(a, BDLA_HALF_FP16, &h) == BDLA_GOOD);
+	bdla_Vxf_zero(&y);
+	TEST(bdla_HMxf_solve_cg(h, b, &y, 1e-6f, NULL, NULL) == BDLA_GOOD);
+	bdla_Vxf_minus(y, x, &e);
+	TEST(bdla_Vxf_norm2(e) / bdla_Vxf_norm2(x) < 1e-3f);
+
+	/* Iteration limit and a starting guess. */
+	iters = 3;
+	bdla_Vxf_copyin(&e, x);
+	TEST(bdla_Mxf_solve_cg(a, b, &y, 1e-6f, &e, &iters) == BDLA_GOOD);
+	bdla_Vxf_minus(y, x, &e);
+	TEST(bdla_Vxf_norm2(e) / bdla_Vxf_norm2(x) < 1e-5f);
+
+	/* Negative definite. */
+	bdla_Mxf_fmult(a, -1.f, &a);
+	TEST(bdla_Mxf_solve_cg(a, b, &y, 1e-6f, NULL, NULL) == BDLA_BAD_PROPERTY);
+	/* Shapes */
+	bdla_Vxf_resize(&b, n - 1);
+	TEST(bdla_Mxf_solve_cg(a, b, &y, 1e-6f, NULL, NULL) == BDLA_DIMENSION_MISMATCH);
+
+	bdla_Mxf_release(&a);
+	bdla_SMxf_release(&s);
+	bdla_HMxf_release(&h);
+	bdla_Vxf_release(&x);
+	bdla_Vxf_release(&b);
+	bdla_Vxf_release(&y);
+	bdla_Vxf_release(&e);
+}
+#endif /* BSV_TEST_CG_H */
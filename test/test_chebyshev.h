@@ -0,0 +1,128 @@
+#ifndef BSV_TEST_CHEBYSHEV_H
+#define BSV_TEST_CHEBYSHEV_H
+/*============================================================================
+test_chebyshev.h
+
+Test the Chebyshev and s-step conjugate gradient solvers.
+
+Copyright(c) 2019 HJA Bird
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files(the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions :
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+============================================================================*/
+#include "../include/bdla/libbdla.h"
+
+#include <math.h>
+
+void testChebyshev(){
+	SECTION("Chebyshev and s-step solvers");
+	bdla_Mxf a;
+	bdla_SMxf s;
+	bdla_HMxf h;
+	bdla_Vxf x, b, y, e;
+	int i, iters, steps, n = 200;
+	float rnorm;
+	/* The eigenvalues of the matrix below are 2.01 - 2 cos(k pi / (n + 1)). */
+	float lmin = 0.01f, lmax = 4.01f;
+
+	a = bdla_Mxf_create(n, n);
+	bdla_Mxf_zero(&a);
+	for (i = 0; i < n; ++i) {
+		bdla_Mxf_writevalue(a, i, i, 2.01f);
+		if (i > 0) { bdla_Mxf_writevalue(a, i, i - 1, -1.f); }
+		if (i < n - 1) { bdla_Mxf_writevalue(a, i, i + 1, -1.f); }
+	}
+	x = bdla_Vxf_create(n);
+	b = bdla_Vxf_create(n);
+	y = bdla_Vxf_create(n);
+	e = bdla_Vxf_create(n);
+	for (i = 0; i < n; ++i) { bdla_Vxf_writevalue(x, i, (float)(i % 5) - 2.f); }
+	bdla_Mxf_vmult(a, x, &b);
+	TEST(bdla_SMxf_fromMxf(a, &s) == BDLA_GOOD);
+	TEST(bdla_HMxf_fromMxf(a, BDLA_HALF_FP16, &h) == BDLA_GOOD);
+
+	/* Chebyshev, on each matrix type. */
+	TEST(bdla_Mxf_solve_chebyshev(a, b, &y, lmin, lmax, 1e-6f, NULL, NULL) == BDLA_GOOD);
+	bdla_Vxf_minus(y, x, &e);
+	TEST(bdla_Vxf_norm2(e) / bdla_Vxf_norm2(x) < 1e-3f);
+	bdla_Vxf_zero(&y);
+	TEST(bdla_SMxf_solve_chebyshev(s, b, &y, lmin, lmax, 1e-6f, NULL, NULL) == BDLA_GOOD);
+	bdla_Vxf_minus(y, x, &e);
+	TEST(bdla_Vxf_norm2(e) / bdla_Vxf_norm2(x) < 1e-3f);
+	bdla_Vxf_zero(&y);
+	TEST(bdla_HMxf_solve_chebyshev(h, b, &y, lmin, lmax, 1e-6f, NULL, NULL) == BDLA_GOOD);
+	bdla_Vxf_minus(y, x, &e);
+	TEST(bdla_Vxf_norm2(e) / bdla_Vxf_norm2(x) < 1e-3f);
+	/* Loose bounds still converge, just more slowly, and a guess helps. */
+	TEST(bdla_Mxf_solve_chebyshev(a, b, &y, 0.005f, 5.f, 1e-5f, NULL, NULL) == BDLA_GOOD);
+	bdla_Vxf_minus(y, x, &e);
+	TEST(bdla_Vxf_norm2(e) / bdla_Vxf_norm2(x) < 1e-2f);
+	bdla_Vxf_copyin(&e, x);
+	iters = 2;
+	TEST(bdla_Mxf_solve_chebyshev(a, b, &y, lmin, lmax, 1e-6f, &e, &iters) == BDLA_GOOD);
+	bdla_Vxf_minus(y, x, &e);
+	TEST(bdla_Vxf_norm2(e) / bdla_Vxf_norm2(x) < 1e-5f);
+	/* Bounds that miss the top of the spectrum, and well above the bottom,
+	where the residual still falls but too slowly to reach tol. */
+	TEST(bdla_Mxf_solve_chebyshev(a, b, &y, lmin, 2.f, 1e-6f, NULL, NULL) == BDLA_BAD_PROPERTY);
+	TEST(bdla_Mxf_solve_chebyshev(a, b, &y, 1.f, lmax, 1e-6f, NULL, NULL) == BDLA_BAD_PROPERTY);
+	TEST(bdla_Mxf_solve_chebyshev(a, b, &y, 0.1f, lmax, 1e-6f, NULL, NULL) == BDLA_BAD_PROPERTY);
+	/* Only a little above it gets there in the end, and then it really has. */
+	bdla_Vxf_zero(&y);
+	TEST(bdla_Mxf_solve_chebyshev(a, b, &y, 0.02f, lmax, 1e-6f, NULL, NULL) == BDLA_GOOD);
+	TEST(bdla_Mxf_residual(a, y, b, NULL, &rnorm) == BDLA_GOOD);
+	TEST(rnorm <= 1e-6f * bdla_Vxf_norm2(b));
+
+	/* s-step CG, for each block size and matrix type. */
+	for (steps = 1; steps <= 8; steps *= 2) {
+		bdla_Vxf_zero(&y);
+		TEST(bdla_Mxf_solve_cg_sstep(a, b, &y, steps, 1e-6f, NULL, NULL) == BDLA_GOOD);
+		bdla_Vxf_minus(y, x, &e);
+		TEST(bdla_Vxf_norm2(e) / bdla_Vxf_norm2(x) < 1e-3f);
+	}
+	bdla_Vxf_zero(&y);
+	TEST(bdla_SMxf_solve_cg_sstep(s, b, &y, 4, 1e-6f, NULL, NULL) == BDLA_GOOD);
+	bdla_Vxf_minus(y, x, &e);
+	TEST(bdla_Vxf_norm2(e) / bdla_Vxf_norm2(x) < 1e-3f);
+	bdla_Vxf_zero(&y);
+	TEST(bdla_HMxf_solve_cg_sstep(h, b, &y, 4, 1e-6f, NULL, NULL) == BDLA_GOOD);
+	bdla_Vxf_minus(y, x, &e);
+	TEST(bdla_Vxf_norm2(e) / bdla_Vxf_norm2(x) < 1e-3f);
+	/* A block of steps from the answer stays there. */
+	bdla_Vxf_copyin(&e, x);
+	iters = 1;
+	TEST(bdla_Mxf_solve_cg_sstep(a, b, &y, 4, 1e-6f, &e, &iters) == BDLA_GOOD);
+	bdla_Vxf_minus(y, x, &e);
+	TEST(bdla_Vxf_norm2(e) / bdla_Vxf_norm2(x) < 1e-5f);
+
+	/* Negative definite, and shapes. */
+	bdla_Mxf_fmult(a, -1.f, &a);
+	TEST(bdla_Mxf_solve_cg_sstep(a, b, &y, 4, 1e-6f, NULL, NULL) == BDLA_BAD_PROPERTY);
+	bdla_Vxf_resize(&b, n - 1);
+	TEST(bdla_Mxf_solve_cg_sstep(a, b, &y, 4, 1e-6f, NULL, NULL) == BDLA_DIMENSION_MISMATCH);
+	TEST(bdla_Mxf_solve_chebyshev(a, b, &y, lmin, lmax, 1e-6f, NULL, NULL) == BDLA_DIMENSION_MISMATCH);
+
+	bdla_Mxf_release(&a);
+	bdla_SMxf_release(&s);
+	bdla_HMxf_release(&h);
+	bdla_Vxf_release(&x);
+	bdla_Vxf_release(&b);
+	bdla_Vxf_release(&y);
+	bdla_Vxf_release(&e);
+}
+#endif /* BSV_TEST_CHEBYSHEV_H */
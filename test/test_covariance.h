@@ -0,0 +1,137 @@
+#ifndef BSV_TEST_COVARIANCE_H
+#define BSV_TEST_COVARIANCE_H
+/*============================================================================
+test_covariance.h
+
+Test the streaming covariance accumulator.
+
+Copyright(c) 2019 HJA Bird
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files(the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions :
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+============================================================================*/
+#include "../include/bdla/libbdla.h"
+
+#include <math.h>
+
+void testCovariance(){
+	SECTION("Streaming covariance");
+	bdla_Covf acc, half;
+	bdla_Mxf X, cov, cov2, G;
+	bdla_Vxf x, mean, mean2;
+	int i, j, l, ok, d = 7, n = 1000;
+	double ref_mean[7], ref_cov[49], ref_gram[49], s;
+	/* A large offset with small spread, which a naive sum of squares in
+	float can't resolve. */
+	X = bdla_Mxf_create(n, d);
+	for (i = 0; i < n; ++i) {
+		for (j = 0; j < d; ++j) {
+			X.arr[i * d + j] = 1000.f * (float)(j + 1)
+				+ (float)((i * (j + 3) * 7919) % 101) / 50.f - 1.f;
+		}
+		X.arr[i * d + 1] += X.arr[i * d] - 1000.f;
+	}
+	for (j = 0; j < d; ++j) {
+		for (s = 0., i = 0; i < n; ++i) { s += X.arr[i * d + j]; }
+		ref_mean[j] = s / n;
+	}
+	for (j = 0; j < d; ++j) {
+		for (l = 0; l < d; ++l) {
+			for (s = 0., i = 0; i < n; ++i) {
+				s += (X.arr[i * d + j] - ref_mean[j]) * (X.arr[i * d + l] - ref_mean[l]);
+			}
+			ref_cov[j * d + l] = s / (n - 1);
+			for (s = 0., i = 0; i < n; ++i) { s += (double)X.arr[i * d + j] * X.arr[i * d + l]; }
+			ref_gram[j * d + l] = s;
+		}
+	}
+	x = bdla_Vxf_create(d);
+	mean = bdla_Vxf_create(1);
+	mean2 = bdla_Vxf_create(1);
+	cov = bdla_Mxf_create(1, 1);
+	cov2 = bdla_Mxf_create(1, 1);
+	G = bdla_Mxf_create(d, d);
+
+	/* Samples one at a time and in rows, across several blocks. */
+	acc = bdla_Covf_create(d, 64);
+	TEST(acc.buf != NULL);
+	TEST(bdla_Covf_finalise(&acc, 1, &mean, &cov) == BDLA_UNDERSIZED);
+	for (ok = 1, i = 0; i < 100; ++i) {
+		bdla_Mxf_row(X, i, &x);
+		ok &= bdla_Covf_add(&acc, x) == BDLA_GOOD;
+	}
+	TEST(ok);
+	bdla_Mxf tail = { { n - 100, d }, X.arr + 100 * d };
+	TEST(bdla_Covf_addrows(&acc, tail) == BDLA_GOOD);
+	TEST(bdla_Covf_count(acc) == n);
+	TEST(bdla_Covf_finalise(&acc, 1, &mean, &cov) == BDLA_GOOD);
+	TEST(mean.len == d && cov.dims[0] == d && cov.dims[1] == d);
+	for (ok = 1, j = 0; j < d; ++j) {
+		ok &= fabs(mean.arr[j] - ref_mean[j]) < 1e-6 * fabs(ref_mean[j]);
+		for (l = 0; l < d; ++l) {
+			ok &= fabs(cov.arr[j * d + l] - ref_cov[j * d + l]) < 1e-4 * (1. + fabs(ref_cov[j * d + l]));
+		}
+	}
+	TEST(ok);
+	TEST(bdla_Covf_gram(&acc, &G) == BDLA_GOOD);
+	for (ok = 1, j = 0; j < d * d; ++j) {
+		ok &= fabs(G.arr[j] - ref_gram[j]) < 1e-6 * fabs(ref_gram[j]);
+	}
+	TEST(ok);
+
+	/* Two partial accumulators, with blocks left part full, merge to the
+	same answer. */
+	bdla_Covf_release(&acc);
+	acc = bdla_Covf_create(d, 0);
+	half = bdla_Covf_create(d, 100);
+	bdla_Mxf first = { { 333, d }, X.arr };
+	bdla_Mxf second = { { n - 333, d }, X.arr + 333 * d };
+	TEST(bdla_Covf_addrows(&acc, first) == BDLA_GOOD);
+	TEST(bdla_Covf_addrows(&half, second) == BDLA_GOOD);
+	TEST(bdla_Covf_merge(&acc, &half) == BDLA_GOOD);
+	TEST(bdla_Covf_count(acc) == n);
+	TEST(bdla_Covf_finalise(&acc, 1, &mean2, &cov2) == BDLA_GOOD);
+	for (ok = 1, j = 0; j < d; ++j) {
+		ok &= fabsf(mean2.arr[j] - mean.arr[j]) <= 1e-6f * fabsf(mean.arr[j]);
+	}
+	for (j = 0; j < d * d; ++j) {
+		ok &= fabsf(cov2.arr[j] - cov.arr[j]) <= 1e-4f * (1.f + fabsf(cov.arr[j]));
+	}
+	TEST(ok);
+	/* Population covariance, and without the mean. */
+	TEST(bdla_Covf_finalise(&acc, 0, NULL, &cov2) == BDLA_GOOD);
+	TEST(fabsf(cov2.arr[0] - cov.arr[0] * (n - 1) / n) <= 1e-4f * cov.arr[0]);
+
+	bdla_Covf_release(&half);
+	half = bdla_Covf_create(d + 1, 0);
+	TEST(bdla_Covf_merge(&acc, &half) == BDLA_DIMENSION_MISMATCH);
+	TEST(bdla_Covf_add(&acc, mean2) == BDLA_GOOD);
+	bdla_Vxf_resize(&mean2, d + 1);
+	TEST(bdla_Covf_add(&acc, mean2) == BDLA_DIMENSION_MISMATCH);
+
+	bdla_Covf_release(&acc);
+	bdla_Covf_release(&half);
+	bdla_Mxf_release(&X);
+	bdla_Mxf_release(&cov);
+	bdla_Mxf_release(&cov2);
+	bdla_Mxf_release(&G);
+	bdla_Vxf_release(&x);
+	bdla_Vxf_release(&mean);
+	bdla_Vxf_release(&mean2);
+}
+#endif /* BSV_TEST_COVARIANCE_H */
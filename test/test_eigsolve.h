@@ -0,0 +1,160 @@
+#ifndef BSV_TEST_EIGSOLVE_H
+#define BSV_TEST_EIGSOLVE_H
+/*============================================================================
+test_eigsolve.h
+
+Test the iterative symmetric eigensolvers.
+
+Copyright(c) 2019 HJA Bird
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files(the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions :
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+============================================================================*/
+#include "../include/bdla/libbdla.h"
+
+#include <math.h>
+
+/* A = H diag(d) H with H the reflector I - 2 u u^T / u^T u, so the
+eigenvectors are H's columns. */
+static bdla_Mxf testEig_matrix(const float *d, int n, bdla_Mxf *H) {
+	bdla_Mxf a = bdla_Mxf_create(n, n), t = bdla_Mxf_create(n, n);
+	bdla_Vxf u = bdla_Vxf_create(n);
+	int i, j;
+	float uu;
+	for (i = 0; i < n; ++i) { bdla_Vxf_writevalue(u, i, sinf(0.9f * i + 0.3f)); }
+	uu = bdla_Vxf_dot(u, u);
+	*H = bdla_Mxf_create(n, n);
+	for (i = 0; i < n; ++i) {
+		for (j = 0; j < n; ++j) {
+			bdla_Mxf_writevalue(*H, i, j, (i == j ? 1.f : 0.f)
+				- 2.f * bdla_Vxf_value(u, i) * bdla_Vxf_value(u, j) / uu);
+			bdla_Mxf_writevalue(t, i, j, bdla_Mxf_value(*H, i, j) * d[j]);
+		}
+	}
+	bdla_Mxf_mult(t, *H, &a);
+	bdla_Mxf_release(&t);
+	bdla_Vxf_release(&u);
+	return a;
+}
+
+/* Largest |A v_i - lambda_i v_i| / |lambda_0| over the columns of V. */
+static float testEig_residual(bdla_Mxf a, bdla_Vxf lambda, bdla_Mxf v) {
+	int i, n = bdla_Mxf_rows(a);
+	float worst = 0.f, r;
+	bdla_Vxf x = bdla_Vxf_create(n), y = bdla_Vxf_create(n);
+	for (i = 0; i < bdla_Vxf_length(lambda); ++i) {
+		bdla_Mxf_col(v, i, &x);
+		bdla_Mxf_vmult(a, x, &y);
+		bdla_Vxf_fmult(x, bdla_Vxf_value(lambda, i), &x);
+		bdla_Vxf_minus(y, x, &y);
+		r = bdla_Vxf_norm2(y) / fabsf(bdla_Vxf_value(lambda, 0));
+		worst = r > worst ? r : worst;
+	}
+	bdla_Vxf_release(&x);
+	bdla_Vxf_release(&y);
+	return worst;
+}
+
+void testEigsolve(){
+	SECTION("Iterative eigensolvers");
+	bdla_Mxf a, h, v, w;
+	bdla_Vxf x, lambda;
+	float d[300], lam;
+	int i, iters, n = 300;
+
+	/* 100, -50, 33.3, -25, ... */
+	for (i = 0; i < n; ++i) { d[i] = (i % 2 ? -100.f : 100.f) / (i + 1); }
+	a = testEig_matrix(d, n, &h);
+	x = bdla_Vxf_create(n);
+	lambda = bdla_Vxf_create(1);
+	v = bdla_Mxf_create(1, 1);
+	w = bdla_Mxf_create(1, 1);
+
+	/* Power iteration, plain and shifted to find the far end. */
+	bdla_Vxf_zero(&x);
+	TEST(bdla_Mxf_eig_power(a, BDLA_MATRIX_SYMMETRIC, 0.f, &lam, &x, 1e-5f, NULL) == BDLA_GOOD);
+	TEST(fabsf(lam - 100.f) < 1e-3f);
+	TEST(fabsf(bdla_Vxf_norm2(x) - 1.f) < 1e-5f);
+	bdla_Vxf_resize(&lambda, n);
+	bdla_Mxf_col(h, 0, &lambda);
+	TEST(fabsf(fabsf(bdla_Vxf_dot(x, lambda)) - 1.f) < 1e-4f);
+	TEST(bdla_Mxf_eig_power(a, BDLA_MATRIX_SYMMETRIC, 100.f, &lam, &x, 1e-5f, NULL) == BDLA_GOOD);
+	TEST(fabsf(lam + 50.f) < 1e-3f);
+	iters = 2;
+	bdla_Vxf_zero(&x);
+	TEST(bdla_Mxf_eig_power(a, BDLA_MATRIX_SYMMETRIC, 0.f, &lam, &x, 1e-5f, &iters) == BDLA_GOOD);
+	TEST(fabsf(lam - 100.f) > 1e-3f);
+
+	/* Lanczos gets several pairs from a limited number of products. */
+	iters = 120;
+	TEST(bdla_Mxf_eig_lanczos(a, BDLA_MATRIX_SYMMETRIC, 4, &lambda, &v, 1e-5f, &iters) == BDLA_GOOD);
+	TEST(bdla_Vxf_length(lambda) == 4);
+	TEST(bdla_Mxf_rows(v) == n && bdla_Mxf_cols(v) == 4);
+	TEST(fabsf(bdla_Vxf_value(lambda, 0) - d[0]) < 1e-3f);
+	TEST(fabsf(bdla_Vxf_value(lambda, 1) - d[1]) < 1e-3f);
+	TEST(fabsf(bdla_Vxf_value(lambda, 2) - d[2]) < 1e-3f);
+	TEST(fabsf(bdla_Vxf_value(lambda, 3) - d[3]) < 1e-3f);
+	TEST(testEig_residual(a, lambda, v) < 1e-4f);
+	/* Orthonormal eigenvectors. */
+	bdla_Mxf_gemm(1.f, v, BDLA_TRANS, v, BDLA_NO_TRANS, 0.f, &w);
+	bdla_Mxf_fdiagshift(&w, -1.f, 0);
+	TEST(bdla_Mxf_isequal(w, w) && fabsf(bdla_Mxf_value(w, 0, 0)) < 1e-4f
+		&& fabsf(bdla_Mxf_value(w, 3, 1)) < 1e-4f);
+
+	/* Blocks agree, including a block wider than k. */
+	TEST(bdla_Mxf_eig_lanczos_block(a, BDLA_MATRIX_SYMMETRIC, 4, 3, &lambda, &v, 1e-5f, NULL) == BDLA_GOOD);
+	TEST(fabsf(bdla_Vxf_value(lambda, 3) - d[3]) < 1e-3f);
+	TEST(testEig_residual(a, lambda, v) < 1e-4f);
+	TEST(bdla_Mxf_eig_lanczos_block(a, BDLA_MATRIX_SYMMETRIC, 2, 5, &lambda, NULL, 1e-5f, NULL) == BDLA_GOOD);
+	TEST(fabsf(bdla_Vxf_value(lambda, 1) - d[1]) < 1e-3f);
+	bdla_Mxf_release(&a);
+	bdla_Mxf_release(&h);
+
+	/* A triple eigenvalue needs a block as wide to be found whole. */
+	for (i = 0; i < n; ++i) { d[i] = i < 3 ? 5.f : 4.f * cosf((float)i); }
+	a = testEig_matrix(d, n, &h);
+	TEST(bdla_Mxf_eig_lanczos_block(a, BDLA_MATRIX_SYMMETRIC, 3, 3, &lambda, &v, 1e-5f, NULL) == BDLA_GOOD);
+	TEST(fabsf(bdla_Vxf_value(lambda, 0) - 5.f) < 1e-3f);
+	TEST(fabsf(bdla_Vxf_value(lambda, 2) - 5.f) < 1e-3f);
+	TEST(testEig_residual(a, lambda, v) < 1e-4f);
+	bdla_Mxf_release(&a);
+	bdla_Mxf_release(&h);
+
+	/* Small matrices are solved directly. */
+	for (i = 0; i < 10; ++i) { d[i] = (float)(i + 1); }
+	a = testEig_matrix(d, 10, &h);
+	TEST(bdla_Mxf_eig_lanczos(a, BDLA_MATRIX_POSITIVE_DEFINITE, 2, &lambda, &v, 1e-5f, NULL) == BDLA_GOOD);
+	TEST(fabsf(bdla_Vxf_value(lambda, 0) - 10.f) < 1e-4f);
+	TEST(fabsf(bdla_Vxf_value(lambda, 1) - 9.f) < 1e-4f);
+	TEST(testEig_residual(a, lambda, v) < 1e-5f);
+
+	/* Bad arguments */
+	TEST(bdla_Mxf_eig_lanczos(a, BDLA_MATRIX_GENERAL, 2, &lambda, &v, 1e-5f, NULL) == BDLA_BAD_PROPERTY);
+	TEST(bdla_Mxf_eig_lanczos(a, BDLA_MATRIX_SYMMETRIC, 11, &lambda, &v, 1e-5f, NULL) == BDLA_DIMENSION_MISMATCH);
+	TEST(bdla_Mxf_eig_power(a, BDLA_MATRIX_SYMMETRIC, 0.f, &lam, &x, 1e-5f, NULL) == BDLA_DIMENSION_MISMATCH);
+	bdla_Mxf_resize(&a, 10, 9);
+	TEST(bdla_Mxf_eig_lanczos(a, BDLA_MATRIX_SYMMETRIC, 2, &lambda, &v, 1e-5f, NULL) == BDLA_NONSQUARE);
+
+	bdla_Mxf_release(&a);
+	bdla_Mxf_release(&h);
+	bdla_Mxf_release(&v);
+	bdla_Mxf_release(&w);
+	bdla_Vxf_release(&x);
+	bdla_Vxf_release(&lambda);
+}
+#endif /* BSV_TEST_EIGSOLVE_H */
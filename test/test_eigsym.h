@@ -0,0 +1,141 @@
+#ifndef BSV_TEST_EIGSYM_H
+#define BSV_TEST_EIGSYM_H
+/*============================================================================
+test_eigsym.h
+
+Test the dense symmetric eigensolver.
+
+Copyright(c) 2019 HJA Bird
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files(the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions :
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+============================================================================*/
+#include "../include/bdla/libbdla.h"
+
+#include <math.h>
+
+/* max |A V - V diag(lambda)| / max |lambda| and max |V^T V - I|. */
+static void testEigSym_check(bdla_Mxf a, bdla_Vxf lambda, bdla_Mxf v,
+	float *residual, float *orth) {
+	int i, j, n = bdla_Mxf_rows(a);
+	float scale = 0.f, t;
+	bdla_Mxf av = bdla_Mxf_create(n, n), vtv = bdla_Mxf_create(n, n);
+	for (i = 0; i < n; ++i) {
+		t = fabsf(bdla_Vxf_value(lambda, i));
+		scale = t > scale ? t : scale;
+	}
+	bdla_Mxf_mult(a, v, &av);
+	bdla_Mxf_gemm(1.f, v, BDLA_TRANS, v, BDLA_NO_TRANS, 0.f, &vtv);
+	*residual = *orth = 0.f;
+	for (i = 0; i < n; ++i) {
+		for (j = 0; j < n; ++j) {
+			t = fabsf(bdla_Mxf_value(av, i, j) - bdla_Mxf_value(v, i, j) * bdla_Vxf_value(lambda, j));
+			*residual = t / scale > *residual ? t / scale : *residual;
+			t = fabsf(bdla_Mxf_value(vtv, i, j) - (i == j ? 1.f : 0.f));
+			*orth = t > *orth ? t : *orth;
+		}
+	}
+	bdla_Mxf_release(&av);
+	bdla_Mxf_release(&vtv);
+}
+
+void testEigSym(){
+	SECTION("Dense symmetric eigensolver");
+	bdla_Mxf a, h, v;
+	bdla_Vxf lambda, mu;
+	float d[300], res, orth;
+	int i, j, ok, n;
+	int sizes[5] = { 1, 2, 33, 100, 300 };
+
+	lambda = bdla_Vxf_create(1);
+	mu = bdla_Vxf_create(1);
+	v = bdla_Mxf_create(1, 1);
+
+	/* Known spectra, small and large enough to split several times. */
+	for (i = 0; i < 5; ++i) {
+		n = sizes[i];
+		for (j = 0; j < n; ++j) { d[j] = (j % 2 ? -100.f : 100.f) / (j + 1); }
+		a = testEig_matrix(d, n, &h);
+		TEST(bdla_Mxf_eig_sym(a, BDLA_MATRIX_SYMMETRIC, &lambda, &v) == BDLA_GOOD);
+		TEST(bdla_Vxf_length(lambda) == n && bdla_Mxf_rows(v) == n && bdla_Mxf_cols(v) == n);
+		ok = 1;
+		for (j = 1; j < n; ++j) { ok = ok && bdla_Vxf_value(lambda, j - 1) <= bdla_Vxf_value(lambda, j); }
+		TEST(ok);
+		TEST(fabsf(bdla_Vxf_value(lambda, 0) - (n > 1 ? -50.f : 100.f)) < 1e-3f);
+		TEST(fabsf(bdla_Vxf_value(lambda, n - 1) - 100.f) < 1e-3f);
+		testEigSym_check(a, lambda, v, &res, &orth);
+		TEST(res < 1e-5f);
+		TEST(orth < 1e-5f);
+		/* Values only agree. */
+		TEST(bdla_Mxf_eig_sym(a, BDLA_MATRIX_SYMMETRIC, &mu, NULL) == BDLA_GOOD);
+		ok = 1;
+		for (j = 0; j < n; ++j) {
+			ok = ok && fabsf(bdla_Vxf_value(mu, j) - bdla_Vxf_value(lambda, j)) < 1e-4f;
+		}
+		TEST(ok);
+		bdla_Mxf_release(&a);
+		bdla_Mxf_release(&h);
+	}
+
+	/* Heavily repeated eigenvalues are all deflation. */
+	n = 200;
+	for (j = 0; j < n; ++j) { d[j] = (float)(j % 3); }
+	a = testEig_matrix(d, n, &h);
+	TEST(bdla_Mxf_eig_sym(a, BDLA_MATRIX_SYMMETRIC, &lambda, &v) == BDLA_GOOD);
+	TEST(fabsf(bdla_Vxf_value(lambda, 0)) < 1e-5f);
+	TEST(fabsf(bdla_Vxf_value(lambda, 100) - 1.f) < 1e-5f);
+	TEST(fabsf(bdla_Vxf_value(lambda, n - 1) - 2.f) < 1e-5f);
+	testEigSym_check(a, lambda, v, &res, &orth);
+	TEST(res < 1e-5f);
+	TEST(orth < 1e-5f);
+	bdla_Mxf_release(&a);
+	bdla_Mxf_release(&h);
+
+	/* A general symmetric matrix, given by its lower triangle only. */
+	n = 150;
+	a = bdla_Mxf_create(n, n);
+	h = bdla_Mxf_create(n, n);
+	for (i = 0; i < n; ++i) {
+		for (j = 0; j <= i; ++j) {
+			bdla_Mxf_writevalue(a, i, j, sinf(1.7f * i * j + 0.1f * i + 0.3f * j));
+			bdla_Mxf_writevalue(h, i, j, bdla_Mxf_value(a, i, j));
+			bdla_Mxf_writevalue(h, j, i, bdla_Mxf_value(a, i, j));
+			if (j < i) { bdla_Mxf_writevalue(a, j, i, 1e3f); }
+		}
+	}
+	TEST(bdla_Mxf_eig_sym(a, BDLA_MATRIX_SYMMETRIC, &lambda, &v) == BDLA_GOOD);
+	testEigSym_check(h, lambda, v, &res, &orth);
+	TEST(res < 1e-5f);
+	TEST(orth < 1e-5f);
+	/* The trace is the sum of the eigenvalues. */
+	res = 0.f;
+	for (i = 0; i < n; ++i) { res += bdla_Mxf_value(h, i, i) - bdla_Vxf_value(lambda, i); }
+	TEST(fabsf(res) < 1e-3f);
+
+	/* Bad arguments */
+	TEST(bdla_Mxf_eig_sym(a, BDLA_MATRIX_TRI_LOWER, &lambda, &v) == BDLA_BAD_PROPERTY);
+	bdla_Mxf_resize(&a, 3, 4);
+	TEST(bdla_Mxf_eig_sym(a, BDLA_MATRIX_SYMMETRIC, &lambda, NULL) == BDLA_NONSQUARE);
+
+	bdla_Mxf_release(&a);
+	bdla_Mxf_release(&h);
+	bdla_Mxf_release(&v);
+	bdla_Vxf_release(&lambda);
+	bdla_Vxf_release(&mu);
+}
+#endif /* BSV_TEST_EIGSYM_H */
@@ -0,0 +1,127 @@
+#ifndef BSV_TEST_EXPR_H
+#define BSV_TEST_EXPR_H
+/*============================================================================
+test_expr.h
+
+Test lazy fused elementwise expressions.
+
+Copyright(c) 2019 HJA Bird
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files(the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions :
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+============================================================================*/
+#include "../include/bdla/libbdla.h"
+
+#include <math.h>
+
+void testExpr(){
+	SECTION("Lazy expressions");
+	int i, n = 1000, ok;
+	int x, y, t, r;
+	float res;
+	double ref;
+	bdla_Vxf a = bdla_Vxf_create(n), b = bdla_Vxf_create(n), c = bdla_Vxf_create(1);
+	bdla_Mxf A = bdla_Mxf_create(20, 50), B = bdla_Mxf_create(2, 2), C = bdla_Mxf_create(4, 4);
+	bdla_Expr e;
+	for (i = 0; i < n; ++i) {
+		bdla_Vxf_writevalue(a, i, (float)i);
+		bdla_Vxf_writevalue(b, i, (float)(i % 7) - 3.f);
+	}
+
+	/* Chain */						/* y = |(2a + b) * b - 1| */
+	e = bdla_Expr_create();
+	x = bdla_Expr_vxf(&e, a);
+	y = bdla_Expr_vxf(&e, b);
+	t = bdla_Expr_axpy(&e, 2.f, x, y);
+	t = bdla_Expr_ewmult(&e, t, y);
+	t = bdla_Expr_fplus(&e, t, -1.f);
+	r = bdla_Expr_abs(&e, t);
+	TEST(r >= 0);
+	TEST(bdla_Expr_evalVxf(&e, r, &c) == BDLA_GOOD);
+	TEST(bdla_Vxf_length(c) == n);
+	for (ok = 1, i = 0; i < n; ++i) {
+		float av = (float)i, bv = (float)(i % 7) - 3.f;
+		ok &= bdla_Vxf_value(c, i) == fabsf((2.f * av + bv) * bv - 1.f);
+	}
+	TEST(ok);
+	/* Reductions */
+	TEST(bdla_Expr_reduce(&e, x, BDLA_REDUCE_SUM, &res) == BDLA_GOOD);
+	TEST(res == (float)(n * (n - 1) / 2));
+	t = bdla_Expr_minus(&e, x, y);
+	TEST(bdla_Expr_reduce(&e, t, BDLA_REDUCE_SUMSQ, &res) == BDLA_GOOD);
+	for (ref = 0., i = 0; i < n; ++i) {
+		double d = (double)i - ((i % 7) - 3.);
+		ref += d * d;
+	}
+	TEST(fabs(res - ref) / ref < 1e-6);
+	TEST(bdla_Expr_reduce(&e, y, BDLA_REDUCE_MAXABS, &res) == BDLA_GOOD);
+	TEST(res == 3.f);
+	/* Output aliasing an operand */
+	TEST(bdla_Expr_evalVxf(&e, t, &a) == BDLA_GOOD);
+	TEST(bdla_Vxf_value(a, 10) == 10.f);
+	TEST(bdla_Vxf_value(a, 11) == 10.f);
+
+	/* Matrices */
+	bdla_Mxf_uniform(&A, 4.f);
+	e = bdla_Expr_create();
+	x = bdla_Expr_mxf(&e, A);
+	t = bdla_Expr_sqrt(&e, x);
+	t = bdla_Expr_max(&e, t, bdla_Expr_const(&e, 3.f));
+	t = bdla_Expr_ewdiv(&e, t, bdla_Expr_fmult(&e, x, 0.5f));
+	TEST(bdla_Expr_evalMxf(&e, t, &B) == BDLA_GOOD);
+	TEST(bdla_Mxf_rows(B) == 20);
+	TEST(bdla_Mxf_cols(B) == 50);
+	TEST(bdla_Mxf_value(B, 19, 49) == 1.5f);
+	/* Vector leaves into a matrix of the same size */
+	e = bdla_Expr_create();
+	t = bdla_Expr_min(&e, bdla_Expr_vxf(&e, b), bdla_Expr_const(&e, 0.f));
+	TEST(bdla_Expr_evalMxf(&e, t, &C) == BDLA_DIMENSION_MISMATCH);
+	bdla_Mxf_resize(&C, 10, 100);
+	TEST(bdla_Expr_evalMxf(&e, t, &C) == BDLA_GOOD);
+	TEST(bdla_Mxf_value(C, 0, 0) == -3.f);
+	TEST(bdla_Mxf_value(C, 0, 6) == 0.f);
+
+	/* Errors are sticky */
+	e = bdla_Expr_create();
+	x = bdla_Expr_vxf(&e, b);
+	TEST(bdla_Expr_mxf(&e, C) == 1);		/* Same length is fine */
+	TEST(bdla_Expr_mxf(&e, A) == -1);	/* Different shape isn't */
+	e = bdla_Expr_create();
+	x = bdla_Expr_vxf(&e, b);
+	bdla_Mxf_resize(&B, 2, 2);
+	TEST(bdla_Expr_mxf(&e, B) == -1);
+	TEST(bdla_Expr_plus(&e, x, -1) == -1);
+	TEST(bdla_Expr_evalVxf(&e, x, &c) == BDLA_DIMENSION_MISMATCH);
+	e = bdla_Expr_create();
+	TEST(bdla_Expr_plus(&e, 0, 1) == -1);
+	TEST(bdla_Expr_reduce(&e, 0, BDLA_REDUCE_SUM, &res) == BDLA_BAD_INDEX);
+	e = bdla_Expr_create();
+	x = bdla_Expr_vxf(&e, b);
+	for (i = 1; i < BDLA_EXPR_MAX_NODES; ++i) { x = bdla_Expr_fplus(&e, x, 1.f); }
+	TEST(x == BDLA_EXPR_MAX_NODES - 1);
+	TEST(bdla_Expr_fplus(&e, x, 1.f) == -1);
+	TEST(bdla_Expr_evalVxf(&e, x, &c) == BDLA_MEM_ERROR);
+
+	bdla_Vxf_release(&a);
+	bdla_Vxf_release(&b);
+	bdla_Vxf_release(&c);
+	bdla_Mxf_release(&A);
+	bdla_Mxf_release(&B);
+	bdla_Mxf_release(&C);
+}
+#endif /* BSV_TEST_EXPR_H */
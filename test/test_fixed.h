@@ -0,0 +1,128 @@
+#ifndef BSV_TEST_FIXED_H
+#define BSV_TEST_FIXED_H
+/*============================================================================
+test_fixed.h
+
+Test functionality of the fixed size 2x2, 3x3 and 4x4 matrices.
+
+Copyright(c) 2019 HJA Bird
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files(the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions :
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+============================================================================*/
+#include "../include/bdla/libbdla.h"
+
+#include <math.h>
+
+void testFixed(){
+	SECTION("Fixed size matrix float");
+	int i;
+	float err;
+	bdla_M2f a2 = { { 4.f, 7.f, 2.f, 6.f } }, i2 = { { 0.f } };
+	bdla_V2f b2 = { { 1.f, 2.f } }, x2 = { { 0.f } };
+	bdla_M3f a3 = { { 2.f, -1.f, 0.f, -1.f, 2.f, -1.f, 0.f, -1.f, 2.f } }, i3 = { { 0.f } }, p3;
+	bdla_V3f b3 = { { 1.f, 0.f, 1.f } }, x3 = { { 0.f } };
+	bdla_M4f a4 = { { 4.f, 1.f, 0.f, 2.f,
+		1.f, 5.f, 1.f, 0.f,
+		0.f, 1.f, 6.f, 1.f,
+		2.f, 0.f, 1.f, 7.f } }, i4 = { { 0.f } }, p4, e4;
+	bdla_V4f b4 = { { 1.f, 2.f, 3.f, 4.f } }, x4 = { { 0.f } }, r4;
+	bdla_M3f s3 = { { 1.f, 2.f, 3.f, 2.f, 4.f, 6.f, 0.f, 1.f, 1.f } };
+
+	/* 2x2 */
+	TEST(bdla_M2f_det(&a2) == 10.f);
+	TEST(bdla_M2f_inverse(&a2, &i2) == BDLA_GOOD);
+	TEST(fabsf(i2.arr[0] - 0.6f) < 1e-6f);
+	TEST(fabsf(i2.arr[1] + 0.7f) < 1e-6f);
+	TEST(bdla_M2f_solve(&a2, &b2, &x2) == BDLA_GOOD);
+	TEST(fabsf(x2.arr[0] + 0.8f) < 1e-6f);
+	TEST(fabsf(x2.arr[1] - 0.6f) < 1e-6f);
+	/* 3x3 */
+	TEST(bdla_M3f_det(&a3) == 4.f);
+	TEST(bdla_M3f_det(&s3) == 0.f);
+	TEST(bdla_M3f_inverse(&s3, &i3) == BDLA_BAD_PROPERTY);
+	TEST(bdla_M3f_inverse(&a3, &i3) == BDLA_GOOD);
+	bdla_M3f_mult(&a3, &i3, &p3);
+	for (err = 0.f, i = 0; i < 9; ++i) {
+		err += fabsf(p3.arr[i] - (i % 4 == 0 ? 1.f : 0.f));
+	}
+	TEST(err < 1e-5f);
+	TEST(bdla_M3f_solve(&a3, &b3, &x3) == BDLA_GOOD);
+	TEST(fabsf(x3.arr[0] - 1.f) < 1e-6f);
+	TEST(fabsf(x3.arr[1] - 1.f) < 1e-6f);
+	TEST(fabsf(x3.arr[2] - 1.f) < 1e-6f);
+	bdla_M3f_transpose(&s3, &p3);
+	TEST(p3.arr[1] == 2.f && p3.arr[3] == 2.f && p3.arr[7] == 6.f);
+	bdla_M3f_transpose(&p3, &p3);
+	TEST(p3.arr[1] == 2.f && p3.arr[7] == 1.f);
+	/* 4x4 */
+	TEST(bdla_M4f_inverse(&a4, &i4) == BDLA_GOOD);
+	bdla_M4f_mult(&i4, &a4, &p4);
+	bdla_M4f_eye(&e4);
+	for (err = 0.f, i = 0; i < 16; ++i) {
+		err += fabsf(p4.arr[i] - e4.arr[i]);
+	}
+	TEST(err < 1e-5f);
+	TEST(fabsf(bdla_M4f_det(&a4) * bdla_M4f_det(&i4) - 1.f) < 1e-5f);
+	TEST(bdla_M4f_solve(&a4, &b4, &x4) == BDLA_GOOD);
+	bdla_M4f_vmult(&a4, &x4, &r4);
+	for (err = 0.f, i = 0; i < 4; ++i) {
+		err += fabsf(r4.arr[i] - b4.arr[i]);
+	}
+	TEST(err < 1e-5f);
+	/* Needs a row swap: the leading entry is zero. */
+	p4 = a4;
+	p4.arr[0] = 0.f;
+	TEST(bdla_M4f_solve(&p4, &b4, &x4) == BDLA_GOOD);
+	bdla_M4f_vmult(&p4, &x4, &r4);
+	for (err = 0.f, i = 0; i < 4; ++i) {
+		err += fabsf(r4.arr[i] - b4.arr[i]);
+	}
+	TEST(err < 1e-5f);
+	for (i = 0; i < 4; ++i) { p4.arr[4 * i + 2] = 0.f; }
+	TEST(bdla_M4f_solve(&p4, &b4, &x4) == BDLA_BAD_PROPERTY);
+	TEST(bdla_M3f_solve(&s3, &b3, &x3) == BDLA_BAD_PROPERTY);
+	/* Interoperability with the variable sized types */
+	{
+		bdla_Mxf ma = bdla_M4f_asMxf(&a4);
+		bdla_Mxf mi = bdla_M4f_asMxf(&i4);
+		bdla_Mxf mp = bdla_Mxf_create(4, 4);
+		bdla_Vxf vb = bdla_V4f_asVxf(&b4);
+		bdla_Vxf vr = bdla_Vxf_create(4);
+		TEST(bdla_Mxf_rows(ma) == 4);
+		TEST(bdla_Mxf_value(ma, 3, 0) == 2.f);
+		bdla_Mxf_mult(ma, mi, &mp);
+		TEST(fabsf(bdla_Mxf_value(mp, 2, 2) - 1.f) < 1e-5f);
+		bdla_Mxf_vmult(ma, vb, &vr);
+		bdla_M4f_vmult(&a4, &b4, &r4);
+		TEST(fabsf(bdla_Vxf_value(vr, 3) - r4.arr[3]) < 1e-5f);
+		TEST(bdla_M4f_fromMxf(mp, &p4) == BDLA_GOOD);
+		TEST(p4.arr[5] == bdla_Mxf_value(mp, 1, 1));
+		TEST(bdla_M3f_fromMxf(mp, &p3) == BDLA_DIMENSION_MISMATCH);
+		/* In place through a view writes back into the fixed size object. */
+		TEST(bdla_Mxf_vmult(ma, vb, &vb) == BDLA_GOOD);
+		TEST(vb.arr == b4.arr);
+		for (err = 0.f, i = 0; i < 4; ++i) {
+			err += fabsf(b4.arr[i] - r4.arr[i]);
+		}
+		TEST(err < 1e-5f);
+		bdla_Mxf_release(&mp);
+		bdla_Vxf_release(&vr);
+	}
+}
+#endif /* BSV_TEST_FIXED_H */
@@ -0,0 +1,182 @@
+#ifndef BSV_TEST_QR_H
+#define BSV_TEST_QR_H
+/*============================================================================
+test_qr.h
+
+Test blocked Householder QR and least squares.
+
+Copyright(c) 2019 HJA Bird
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files(the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions :
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+============================================================================*/
+#include "../include/bdla/libbdla.h"
+
+#include <math.h>
+
+static bdla_Mxf testQR_matrix(int m, int n) {
+	bdla_Mxf a = bdla_Mxf_create(m, n);
+	int i, j;
+	for (i = 0; i < m; ++i) {
+		for (j = 0; j < n; ++j) {
+			bdla_Mxf_writevalue(a, i, j, sinf(0.7f * i + 1.3f * j * j + 0.2f) + (i == j ? 2.f : 0.f));
+		}
+	}
+	return a;
+}
+
+void testQR(){
+	SECTION("QR factorisation and least squares");
+	bdla_Mxf a, qr, t, b, x;
+	bdla_Vxf v, w, r;
+	float worst, norm;
+	int i, j, k, m, n, ok;
+	/* Square, several blocks with a partial last one, wide, and one block. */
+	int shapes[5][2] = { { 1, 1 }, { 50, 50 }, { 200, 70 }, { 70, 200 }, { 100, 33 } };
+
+	t = bdla_Mxf_create(1, 1);
+	b = bdla_Mxf_create(1, 1);
+	v = bdla_Vxf_create(1);
+	w = bdla_Vxf_create(1);
+
+	for (i = 0; i < 5; ++i) {
+		m = shapes[i][0];
+		n = shapes[i][1];
+		k = m < n ? m : n;
+		a = testQR_matrix(m, n);
+		qr = bdla_Mxf_copy(a);
+		TEST(bdla_Mxf_qr(&qr, &t) == BDLA_GOOD);
+		TEST(bdla_Mxf_cols(t) == k && bdla_Mxf_rows(t) == (k < 32 ? k : 32));
+		/* Q^T A is R. */
+		bdla_Mxf_release(&b);
+		b = bdla_Mxf_copy(a);
+		TEST(bdla_Mxf_qtmult(qr, t, &b) == BDLA_GOOD);
+		worst = 0.f;
+		for (j = 0; j < m * n; ++j) {
+			norm = j / n <= j % n ? qr.arr[j] : 0.f;
+			worst = fmaxf(worst, fabsf(b.arr[j] - norm));
+		}
+		TEST(worst < 1e-4f * sqrtf((float)m));
+		/* Q^T keeps lengths, and does the same to a vector as to a column. */
+		bdla_Vxf_resize(&v, m);
+		bdla_Mxf_col(a, n - 1, &v);
+		norm = bdla_Vxf_norm2(v);
+		TEST(bdla_Mxf_vqtmult(qr, t, &v) == BDLA_GOOD);
+		TEST(fabsf(bdla_Vxf_norm2(v) - norm) < 1e-5f * norm);
+		ok = 1;
+		for (j = 0; j < m; ++j) {
+			ok = ok && fabsf(bdla_Vxf_value(v, j) - bdla_Mxf_value(b, j, n - 1)) < 1e-5f * norm;
+		}
+		TEST(ok);
+		bdla_Mxf_release(&a);
+		bdla_Mxf_release(&qr);
+	}
+
+	/* A consistent overdetermined system is solved exactly. */
+	m = 300;
+	n = 40;
+	a = testQR_matrix(m, n);
+	x = bdla_Mxf_create(n, 2);
+	for (j = 0; j < n; ++j) {
+		bdla_Mxf_writevalue(x, j, 0, 1.f + j);
+		bdla_Mxf_writevalue(x, j, 1, cosf((float)j));
+	}
+	bdla_Mxf_resize(&b, m, 2);
+	bdla_Mxf_mult(a, x, &b);
+	qr = bdla_Mxf_copy(a);
+	TEST(bdla_Mxf_qr(&qr, &t) == BDLA_GOOD);
+	TEST(bdla_Mxf_qrsolve(qr, t, &b) == BDLA_GOOD);
+	worst = 0.f;
+	for (j = 0; j < n; ++j) {
+		worst = fmaxf(worst, fabsf(bdla_Mxf_value(b, j, 0) - bdla_Mxf_value(x, j, 0)) / n);
+		worst = fmaxf(worst, fabsf(bdla_Mxf_value(b, j, 1) - bdla_Mxf_value(x, j, 1)));
+	}
+	TEST(worst < 1e-4f);
+	worst = 0.f;
+	for (j = n; j < m; ++j) { worst = fmaxf(worst, fabsf(bdla_Mxf_value(b, j, 0))); }
+	TEST(worst < 1e-3f);
+
+	/* An inconsistent one leaves a residual orthogonal to A's columns. */
+	bdla_Vxf_resize(&v, m);
+	for (j = 0; j < m; ++j) { bdla_Vxf_writevalue(v, j, sinf(3.1f * j)); }
+	bdla_Vxf_release(&w);
+	w = bdla_Vxf_copy(v);
+	TEST(bdla_Mxf_vqrsolve(qr, t, &w) == BDLA_GOOD);
+	TEST(bdla_Vxf_length(w) == m);
+	norm = 0.f;
+	for (j = n; j < m; ++j) { norm += bdla_Vxf_value(w, j) * bdla_Vxf_value(w, j); }
+	bdla_Vxf_resize(&w, n);
+	r = bdla_Vxf_create(m);
+	bdla_Mxf_vmult(a, w, &r);
+	bdla_Vxf_minus(r, v, &r);
+	TEST(fabsf(bdla_Vxf_norm2(r) - sqrtf(norm)) < 1e-4f * sqrtf(norm));
+	bdla_Mxf_gemv(1.f, a, BDLA_TRANS, r, 0.f, &w);
+	TEST(bdla_Vxf_norm2(w) < 1e-3f);
+
+	/* Polynomial fitting, where the normal equations lose most digits. */
+	bdla_Mxf_release(&a);
+	bdla_Mxf_release(&qr);
+	m = 100;
+	n = 7;
+	a = bdla_Mxf_create(m, n);
+	bdla_Vxf_resize(&v, m);
+	for (i = 0; i < m; ++i) {
+		float s = (float)i / (m - 1), p = 1.f, y = 0.f;
+		for (j = 0; j < n; ++j) {
+			bdla_Mxf_writevalue(a, i, j, p);
+			y += p / (j + 1);
+			p *= s;
+		}
+		bdla_Vxf_writevalue(v, i, y);
+	}
+	qr = bdla_Mxf_copy(a);
+	TEST(bdla_Mxf_qr(&qr, &t) == BDLA_GOOD);
+	TEST(bdla_Mxf_vqrsolve(qr, t, &v) == BDLA_GOOD);
+	worst = 0.f;
+	for (j = 0; j < n; ++j) { worst = fmaxf(worst, fabsf(bdla_Vxf_value(v, j) - 1.f / (j + 1))); }
+	TEST(worst < 2e-2f);
+
+	/* Rank deficient, mismatched and wide problems. */
+	for (i = 0; i < m; ++i) { bdla_Mxf_writevalue(a, i, 3, 0.f); }
+	bdla_Mxf_release(&qr);
+	qr = bdla_Mxf_copy(a);
+	TEST(bdla_Mxf_qr(&qr, &t) == BDLA_GOOD);
+	bdla_Vxf_resize(&v, m);
+	TEST(bdla_Mxf_vqrsolve(qr, t, &v) == BDLA_BAD_PROPERTY);
+	bdla_Vxf_resize(&v, m + 1);
+	TEST(bdla_Mxf_vqtmult(qr, t, &v) == BDLA_DIMENSION_MISMATCH);
+	bdla_Mxf_resize(&b, m, 3);
+	bdla_Mxf_resize(&t, 7, 6);
+	TEST(bdla_Mxf_qtmult(qr, t, &b) == BDLA_DIMENSION_MISMATCH);
+	bdla_Mxf_release(&qr);
+	qr = testQR_matrix(5, 8);
+	TEST(bdla_Mxf_qr(&qr, &t) == BDLA_GOOD);
+	bdla_Vxf_resize(&v, 5);
+	TEST(bdla_Mxf_vqrsolve(qr, t, &v) == BDLA_DIMENSION_MISMATCH);
+
+	bdla_Mxf_release(&a);
+	bdla_Mxf_release(&qr);
+	bdla_Mxf_release(&t);
+	bdla_Mxf_release(&b);
+	bdla_Mxf_release(&x);
+	bdla_Vxf_release(&v);
+	bdla_Vxf_release(&w);
+	bdla_Vxf_release(&r);
+}
+
+#endif /* BSV_TEST_QR_H */
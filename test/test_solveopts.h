@@ -0,0 +1,186 @@
+#ifndef BSV_TEST_SOLVEOPTS_H
+#define BSV_TEST_SOLVEOPTS_H
+/*============================================================================
+test_solveopts.h
+
+Test the solver options and results of the *_ext linear solvers.
+
+Copyright(c) 2019 HJA Bird
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files(the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions :
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+============================================================================*/
+#include "../include/bdla/libbdla.h"
+
+/* Stops the solve at the iteration *data says. */
+static int testSolveOptions_stopat(const bdla_SolveRecord *record, void *data) {
+	return record->iteration >= *(int *)data;
+}
+
+void testSolveOptions(){
+	SECTION("Solver options and results");
+	bdla_Mxf a;
+	bdla_SMxf s;
+	bdla_HMxf h;
+	bdla_Vxf x, b, y, e;
+	bdla_SolveOptions opts;
+	bdla_SolveResult res;
+	bdla_SolveHistory hist;
+	bdla_SolveRecord records[8];
+	float rnorm;
+	int i, ok, stopat, n = 100;
+	/* Diagonally dominant and positive definite, so every solver applies. */
+	a = bdla_Mxf_create(n, n);
+	bdla_Mxf_zero(&a);
+	for (i = 0; i < n; ++i) {
+		bdla_Mxf_writevalue(a, i, i, 4.f);
+		if (i > 0) { bdla_Mxf_writevalue(a, i, i - 1, -1.f); }
+		if (i < n - 1) { bdla_Mxf_writevalue(a, i, i + 1, -1.f); }
+	}
+	bdla_SMxf_fromMxf(a, &s);
+	bdla_HMxf_fromMxf(a, BDLA_HALF_FP16, &h);
+	x = bdla_Vxf_create(n);
+	b = bdla_Vxf_create(n);
+	y = bdla_Vxf_create(n);
+	e = bdla_Vxf_create(n);
+	for (i = 0; i < n; ++i) { bdla_Vxf_writevalue(x, i, (float)(i % 7) - 3.f); }
+	bdla_Mxf_vmult(a, x, &b);
+
+	/* Defaults, and testing only every fifth iteration. */
+	opts = bdla_SolveOptions_default();
+	TEST(bdla_Mxf_solve_jacobi_ext(a, b, &y, NULL, &opts, &res) == BDLA_GOOD);
+	TEST(res.reason == BDLA_STOP_CONVERGED);
+	TEST(res.residual <= 1e-6f * bdla_Vxf_norm2(b));
+	i = res.iterations;
+	opts.check_every = 5;
+	TEST(bdla_Mxf_solve_jacobi_ext(a, b, &y, NULL, &opts, &res) == BDLA_GOOD);
+	TEST(res.reason == BDLA_STOP_CONVERGED);
+	TEST(res.iterations % 5 == 0);
+	TEST(res.iterations >= i && res.iterations < i + 5);
+	bdla_Vxf_minus(y, x, &e);
+	TEST(bdla_Vxf_norm2(e) / bdla_Vxf_norm2(x) < 1e-5f);
+	TEST(bdla_SMxf_solve_jacobi_ext(s, b, &y, NULL, &opts, &res) == BDLA_GOOD);
+	TEST(res.reason == BDLA_STOP_CONVERGED && res.iterations % 5 == 0);
+	TEST(bdla_Mxf_solve_gauss_seidel_ext(a, b, &y, NULL, &opts, &res) == BDLA_GOOD);
+	TEST(res.reason == BDLA_STOP_CONVERGED && res.iterations % 5 == 0);
+	TEST(res.residual <= 1e-6f * bdla_Vxf_norm2(b));
+
+	/* The update criterion, where the reported residual is measured at
+	the end. */
+	opts = bdla_SolveOptions_default();
+	opts.test = BDLA_CONVERGE_UPDATE;
+	opts.rtol = 1e-7f;
+	TEST(bdla_Mxf_solve_jacobi_ext(a, b, &y, NULL, &opts, &res) == BDLA_GOOD);
+	TEST(res.reason == BDLA_STOP_CONVERGED);
+	bdla_Mxf_residual(a, y, b, NULL, &rnorm);
+	TEST(fabsf(res.residual - rnorm) <= 1e-3f * rnorm + 1e-6f);
+	bdla_Vxf_minus(y, x, &e);
+	TEST(bdla_Vxf_norm2(e) / bdla_Vxf_norm2(x) < 1e-5f);
+	TEST(bdla_SMxf_solve_gauss_seidel_ext(s, b, &y, NULL, &opts, &res) == BDLA_GOOD);
+	TEST(res.reason == BDLA_STOP_CONVERGED);
+	bdla_Vxf_minus(y, x, &e);
+	TEST(bdla_Vxf_norm2(e) / bdla_Vxf_norm2(x) < 1e-5f);
+	TEST(bdla_HMxf_solve_jacobi_ext(h, b, &y, NULL, &opts, &res) == BDLA_GOOD);
+	TEST(res.reason == BDLA_STOP_CONVERGED);
+	bdla_Vxf_minus(y, x, &e);
+	TEST(bdla_Vxf_norm2(e) / bdla_Vxf_norm2(x) < 1e-5f);
+	TEST(bdla_Mxf_solve_cg_ext(a, b, &y, NULL, &opts, &res) == BDLA_GOOD);
+	TEST(res.reason == BDLA_STOP_CONVERGED);
+	bdla_Vxf_minus(y, x, &e);
+	TEST(bdla_Vxf_norm2(e) / bdla_Vxf_norm2(x) < 1e-5f);
+
+	/* An absolute tolerance only. */
+	opts = bdla_SolveOptions_default();
+	opts.rtol = 0.f;
+	opts.atol = 1e-2f;
+	TEST(bdla_SMxf_solve_cg_ext(s, b, &y, NULL, &opts, &res) == BDLA_GOOD);
+	TEST(res.reason == BDLA_STOP_CONVERGED);
+	TEST(res.residual <= 1e-2f);
+
+	/* Running out of iterations is told apart from converging. */
+	opts = bdla_SolveOptions_default();
+	opts.max_iter = 3;
+	TEST(bdla_Mxf_solve_jacobi_ext(a, b, &y, NULL, &opts, &res) == BDLA_GOOD);
+	TEST(res.reason == BDLA_STOP_MAX_ITER);
+	TEST(res.iterations == 3);
+	bdla_Mxf_residual(a, y, b, NULL, &rnorm);
+	TEST(fabsf(res.residual - rnorm) <= 1e-3f * rnorm);
+	TEST(bdla_HMxf_solve_cg_ext(h, b, &y, NULL, &opts, &res) == BDLA_GOOD);
+	TEST(res.reason == BDLA_STOP_MAX_ITER && res.iterations == 3);
+
+	/* And so is running out of time. */
+	opts = bdla_SolveOptions_default();
+	opts.rtol = 0.f;
+	opts.time_limit = 1e-9;
+	TEST(bdla_Mxf_solve_gauss_seidel_ext(a, b, &y, NULL, &opts, &res) == BDLA_GOOD);
+	TEST(res.reason == BDLA_STOP_TIME_LIMIT);
+	TEST(res.iterations == 1);
+
+	/* Telemetry: the history keeps the latest iterations, and the callback
+	can stop the solve. */
+	opts = bdla_SolveOptions_default();
+	hist.records = records;
+	hist.capacity = 8;
+	hist.count = 0;
+	opts.history = &hist;
+	TEST(bdla_Mxf_solve_jacobi_ext(a, b, &y, NULL, &opts, &res) == BDLA_GOOD);
+	TEST(res.reason == BDLA_STOP_CONVERGED);
+	TEST(hist.count == res.iterations && hist.count > 8);
+	ok = 1;
+	for (i = hist.count - 8; i < hist.count; ++i) {
+		ok &= records[i % 8].iteration == i + 1;
+		ok &= records[i % 8].residual > 0.f && records[i % 8].update == -1.f;
+		ok &= records[i % 8].elapsed >= 0.;
+		if (i > hist.count - 8) {
+			ok &= records[i % 8].residual < records[(i - 1) % 8].residual;
+			ok &= records[i % 8].elapsed >= records[(i - 1) % 8].elapsed;
+		}
+	}
+	TEST(ok);
+	TEST(records[(hist.count - 1) % 8].residual == res.residual);
+	stopat = 4;
+	hist.count = 0;
+	opts.check_every = 2;
+	opts.callback = testSolveOptions_stopat;
+	opts.callback_data = &stopat;
+	TEST(bdla_SMxf_solve_gauss_seidel_ext(s, b, &y, NULL, &opts, &res) == BDLA_GOOD);
+	TEST(res.reason == BDLA_STOP_CALLBACK && res.iterations == 4);
+	TEST(hist.count == 4);
+	TEST(records[0].residual == -1.f && records[1].residual > 0.f);
+	TEST(records[2].update > 0.f);
+	hist.count = 0;
+	TEST(bdla_HMxf_solve_cg_ext(h, b, &y, NULL, &opts, &res) == BDLA_GOOD);
+	TEST(res.reason == BDLA_STOP_CALLBACK && hist.count == 4);
+
+	/* A guess that is already the answer needs no iterations of CG, and
+	NULL options and result are allowed. */
+	TEST(bdla_Mxf_solve_cg_ext(a, b, &y, &x, NULL, &res) == BDLA_GOOD);
+	TEST(res.reason == BDLA_STOP_CONVERGED && res.iterations == 0);
+	TEST(bdla_Mxf_solve_jacobi_ext(a, b, &y, NULL, NULL, NULL) == BDLA_GOOD);
+	bdla_Vxf_minus(y, x, &e);
+	TEST(bdla_Vxf_norm2(e) / bdla_Vxf_norm2(x) < 1e-5f);
+
+	bdla_Mxf_release(&a);
+	bdla_SMxf_release(&s);
+	bdla_HMxf_release(&h);
+	bdla_Vxf_release(&x);
+	bdla_Vxf_release(&b);
+	bdla_Vxf_release(&y);
+	bdla_Vxf_release(&e);
+}
+#endif /* BSV_TEST_SOLVEOPTS_H */
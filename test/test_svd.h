@@ -0,0 +1,190 @@
+#ifndef BSV_TEST_SVD_H
+#define BSV_TEST_SVD_H
+/*============================================================================
+test_svd.h
+
+Test the singular value decomposition.
+
+Copyright(c) 2019 HJA Bird
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files(the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions :
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+============================================================================*/
+#include "../include/bdla/libbdla.h"
+
+#include <math.h>
+
+/* An m x n matrix with singular values s, as Hm [diag(s); 0] Hn for
+reflections Hm and Hn. */
+static bdla_Mxf testSvd_matrix(const float *s, int m, int n) {
+	bdla_Mxf a = bdla_Mxf_create(m, n), hm, hn, t;
+	float ones[300];
+	int i, j, k = m < n ? m : n;
+	for (i = 0; i < 300; ++i) { ones[i] = 1.f; }
+	t = testEig_matrix(ones, m, &hm);
+	bdla_Mxf_release(&t);
+	t = testEig_matrix(ones, n, &hn);
+	bdla_Mxf_release(&t);
+	t = bdla_Mxf_create(m, n);
+	bdla_Mxf_zero(&t);
+	for (i = 0; i < m; ++i) {
+		for (j = 0; j < k; ++j) { bdla_Mxf_writevalue(t, i, j, bdla_Mxf_value(hm, i, j) * s[j]); }
+	}
+	bdla_Mxf_mult(t, hn, &a);
+	bdla_Mxf_release(&t);
+	bdla_Mxf_release(&hm);
+	bdla_Mxf_release(&hn);
+	return a;
+}
+
+/* max |U^T U - I| over the k x k result. */
+static float testSvd_orth(bdla_Mxf u) {
+	int i, j, k = bdla_Mxf_cols(u);
+	float worst = 0.f, t;
+	bdla_Mxf utu = bdla_Mxf_create(k, k);
+	bdla_Mxf_gemm(1.f, u, BDLA_TRANS, u, BDLA_NO_TRANS, 0.f, &utu);
+	for (i = 0; i < k; ++i) {
+		for (j = 0; j < k; ++j) {
+			t = fabsf(bdla_Mxf_value(utu, i, j) - (i == j ? 1.f : 0.f));
+			worst = t <= worst ? worst : t;	/* Keeps a NaN. */
+		}
+	}
+	bdla_Mxf_release(&utu);
+	return worst;
+}
+
+/* max |A - U diag(s) V^T| / s_0. */
+static float testSvd_residual(bdla_Mxf a, bdla_Vxf s, bdla_Mxf u, bdla_Mxf v) {
+	int i, j, m = bdla_Mxf_rows(a), n = bdla_Mxf_cols(a), k = bdla_Vxf_length(s);
+	float worst = 0.f, t;
+	bdla_Mxf us = bdla_Mxf_create(m, k), usv = bdla_Mxf_create(m, n);
+	for (i = 0; i < m; ++i) {
+		for (j = 0; j < k; ++j) {
+			bdla_Mxf_writevalue(us, i, j, bdla_Mxf_value(u, i, j) * bdla_Vxf_value(s, j));
+		}
+	}
+	bdla_Mxf_gemm(1.f, us, BDLA_NO_TRANS, v, BDLA_TRANS, 0.f, &usv);
+	for (i = 0; i < m; ++i) {
+		for (j = 0; j < n; ++j) {
+			t = fabsf(bdla_Mxf_value(a, i, j) - bdla_Mxf_value(usv, i, j));
+			worst = t <= worst ? worst : t;	/* Keeps a NaN. */
+		}
+	}
+	bdla_Mxf_release(&us);
+	bdla_Mxf_release(&usv);
+	return worst / bdla_Vxf_value(s, 0);
+}
+
+void testSvd(){
+	SECTION("Singular value decomposition");
+	bdla_Mxf a, u, v;
+	bdla_Vxf s, t;
+	float sv[300], worst;
+	int i, j, k, m, n, ok;
+	/* Tall and wide, square, long enough for the QR first, and near square. */
+	int shapes[8][2] = { { 1, 1 }, { 5, 1 }, { 1, 5 }, { 40, 40 },
+		{ 300, 20 }, { 20, 300 }, { 60, 45 }, { 45, 60 } };
+
+	s = bdla_Vxf_create(1);
+	t = bdla_Vxf_create(1);
+	u = bdla_Mxf_create(1, 1);
+	v = bdla_Mxf_create(1, 1);
+
+	for (i = 0; i < 8; ++i) {
+		m = shapes[i][0];
+		n = shapes[i][1];
+		k = m < n ? m : n;
+		/* Out of order, so they have to be sorted. */
+		for (j = 0; j < k; ++j) { sv[j] = 1.f + (float)(7 * j % k); }
+		a = testSvd_matrix(sv, m, n);
+		TEST(bdla_Mxf_svd(a, &s, &u, &v) == BDLA_GOOD);
+		TEST(bdla_Vxf_length(s) == k && bdla_Mxf_rows(u) == m && bdla_Mxf_cols(u) == k
+			&& bdla_Mxf_rows(v) == n && bdla_Mxf_cols(v) == k);
+		ok = 1;
+		for (j = 0; j < k; ++j) { ok = ok && fabsf(bdla_Vxf_value(s, j) - (float)(k - j)) < 1e-4f * k; }
+		TEST(ok);
+		TEST(testSvd_residual(a, s, u, v) < 1e-5f);
+		TEST(testSvd_orth(u) < 1e-5f && testSvd_orth(v) < 1e-5f);
+		/* Values only, and one side only, agree. */
+		TEST(bdla_Mxf_svd(a, &t, NULL, NULL) == BDLA_GOOD);
+		worst = 0.f;
+		for (j = 0; j < k; ++j) {
+			worst = fmaxf(worst, fabsf(bdla_Vxf_value(t, j) - bdla_Vxf_value(s, j)));
+		}
+		TEST(worst < 1e-4f * k);
+		TEST(bdla_Mxf_svd(a, &t, NULL, &v) == BDLA_GOOD);
+		TEST(testSvd_orth(v) < 1e-5f);
+		TEST(bdla_Mxf_svd(a, &t, &u, NULL) == BDLA_GOOD);
+		TEST(testSvd_orth(u) < 1e-5f);
+		bdla_Mxf_release(&a);
+	}
+
+	/* Rank deficient: U still has orthonormal columns. */
+	for (j = 0; j < 30; ++j) { sv[j] = j < 20 ? 1.f + j : 0.f; }
+	a = testSvd_matrix(sv, 50, 30);
+	TEST(bdla_Mxf_svd(a, &s, &u, &v) == BDLA_GOOD);
+	TEST(fabsf(bdla_Vxf_value(s, 0) - 20.f) < 1e-3f && bdla_Vxf_value(s, 29) < 1e-4f);
+	TEST(testSvd_residual(a, s, u, v) < 1e-5f);
+	TEST(testSvd_orth(u) < 1e-5f && testSvd_orth(v) < 1e-5f);
+	bdla_Mxf_release(&a);
+
+	/* Rank one, where the reflectors meet columns that are zero but for
+	rounding, and must not overflow on them. */
+	for (i = 0; i < 6; ++i) {
+		int rshapes[6][2] = { { 17, 9 }, { 19, 9 }, { 31, 9 }, { 17, 10 }, { 34, 9 }, { 50, 20 } };
+		m = rshapes[i][0];
+		n = rshapes[i][1];
+		a = bdla_Mxf_create(m, n);
+		for (j = 0; j < m * n; ++j) { a.arr[j] = (float)(j / n + 1) * (float)(j % n % 3 + 1); }
+		TEST(bdla_Mxf_svd(a, &s, &u, &v) == BDLA_GOOD);
+		for (ok = 1, j = 0; j < bdla_Vxf_length(s); ++j) { ok = ok && isfinite(bdla_Vxf_value(s, j)); }
+		TEST(ok);
+		TEST(testSvd_residual(a, s, u, v) < 1e-5f);
+		TEST(bdla_Mxf_svd(a, &t, NULL, NULL) == BDLA_GOOD);
+		TEST(fabsf(bdla_Vxf_value(t, 0) - bdla_Vxf_value(s, 0)) < 1e-4f * bdla_Vxf_value(s, 0));
+		bdla_Mxf_release(&a);
+	}
+
+	/* Exactly zero. */
+	a = bdla_Mxf_create(6, 4);
+	bdla_Mxf_zero(&a);
+	TEST(bdla_Mxf_svd(a, &s, &u, &v) == BDLA_GOOD);
+	TEST(bdla_Vxf_value(s, 0) == 0.f);
+	TEST(testSvd_orth(u) < 1e-6f && testSvd_orth(v) < 1e-6f);
+	bdla_Mxf_release(&a);
+
+	/* Tall enough to be streamed in several blocks. */
+	a = bdla_Mxf_create(1000, 8);
+	for (i = 0; i < 1000; ++i) {
+		for (j = 0; j < 8; ++j) { bdla_Mxf_writevalue(a, i, j, sinf(0.37f * i * (j + 1) + j)); }
+	}
+	TEST(bdla_Mxf_svd(a, &s, &u, &v) == BDLA_GOOD);
+	TEST(testSvd_residual(a, s, u, v) < 1e-5f);
+	TEST(bdla_Mxf_svd(a, &t, NULL, NULL) == BDLA_GOOD);
+	worst = 0.f;
+	for (j = 0; j < 8; ++j) { worst = fmaxf(worst, fabsf(bdla_Vxf_value(t, j) - bdla_Vxf_value(s, j))); }
+	TEST(worst < 1e-4f * bdla_Vxf_value(s, 0));
+	bdla_Mxf_release(&a);
+
+	bdla_Vxf_release(&s);
+	bdla_Vxf_release(&t);
+	bdla_Mxf_release(&u);
+	bdla_Mxf_release(&v);
+}
+
+#endif /* BSV_TEST_SVD_H */
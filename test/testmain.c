@@ -61,11 +61,41 @@ void section(char section_name[]){
 #include "test_blasMxf.h"
 #include "test_jacobi.h"
 #include "test_gauss_seidel.h"
+#include "test_blasSMxf.h"
+#include "test_blasBMxf.h"
+#include "test_fixed.h"
+#include "test_expr.h"
+#include "test_async.h"
+#include "test_blasHMxf.h"
+#include "test_cg.h"
+#include "test_chebyshev.h"
+#include "test_solveopts.h"
+#include "test_blasQMxf.h"
+#include "test_eigsolve.h"
+#include "test_eigsym.h"
+#include "test_svd.h"
+#include "test_qr.h"
+#include "test_covariance.h"
 
 int main(int argc, char* argv[]){
 	testVxf();
 	testMxf();
 	testJacobi();
 	testGaussSeidel();
+	testSMxf();
+	testBMxf();
+	testFixed();
+	testExpr();
+	testAsync();
+	testHMxf();
+	testCG();
+	testChebyshev();
+	testSolveOptions();
+	testQMxf();
+	testEigsolve();
+	testEigSym();
+	testSvd();
+	testQR();
+	testCovariance();
     SECTION("Ending!");
 }